@@ -0,0 +1,304 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+#include "BVH.h"
+
+#define cBVHBins 16
+
+namespace
+{
+struct Box {
+  float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  void add(const float *lo, const float *hi)
+  {
+    for (int a = 0; a < 3; ++a) {
+      min[a] = std::min(min[a], lo[a]);
+      max[a] = std::max(max[a], hi[a]);
+    }
+  }
+
+  void add(const Box &other) { add(other.min, other.max); }
+
+  float area() const
+  {
+    if (min[0] > max[0])
+      return 0.0F;
+    float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+    return dx * dy + dy * dz + dz * dx;
+  }
+};
+
+struct BuildTask {
+  int node, begin, end, depth;
+};
+} // namespace
+
+bool BVHType::build(int n, const float *bounds, const int *ids, int max_leaf)
+{
+  Nodes.clear();
+  EList.clear();
+  EList.push_back(-1);
+
+  if (n <= 0)
+    return true;
+
+  if (max_leaf < 1)
+    max_leaf = 1;
+
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+
+  std::vector<float> centroid(3 * n);
+  for (int i = 0; i < n; ++i) {
+    const float *b = bounds + 6 * i;
+    for (int a = 0; a < 3; ++a)
+      centroid[3 * i + a] = 0.5F * (b[a] + b[a + 3]);
+  }
+
+  Nodes.reserve(2 * (n / max_leaf) + 1);
+  EList.reserve(n + n / max_leaf + 2);
+  Nodes.emplace_back();
+
+  std::vector<BuildTask> stack;
+  stack.push_back({0, 0, n, 0});
+
+  while (!stack.empty()) {
+    BuildTask task = stack.back();
+    stack.pop_back();
+
+    Box box, cbox;
+    for (int k = task.begin; k < task.end; ++k) {
+      int i = order[k];
+      box.add(bounds + 6 * i, bounds + 6 * i + 3);
+      cbox.add(centroid.data() + 3 * i, centroid.data() + 3 * i);
+    }
+
+    int count = task.end - task.begin;
+    int axis = 0;
+    for (int a = 1; a < 3; ++a) {
+      if (cbox.max[a] - cbox.min[a] > cbox.max[axis] - cbox.min[axis])
+        axis = a;
+    }
+    float extent = cbox.max[axis] - cbox.min[axis];
+
+    int mid = -1;
+
+    if (count > max_leaf && task.depth < cBVHMaxDepth && extent > 0.0F) {
+      /* binned SAH along the widest centroid axis */
+      Box bin_box[cBVHBins];
+      int bin_count[cBVHBins] = {0};
+      const float scale = cBVHBins / extent * 0.9999F;
+
+      auto bin_of = [&](int i) {
+        int b = (int) ((centroid[3 * i + axis] - cbox.min[axis]) * scale);
+        return std::min(std::max(b, 0), cBVHBins - 1);
+      };
+
+      for (int k = task.begin; k < task.end; ++k) {
+        int i = order[k];
+        int b = bin_of(i);
+        bin_count[b]++;
+        bin_box[b].add(bounds + 6 * i, bounds + 6 * i + 3);
+      }
+
+      float right_area[cBVHBins];
+      int right_count[cBVHBins];
+      {
+        Box acc;
+        int cnt = 0;
+        for (int b = cBVHBins - 1; b > 0; --b) {
+          acc.add(bin_box[b]);
+          cnt += bin_count[b];
+          right_area[b] = acc.area();
+          right_count[b] = cnt;
+        }
+      }
+
+      float best_cost = FLT_MAX;
+      int best_split = -1;
+      {
+        Box acc;
+        int cnt = 0;
+        for (int b = 0; b < cBVHBins - 1; ++b) {
+          acc.add(bin_box[b]);
+          cnt += bin_count[b];
+          if (!cnt || !right_count[b + 1])
+            continue;
+          float cost = acc.area() * cnt + right_area[b + 1] * right_count[b + 1];
+          if (cost < best_cost) {
+            best_cost = cost;
+            best_split = b;
+          }
+        }
+      }
+
+      if (best_split >= 0) {
+        /* relative cost of a leaf vs. one traversal step plus the children */
+        float leaf_cost = box.area() * count;
+        if (best_cost + box.area() < leaf_cost || count > 4 * max_leaf) {
+          auto it = std::partition(order.begin() + task.begin,
+              order.begin() + task.end,
+              [&](int i) { return bin_of(i) <= best_split; });
+          mid = it - order.begin();
+        }
+      }
+
+      if (mid <= task.begin || mid >= task.end) {
+        if (count > 4 * max_leaf) {
+          /* degenerate distribution: fall back to a median split */
+          mid = task.begin + count / 2;
+          std::nth_element(order.begin() + task.begin, order.begin() + mid,
+              order.begin() + task.end, [&](int i, int j) {
+                return centroid[3 * i + axis] < centroid[3 * j + axis];
+              });
+        } else {
+          mid = -1;
+        }
+      }
+    }
+
+    Node &node = Nodes[task.node];
+    std::copy(box.min, box.min + 3, node.Min);
+    std::copy(box.max, box.max + 3, node.Max);
+
+    if (mid < 0) {
+      node.First = EList.size();
+      node.Count = count;
+      for (int k = task.begin; k < task.end; ++k) {
+        EList.push_back(ids ? ids[order[k]] : order[k]);
+      }
+      EList.push_back(-1);
+    } else {
+      int left = Nodes.size();
+      node.First = left;
+      node.Count = 0;
+      Nodes.emplace_back();
+      Nodes.emplace_back();
+      stack.push_back({left + 1, mid, task.end, task.depth + 1});
+      stack.push_back({left, task.begin, mid, task.depth + 1});
+    }
+  }
+
+  return true;
+}
+
+size_t BVHType::memory() const
+{
+  return Nodes.capacity() * sizeof(Node) + EList.capacity() * sizeof(int);
+}
+
+/*========================================================================*/
+
+void BVHWalker::init(const BVHType *bvh, const float *org, const float *dir,
+    float t_min, BVHStats *stats)
+{
+  float t;
+
+  m_bvh = bvh;
+  m_stats = stats;
+  m_t_min = t_min;
+  m_depth = 0;
+
+  for (int a = 0; a < 3; ++a) {
+    m_org[a] = org[a];
+    m_parallel[a] = (dir[a] == 0.0F);
+    m_inv[a] = m_parallel[a] ? 0.0F : 1.0F / dir[a];
+  }
+
+  if (!bvh->Nodes.empty() && hit(bvh->Nodes[0], &t)) {
+    m_stack[m_depth++] = {0, t};
+  }
+}
+
+/**
+ * Slab test, entry distance is clamped to t_min
+ */
+bool BVHWalker::hit(const BVHType::Node &node, float *t_entry) const
+{
+  float t0 = m_t_min, t1 = FLT_MAX;
+
+  for (int a = 0; a < 3; ++a) {
+    if (m_parallel[a]) {
+      if (m_org[a] < node.Min[a] || m_org[a] > node.Max[a])
+        return false;
+    } else {
+      float ta = (node.Min[a] - m_org[a]) * m_inv[a];
+      float tb = (node.Max[a] - m_org[a]) * m_inv[a];
+      if (ta > tb)
+        std::swap(ta, tb);
+      if (ta > t0)
+        t0 = ta;
+      if (tb < t1)
+        t1 = tb;
+      if (t0 > t1)
+        return false;
+    }
+  }
+
+  *t_entry = t0;
+  return true;
+}
+
+int BVHWalker::next(float t_limit)
+{
+  const auto &nodes = m_bvh->Nodes;
+
+  while (m_depth) {
+    Entry entry = m_stack[--m_depth];
+
+    if (entry.t > t_limit)
+      continue;
+
+    const auto &node = nodes[entry.node];
+
+    if (m_stats)
+      m_stats->NNode++;
+
+    if (node.Count) {
+      if (m_stats)
+        m_stats->NLeaf++;
+      return node.First;
+    }
+
+    /* push the far child first so that the near one is visited next */
+    float t_left, t_right;
+    int left = node.First, right = node.First + 1;
+    bool hit_left = hit(nodes[left], &t_left) && t_left <= t_limit;
+    bool hit_right = hit(nodes[right], &t_right) && t_right <= t_limit;
+
+    if (hit_left && hit_right) {
+      if (t_left < t_right) {
+        m_stack[m_depth++] = {right, t_right};
+        m_stack[m_depth++] = {left, t_left};
+      } else {
+        m_stack[m_depth++] = {left, t_left};
+        m_stack[m_depth++] = {right, t_right};
+      }
+    } else if (hit_left) {
+      m_stack[m_depth++] = {left, t_left};
+    } else if (hit_right) {
+      m_stack[m_depth++] = {right, t_right};
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_BVH
+#define _H_BVH
+
+/* BVH - bounding volume hierarchy over axis-aligned boxes, an alternative
+ * to the uniform MapType grid for scenes with widely varying element sizes */
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#define cBVHMaxDepth 60
+
+struct BVHType {
+  struct Node {
+    float Min[3], Max[3];
+    int First;  /* leaf: offset into EList, inner: index of left child */
+    int Count;  /* leaf: number of elements, inner: 0 */
+  };
+
+  std::vector<Node> Nodes;
+
+  /* leaf element lists, each terminated with -1 like MapType::EList.
+   * EList[0] is a sentinel so that every valid leaf offset is > 0 */
+  std::vector<int> EList;
+
+  /**
+   * Build with the binned surface area heuristic.
+   * @param n number of elements
+   * @param bounds 6 floats per element: min xyz, max xyz
+   * @param ids element ids written to the leaf lists (NULL: 0..n-1)
+   * @param max_leaf maximum number of elements per leaf
+   */
+  bool build(int n, const float *bounds, const int *ids, int max_leaf = 4);
+
+  /**
+   * Recompute the boxes for moved elements and keep the tree, e.g. for the
+   * same primitives seen from another direction.
+   * @param bounds callable (int id, float *min, float *max) -> bool, false
+   * if the element is empty
+   */
+  template <typename F> void refit(F &&bounds)
+  {
+    /* children are always stored after their parent */
+    for (size_t n = Nodes.size(); n--;) {
+      Node &node = Nodes[n];
+      std::fill(node.Min, node.Min + 3, FLT_MAX);
+      std::fill(node.Max, node.Max + 3, -FLT_MAX);
+
+      auto add = [&node](const float *lo, const float *hi) {
+        for (int a = 0; a < 3; ++a) {
+          node.Min[a] = std::min(node.Min[a], lo[a]);
+          node.Max[a] = std::max(node.Max[a], hi[a]);
+        }
+      };
+
+      if (node.Count) {
+        float lo[3], hi[3];
+        for (int k = 0; k < node.Count; ++k) {
+          if (bounds(EList[node.First + k], lo, hi))
+            add(lo, hi);
+        }
+      } else {
+        add(Nodes[node.First].Min, Nodes[node.First].Max);
+        add(Nodes[node.First + 1].Min, Nodes[node.First + 1].Max);
+      }
+    }
+  }
+
+  size_t memory() const;
+};
+
+/* traversal counters */
+struct BVHStats {
+  size_t NNode = 0, NLeaf = 0;
+};
+
+/* front-to-back traversal of a BVHType along a ray */
+
+class BVHWalker {
+  struct Entry {
+    int node;
+    float t;
+  };
+
+  const BVHType *m_bvh = nullptr;
+  float m_org[3];
+  float m_inv[3];
+  bool m_parallel[3];
+  float m_t_min;
+  Entry m_stack[cBVHMaxDepth + 4];
+  int m_depth = 0;
+  BVHStats *m_stats = nullptr;
+
+  bool hit(const BVHType::Node &node, float *t_entry) const;
+
+public:
+  /**
+   * @param org ray origin
+   * @param dir ray direction (distances are in units of its length)
+   * @param t_min boxes which are left before this distance are skipped
+   * @param stats counters to update (may be NULL)
+   */
+  void init(const BVHType *bvh, const float *org, const float *dir, float t_min,
+      BVHStats *stats = nullptr);
+
+  /**
+   * @param t_limit skip boxes which are entered beyond this distance
+   * @return EList offset of the next leaf, or 0 when done
+   */
+  int next(float t_limit);
+};
+
+#endif
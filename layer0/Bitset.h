@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pymol
+{
+
+/**
+ * Fixed size set of bits, packed into 64-bit words.
+ *
+ * The logical operators are plain loops over whole words, which compilers
+ * turn into SIMD code. Bits beyond size() are always zero, so count() and
+ * the operators never need to mask the last word.
+ */
+class Bitset
+{
+public:
+  using word_type = std::uint64_t;
+  static constexpr std::size_t word_bits = 64;
+
+  Bitset() = default;
+  explicit Bitset(std::size_t n) : m_size(n), m_words((n + word_bits - 1) / word_bits) {}
+
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_words.empty(); }
+
+  bool test(std::size_t i) const
+  {
+    return (m_words[i / word_bits] >> (i % word_bits)) & 1;
+  }
+
+  void set(std::size_t i) { m_words[i / word_bits] |= word_type(1) << (i % word_bits); }
+
+  /**
+   * Packs `n` values: bit i is set if `values[i]` is nonzero.
+   * @return false (and leaves the set empty) if any value is not 0 or 1,
+   * e.g. the tags of an ordered selection
+   */
+  template <typename T> bool assignBool(const T* values, std::size_t n)
+  {
+    *this = Bitset(n);
+    for (std::size_t w = 0; w < m_words.size(); ++w) {
+      std::size_t begin = w * word_bits;
+      std::size_t end = std::min(begin + word_bits, n);
+      word_type word = 0, bad = 0;
+      for (std::size_t i = begin; i < end; ++i) {
+        word |= word_type(values[i] != 0) << (i - begin);
+        bad |= word_type(values[i] != 0 && values[i] != 1);
+      }
+      if (bad) {
+        *this = Bitset();
+        return false;
+      }
+      m_words[w] = word;
+    }
+    return true;
+  }
+
+  /**
+   * Unpacks into `size()` values of 0 or 1
+   */
+  template <typename T> void copyTo(T* values) const
+  {
+    for (std::size_t i = 0; i < m_size; ++i)
+      values[i] = test(i);
+  }
+
+  Bitset& operator|=(const Bitset& other)
+  {
+    for (std::size_t w = 0; w < m_words.size(); ++w)
+      m_words[w] |= other.m_words[w];
+    return *this;
+  }
+
+  Bitset& operator&=(const Bitset& other)
+  {
+    for (std::size_t w = 0; w < m_words.size(); ++w)
+      m_words[w] &= other.m_words[w];
+    return *this;
+  }
+
+  /**
+   * this = this and not other
+   */
+  Bitset& andNot(const Bitset& other)
+  {
+    for (std::size_t w = 0; w < m_words.size(); ++w)
+      m_words[w] &= ~other.m_words[w];
+    return *this;
+  }
+
+  /**
+   * Inverts all bits in [0, size())
+   */
+  Bitset& flip()
+  {
+    for (auto& word : m_words)
+      word = ~word;
+    clearTail();
+    return *this;
+  }
+
+  /**
+   * Number of set bits
+   */
+  std::size_t count() const
+  {
+    std::size_t n = 0;
+    for (auto word : m_words)
+      n += popcount(word);
+    return n;
+  }
+
+  bool operator==(const Bitset& other) const
+  {
+    return m_size == other.m_size && m_words == other.m_words;
+  }
+
+private:
+  static unsigned popcount(word_type word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return unsigned((word * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  void clearTail()
+  {
+    if (m_size % word_bits)
+      m_words.back() &= (word_type(1) << (m_size % word_bits)) - 1;
+  }
+
+  std::size_t m_size = 0;
+  std::vector<word_type> m_words;
+};
+
+} // namespace pymol
@@ -0,0 +1,854 @@
+/*
+ * Molecular surface from a distance field on a grid
+ */
+
+#include "GridSurface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "ThreadPool.h"
+#include "marching_cubes.h"
+
+namespace pymol
+{
+namespace
+{
+
+/// Grid cells per brick edge
+constexpr int cBrickCells = 64;
+
+/// Upper limit for GridSurfaceParams::cavity_cull, determines the brick halo
+constexpr int cMaxCavityCull = 32;
+
+/// Field values closer to the contour level get moved away by this (times
+/// spacing), so no vertex falls onto a grid point
+constexpr float cFieldEpsilon = 1e-2F;
+
+enum : char {
+  cPointInside = 0, ///< inside the solvent accessible surface
+  cPointProbe = 1,  ///< probe center position
+};
+
+/// Grid point coordinates in edge ids are offset by this (20 bits)
+constexpr std::int64_t cEdgeOffset = 1 << 19;
+
+/**
+ * Setup shared by all bricks. Grid points are at multiples of the spacing,
+ * so a brick is at the same place in every call (see GridSurfaceCache).
+ */
+struct GridSetup {
+  const float* coord;
+  std::vector<float> radius;     ///< vdw + probe, by atom index
+  float max_radius = 0.F;
+
+  const GridSurfaceParams* params;
+  float h;
+  float stamp; ///< extra reach of atom spheres (beyond radius)
+  int halo;    ///< grid points around the brick core
+  int brick_lo[3]; ///< position of brick 0, in bricks
+  int brick_dim[3];
+  int brick_reach; ///< neighbor bricks which can contribute atoms
+
+  /// atoms sorted by brick of their center (CSR)
+  std::vector<int> brick_start;
+  std::vector<int> brick_atoms;
+
+  int brickIndex(int i, int j, int k) const
+  {
+    return i + brick_dim[0] * (j + brick_dim[1] * k);
+  }
+};
+
+/**
+ * Per worker scratch space, reused between bricks
+ */
+struct BrickScratch {
+  std::vector<int> atoms;
+  std::vector<float> sas;  ///< max(radius - distance), > 0 inside
+  std::vector<int> nearest; ///< atom with the largest sas value
+  std::vector<char> state;
+  std::vector<float> dist;  ///< distance to nearest probe position
+  std::vector<float> field; ///< core plus one point on each side
+  std::vector<int> queue;
+};
+
+struct BrickMesh {
+  std::vector<float> v, vn;
+  std::vector<int> tri;
+  std::vector<std::int64_t> edge; ///< global grid edge on brick faces, or -1
+
+  std::size_t bytes() const
+  {
+    return sizeof(BrickMesh) + (v.size() + vn.size() + tri.size()) * 4 +
+           edge.size() * 8;
+  }
+};
+
+std::uint64_t Mix64(std::uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ * 128 bit fingerprint of the input of a brick
+ */
+struct BrickKey {
+  std::uint64_t a = 0x243f6a8885a308d3ULL;
+  std::uint64_t b = 0x13198a2e03707344ULL;
+
+  void add(std::uint64_t x)
+  {
+    a = Mix64(a ^ x);
+    b = Mix64(b + x * 0x9e3779b97f4a7c15ULL) ^ (b >> 7);
+  }
+
+  void add(float f)
+  {
+    std::uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    add(std::uint64_t(u));
+  }
+
+  bool operator==(const BrickKey& o) const { return a == o.a && b == o.b; }
+};
+
+struct BrickKeyHash {
+  std::size_t operator()(const BrickKey& k) const { return k.a ^ k.b; }
+};
+
+} // namespace
+
+struct GridSurfaceCache::Impl {
+  struct Entry {
+    std::shared_ptr<const BrickMesh> mesh;
+    std::uint64_t last_use;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<BrickKey, Entry, BrickKeyHash> entries;
+  std::uint64_t generation = 0;
+  std::size_t bytes = 0;
+
+  std::shared_ptr<const BrickMesh> find(
+      const BrickKey& key, std::uint64_t generation_)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end())
+      return nullptr;
+    it->second.last_use = std::max(it->second.last_use, generation_);
+    return it->second.mesh;
+  }
+
+  void insert(const BrickKey& key, std::shared_ptr<const BrickMesh> mesh,
+      std::uint64_t generation_)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto bytes_ = mesh->bytes();
+    if (entries.emplace(key, Entry{std::move(mesh), generation_}).second)
+      bytes += bytes_;
+  }
+
+  /**
+   * Drop least recently used bricks, except those of `generation_`, until
+   * at most `budget` bytes are left.
+   */
+  void trim(std::uint64_t generation_, std::size_t budget)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes <= budget)
+      return;
+
+    std::vector<decltype(entries)::iterator> old;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->second.last_use < generation_)
+        old.push_back(it);
+    }
+    std::sort(old.begin(), old.end(), [](const auto& a, const auto& b) {
+      return a->second.last_use < b->second.last_use;
+    });
+    for (auto it : old) {
+      if (bytes <= budget)
+        break;
+      bytes -= it->second.mesh->bytes();
+      entries.erase(it);
+    }
+  }
+};
+
+GridSurfaceCache::GridSurfaceCache()
+    : m_impl(new Impl())
+{
+}
+
+GridSurfaceCache::~GridSurfaceCache() = default;
+
+std::size_t GridSurfaceCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_impl->mutex);
+  return m_impl->entries.size();
+}
+
+void GridSurfaceCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_impl->mutex);
+  m_impl->entries.clear();
+  m_impl->bytes = 0;
+}
+
+namespace
+{
+
+/**
+ * Marching cubes view of the brick core
+ */
+class BrickField : public mc::Field
+{
+  const float* m_field;
+  int m_dim; ///< core points + 2
+  float m_origin[3];
+  float m_h;
+
+public:
+  BrickField(const float* field, int dim, const float* origin, float h)
+      : m_field(field)
+      , m_dim(dim)
+      , m_h(h)
+  {
+    std::copy_n(origin, 3, m_origin);
+  }
+
+  size_t xDim() const override { return m_dim - 2; }
+  size_t yDim() const override { return m_dim - 2; }
+  size_t zDim() const override { return m_dim - 2; }
+
+  float get(size_t x, size_t y, size_t z) const override
+  {
+    return m_field[(x + 1) + m_dim * ((y + 1) + m_dim * (z + 1))];
+  }
+
+  mc::Point get_point(size_t x, size_t y, size_t z) const override
+  {
+    return {m_origin[0] + x * m_h, m_origin[1] + y * m_h, m_origin[2] + z * m_h};
+  }
+};
+
+/**
+ * Fill voids of probe positions which are smaller than `max_size` and don't
+ * touch the border of the region.
+ */
+void CullCavities(BrickScratch& s, int dim, int max_size)
+{
+  const int n = dim * dim * dim;
+  auto& state = s.state;
+  auto& queue = s.queue;
+  std::vector<char> seen(n, 0);
+
+  for (int start = 0; start < n; ++start) {
+    if (seen[start] || state[start] != cPointProbe)
+      continue;
+
+    queue.clear();
+    queue.push_back(start);
+    seen[start] = 1;
+    bool border = false;
+
+    for (size_t q = 0; q < queue.size(); ++q) {
+      int p = queue[q];
+      int x = p % dim, y = (p / dim) % dim, z = p / (dim * dim);
+      if (x == 0 || y == 0 || z == 0 || x == dim - 1 || y == dim - 1 ||
+          z == dim - 1) {
+        border = true;
+        continue;
+      }
+      for (int o : {1, -1, dim, -dim, dim * dim, -dim * dim}) {
+        if (!seen[p + o] && state[p + o] == cPointProbe) {
+          seen[p + o] = 1;
+          queue.push_back(p + o);
+        }
+      }
+    }
+
+    if (!border && queue.size() < size_t(max_size)) {
+      for (int p : queue)
+        state[p] = cPointInside;
+    }
+  }
+}
+
+/**
+ * Compute the field of one brick and contour it.
+ * @param babs position of the brick, in bricks
+ * @param s atoms must be gathered
+ */
+void BrickContour(
+    const GridSetup& I, const int babs[3], BrickScratch& s, BrickMesh& out)
+{
+  const auto& params = *I.params;
+  const float h = I.h;
+  const float rp = params.probe_radius;
+  const int B = cBrickCells;
+  const int H = I.halo;
+  const int dim = B + 1 + 2 * H;
+  const int n = dim * dim * dim;
+
+  float ext_origin[3];
+  for (int d = 0; d < 3; ++d)
+    ext_origin[d] = float(babs[d] * B - H) * h;
+
+  // solvent accessible field
+  s.sas.assign(n, -I.stamp);
+  s.nearest.assign(n, -1);
+
+  for (int atm : s.atoms) {
+    const float* c = I.coord + atm * 3;
+    const float r = I.radius[atm];
+    const float reach = r + I.stamp;
+    int lo[3], hi[3];
+    for (int d = 0; d < 3; ++d) {
+      lo[d] = std::max(0, (int) std::ceil((c[d] - reach - ext_origin[d]) / h));
+      hi[d] = std::min(
+          dim - 1, (int) std::floor((c[d] + reach - ext_origin[d]) / h));
+    }
+    for (int z = lo[2]; z <= hi[2]; ++z) {
+      float dz = ext_origin[2] + z * h - c[2];
+      for (int y = lo[1]; y <= hi[1]; ++y) {
+        float dy = ext_origin[1] + y * h - c[1];
+        float dyz2 = dy * dy + dz * dz;
+        if (dyz2 > reach * reach)
+          continue;
+        int p = lo[0] + dim * (y + dim * z);
+        for (int x = lo[0]; x <= hi[0]; ++x, ++p) {
+          float dx = ext_origin[0] + x * h - c[0];
+          float d2 = dx * dx + dyz2;
+          // r - sqrt(d2) > sas[p], without the sqrt in most cases
+          float lim = r - s.sas[p];
+          if (lim > 0.F && d2 < lim * lim) {
+            s.sas[p] = r - std::sqrt(d2);
+            s.nearest[p] = atm;
+          }
+        }
+      }
+    }
+  }
+
+  // field over the core and one point on each side (for gradients)
+  const int fdim = B + 3;
+  s.field.resize(fdim * fdim * fdim);
+  auto ext_index = [&](int x, int y, int z) {
+    return (x + H - 1) + dim * ((y + H - 1) + dim * (z + H - 1));
+  };
+
+  if (params.solvent_accessible) {
+    for (int z = 0, f = 0; z < fdim; ++z)
+      for (int y = 0; y < fdim; ++y)
+        for (int x = 0; x < fdim; ++x)
+          s.field[f++] = s.sas[ext_index(x, y, z)];
+  } else {
+    // solvent excluded: distance to the nearest probe position
+    s.state.resize(n);
+    for (int p = 0; p < n; ++p)
+      s.state[p] = (s.sas[p] > 0.F) ? cPointInside : cPointProbe;
+
+    if (params.cavity_cull > 0)
+      CullCavities(s, dim, std::min(params.cavity_cull, cMaxCavityCull));
+
+    const float cap = rp + 2.F * h;
+    s.dist.assign(fdim * fdim * fdim, cap);
+
+    // world position of field point 0
+    float f_origin[3];
+    for (int d = 0; d < 3; ++d)
+      f_origin[d] = ext_origin[d] + (H - 1) * h;
+
+    const int offsets[6] = {1, -1, dim, -dim, dim * dim, -dim * dim};
+
+    for (int z = 1; z < dim - 1; ++z)
+      for (int y = 1; y < dim - 1; ++y)
+        for (int x = 1; x < dim - 1; ++x) {
+          int p = x + dim * (y + dim * z);
+          if (s.state[p] != cPointProbe)
+            continue;
+
+          bool boundary = false;
+          for (int o : offsets) {
+            if (s.state[p + o] != cPointProbe) {
+              boundary = true;
+              break;
+            }
+          }
+          if (!boundary)
+            continue;
+
+          float b[3] = {ext_origin[0] + x * h, ext_origin[1] + y * h,
+              ext_origin[2] + z * h};
+
+          // move onto the nearest atom sphere, unless that would clash
+          // with an atom next to it (crevices)
+          int atm = s.nearest[p];
+          if (atm >= 0) {
+            const float* c = I.coord + atm * 3;
+            float r = I.radius[atm];
+            float v[3] = {b[0] - c[0], b[1] - c[1], b[2] - c[2]};
+            float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            if (len > 0.F) {
+              float q[3];
+              for (int d = 0; d < 3; ++d)
+                q[d] = c[d] + v[d] * (r / len);
+              bool clash = false;
+              for (int o = 0; !clash && o < 27; ++o) {
+                int other = s.nearest[p + (o % 3 - 1) +
+                                      dim * ((o / 3 % 3 - 1) +
+                                                dim * (o / 9 - 1))];
+                if (other < 0 || other == atm)
+                  continue;
+                const float* c2 = I.coord + other * 3;
+                float r2 = I.radius[other] * 0.999F;
+                float dx = q[0] - c2[0], dy = q[1] - c2[1], dz = q[2] - c2[2];
+                clash = (dx * dx + dy * dy + dz * dz < r2 * r2);
+              }
+              if (!clash)
+                std::copy_n(q, 3, b);
+            }
+          }
+
+          int lo[3], hi[3];
+          for (int d = 0; d < 3; ++d) {
+            lo[d] = std::max(0, (int) std::ceil((b[d] - cap - f_origin[d]) / h));
+            hi[d] = std::min(
+                fdim - 1, (int) std::floor((b[d] + cap - f_origin[d]) / h));
+          }
+          for (int fz = lo[2]; fz <= hi[2]; ++fz) {
+            float dz = f_origin[2] + fz * h - b[2];
+            for (int fy = lo[1]; fy <= hi[1]; ++fy) {
+              float dy = f_origin[1] + fy * h - b[1];
+              float dyz2 = dy * dy + dz * dz;
+              if (dyz2 > cap * cap)
+                continue;
+              for (int fx = lo[0]; fx <= hi[0]; ++fx) {
+                float dx = f_origin[0] + fx * h - b[0];
+                float d2 = dx * dx + dyz2;
+                int f = fx + fdim * (fy + fdim * fz);
+                if (d2 < s.dist[f] * s.dist[f])
+                  s.dist[f] = std::sqrt(d2);
+              }
+            }
+          }
+        }
+
+    for (int z = 0, f = 0; z < fdim; ++z)
+      for (int y = 0; y < fdim; ++y)
+        for (int x = 0; x < fdim; ++x, ++f)
+          s.field[f] = (s.state[ext_index(x, y, z)] == cPointProbe)
+                           ? -rp
+                           : s.dist[f] - rp;
+  }
+
+  // nothing to contour if all core points are on the same side
+  {
+    bool any_in = false, any_out = false;
+    for (int z = 1; z <= B + 1; ++z)
+      for (int y = 1; y <= B + 1; ++y)
+        for (int x = 1; x <= B + 1; ++x) {
+          if (s.field[x + fdim * (y + fdim * z)] < 0.F)
+            any_out = true;
+          else
+            any_in = true;
+        }
+    if (!(any_in && any_out))
+      return;
+  }
+
+  // keep vertices off the grid points, so each one has a unique grid edge
+  const float eps = cFieldEpsilon * h;
+  for (auto& value : s.field) {
+    if (std::abs(value) < eps)
+      value = (value < 0.F) ? -eps : eps;
+  }
+
+  float core_origin[3];
+  for (int d = 0; d < 3; ++d)
+    core_origin[d] = float(babs[d] * B) * h;
+
+  BrickField field(s.field.data(), fdim, core_origin, h);
+  auto mesh = mc::march(field, 0.F, false, false);
+
+  if (!mesh.faceCount)
+    return;
+
+  out.v.resize(mesh.vertexCount * 3);
+  out.vn.resize(mesh.vertexCount * 3);
+  out.edge.resize(mesh.vertexCount);
+
+  auto F = [&](int x, int y, int z) {
+    return s.field[(x + 1) + fdim * ((y + 1) + fdim * (z + 1))];
+  };
+
+  for (size_t i = 0; i < mesh.vertexCount; ++i) {
+    const auto& pt = mesh.vertices[i];
+    float t[3], w[3];
+    int c[3];
+    int axis = -1;
+    bool face = false;
+    for (int d = 0; d < 3; ++d) {
+      t[d] = (pt[d] - core_origin[d]) / h;
+      c[d] = std::min(B - 1, std::max(0, (int) std::floor(t[d])));
+      w[d] = std::min(1.F, std::max(0.F, t[d] - c[d]));
+      float r = std::round(t[d]);
+      if (std::abs(t[d] - r) > 1e-3F) {
+        axis = d; // along the edge
+      } else if (r == 0.F || r == B) {
+        face = true;
+      }
+    }
+
+    // trilinear interpolation of central difference gradients
+    float grad[3] = {0.F, 0.F, 0.F};
+    for (int corner = 0; corner < 8; ++corner) {
+      int x = c[0] + (corner & 1);
+      int y = c[1] + ((corner >> 1) & 1);
+      int z = c[2] + ((corner >> 2) & 1);
+      float weight = ((corner & 1) ? w[0] : 1.F - w[0]) *
+                     (((corner >> 1) & 1) ? w[1] : 1.F - w[1]) *
+                     (((corner >> 2) & 1) ? w[2] : 1.F - w[2]);
+      grad[0] += weight * (F(x + 1, y, z) - F(x - 1, y, z));
+      grad[1] += weight * (F(x, y + 1, z) - F(x, y - 1, z));
+      grad[2] += weight * (F(x, y, z + 1) - F(x, y, z - 1));
+    }
+
+    // field increases inwards
+    float len = std::sqrt(
+        grad[0] * grad[0] + grad[1] * grad[1] + grad[2] * grad[2]);
+    for (int d = 0; d < 3; ++d) {
+      out.v[i * 3 + d] = pt[d];
+      out.vn[i * 3 + d] = (len > 0.F) ? -grad[d] / len : 0.F;
+    }
+
+    out.edge[i] = -1;
+    if (face && axis >= 0) {
+      std::int64_t g[3];
+      for (int d = 0; d < 3; ++d) {
+        g[d] = std::int64_t(babs[d]) * B + cEdgeOffset +
+               ((d == axis) ? c[d] : (std::int64_t) std::round(t[d]));
+      }
+      out.edge[i] = ((g[2] << 40) | (g[1] << 20) | g[0]) * 3 + axis;
+    }
+  }
+
+  out.tri.resize(mesh.faceCount * 3);
+  for (size_t i = 0; i < mesh.faceCount; ++i) {
+    int t0 = mesh.faces[i * 3], t1 = mesh.faces[i * 3 + 1],
+        t2 = mesh.faces[i * 3 + 2];
+    const float *v0 = &out.v[t0 * 3], *v1 = &out.v[t1 * 3],
+                *v2 = &out.v[t2 * 3];
+    float e1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+    float e2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+    float cross[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+        e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    float dot = 0.F;
+    for (int d = 0; d < 3; ++d)
+      dot += cross[d] *
+             (out.vn[t0 * 3 + d] + out.vn[t1 * 3 + d] + out.vn[t2 * 3 + d]);
+    if (dot < 0.F)
+      std::swap(t1, t2);
+    out.tri[i * 3] = t0;
+    out.tri[i * 3 + 1] = t1;
+    out.tri[i * 3 + 2] = t2;
+  }
+}
+
+/**
+ * Compute the field of one brick and contour it, or take it from the cache.
+ * @param cache optional
+ * @return false if the brick has no atoms
+ */
+bool BrickRun(const GridSetup& I, int bi, int bj, int bk, BrickScratch& s,
+    std::shared_ptr<const BrickMesh>& result, GridSurfaceCache::Impl* cache,
+    std::uint64_t generation, bool& reused)
+{
+  const auto& params = *I.params;
+  const float h = I.h;
+  const float rp = params.probe_radius;
+  const int B = cBrickCells;
+  const int H = I.halo;
+  const int dim = B + 1 + 2 * H;
+  const int bijk[3] = {bi, bj, bk};
+
+  // position in bricks
+  int babs[3];
+  for (int d = 0; d < 3; ++d)
+    babs[d] = I.brick_lo[d] + bijk[d];
+
+  // world position of extended region point 0
+  float ext_origin[3];
+  for (int d = 0; d < 3; ++d)
+    ext_origin[d] = float(babs[d] * B - H) * h;
+
+  // gather atoms which reach the extended region
+  s.atoms.clear();
+  const float ext_size = (dim - 1) * h;
+  for (int k = std::max(0, bk - I.brick_reach);
+       k <= std::min(I.brick_dim[2] - 1, bk + I.brick_reach); ++k)
+    for (int j = std::max(0, bj - I.brick_reach);
+         j <= std::min(I.brick_dim[1] - 1, bj + I.brick_reach); ++j)
+      for (int i = std::max(0, bi - I.brick_reach);
+           i <= std::min(I.brick_dim[0] - 1, bi + I.brick_reach); ++i) {
+        int b = I.brickIndex(i, j, k);
+        for (int a = I.brick_start[b]; a < I.brick_start[b + 1]; ++a) {
+          int atm = I.brick_atoms[a];
+          const float* c = I.coord + atm * 3;
+          float reach = I.radius[atm] + I.stamp;
+          bool inside = true;
+          for (int d = 0; d < 3; ++d) {
+            if (c[d] + reach < ext_origin[d] ||
+                c[d] - reach > ext_origin[d] + ext_size)
+              inside = false;
+          }
+          if (inside)
+            s.atoms.push_back(atm);
+        }
+      }
+
+  if (s.atoms.empty())
+    return false;
+
+  BrickKey key;
+  if (cache) {
+    key.add(h);
+    key.add(rp);
+    key.add(std::uint64_t(params.solvent_accessible));
+    key.add(std::uint64_t(params.cavity_cull));
+    for (int d = 0; d < 3; ++d)
+      key.add(std::uint64_t(std::int64_t(babs[d])));
+    for (int atm : s.atoms) {
+      for (int d = 0; d < 3; ++d)
+        key.add(I.coord[atm * 3 + d]);
+      key.add(I.radius[atm]);
+    }
+
+    result = cache->find(key, generation);
+    if (result) {
+      reused = true;
+      return true;
+    }
+  }
+
+  auto out = std::make_shared<BrickMesh>();
+  BrickContour(I, babs, s, *out);
+
+  if (cache) {
+    cache->insert(key, out, generation);
+  }
+
+  result = std::move(out);
+  return true;
+}
+
+} // namespace
+
+bool GridSurfaceGenerate(const float* coord, const float* vdw,
+    const int* present, int n_atom, const GridSurfaceParams& params,
+    GridSurfaceMesh& mesh)
+{
+  mesh.v.clear();
+  mesh.vn.clear();
+  mesh.tri.clear();
+  mesh.n_brick = 0;
+  mesh.n_brick_reused = 0;
+
+  std::vector<int> atoms;
+  for (int a = 0; a < n_atom; ++a) {
+    if (!present || present[a])
+      atoms.push_back(a);
+  }
+
+  if (atoms.empty())
+    return true;
+
+  GridSetup I;
+  I.coord = coord;
+  I.params = &params;
+  I.h = std::max(params.spacing, 0.01F);
+  I.radius.resize(n_atom);
+
+  const float h = I.h;
+  const int B = cBrickCells;
+
+  float lo[3], hi[3];
+  for (int d = 0; d < 3; ++d) {
+    lo[d] = coord[atoms[0] * 3 + d];
+    hi[d] = lo[d];
+  }
+  for (int a : atoms) {
+    I.radius[a] = vdw[a] + params.probe_radius;
+    I.max_radius = std::max(I.max_radius, I.radius[a]);
+    for (int d = 0; d < 3; ++d) {
+      lo[d] = std::min(lo[d], coord[a * 3 + d]);
+      hi[d] = std::max(hi[d], coord[a * 3 + d]);
+    }
+  }
+
+  I.stamp = 2.F * h;
+  if (params.solvent_accessible) {
+    I.halo = 1;
+  } else {
+    // probe positions up to this far from the core affect its field
+    I.halo = (int) std::ceil((params.probe_radius + 2.F * h) / h) + 3;
+    if (params.cavity_cull > 0)
+      I.halo += std::min(params.cavity_cull, cMaxCavityCull);
+  }
+
+  const float margin = I.max_radius + I.stamp + h;
+  float origin[3];
+  for (int d = 0; d < 3; ++d) {
+    I.brick_lo[d] = (int) std::floor((lo[d] - margin) / (B * h));
+    origin[d] = float(I.brick_lo[d] * B) * h;
+    int n_cell = (int) std::ceil((hi[d] + margin - origin[d]) / h);
+    I.brick_dim[d] = std::max(1, (n_cell + B - 1) / B);
+  }
+  I.brick_reach = (int) std::ceil(
+      (I.max_radius + I.stamp + I.halo * h) / (B * h));
+
+  // sort atoms by brick (counting sort)
+  const int n_brick = I.brick_dim[0] * I.brick_dim[1] * I.brick_dim[2];
+  std::vector<int> atom_brick(atoms.size());
+  I.brick_start.assign(n_brick + 1, 0);
+  for (size_t i = 0; i < atoms.size(); ++i) {
+    int bijk[3];
+    for (int d = 0; d < 3; ++d) {
+      bijk[d] = (int) ((coord[atoms[i] * 3 + d] - origin[d]) / (B * h));
+      bijk[d] = std::min(I.brick_dim[d] - 1, std::max(0, bijk[d]));
+    }
+    atom_brick[i] = I.brickIndex(bijk[0], bijk[1], bijk[2]);
+    ++I.brick_start[atom_brick[i] + 1];
+  }
+  for (int b = 0; b < n_brick; ++b)
+    I.brick_start[b + 1] += I.brick_start[b];
+  I.brick_atoms.resize(atoms.size());
+  {
+    std::vector<int> fill(I.brick_start.begin(), I.brick_start.end() - 1);
+    for (size_t i = 0; i < atoms.size(); ++i)
+      I.brick_atoms[fill[atom_brick[i]]++] = atoms[i];
+  }
+
+  // bricks next to atoms
+  std::vector<char> active(n_brick, 0);
+  for (int k = 0; k < I.brick_dim[2]; ++k)
+    for (int j = 0; j < I.brick_dim[1]; ++j)
+      for (int i = 0; i < I.brick_dim[0]; ++i) {
+        int b = I.brickIndex(i, j, k);
+        if (I.brick_start[b] == I.brick_start[b + 1])
+          continue;
+        const int r = I.brick_reach;
+        for (int kk = std::max(0, k - r);
+             kk <= std::min(I.brick_dim[2] - 1, k + r); ++kk)
+          for (int jj = std::max(0, j - r);
+               jj <= std::min(I.brick_dim[1] - 1, j + r); ++jj)
+            for (int ii = std::max(0, i - r);
+                 ii <= std::min(I.brick_dim[0] - 1, i + r); ++ii)
+              active[I.brickIndex(ii, jj, kk)] = 1;
+      }
+
+  std::vector<int> bricks;
+  for (int b = 0; b < n_brick; ++b) {
+    if (active[b])
+      bricks.push_back(b);
+  }
+
+  const int n_thread = std::max(1, params.n_thread);
+  std::vector<BrickScratch> scratch(n_thread);
+  std::vector<std::shared_ptr<const BrickMesh>> brick_mesh(bricks.size());
+  std::vector<char> brick_used(bricks.size(), 0);
+  std::vector<char> brick_reused(bricks.size(), 0);
+
+  auto cache = params.cache ? params.cache->m_impl.get() : nullptr;
+  std::uint64_t generation = 0;
+  if (cache) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    generation = ++cache->generation;
+  }
+
+  ThreadPoolRunTasks(n_thread, bricks.size(), [&](int worker, size_t t) {
+    if (params.interrupt && *params.interrupt)
+      return;
+    int b = bricks[t];
+    int i = b % I.brick_dim[0];
+    int j = (b / I.brick_dim[0]) % I.brick_dim[1];
+    int k = b / (I.brick_dim[0] * I.brick_dim[1]);
+    bool reused = false;
+    brick_used[t] = BrickRun(I, i, j, k, scratch[worker], brick_mesh[t],
+        cache, generation, reused);
+    brick_reused[t] = reused;
+  });
+
+  if (params.interrupt && *params.interrupt)
+    return false;
+
+  std::size_t bytes = 0;
+  for (size_t t = 0; t < bricks.size(); ++t) {
+    mesh.n_brick += brick_used[t];
+    mesh.n_brick_reused += brick_reused[t];
+    if (brick_mesh[t])
+      bytes += brick_mesh[t]->bytes();
+  }
+
+  if (cache) {
+    cache->trim(generation, 2 * bytes);
+  }
+
+  // merge in brick order, weld vertices on shared brick faces
+  std::unordered_map<std::int64_t, int> welded;
+  std::vector<int> index;
+
+  for (auto& bm_ptr : brick_mesh) {
+    if (!bm_ptr)
+      continue;
+
+    const auto& bm = *bm_ptr;
+    const size_t n_vert = bm.edge.size();
+    index.resize(n_vert);
+
+    for (size_t i = 0; i < n_vert; ++i) {
+      const float* p = &bm.v[i * 3];
+      int id = mesh.v.size() / 3;
+
+      if (bm.edge[i] >= 0) {
+        auto it = welded.emplace(bm.edge[i], id);
+        if (!it.second) {
+          index[i] = it.first->second;
+          continue;
+        }
+      }
+
+      index[i] = id;
+      mesh.v.insert(mesh.v.end(), p, p + 3);
+      mesh.vn.insert(mesh.vn.end(), &bm.vn[i * 3], &bm.vn[i * 3] + 3);
+    }
+
+    for (size_t t = 0; t < bm.tri.size(); t += 3) {
+      int t0 = index[bm.tri[t]], t1 = index[bm.tri[t + 1]],
+          t2 = index[bm.tri[t + 2]];
+      if (t0 == t1 || t1 == t2 || t0 == t2)
+        continue;
+      mesh.tri.push_back(t0);
+      mesh.tri.push_back(t1);
+      mesh.tri.push_back(t2);
+    }
+
+    bm_ptr.reset();
+  }
+
+  return true;
+}
+
+} // namespace pymol
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace pymol
+{
+
+class GridSurfaceCache;
+
+/**
+ * Molecular surface by contouring a distance field on a grid (marching
+ * cubes), as an alternative to the dot placement and triangulation in
+ * RepSurface. Much faster for very large systems, at the cost of grid
+ * artifacts (vertex spacing is the grid spacing).
+ *
+ * The grid is processed in independent bricks, so memory use is
+ * proportional to the surface area and not to the bounding box volume.
+ */
+struct GridSurfaceParams {
+  float probe_radius = 1.4F;
+
+  /// Grid spacing in Angstrom
+  float spacing = 0.5F;
+
+  /// Solvent accessible instead of solvent excluded surface
+  bool solvent_accessible = false;
+
+  /// Fill probe accessible voids with fewer grid points than this
+  int cavity_cull = 0;
+
+  /// Number of threads
+  int n_thread = 1;
+
+  /// Abort if this becomes non-zero (e.g. &G->Interrupt)
+  const int* interrupt = nullptr;
+
+  /// Optional, reuse bricks from previous calls
+  GridSurfaceCache* cache = nullptr;
+};
+
+struct GridSurfaceMesh {
+  std::vector<float> v;  ///< vertex positions, 3 per vertex
+  std::vector<float> vn; ///< outward vertex normals, 3 per vertex
+  std::vector<int> tri;  ///< 3 vertex indices per triangle, counter-clockwise
+
+  std::size_t n_brick = 0;        ///< bricks with atoms
+  std::size_t n_brick_reused = 0; ///< of those, taken from the cache
+
+  std::size_t vertexCount() const { return v.size() / 3; }
+  std::size_t triangleCount() const { return tri.size() / 3; }
+};
+
+/**
+ * Bricks from previous GridSurfaceGenerate calls. A brick is only
+ * recomputed if any of the atoms within its reach moved (or the parameters
+ * changed), so local changes like sculpting or torsion editing only update
+ * a few surface patches. Bricks are looked up by their input, so a cache
+ * may be shared between states and threads.
+ *
+ * Bricks which were not used by a call are dropped once the cache holds
+ * more than twice the data of that call.
+ */
+class GridSurfaceCache
+{
+public:
+  GridSurfaceCache();
+  ~GridSurfaceCache();
+
+  /// Number of cached bricks
+  std::size_t size() const;
+
+  void clear();
+
+  struct Impl;
+
+private:
+  std::unique_ptr<Impl> m_impl;
+
+  friend bool GridSurfaceGenerate(const float*, const float*, const int*, int,
+      const GridSurfaceParams&, GridSurfaceMesh&);
+};
+
+/**
+ * Compute a molecular surface.
+ * @param coord atom coordinates, n_atom * 3
+ * @param vdw atom radii
+ * @param present optional flags, only atoms with present[i] != 0 are used
+ * @param[out] mesh surface, empty if there are no atoms
+ * @return false if interrupted
+ */
+bool GridSurfaceGenerate(const float* coord, const float* vdw,
+    const int* present, int n_atom, const GridSurfaceParams& params,
+    GridSurfaceMesh& mesh);
+
+} // namespace pymol
@@ -62,6 +62,7 @@ Z* -------------------------------------------------------------------
 
 #define cCache_map_scene_cache                           40
 #define cCache_map_shadow_cache                          44
+#define cCache_map_instance_cache                        48
 #define cCache_map_cache_offset                          1
 #define cCache_map_cache_link_offset                     2
 
@@ -88,6 +88,7 @@ typedef struct _CType CType;
 typedef struct _CMain CMain;
 struct CPlugIOManager;
 struct COpenVR;
+struct CRayProgress;
 struct ObjectMolecule;
 
 class CShaderMgr;
@@ -174,6 +175,7 @@ struct PyMOLGlobals {
   CPlugIOManager *PlugIOManager;
   CShaderMgr* ShaderMgr;
   COpenVR* OpenVR;
+  CRayProgress *RayProgress;    /* partial images of the ray tracer */
 
 #ifndef _PYMOL_NOPY
   CP_inst *P_inst;
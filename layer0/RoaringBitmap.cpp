@@ -0,0 +1,424 @@
+/*
+ * Compressed bitmap of 32-bit integers
+ */
+
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace pymol
+{
+
+namespace
+{
+constexpr std::size_t cBitsetWords = 65536 / 64;
+
+unsigned popcount(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(word);
+#else
+  unsigned n = 0;
+  for (; word; word &= word - 1)
+    ++n;
+  return n;
+#endif
+}
+
+void putLE(std::string& out, std::uint64_t value, int n_byte)
+{
+  for (int i = 0; i < n_byte; ++i)
+    out.push_back(char((value >> (8 * i)) & 0xFF));
+}
+
+bool getLE(const char*& data, const char* end, std::uint64_t& value, int n_byte)
+{
+  if (end - data < n_byte)
+    return false;
+  value = 0;
+  for (int i = 0; i < n_byte; ++i)
+    value |= std::uint64_t(static_cast<unsigned char>(*data++)) << (8 * i);
+  return true;
+}
+} // namespace
+
+/*========================================================================*/
+bool RoaringBitmap::Container::contains(std::uint16_t low) const
+{
+  if (isBitset())
+    return (bits[low / 64] >> (low % 64)) & 1;
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::toBitset()
+{
+  bits.assign(cBitsetWords, 0);
+  for (auto low : array)
+    bits[low / 64] |= std::uint64_t(1) << (low % 64);
+  array.clear();
+  array.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::toArray()
+{
+  array.clear();
+  array.reserve(card);
+  for (std::size_t w = 0; w < bits.size(); ++w)
+    for (auto word = bits[w]; word; word &= word - 1)
+      array.push_back(std::uint16_t(w * 64 + countTrailingZeros(word)));
+  bits.clear();
+  bits.shrink_to_fit();
+}
+
+/**
+ * Recount a bitset and pick the smaller representation
+ */
+void RoaringBitmap::Container::normalize()
+{
+  if (isBitset()) {
+    card = 0;
+    for (auto word : bits)
+      card += popcount(word);
+    if (card <= cArrayMax)
+      toArray();
+  } else {
+    card = array.size();
+    if (card > cArrayMax)
+      toBitset();
+  }
+}
+
+/*========================================================================*/
+std::size_t RoaringBitmap::find(std::uint16_t key) const
+{
+  return std::lower_bound(m_keys.begin(), m_keys.end(), key) - m_keys.begin();
+}
+
+void RoaringBitmap::add(std::uint32_t value)
+{
+  std::uint16_t key = value >> 16, low = value & 0xFFFF;
+  auto i = find(key);
+  if (i == m_keys.size() || m_keys[i] != key) {
+    m_keys.insert(m_keys.begin() + i, key);
+    m_containers.insert(m_containers.begin() + i, Container());
+  }
+
+  auto& c = m_containers[i];
+  if (c.isBitset()) {
+    auto& word = c.bits[low / 64];
+    auto mask = std::uint64_t(1) << (low % 64);
+    if (!(word & mask)) {
+      word |= mask;
+      ++c.card;
+    }
+    return;
+  }
+
+  auto it = std::lower_bound(c.array.begin(), c.array.end(), low);
+  if (it != c.array.end() && *it == low)
+    return;
+  c.array.insert(it, low);
+  if (++c.card > cArrayMax)
+    c.toBitset();
+}
+
+bool RoaringBitmap::remove(std::uint32_t value)
+{
+  std::uint16_t key = value >> 16, low = value & 0xFFFF;
+  auto i = find(key);
+  if (i == m_keys.size() || m_keys[i] != key)
+    return false;
+
+  auto& c = m_containers[i];
+  if (c.isBitset()) {
+    auto& word = c.bits[low / 64];
+    auto mask = std::uint64_t(1) << (low % 64);
+    if (!(word & mask))
+      return false;
+    word &= ~mask;
+    if (--c.card <= cArrayMax)
+      c.toArray();
+  } else {
+    auto it = std::lower_bound(c.array.begin(), c.array.end(), low);
+    if (it == c.array.end() || *it != low)
+      return false;
+    c.array.erase(it);
+    --c.card;
+  }
+
+  if (!c.card) {
+    m_keys.erase(m_keys.begin() + i);
+    m_containers.erase(m_containers.begin() + i);
+  }
+  return true;
+}
+
+bool RoaringBitmap::contains(std::uint32_t value) const
+{
+  std::uint16_t key = value >> 16;
+  auto i = find(key);
+  return i != m_keys.size() && m_keys[i] == key &&
+         m_containers[i].contains(value & 0xFFFF);
+}
+
+std::size_t RoaringBitmap::cardinality() const
+{
+  std::size_t n = 0;
+  for (auto& c : m_containers)
+    n += c.card;
+  return n;
+}
+
+void RoaringBitmap::clear()
+{
+  m_keys.clear();
+  m_containers.clear();
+}
+
+std::vector<std::uint32_t> RoaringBitmap::toVector() const
+{
+  std::vector<std::uint32_t> values;
+  values.reserve(cardinality());
+  forEach([&](std::uint32_t value) { values.push_back(value); });
+  return values;
+}
+
+std::size_t RoaringBitmap::memoryUsage() const
+{
+  std::size_t n = m_keys.capacity() * sizeof(std::uint16_t) +
+                  m_containers.capacity() * sizeof(Container);
+  for (auto& c : m_containers)
+    n += c.array.capacity() * sizeof(std::uint16_t) +
+         c.bits.capacity() * sizeof(std::uint64_t);
+  return n;
+}
+
+/*========================================================================*/
+RoaringBitmap::Container RoaringBitmap::unite(
+    const Container& a, const Container& b)
+{
+  Container c;
+  if (a.isBitset() || b.isBitset()) {
+    c = a.isBitset() ? a : b;
+    auto& other = a.isBitset() ? b : a;
+    if (other.isBitset()) {
+      for (std::size_t w = 0; w < cBitsetWords; ++w)
+        c.bits[w] |= other.bits[w];
+    } else {
+      for (auto low : other.array)
+        c.bits[low / 64] |= std::uint64_t(1) << (low % 64);
+    }
+  } else {
+    c.array.reserve(a.array.size() + b.array.size());
+    std::set_union(a.array.begin(), a.array.end(), b.array.begin(),
+        b.array.end(), std::back_inserter(c.array));
+  }
+  c.normalize();
+  return c;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(
+    const Container& a, const Container& b)
+{
+  Container c;
+  if (a.isBitset() && b.isBitset()) {
+    c.bits.resize(cBitsetWords);
+    for (std::size_t w = 0; w < cBitsetWords; ++w)
+      c.bits[w] = a.bits[w] & b.bits[w];
+  } else if (a.isBitset() || b.isBitset()) {
+    auto& array = a.isBitset() ? b.array : a.array;
+    auto& bitset = a.isBitset() ? a : b;
+    for (auto low : array)
+      if (bitset.contains(low))
+        c.array.push_back(low);
+  } else {
+    std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(),
+        b.array.end(), std::back_inserter(c.array));
+  }
+  c.normalize();
+  return c;
+}
+
+RoaringBitmap::Container RoaringBitmap::subtract(
+    const Container& a, const Container& b)
+{
+  Container c;
+  if (a.isBitset()) {
+    c = a;
+    if (b.isBitset()) {
+      for (std::size_t w = 0; w < cBitsetWords; ++w)
+        c.bits[w] &= ~b.bits[w];
+    } else {
+      for (auto low : b.array)
+        c.bits[low / 64] &= ~(std::uint64_t(1) << (low % 64));
+    }
+  } else if (b.isBitset()) {
+    for (auto low : a.array)
+      if (!b.contains(low))
+        c.array.push_back(low);
+  } else {
+    std::set_difference(a.array.begin(), a.array.end(), b.array.begin(),
+        b.array.end(), std::back_inserter(c.array));
+  }
+  c.normalize();
+  return c;
+}
+
+RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other)
+{
+  RoaringBitmap result;
+  std::size_t i = 0, j = 0;
+  while (i < m_keys.size() || j < other.m_keys.size()) {
+    if (j == other.m_keys.size() ||
+        (i < m_keys.size() && m_keys[i] < other.m_keys[j])) {
+      result.m_keys.push_back(m_keys[i]);
+      result.m_containers.push_back(std::move(m_containers[i++]));
+    } else if (i == m_keys.size() || other.m_keys[j] < m_keys[i]) {
+      result.m_keys.push_back(other.m_keys[j]);
+      result.m_containers.push_back(other.m_containers[j++]);
+    } else {
+      result.m_keys.push_back(m_keys[i]);
+      result.m_containers.push_back(
+          unite(m_containers[i++], other.m_containers[j++]));
+    }
+  }
+  return *this = std::move(result);
+}
+
+RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other)
+{
+  RoaringBitmap result;
+  std::size_t i = 0, j = 0;
+  while (i < m_keys.size() && j < other.m_keys.size()) {
+    if (m_keys[i] < other.m_keys[j]) {
+      ++i;
+    } else if (other.m_keys[j] < m_keys[i]) {
+      ++j;
+    } else {
+      auto c = intersect(m_containers[i], other.m_containers[j]);
+      if (c.card) {
+        result.m_keys.push_back(m_keys[i]);
+        result.m_containers.push_back(std::move(c));
+      }
+      ++i;
+      ++j;
+    }
+  }
+  return *this = std::move(result);
+}
+
+RoaringBitmap& RoaringBitmap::andNot(const RoaringBitmap& other)
+{
+  RoaringBitmap result;
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < m_keys.size(); ++i) {
+    while (j < other.m_keys.size() && other.m_keys[j] < m_keys[i])
+      ++j;
+    if (j < other.m_keys.size() && other.m_keys[j] == m_keys[i]) {
+      auto c = subtract(m_containers[i], other.m_containers[j]);
+      if (!c.card)
+        continue;
+      result.m_containers.push_back(std::move(c));
+    } else {
+      result.m_containers.push_back(std::move(m_containers[i]));
+    }
+    result.m_keys.push_back(m_keys[i]);
+  }
+  return *this = std::move(result);
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap& other) const
+{
+  if (m_keys != other.m_keys)
+    return false;
+  for (std::size_t i = 0; i < m_containers.size(); ++i) {
+    // representation only depends on the cardinality
+    auto& a = m_containers[i];
+    auto& b = other.m_containers[i];
+    if (a.card != b.card || a.array != b.array || a.bits != b.bits)
+      return false;
+  }
+  return true;
+}
+
+/*========================================================================*/
+/*
+ * Format: uint32 number of containers, then for every container
+ * uint16 key, uint32 cardinality and either `cardinality` uint16 values
+ * (array) or 1024 uint64 words (bitset, if cardinality > cArrayMax).
+ */
+std::string RoaringBitmap::serialize() const
+{
+  std::string out;
+  putLE(out, m_keys.size(), 4);
+  for (std::size_t i = 0; i < m_keys.size(); ++i) {
+    auto& c = m_containers[i];
+    putLE(out, m_keys[i], 2);
+    putLE(out, c.card, 4);
+    if (c.isBitset()) {
+      for (auto word : c.bits)
+        putLE(out, word, 8);
+    } else {
+      for (auto low : c.array)
+        putLE(out, low, 2);
+    }
+  }
+  return out;
+}
+
+bool RoaringBitmap::deserialize(
+    const char* data, std::size_t size, RoaringBitmap& out)
+{
+  const char* end = data + size;
+  RoaringBitmap result;
+
+  auto read = [&]() {
+    std::uint64_t n_container, key, card, value;
+    if (!getLE(data, end, n_container, 4))
+      return false;
+
+    for (std::uint64_t i = 0; i < n_container; ++i) {
+      if (!getLE(data, end, key, 2) || !getLE(data, end, card, 4) || !card ||
+          card > 65536 ||
+          (!result.m_keys.empty() && key <= result.m_keys.back()))
+        return false;
+
+      Container c;
+      if (card > cArrayMax) {
+        c.bits.resize(cBitsetWords);
+        for (auto& word : c.bits) {
+          if (!getLE(data, end, value, 8))
+            return false;
+          word = value;
+        }
+      } else {
+        c.array.resize(card);
+        for (std::size_t k = 0; k < card; ++k) {
+          if (!getLE(data, end, value, 2) || (k && value <= c.array[k - 1]))
+            return false;
+          c.array[k] = value;
+        }
+      }
+
+      c.normalize();
+      if (c.card != card || c.isBitset() != (card > cArrayMax))
+        return false;
+
+      result.m_keys.push_back(key);
+      result.m_containers.push_back(std::move(c));
+    }
+
+    return data == end;
+  };
+
+  if (!read()) {
+    out.clear();
+    return false;
+  }
+
+  out = std::move(result);
+  return true;
+}
+
+} // namespace pymol
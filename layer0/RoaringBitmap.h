@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pymol
+{
+
+/**
+ * Compressed set of 32-bit integers (roaring bitmap).
+ *
+ * Values are grouped by their upper 16 bits into containers. A container
+ * with at most cArrayMax values stores them as a sorted array of the lower
+ * 16 bits, a denser one as a 65536-bit bitset. Sparse and dense sets both
+ * stay compact, e.g. a selection of one residue or of all waters.
+ */
+class RoaringBitmap
+{
+public:
+  /// Containers with more values than this are stored as bitsets
+  static constexpr std::size_t cArrayMax = 4096;
+
+  void add(std::uint32_t value);
+
+  /**
+   * @return false if the value was not in the set
+   */
+  bool remove(std::uint32_t value);
+
+  bool contains(std::uint32_t value) const;
+
+  /**
+   * Number of values in the set
+   */
+  std::size_t cardinality() const;
+
+  bool empty() const { return m_keys.empty(); }
+
+  void clear();
+
+  RoaringBitmap& operator|=(const RoaringBitmap& other);
+  RoaringBitmap& operator&=(const RoaringBitmap& other);
+
+  /**
+   * this = this and not other
+   */
+  RoaringBitmap& andNot(const RoaringBitmap& other);
+
+  bool operator==(const RoaringBitmap& other) const;
+  bool operator!=(const RoaringBitmap& other) const { return !(*this == other); }
+
+  /**
+   * Calls `fn(value)` for all values in ascending order
+   */
+  template <typename Fn> void forEach(Fn&& fn) const
+  {
+    for (std::size_t i = 0; i < m_keys.size(); ++i) {
+      std::uint32_t high = std::uint32_t(m_keys[i]) << 16;
+      auto& c = m_containers[i];
+      if (c.isBitset()) {
+        for (std::size_t w = 0; w < c.bits.size(); ++w) {
+          for (auto word = c.bits[w]; word; word &= word - 1) {
+            fn(high | std::uint32_t(w * 64 + countTrailingZeros(word)));
+          }
+        }
+      } else {
+        for (auto low : c.array) {
+          fn(high | low);
+        }
+      }
+    }
+  }
+
+  std::vector<std::uint32_t> toVector() const;
+
+  /**
+   * Approximate number of bytes used by the containers
+   */
+  std::size_t memoryUsage() const;
+
+  /**
+   * Portable (little endian) binary representation, e.g. for sessions
+   */
+  std::string serialize() const;
+
+  /**
+   * Inverse of serialize()
+   * @return false (and leaves `out` empty) if the data is malformed
+   */
+  static bool deserialize(const char* data, std::size_t size, RoaringBitmap& out);
+
+private:
+  struct Container {
+    std::vector<std::uint16_t> array; ///< sorted, if not a bitset
+    std::vector<std::uint64_t> bits;  ///< 1024 words, or empty
+    std::uint32_t card = 0;
+
+    bool isBitset() const { return !bits.empty(); }
+    bool contains(std::uint16_t low) const;
+    void toBitset();
+    void toArray();
+    void normalize();
+  };
+
+  static unsigned countTrailingZeros(std::uint64_t word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    unsigned n = 0;
+    for (; !(word & 1); word >>= 1)
+      ++n;
+    return n;
+#endif
+  }
+
+  static Container unite(const Container& a, const Container& b);
+  static Container intersect(const Container& a, const Container& b);
+  static Container subtract(const Container& a, const Container& b);
+
+  /// Index of the container for `key`, or where it would be inserted
+  std::size_t find(std::uint16_t key) const;
+
+  std::vector<std::uint16_t> m_keys; ///< sorted upper 16 bits
+  std::vector<Container> m_containers;
+};
+
+} // namespace pymol
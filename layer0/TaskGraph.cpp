@@ -0,0 +1,118 @@
+/*
+ * Native task scheduler with dependencies
+ */
+
+#include "TaskGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "ThreadPool.h"
+
+namespace pymol
+{
+
+TaskGraph::TaskId TaskGraph::add(std::function<void()> func,
+    const std::vector<TaskId>& deps, bool main_thread)
+{
+  TaskId id = m_tasks.size();
+
+  Task task;
+  task.func = std::move(func);
+  task.main_thread = main_thread;
+
+  for (auto dep : deps) {
+    assert(dep < id);
+    m_tasks[dep].successors.push_back(id);
+    ++task.n_deps;
+  }
+
+  m_tasks.push_back(std::move(task));
+  return id;
+}
+
+void TaskGraph::run(int n_worker)
+{
+  const std::size_t n_task = m_tasks.size();
+
+  if (n_worker < 1) {
+    n_worker = 1;
+  }
+
+  // split all threads among the tasks, for parallel loops within tasks
+  ThreadBudget budget(n_worker);
+
+  // no point in more threads than tasks which may run concurrently
+  n_worker = std::min<std::size_t>(n_worker, std::max<std::size_t>(n_task, 1));
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<TaskId> ready, ready_main;
+  std::size_t n_done = 0;
+  std::size_t n_running = 0;
+
+  auto update_budget = [&] {
+    budget.setScheduled(int(n_running + ready.size() + ready_main.size()));
+  };
+
+  for (TaskId id = 0; id < n_task; ++id) {
+    if (!m_tasks[id].n_deps) {
+      (m_tasks[id].main_thread ? ready_main : ready).push_back(id);
+    }
+  }
+  update_budget();
+
+  ThreadPoolRun(n_worker, [&](int worker) {
+    ThreadBudget::Scope scope(&budget);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;) {
+      cond.wait(lock, [&] {
+        return n_done == n_task || !ready.empty() ||
+               (worker == 0 && !ready_main.empty());
+      });
+
+      if (n_done == n_task) {
+        break;
+      }
+
+      TaskId id;
+      if (worker == 0 && !ready_main.empty()) {
+        id = ready_main.front();
+        ready_main.pop_front();
+      } else {
+        id = ready.front();
+        ready.pop_front();
+      }
+
+      ++n_running;
+      lock.unlock();
+      m_tasks[id].func();
+      lock.lock();
+      --n_running;
+
+      bool wake = false;
+
+      for (auto succ : m_tasks[id].successors) {
+        auto& task = m_tasks[succ];
+        if (!--task.n_deps) {
+          (task.main_thread ? ready_main : ready).push_back(succ);
+          wake = true;
+        }
+      }
+
+      update_budget();
+
+      if (++n_done == n_task || wake) {
+        cond.notify_all();
+      }
+    }
+  });
+
+  m_tasks.clear();
+}
+
+} // namespace pymol
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace pymol
+{
+
+/**
+ * Set of tasks with dependencies, executed on native threads.
+ *
+ * A task becomes ready once all of its dependencies have finished. Ready
+ * tasks are run by any worker, except "main thread" tasks, which only run on
+ * worker 0 (the thread which called run()). Those may call back into Python
+ * or the GUI, see ThreadPoolRun.
+ *
+ * @verbatim
+   TaskGraph graph;
+   auto prep = graph.add([&] { ... });
+   graph.add([&] { ... }, {prep});
+   graph.add([&] { ... }, {prep});
+   graph.run(n_thread);
+   @endverbatim
+ */
+class TaskGraph
+{
+public:
+  using TaskId = std::size_t;
+
+  /**
+   * Add a task.
+   * @param deps tasks which must finish before this one starts. Must have
+   * been added before, so the graph is acyclic by construction.
+   * @param main_thread only run this task on the thread which calls run()
+   * @return id for use in `deps` of later tasks
+   */
+  TaskId add(std::function<void()> func, const std::vector<TaskId>& deps = {},
+      bool main_thread = false);
+
+  /**
+   * Number of tasks
+   */
+  std::size_t size() const { return m_tasks.size(); }
+
+  bool empty() const { return m_tasks.empty(); }
+
+  /**
+   * Run all tasks on up to `n_worker` threads and wait for them to finish.
+   * The graph is empty afterwards and may be reused.
+   */
+  void run(int n_worker);
+
+private:
+  struct Task {
+    std::function<void()> func;
+    std::vector<TaskId> successors;
+    std::size_t n_deps = 0;
+    bool main_thread = false;
+  };
+
+  std::vector<Task> m_tasks;
+};
+
+} // namespace pymol
@@ -0,0 +1,294 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+/*
+ * Native work-stealing thread pool
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace pymol
+{
+
+WorkStealingQueue::WorkStealingQueue(std::size_t n_task, int n_worker)
+    : m_size(n_task)
+{
+  if (n_worker < 1) {
+    n_worker = 1;
+  }
+
+  m_runs.reserve(n_worker);
+
+  for (int a = 0; a < n_worker; ++a) {
+    auto run = std::unique_ptr<Run>(new Run);
+    run->begin = (n_task * a) / n_worker;
+    run->end = (n_task * (a + 1)) / n_worker;
+    m_runs.push_back(std::move(run));
+  }
+}
+
+bool WorkStealingQueue::pop(int worker, std::size_t& task)
+{
+  auto& run = *m_runs[worker];
+
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(run.mutex);
+      if (run.begin < run.end) {
+        task = run.begin++;
+        return true;
+      }
+    }
+
+    if (!steal(worker)) {
+      return false;
+    }
+  }
+}
+
+/**
+ * Move the upper half of the largest foreign run into the (empty) run of
+ * `worker`.
+ * @return false if there was nothing left to steal
+ */
+bool WorkStealingQueue::steal(int worker)
+{
+  const int n_worker = m_runs.size();
+
+  for (;;) {
+    int victim = -1;
+    std::size_t victim_size = 0;
+
+    for (int a = 0; a < n_worker; ++a) {
+      if (a == worker) {
+        continue;
+      }
+      auto& run = *m_runs[a];
+      std::lock_guard<std::mutex> lock(run.mutex);
+      std::size_t size = run.end - run.begin;
+      if (size > victim_size) {
+        victim_size = size;
+        victim = a;
+      }
+    }
+
+    if (victim < 0) {
+      return false;
+    }
+
+    std::size_t begin, end;
+
+    {
+      auto& run = *m_runs[victim];
+      std::lock_guard<std::mutex> lock(run.mutex);
+      if (run.begin >= run.end) {
+        // drained in the meantime, look again
+        continue;
+      }
+      end = run.end;
+      begin = run.end - (run.end - run.begin + 1) / 2;
+      run.end = begin;
+    }
+
+    auto& run = *m_runs[worker];
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.begin = begin;
+    run.end = end;
+    return true;
+  }
+}
+
+std::size_t WorkStealingQueue::done() const
+{
+  std::size_t remaining = 0;
+  for (auto& run : m_runs) {
+    std::lock_guard<std::mutex> lock(run->mutex);
+    remaining += run->end - run->begin;
+  }
+  return m_size - remaining;
+}
+
+static thread_local bool s_is_worker = false;
+
+bool ThreadPoolIsWorker()
+{
+  return s_is_worker;
+}
+
+static thread_local const ThreadBudget* s_budget = nullptr;
+
+int ThreadBudget::share() const
+{
+  int n_scheduled = std::max(1, m_n_scheduled.load(std::memory_order_relaxed));
+  return std::max(1, m_n_worker / n_scheduled);
+}
+
+ThreadBudget::Scope::Scope(const ThreadBudget* budget)
+    : m_prev(s_budget)
+{
+  s_budget = budget;
+}
+
+ThreadBudget::Scope::~Scope()
+{
+  s_budget = m_prev;
+}
+
+int ThreadPoolBudget(int n_max)
+{
+  if (s_budget) {
+    n_max = std::min(n_max, s_budget->share());
+  }
+  return std::max(1, n_max);
+}
+
+namespace
+{
+
+/**
+ * One ThreadPoolRun call. Workers [1, n_worker) are claimed by pool threads
+ * or, if still unclaimed after func(0), by the calling thread.
+ */
+struct PoolJob {
+  const std::function<void(int)>* func;
+  int n_worker;
+  int next = 1;     ///< next unclaimed worker
+  int finished = 0; ///< finished workers > 0
+};
+
+class Pool
+{
+  std::mutex m_mutex;
+  std::condition_variable m_work;     ///< jobs were queued
+  std::condition_variable m_finished; ///< a worker finished
+  std::deque<PoolJob*> m_jobs;        ///< jobs with unclaimed workers
+  std::vector<std::thread> m_threads;
+  bool m_stop = false;
+
+  /**
+   * Claim the next worker of `job`.
+   * @pre locked, job has unclaimed workers
+   */
+  int claim(PoolJob& job)
+  {
+    int worker = job.next++;
+    if (job.next == job.n_worker) {
+      m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+    }
+    return worker;
+  }
+
+  void loop()
+  {
+    s_is_worker = true;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_work.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+      if (m_stop) {
+        break;
+      }
+      auto& job = *m_jobs.front();
+      int worker = claim(job);
+      lock.unlock();
+      (*job.func)(worker);
+      lock.lock();
+      ++job.finished;
+      m_finished.notify_all();
+    }
+  }
+
+public:
+  ~Pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_work.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  void run(int n_worker, const std::function<void(int)>& func)
+  {
+    PoolJob job;
+    job.func = &func;
+    job.n_worker = n_worker;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      while (m_threads.size() < std::size_t(n_worker - 1)) {
+        m_threads.emplace_back(&Pool::loop, this);
+      }
+      m_jobs.push_back(&job);
+    }
+    m_work.notify_all();
+
+    func(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // run what the pool hasn't picked up
+    while (job.next < job.n_worker) {
+      int worker = claim(job);
+      lock.unlock();
+      func(worker);
+      lock.lock();
+      ++job.finished;
+    }
+
+    m_finished.wait(
+        lock, [&job] { return job.finished == job.n_worker - 1; });
+  }
+};
+
+} // namespace
+
+void ThreadPoolRun(int n_worker, const std::function<void(int)>& func)
+{
+  if (n_worker < 2) {
+    func(0);
+    return;
+  }
+
+  static Pool pool;
+  pool.run(n_worker, func);
+}
+
+void ThreadPoolRunTasks(int n_worker, std::size_t n_task,
+    const std::function<void(int, std::size_t)>& func)
+{
+  if (n_worker < 1) {
+    n_worker = 1;
+  }
+
+  WorkStealingQueue queue(n_task, n_worker);
+
+  ThreadPoolRun(n_worker, [&](int worker) {
+    std::size_t task;
+    while (queue.pop(worker, task)) {
+      func(worker, task);
+    }
+  });
+}
+
+} // namespace pymol
@@ -0,0 +1,134 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pymol
+{
+/**
+ * Work-stealing queue of task indices [0, n_task).
+ *
+ * The range is initially split into contiguous runs, one per worker. A
+ * worker pops from the front of its own run and, once that is exhausted,
+ * steals the upper half of the largest remaining run of another worker.
+ */
+class WorkStealingQueue
+{
+public:
+  WorkStealingQueue(std::size_t n_task, int n_worker);
+
+  /**
+   * Get the next task for a worker.
+   * @param worker worker index in [0, n_worker)
+   * @param[out] task next task index
+   * @return false if no tasks are left
+   */
+  bool pop(int worker, std::size_t& task);
+
+  /**
+   * @return the number of tasks which have been handed out so far
+   */
+  std::size_t done() const;
+
+  /**
+   * @return the total number of tasks
+   */
+  std::size_t size() const { return m_size; }
+
+private:
+  struct Run {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+  };
+
+  bool steal(int worker);
+
+  std::vector<std::unique_ptr<Run>> m_runs;
+  std::size_t m_size = 0;
+};
+
+/**
+ * Run `func(worker)` concurrently on `n_worker` threads and wait for all of
+ * them to finish. Worker 0 runs on the calling thread, so it's the only one
+ * which may call back into Python or the GUI (e.g. OrthoBusyFast).
+ *
+ * Workers > 0 run on persistent pool threads, which are started on first
+ * use. Calls may be nested or concurrent: while the pool is busy, the
+ * calling thread runs the workers which no pool thread has picked up yet,
+ * after func(0). So `func` must not wait for another worker to start.
+ */
+void ThreadPoolRun(int n_worker, const std::function<void(int)>& func);
+
+/**
+ * @return true on the threads started by ThreadPoolRun (workers > 0), which
+ * must not call into Python or the GUI
+ */
+bool ThreadPoolIsWorker();
+
+/**
+ * Workers of a TaskGraph run, shared by its scheduled (running or ready)
+ * tasks. A task which runs a parallel loop itself, like a surface
+ * calculation, takes its share with ThreadPoolBudget, so concurrent tasks
+ * don't each start max_threads threads.
+ */
+class ThreadBudget
+{
+  int m_n_worker;
+  std::atomic<int> m_n_scheduled{0};
+
+public:
+  explicit ThreadBudget(int n_worker) : m_n_worker(n_worker) {}
+
+  /// Update the number of running and ready tasks
+  void setScheduled(int n) { m_n_scheduled.store(n, std::memory_order_relaxed); }
+
+  /// Threads per scheduled task, at least 1
+  int share() const;
+
+  /// Budget of the calling thread while in scope
+  class Scope
+  {
+    const ThreadBudget* m_prev;
+
+  public:
+    explicit Scope(const ThreadBudget* budget);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+};
+
+/**
+ * Threads for a parallel loop: `n_max` (e.g. max_threads), limited to the
+ * ThreadBudget share when called from a TaskGraph task.
+ */
+int ThreadPoolBudget(int n_max);
+
+/**
+ * Convenience wrapper: distribute tasks [0, n_task) over `n_worker` threads
+ * with a WorkStealingQueue and call `func(worker, task)` for each task.
+ */
+void ThreadPoolRunTasks(int n_worker, std::size_t n_task,
+    const std::function<void(int, std::size_t)>& func);
+} // namespace pymol
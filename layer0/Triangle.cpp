@@ -40,6 +40,16 @@ Z* -------------------------------------------------------------------
 #include"Ortho.h"
 #include"Feedback.h"
 #include"Util.h"
+#include"ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+/* below this many points, triangulate on the calling thread only */
+#define cTriangleParallelMinPoints 10000
 
 typedef struct {
   int index;
@@ -2277,9 +2287,9 @@ static int TriangleBruteForceClosure(TriangleSurfaceRec * II, float *v, float *v
   return ok;
 }
 
-int *TrianglePointsToSurface(PyMOLGlobals * G, float *v, float *vn, int n,
-                             float cutoff, int *nTriPtr, int **stripPtr,
-                             float *extent, int cavity_mode)
+static int *TrianglePointsToSurfacePatch(PyMOLGlobals * G, float *v, float *vn, int n,
+                                         float cutoff, int *nTriPtr, int **stripPtr,
+                                         float *extent, int cavity_mode)
 {
   TriangleSurfaceRec *I = NULL;
   int ok = true;
@@ -2414,6 +2424,209 @@ int *TrianglePointsToSurface(PyMOLGlobals * G, float *v, float *vn, int n,
   return (result);
 }
 
+/**
+ * Split points into groups which can be triangulated independently. Points
+ * closer than `link_dist` always end up in the same group. Uses a grid with
+ * cells of size `link_dist` and joins all points in adjacent cells, so
+ * groups may be larger than necessary.
+ *
+ * @param[out] n_group number of groups
+ * @return group index for every point, groups are numbered in order of
+ * their first point
+ */
+static std::vector<int> TrianglePartition(const float *v, int n,
+                                          float link_dist, int *n_group)
+{
+  std::vector<int> parent(n);
+  std::iota(parent.begin(), parent.end(), 0);
+
+  auto find = [&](int a) {
+    while(parent[a] != a)
+      a = parent[a] = parent[parent[a]];
+    return a;
+  };
+  auto unite = [&](int a, int b) {
+    a = find(a);
+    b = find(b);
+    if(a != b)
+      parent[std::max(a, b)] = std::min(a, b);
+  };
+
+  // 21 bits per axis
+  auto cell_key = [](int i, int j, int k) {
+    return ((std::uint64_t(i) & 0x1FFFFF) << 42) |
+           ((std::uint64_t(j) & 0x1FFFFF) << 21) | (std::uint64_t(k) & 0x1FFFFF);
+  };
+
+  std::unordered_map<std::uint64_t, int> cells; // key -> first point
+  std::vector<int> cell_ijk;
+  cells.reserve(n / 4 + 1);
+
+  for(int a = 0; a < n; a++) {
+    int ijk[3];
+    for(int d = 0; d < 3; d++)
+      ijk[d] = (int) floorf(v[a * 3 + d] / link_dist);
+    auto it = cells.emplace(cell_key(ijk[0], ijk[1], ijk[2]), a);
+    if(it.second) {
+      cell_ijk.insert(cell_ijk.end(), ijk, ijk + 3);
+    } else {
+      unite(it.first->second, a);
+    }
+  }
+
+  for(size_t c = 0; c < cell_ijk.size(); c += 3) {
+    const int *ijk = cell_ijk.data() + c;
+    int first = cells[cell_key(ijk[0], ijk[1], ijk[2])];
+    for(int di = -1; di <= 1; di++)
+      for(int dj = -1; dj <= 1; dj++)
+        for(int dk = -1; dk <= 1; dk++) {
+          auto it = cells.find(cell_key(ijk[0] + di, ijk[1] + dj, ijk[2] + dk));
+          if(it != cells.end())
+            unite(first, it->second);
+        }
+  }
+
+  std::vector<int> group(n);
+  *n_group = 0;
+  for(int a = 0; a < n; a++) {
+    int root = find(a);
+    group[a] = (root == a) ? (*n_group)++ : group[root];
+  }
+  return group;
+}
+
+/**
+ * Triangulate a set of surface points. With n_thread > 1, groups of points
+ * which are too far apart to share any triangle (see TrianglePartition) are
+ * triangulated concurrently. Every group gets the
+ * same treatment as a whole surface, so the result is the same set of
+ * triangles as a serial run, except that passes limited by
+ * triangle_max_passes and the brute force closure are counted per group.
+ *
+ * @param v points, n * 3
+ * @param vn point normals, n * 3, get adjusted to the triangles
+ * @param[out] nTriPtr number of triangles
+ * @param[out] stripPtr triangle strip VLA (count, vert, vert, ..., 0)
+ * @param n_thread thread budget of the caller, see ThreadPoolBudget
+ * @return triangle VLA, nTriPtr * 3 vertex indices, or NULL on failure
+ */
+int *TrianglePointsToSurface(PyMOLGlobals * G, float *v, float *vn, int n,
+                             float cutoff, int *nTriPtr, int **stripPtr,
+                             float *extent, int cavity_mode, int n_thread)
+{
+  int n_group = 1;
+  std::vector<int> group;
+
+  if(n_thread > 1 && n >= cTriangleParallelMinPoints) {
+    /* the triangulation passes look at most two map cells (of size
+       cutoff) away, the brute force closure at most 3 * cutoff */
+    group = TrianglePartition(v, n, cutoff * 4.0F, &n_group);
+  }
+
+  if(n_group < 2) {
+    return TrianglePointsToSurfacePatch(G, v, vn, n, cutoff, nTriPtr, stripPtr,
+                                        extent, cavity_mode);
+  }
+
+  struct Patch {
+    std::vector<int> index;     /* global point indices, ascending */
+    int *tri = NULL;
+    int *strip = NULL;
+    int nTri = 0;
+    int ok = true;
+  };
+
+  std::vector<Patch> patches(n_group);
+  for(int a = 0; a < n; a++)
+    patches[group[a]].index.push_back(a);
+
+  /* largest patches first, for load balancing */
+  std::vector<int> order(n_group);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return patches[a].index.size() > patches[b].index.size();
+  });
+
+  PRINTFB(G, FB_Triangle, FB_Blather)
+    " Triangle: %d independent patches, largest %d of %d points\n", n_group,
+    (int) patches[order[0]].index.size(), n ENDFB(G);
+
+  pymol::ThreadPoolRunTasks(std::min(n_thread, n_group), n_group,
+      [&](int worker, size_t t) {
+    auto& patch = patches[order[t]];
+    const int m = patch.index.size();
+    if(m < 3 || G->Interrupt)
+      return;
+
+    std::vector<float> pv(m * 3), pvn(m * 3);
+    for(int a = 0; a < m; a++) {
+      copy3f(v + patch.index[a] * 3, pv.data() + a * 3);
+      copy3f(vn + patch.index[a] * 3, pvn.data() + a * 3);
+    }
+
+    patch.tri = TrianglePointsToSurfacePatch(G, pv.data(), pvn.data(), m,
+        cutoff, &patch.nTri, &patch.strip, NULL, cavity_mode);
+    patch.ok = (patch.tri != NULL);
+
+    /* adjusted normals, patches have disjoint points */
+    for(int a = 0; a < m; a++)
+      copy3f(pvn.data() + a * 3, vn + patch.index[a] * 3);
+  });
+
+  int ok = !G->Interrupt;
+  int nTri = 0, nStrip = 1;
+
+  for(auto& patch : patches) {
+    ok &= patch.ok;
+    nTri += patch.nTri;
+    if(patch.strip) {
+      for(const int *s = patch.strip; *s; s += *s + 3)
+        nStrip += *s + 3;
+    }
+  }
+
+  int *result = NULL;
+  int *strip = NULL;
+
+  if(ok) {
+    result = VLAlloc(int, nTri * 3 + 1);
+    strip = VLAlloc(int, nStrip);
+    ok = result && strip;
+  }
+
+  if(ok) {
+    /* concatenate in patch order, with global point indices */
+    int *t = result;
+    int *s = strip;
+    for(auto& patch : patches) {
+      const auto& index = patch.index;
+      for(int a = 0; a < patch.nTri * 3; a++)
+        *(t++) = index[patch.tri[a]];
+      if(patch.strip) {
+        for(const int *ps = patch.strip; *ps; ) {
+          int c = *(ps++);
+          *(s++) = c;
+          for(int b = 0; b < c + 2; b++)
+            *(s++) = index[*(ps++)];
+        }
+      }
+    }
+    *s = 0;
+    *nTriPtr = nTri;
+    *stripPtr = strip;
+  } else {
+    VLAFreeP(result);
+    VLAFreeP(strip);
+  }
+
+  for(auto& patch : patches) {
+    VLAFreeP(patch.tri);
+    VLAFreeP(patch.strip);
+  }
+
+  return result;
+}
+
 void CalculateTriangleNormal(float *p1, float *p2, float *p3, float *n){
   float v1[3], v2[3];
   subtract3f(p2, p1, v1);
@@ -23,7 +23,7 @@ Z* -------------------------------------------------------------------
 
 int *TrianglePointsToSurface(PyMOLGlobals * G, float *v, float *vn, int n,
                              float cutoff, int *nTriPtr, int **stripPtr, float *extent,
-                             int cavity_mode);
+                             int cavity_mode, int n_thread = 1);
 
 int TriangleDegenerate(float *v1, float *n1, float *v2, float *n2, float *v3, float *n3);
 
@@ -495,9 +495,11 @@ struct Triangle {
  * the mesh
  * @param gradient_normals Compute normals based on field gradient. If false,
  * then don't compute normals.
+ * @param parallel Use OpenMP (if available)
  * @return The iso-surface mesh
  */
-Mesh march(const Field& volume, float isoLevel, bool gradient_normals)
+Mesh march(const Field& volume, float isoLevel, bool gradient_normals,
+    bool parallel)
 {
   auto const xDim = volume.xDim();
   auto const yDim = volume.yDim();
@@ -505,6 +507,7 @@ Mesh march(const Field& volume, float isoLevel, bool gradient_normals)
 
 #ifndef PYMOL_OPENMP
   using isocheck_bool_t = bool;
+  (void) parallel;
 #else
   // writes to std::vector<bool> are not thread-safe
   using isocheck_bool_t = char;
@@ -513,7 +516,7 @@ Mesh march(const Field& volume, float isoLevel, bool gradient_normals)
   // pre-compute isovalue check for better performance
   std::vector<isocheck_bool_t> isocheck(xDim * yDim * zDim);
 
-#pragma omp parallel for
+#pragma omp parallel for if (parallel)
   for (int z = 0; z < zDim; ++z) {
     for (size_t y = 0; y < yDim; ++y) {
       auto const offset = xDim * y + xDim * yDim * z;
@@ -545,7 +548,7 @@ Mesh march(const Field& volume, float isoLevel, bool gradient_normals)
   trianglesVec.resize(omp_get_max_threads());
   vertexMapVec.resize(zDim);
 
-#pragma omp parallel for
+#pragma omp parallel for if (parallel)
 #endif
   for (int z = 0; z < zEnd; ++z) {
     auto& triangles = trianglesVec[omp_get_thread_num()];
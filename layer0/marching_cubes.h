@@ -48,7 +48,12 @@ struct Mesh {
       faces; //!< the faces given by 3 vertex indices (length = faceCount * 3)
 };
 
-Mesh march(const Field& volume, float isoLevel, bool gradient_normals = true);
+/**
+ * @param parallel Use OpenMP (if available). Pass false when calling from a
+ * thread pool worker.
+ */
+Mesh march(const Field& volume, float isoLevel, bool gradient_normals = true,
+    bool parallel = true);
 
 void calculateNormals(Mesh& mesh);
 
@@ -26,6 +26,17 @@ Z* -------------------------------------------------------------------
 #include"Util.h"
 #include"MemoryCache.h"
 #include"Character.h"
+#include"Setting.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define _PYMOL_RAY_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define _PYMOL_RAY_AVX
+#include <immintrin.h>
+#endif
 
 static const float kR_SMALL4 = 0.0001F;
 static const float kR_SMALL5 = 0.0001F;
@@ -1400,7 +1411,7 @@ void BasisGetEllipsoidNormal(CBasis * I, RayInfo * r, int i, int perspective)
   {
     float *n1 = I->Normal + (3 * I->Vert2Normal[i]);
     float *n2 = n1 + 3, *n3 = n1 + 6;
-    float *scale = r->prim->n0;
+    float *scale = r->prim->ext->n0;
     float d1, d2, d3, s1, s2, s3;
     float comp1[3], comp2[3], comp3[3];
     float direct[3], surfnormal[3];
@@ -1463,11 +1474,14 @@ void BasisGetTriangleNormal(CBasis * I, RayInfo * r, int i, float *fc, int persp
   w2 = 1.0F - (r->tri1 + r->tri2);
   /*  printf("%8.3f %8.3f\n",r->tri[1],r->tri[2]); */
 
-  fc0 = (lprim->c2[0] * r->tri1) + (lprim->c3[0] * r->tri2) + (lprim->c1[0] * w2);
-  fc1 = (lprim->c2[1] * r->tri1) + (lprim->c3[1] * r->tri2) + (lprim->c1[1] * w2);
-  fc2 = (lprim->c2[2] * r->tri1) + (lprim->c3[2] * r->tri2) + (lprim->c1[2] * w2);
+  fc0 = (lprim->c2[0] * r->tri1) + (lprim->ext->c3[0] * r->tri2) + (lprim->c1[0] * w2);
+  fc1 = (lprim->c2[1] * r->tri1) + (lprim->ext->c3[1] * r->tri2) + (lprim->c1[1] * w2);
+  fc2 = (lprim->c2[2] * r->tri1) + (lprim->ext->c3[2] * r->tri2) + (lprim->c1[2] * w2);
 
-  r->trans = (lprim->tr[1] * r->tri1) + (lprim->tr[2] * r->tri2) + (lprim->tr[0] * w2);
+  {
+    const float *tr = lprim->ext->tr;
+    r->trans = (tr[1] * r->tri1) + (tr[2] * r->tri2) + (tr[0] * w2);
+  }
 
   scale3f(n0 + 3, r->tri1, r->surfnormal);
   scale3f(n0 + 6, r->tri2, vt1);
@@ -1500,20 +1514,27 @@ int BasisHitPerspective(BasisCallRec * BC)
 {
   CBasis *BI = BC->Basis;
   MapType *map = BI->Map;
-  int iMin0 = map->iMin[0];
-  int iMin1 = map->iMin[1];
-  int iMin2 = map->iMin[2];
-  int iMax0 = map->iMax[0];
-  int iMax1 = map->iMax[1];
-  int iMax2 = map->iMax[2];
+  BVHType *bvh = BI->BVH;
+  int iMin0 = 0, iMin1 = 0, iMin2 = 0;
+  int iMax0 = 0, iMax1 = 0, iMax2 = 0;
   int a, b, c;
 
-  float iDiv = map->recipDiv;
-  float base0, base1, base2;
-
-  float min0 = map->Min[0] * iDiv;
-  float min1 = map->Min[1] * iDiv;
-  float min2 = map->Min[2] * iDiv;
+  float iDiv = 0.0F;
+  float base0 = 0.0F, base1 = 0.0F, base2 = 0.0F;
+  float min0 = 0.0F, min1 = 0.0F, min2 = 0.0F;
+
+  if(!bvh) {
+    iMin0 = map->iMin[0];
+    iMin1 = map->iMin[1];
+    iMin2 = map->iMin[2];
+    iMax0 = map->iMax[0];
+    iMax1 = map->iMax[1];
+    iMax2 = map->iMax[2];
+    iDiv = map->recipDiv;
+    min0 = map->Min[0] * iDiv;
+    min1 = map->Min[1] * iDiv;
+    min2 = map->Min[2] * iDiv;
+  }
 
   int new_ray = !BC->pass;
   RayInfo *r = BC->rr;
@@ -1524,7 +1545,7 @@ int BasisHitPerspective(BasisCallRec * BC)
 
   CPrimitive *r_prim = NULL;
 
-  if(new_ray) {                 /* see if we can eliminate this ray right away using the mask */
+  if(new_ray && !bvh) {         /* see if we can eliminate this ray right away using the mask */
 
     base0 = (r->base[0] * iDiv) - min0;
     base1 = (r->base[1] * iDiv) - min1;
@@ -1551,7 +1572,7 @@ int BasisHitPerspective(BasisCallRec * BC)
     int allow_break;
     int minIndex = -1;
 
-    float step0, step1, step2;
+    float step0 = 0.0F, step1 = 0.0F, step2 = 0.0F;
     float back_dist = BC->back_dist;
 
     const float _0 = 0.0F, _1 = 1.0F;
@@ -1561,16 +1582,16 @@ int BasisHitPerspective(BasisCallRec * BC)
     int excl_trans_flag;
     int *elist, local_iflag = false;
     int terminal = -1;
-    int *ehead = map->EHead;
-    int d1d2 = map->D1D2;
-    int d2 = map->Dim[2];
+    int *ehead = bvh ? NULL : map->EHead;
+    int d1d2 = bvh ? 0 : map->D1D2;
+    int d2 = bvh ? 0 : map->Dim[2];
     const int *vert2prim = BC->vert2prim;
     const float excl_trans = BC->excl_trans;
     const float BasisFudge0 = BC->fudge0;
     const float BasisFudge1 = BC->fudge1;
     int v2p;
     int i, ii;
-    int n_vert = BI->NVertex, n_eElem = map->NEElem;
+    int n_vert = BI->NVertex, n_eElem = bvh ? bvh->EList.size() : map->NEElem;
     int except1 = BC->except1;
     int except2 = BC->except2;
     int check_interior_flag = BC->check_interior && !BC->pass;
@@ -1582,9 +1603,10 @@ int BasisHitPerspective(BasisCallRec * BC)
     float *BI_Normal = BI->Normal;
     float *BI_Radius = BI->Radius;
     float *BI_Radius2 = BI->Radius2;
+    BVHWalker walker;
     copy3f(r->base, vt);
 
-    elist = map->EList;
+    elist = bvh ? bvh->EList.data() : map->EList;
 
     r_dist = FLT_MAX;
 
@@ -1597,89 +1619,102 @@ int BasisHitPerspective(BasisCallRec * BC)
 
     MapCacheReset(cache);
 
-    {                           /* take steps with a Z-size equil to the grid spacing */
+    if(bvh) {
+      walker.init(bvh, r->base, r->dir, -kR_SMALL4, &BC->bvh_stats);
+    } else {                    /* take steps with a Z-size equil to the grid spacing */
       float div = iDiv * (-MapGetDiv(BI->Map) / r->dir[2]);
       step0 = r->dir[0] * div;
       step1 = r->dir[1] * div;
       step2 = r->dir[2] * div;
-    }
 
-    base0 = (r->skip[0] * iDiv) - min0;
-    base1 = (r->skip[1] * iDiv) - min1;
-    base2 = (r->skip[2] * iDiv) - min2;
+      base0 = (r->skip[0] * iDiv) - min0;
+      base1 = (r->skip[1] * iDiv) - min1;
+      base2 = (r->skip[2] * iDiv) - min2;
+    }
 
     allow_break = false;
     while(1) {
       int inside_code;
       int clamped;
 
-      a = ((int) base0);
-      b = ((int) base1);
-      c = ((int) base2);
+      if(bvh) {
+        /* leaves come front to back, no need to step through a grid */
+        if(!(h = walker.next(std::min(r_dist, back_dist))))
+          break;
+        a = b = c = 0;
+        last_a = -1;
+        inside_code = 1;
+        clamped = false;
+      } else {
+        a = ((int) base0);
+        b = ((int) base1);
+        c = ((int) base2);
 
-      inside_code = 1;
-      clamped = false;
+        inside_code = 1;
+        clamped = false;
 
-      a += MapBorder;
-      b += MapBorder;
-      c += MapBorder;
+        a += MapBorder;
+        b += MapBorder;
+        c += MapBorder;
 #define EDGE_ALLOWANCE 1
 
-      if(a < iMin0) {
-        if(((iMin0 - a) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          a = iMin0;
-          clamped = true;
-        }
-      } else if(a > iMax0) {
-        if(((a - iMax0) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          a = iMax0;
-          clamped = true;
-        }
-      }
-      if(b < iMin1) {
-        if(((iMin1 - b) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          b = iMin1;
-          clamped = true;
-        }
-      } else if(b > iMax1) {
-        if(((b - iMax1) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          b = iMax1;
-          clamped = true;
+        if(a < iMin0) {
+          if(((iMin0 - a) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            a = iMin0;
+            clamped = true;
+          }
+        } else if(a > iMax0) {
+          if(((a - iMax0) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            a = iMax0;
+            clamped = true;
+          }
         }
-      }
-      if(c < iMin2) {
-        if((iMin2 - c) > EDGE_ALLOWANCE)
-          break;
-        else {
-          c = iMin2;
-          clamped = true;
+        if(b < iMin1) {
+          if(((iMin1 - b) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            b = iMin1;
+            clamped = true;
+          }
+        } else if(b > iMax1) {
+          if(((b - iMax1) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            b = iMax1;
+            clamped = true;
+          }
         }
-      } else if(c > iMax2) {
-        if((c - iMax2) > EDGE_ALLOWANCE)
-          inside_code = 0;
-        else {
-          c = iMax2;
-          clamped = true;
+        if(c < iMin2) {
+          if((iMin2 - c) > EDGE_ALLOWANCE)
+            break;
+          else {
+            c = iMin2;
+            clamped = true;
+          }
+        } else if(c > iMax2) {
+          if((c - iMax2) > EDGE_ALLOWANCE)
+            inside_code = 0;
+          else {
+            c = iMax2;
+            clamped = true;
+          }
         }
       }
       if(inside_code && (((a != last_a) || (b != last_b) || (c != last_c)))) {
         int new_min_index;
-        h = *(ehead + (d1d2 * a) + (d2 * b) + c);
+        if(!bvh)
+          h = *(ehead + (d1d2 * a) + (d2 * b) + c);
 
         new_min_index = -1;
 
         if(!clamped)            /* don't discard a ray until it has hit the objective at least once */
           allow_break = true;
 
-        if((terminal > 0) && (last_c != c)) {
+        if(!bvh && (terminal > 0) && (last_c != c)) {
           if(!terminal--)
             break;
         }
@@ -1808,7 +1843,7 @@ int BasisHitPerspective(BasisCallRec * BC)
                       if(LineClipEllipsoidPoint(r->base, r->dir,
                                                 BI_Vertex + i * 3, &dist,
                                                 BI_Radius[i], BI_Radius2[i],
-                                                prm->n0, n1, n1 + 3, n1 + 6)) {
+                                                prm->ext->n0, n1, n1 + 3, n1 + 6)) {
                         if(dist < r_dist) {
                           if((dist >= _0) && (dist <= back_dist)) {
                             new_min_index = prm->vert;
@@ -1990,65 +2025,510 @@ int BasisHitPerspective(BasisCallRec * BC)
   }
 }
 
-int BasisHitOrthoscopic(BasisCallRec * BC)
+/*========================================================================*/
+/*
+ * Packet kernels: ZLineClipPoint() and the sphere distance for n coherent
+ * rays along -Z against a single sphere. The arrays must have room for
+ * cBasisPacketMax elements. hit[k] is set where ray k hits the sphere.
+ */
+
+typedef void ZSpherePacketFn(int n, const float *bx, const float *by, const float *bz,
+                             const float *point, float radius, float radius2,
+                             float *dist, int *hit);
+
+static void ZSpherePacketScalar(int n, const float *bx, const float *by,
+                                const float *bz, const float *point, float radius,
+                                float radius2, float *dist, int *hit)
+{
+  int k;
+  for(k = 0; k < n; k++) {
+    float base[3] = { bx[k], by[k], bz[k] };
+    float along, oppSq;
+    oppSq = ZLineClipPoint(base, (float *) point, &along, radius);
+    hit[k] = (oppSq <= radius2);
+    if(hit[k])
+      dist[k] = (float) (sqrt1f(along) - sqrt1f((radius2 - oppSq)));
+  }
+}
+
+#ifdef _PYMOL_RAY_SSE2
+static void ZSpherePacketSSE2(int n, const float *bx, const float *by,
+                              const float *bz, const float *point, float radius,
+                              float radius2, float *dist, int *hit)
+{
+  const __m128 px = _mm_set1_ps(point[0]);
+  const __m128 py = _mm_set1_ps(point[1]);
+  const __m128 pz = _mm_set1_ps(point[2]);
+  const __m128 cut = _mm_set1_ps(radius);
+  const __m128 rr = _mm_set1_ps(radius2);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  int k, j;
+
+  for(k = 0; k < n; k += 4) {
+    __m128 h0 = _mm_sub_ps(px, _mm_loadu_ps(bx + k));
+    __m128 h1 = _mm_sub_ps(py, _mm_loadu_ps(by + k));
+    __m128 h2 = _mm_sub_ps(pz, _mm_loadu_ps(bz + k));
+    __m128 opp = _mm_add_ps(_mm_mul_ps(h0, h0), _mm_mul_ps(h1, h1));
+    __m128 ok = _mm_and_ps(_mm_cmple_ps(_mm_and_ps(h0, abs_mask), cut),
+                           _mm_cmple_ps(_mm_and_ps(h1, abs_mask), cut));
+    int mask;
+    ok = _mm_and_ps(ok, _mm_cmplt_ps(h2, zero));
+    ok = _mm_and_ps(ok, _mm_cmple_ps(opp, rr));
+    /* sqrt1f: negative arguments give zero */
+    _mm_storeu_ps(dist + k,
+                  _mm_sub_ps(_mm_sqrt_ps(_mm_max_ps(_mm_mul_ps(h2, h2), zero)),
+                             _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(rr, opp), zero))));
+    mask = _mm_movemask_ps(ok);
+    for(j = 0; j < 4; j++)
+      hit[k + j] = (mask >> j) & 1;
+  }
+}
+#endif
+
+#ifdef _PYMOL_RAY_AVX
+__attribute__((target("avx")))
+static void ZSpherePacketAVX(int n, const float *bx, const float *by,
+                             const float *bz, const float *point, float radius,
+                             float radius2, float *dist, int *hit)
+{
+  const __m256 px = _mm256_set1_ps(point[0]);
+  const __m256 py = _mm256_set1_ps(point[1]);
+  const __m256 pz = _mm256_set1_ps(point[2]);
+  const __m256 cut = _mm256_set1_ps(radius);
+  const __m256 rr = _mm256_set1_ps(radius2);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  int k, j;
+
+  for(k = 0; k < n; k += 8) {
+    __m256 h0 = _mm256_sub_ps(px, _mm256_loadu_ps(bx + k));
+    __m256 h1 = _mm256_sub_ps(py, _mm256_loadu_ps(by + k));
+    __m256 h2 = _mm256_sub_ps(pz, _mm256_loadu_ps(bz + k));
+    __m256 opp = _mm256_add_ps(_mm256_mul_ps(h0, h0), _mm256_mul_ps(h1, h1));
+    __m256 ok = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_and_ps(h0, abs_mask), cut, _CMP_LE_OQ),
+        _mm256_cmp_ps(_mm256_and_ps(h1, abs_mask), cut, _CMP_LE_OQ));
+    int mask;
+    ok = _mm256_and_ps(ok, _mm256_cmp_ps(h2, zero, _CMP_LT_OQ));
+    ok = _mm256_and_ps(ok, _mm256_cmp_ps(opp, rr, _CMP_LE_OQ));
+    _mm256_storeu_ps(dist + k,
+        _mm256_sub_ps(_mm256_sqrt_ps(_mm256_max_ps(_mm256_mul_ps(h2, h2), zero)),
+                      _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(rr, opp), zero))));
+    mask = _mm256_movemask_ps(ok);
+    for(j = 0; j < 8; j++)
+      hit[k + j] = (mask >> j) & 1;
+  }
+}
+#endif
+
+/* widest packet kernel supported by this CPU */
+static int BasisPacketWidthMax(void)
+{
+#ifdef _PYMOL_RAY_AVX
+  static const int avx = __builtin_cpu_supports("avx");
+  if(avx)
+    return 8;
+#endif
+#ifdef _PYMOL_RAY_SSE2
+  return 4;
+#else
+  return 1;
+#endif
+}
+
+static ZSpherePacketFn *ZSpherePacketGet(int width)
+{
+#ifdef _PYMOL_RAY_AVX
+  if(width > 4)
+    return ZSpherePacketAVX;
+#endif
+#ifdef _PYMOL_RAY_SSE2
+  if(width > 1)
+    return ZSpherePacketSSE2;
+#endif
+  return ZSpherePacketScalar;
+}
+
+/**
+ * Number of rays per packet for the packet traversal, from ray_packet_size
+ * and what the CPU supports. 1 means use the scalar code.
+ */
+int BasisPacketWidth(PyMOLGlobals * G)
+{
+  int width = SettingGetGlobal_i(G, cSetting_ray_packet_size);
+  int width_max = BasisPacketWidthMax();
+
+  if(width < 0 || width > width_max)
+    width = width_max;
+  else if(width > 4)
+    width = 8;
+  else if(width > 1)
+    width = 4;
+  else
+    width = 1;
+  return width;
+}
+
+/**
+ * Linear index of the voxel in which a ray along -Z starting at `v` enters
+ * the map, or -1 if it misses the map or there is no map (ray_bvh). Rays
+ * with the same index may be traced as one packet.
+ */
+int BasisGetVoxel(CBasis * I, const float *v)
+{
+  int a, b, c;
+  if(!I->Map || !MapInsideXY(I->Map, v, &a, &b, &c))
+    return -1;
+  return (a * I->Map->D1D2) + (b * I->Map->Dim[2]) + c;
+}
+
+/*========================================================================*/
+/*
+ * State of one ray in BasisHitOrthoscopic. Single rays and packets share
+ * the per-primitive intersection code below.
+ */
+typedef struct {
+  RayInfo *r;
+  float vt[3];
+  float r_tri1, r_tri2, r_dist;
+  float r_sphere0, r_sphere1, r_sphere2;
+  CPrimitive *r_prim;
+  int minIndex;
+  int local_iflag;
+} OrthoHitRec;
+
+static void OrthoHitInit(const BasisCallRec * BC, OrthoHitRec * H, RayInfo * r)
+{
+  H->r = r;
+
+  /* assumption: always heading in the negative Z direction with our vector... */
+  H->vt[0] = r->base[0];
+  H->vt[1] = r->base[1];
+  H->vt[2] = r->base[2] - BC->front;
+
+  H->r_tri1 = H->r_tri2 = 0.0F;         /* zero inits to suppress compiler warnings */
+  H->r_sphere0 = H->r_sphere1 = H->r_sphere2 = 0.0F;
+  H->r_dist = FLT_MAX;
+  H->r_prim = NULL;
+  H->minIndex = -1;
+  H->local_iflag = false;
+}
+
+static int OrthoHitFinish(const BasisCallRec * BC, OrthoHitRec * H)
+{
+  RayInfo *r = H->r;
+
+  if(H->minIndex > -1) {
+    H->r_prim = BC->prim + BC->vert2prim[H->minIndex];
+
+    if((H->r_prim->type == cPrimSphere) || (H->r_prim->type == cPrimEllipsoid)) {
+      const float *vv = BC->Basis->Vertex + H->minIndex * 3;
+      H->r_sphere0 = vv[0];
+      H->r_sphere1 = vv[1];
+      H->r_sphere2 = vv[2];
+    }
+  }
+
+  r->tri1 = H->r_tri1;
+  r->tri2 = H->r_tri2;
+  r->prim = H->r_prim;
+  r->dist = H->r_dist;
+  r->sphere[0] = H->r_sphere0;
+  r->sphere[1] = H->r_sphere1;
+  r->sphere[2] = H->r_sphere2;
+  return (H->minIndex);
+}
+
+/* we've processed all primitives associated with voxel c, so if an
+   intersection has been found which occurs in front of the next voxel,
+   then we can stop */
+static int OrthoHitInFront(const BasisCallRec * BC, OrthoHitRec * H, int c)
+{
+  if(H->minIndex > -1) {
+    int aa, bb, cc;
+
+    H->vt[2] = H->r->base[2] - H->r_dist;
+    MapLocus(BC->Basis->Map, H->vt, &aa, &bb, &cc);
+    if(cc > c)
+      return true;
+    else
+      H->vt[2] = H->r->base[2] - BC->front;
+  }
+  return false;
+}
+
+static inline void OrthoHitSphere(BasisCallRec * BC, OrthoHitRec * H,
+                                  CPrimitive * prm, int i, float dist)
+{
+  CBasis *BI = BC->Basis;
+  const float front = BC->front;
+
+  if((dist < H->r_dist) && (prm->trans != 1.0F)) {
+    if((dist >= front) && (dist <= BC->back)) {
+      H->minIndex = prm->vert;
+      H->r_dist = dist;
+    } else if(BC->check_interior && (!BC->pass)) {
+      if(diffsq3f(H->vt, BI->Vertex + i * 3) < BI->Radius2[i]) {
+        H->local_iflag = true;
+        H->r_prim = prm;
+        H->r_dist = front;
+        H->minIndex = prm->vert;
+      }
+    }
+  }
+}
+
+static inline void OrthoHitPrim(BasisCallRec * BC, OrthoHitRec * H,
+                                CPrimitive * prm, int i)
 {
   const float _0 = 0.0F, _1 = 1.0F;
-  float oppSq, dist = _0, sph[3], vt[3], tri1, tri2;
+  float oppSq, dist = _0, sph[3], tri1, tri2;
+  float minusZ[3] = { 0.0F, 0.0F, -1.0F };
+  CBasis *BI = BC->Basis;
+  RayInfo *r = H->r;
+  float *vt = H->vt;
+  const float front = BC->front;
+  const float back = BC->back;
+  const float excl_trans = BC->excl_trans;
+  const int excl_trans_flag = (excl_trans != _0);
+  const int check_interior_flag = BC->check_interior && (!BC->pass);
+  const float BasisFudge0 = BC->fudge0;
+  const float BasisFudge1 = BC->fudge1;
+
+  switch (prm->type) {
+  case cPrimTriangle:
+  case cPrimCharacter:
+    if(!prm->cull) {
+      float *pre = BI->Precomp + BI->Vert2Normal[i] * 3;
+
+      if(pre[6]) {
+        float *vert0 = BI->Vertex + prm->vert * 3;
+
+        float tvec0 = vt[0] - vert0[0];
+        float tvec1 = vt[1] - vert0[1];
+
+        tri1 = (tvec0 * pre[4] - tvec1 * pre[3]) * pre[7];
+        tri2 = -(tvec0 * pre[1] - tvec1 * pre[0]) * pre[7];
+
+        if(!((tri1 < BasisFudge0) || (tri2 < BasisFudge0) ||
+             (tri1 > BasisFudge1) || ((tri1 + tri2) > BasisFudge1))) {
+          dist = (r->base[2] - (tri1 * pre[2]) - (tri2 * pre[5]) - vert0[2]);
+
+          if((dist < H->r_dist) && (dist >= front) &&
+             (dist <= back) && (prm->trans != _1)) {
+            H->minIndex = prm->vert;
+            H->r_tri1 = tri1;
+            H->r_tri2 = tri2;
+            H->r_dist = dist;
+          }
+        }
+      }
+    }
+    break;
+
+  case cPrimSphere:
+    oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
+    if(oppSq <= BI->Radius2[i]) {
+      dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+      OrthoHitSphere(BC, H, prm, i, dist);
+    }
+    break;
+  case cPrimEllipsoid:
+    oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
+    if(oppSq <= BI->Radius2[i]) {
+
+      dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+
+      if((dist < H->r_dist) && (prm->trans != _1)) {
+        float *n1 = BI->Normal + BI->Vert2Normal[i] * 3;
+        if(LineClipEllipsoidPoint(r->base, minusZ,
+                                  BI->Vertex + i * 3, &dist,
+                                  BI->Radius[i], BI->Radius2[i],
+                                  prm->ext->n0, n1, n1 + 3, n1 + 6)) {
+          if(dist < H->r_dist) {
+            if((dist >= _0) && (dist <= back)) {
+              H->minIndex = prm->vert;
+              H->r_dist = dist;
+            }
+          }
+        }
+      }
+    }
+    break;
+
+  case cPrimCylinder:
+    if(ZLineToSphereCapped(r->base, BI->Vertex + i * 3,
+                           BI->Normal + BI->Vert2Normal[i] * 3,
+                           BI->Radius[i], prm->l1, sph, &tri1, prm->cap1,
+                           prm->cap2, BI->Precomp + BI->Vert2Normal[i] * 3)) {
+      oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
+      if(oppSq <= BI->Radius2[i]) {
+        dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+
+        if((dist < H->r_dist) && (prm->trans != _1)) {
+          if((dist >= front) && (dist <= back)) {
+            if(prm->l1 > kR_SMALL4)
+              H->r_tri1 = tri1 / prm->l1;
+
+            H->r_sphere0 = sph[0];
+            H->r_sphere1 = sph[1];
+            H->r_sphere2 = sph[2];
+            H->minIndex = prm->vert;
+            H->r_dist = dist;
+          } else if(check_interior_flag) {
+            if(FrontToInteriorSphereCapped(vt,
+                                           BI->Vertex + i * 3,
+                                           BI->Normal + BI->Vert2Normal[i] * 3,
+                                           BI->Radius[i],
+                                           BI->Radius2[i],
+                                           prm->l1, prm->cap1, prm->cap2)) {
+              H->local_iflag = true;
+              H->r_prim = prm;
+              H->r_dist = front;
+              H->minIndex = prm->vert;
+            }
+          }
+        }
+      }
+    }
+    break;
+  case cPrimCone:
+    {
+      float sph_rad, sph_rad_sq;
+      if(ConeLineToSphereCapped(r->base, minusZ, BI->Vertex + i * 3,
+                                BI->Normal + BI->Vert2Normal[i] * 3,
+                                BI->Radius[i], prm->r2, prm->l1, sph, &tri1,
+                                &sph_rad, &sph_rad_sq, prm->cap1, prm->cap2)) {
+
+        oppSq = ZLineClipPoint(r->base, sph, &dist, sph_rad);
+        if(oppSq <= sph_rad_sq) {
+          dist = (float) (sqrt1f(dist) - sqrt1f((sph_rad_sq - oppSq)));
+
+          if((dist < H->r_dist) && (prm->trans != _1)) {
+            if((dist >= front) && (dist <= back)) {
+              if(prm->l1 > kR_SMALL4)
+                H->r_tri1 = tri1 / prm->l1;
+
+              H->r_sphere0 = sph[0];
+              H->r_sphere1 = sph[1];
+              H->r_sphere2 = sph[2];
+              H->minIndex = prm->vert;
+              H->r_dist = dist;
+            } else if(check_interior_flag) {
+              if(FrontToInteriorSphereCapped(vt,
+                                             BI->Vertex + i * 3,
+                                             BI->Normal +
+                                             BI->Vert2Normal[i] * 3, sph_rad,
+                                             sph_rad_sq, prm->l1, prm->cap1,
+                                             prm->cap2)) {
+                H->local_iflag = true;
+                H->r_prim = prm;
+                H->r_dist = front;
+                H->minIndex = prm->vert;
+              }
+            }
+          }
+        }
+      }
+    }
+    break;
+  case cPrimSausage:
+    if(ZLineToSphere
+       (r->base, BI->Vertex + i * 3, BI->Normal + BI->Vert2Normal[i] * 3,
+        BI->Radius[i], prm->l1, sph, &tri1,
+        BI->Precomp + BI->Vert2Normal[i] * 3)) {
+      oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
+      if(oppSq <= BI->Radius2[i]) {
+        int tmp_flag = false;
+
+        dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+        if((dist < H->r_dist) && (prm->trans != _1)) {
+          if((dist >= front) && (dist <= back)) {
+            tmp_flag = true;
+            if(excl_trans_flag) {
+              if((prm->trans > _0) && (dist < excl_trans))
+                tmp_flag = false;
+            }
+            if(tmp_flag) {
+              if(prm->l1 > kR_SMALL4)
+                H->r_tri1 = tri1 / prm->l1;
+
+              H->r_sphere0 = sph[0];
+              H->r_sphere1 = sph[1];
+              H->r_sphere2 = sph[2];
+              H->minIndex = prm->vert;
+              H->r_dist = dist;
+            }
+          } else if(check_interior_flag) {
+            if(FrontToInteriorSphere
+               (vt, BI->Vertex + i * 3, BI->Normal + BI->Vert2Normal[i] * 3,
+                BI->Radius[i], BI->Radius2[i], prm->l1)) {
+              H->local_iflag = true;
+              H->r_prim = prm;
+              H->r_dist = front;
+              H->minIndex = prm->vert;
+            }
+          }
+        }
+      }
+    }
+    break;
+  }                   /* end of switch */
+}
+
+int BasisHitOrthoscopic(BasisCallRec * BC)
+{
   int a, b, c, h, *ip;
-  int excl_trans_flag;
-  int check_interior_flag;
-  int *elist, local_iflag = false;
+  int *elist;
   float minusZ[3] = { 0.0F, 0.0F, -1.0F };
 
   CBasis *BI = BC->Basis;
   RayInfo *r = BC->rr;
+  BVHType *bvh = BI->BVH;
 
-  if(MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
-    int minIndex = -1;
+  if(bvh || MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
+    OrthoHitRec H;
     int v2p;
     int i, ii;
-    int *xxtmp;
+    int *xxtmp = NULL;
     int do_loop;
     int except1 = BC->except1;
     int except2 = BC->except2;
-    int n_vert = BI->NVertex, n_eElem = BI->Map->NEElem;
+    int n_vert = BI->NVertex;
+    int n_eElem = bvh ? (int) bvh->EList.size() : BI->Map->NEElem;
+    BVHWalker walker;
     const int *vert2prim = BC->vert2prim;
-    const float front = BC->front;
-    const float back = BC->back;
-    const float excl_trans = BC->excl_trans;
-    const float BasisFudge0 = BC->fudge0;
-    const float BasisFudge1 = BC->fudge1;
 
     MapCache *cache = &BC->cache;
 
-    float r_tri1 = _0, r_tri2 = _0, r_dist = _0;        /* zero inits to suppress compiler warnings */
-    float r_sphere0 = _0, r_sphere1 = _0, r_sphere2 = _0;
-    CPrimitive *r_prim = NULL;
-
-    check_interior_flag = BC->check_interior && (!BC->pass);
-
-    /* assumption: always heading in the negative Z direction with our vector... */
-    vt[0] = r->base[0];
-    vt[1] = r->base[1];
-    vt[2] = r->base[2] - front;
+    OrthoHitInit(BC, &H, r);
 
     if(except1 >= 0)
       except1 = vert2prim[except1];
     if(except2 >= 0)
       except2 = vert2prim[except2];
 
-    excl_trans_flag = (excl_trans != _0);
-
-    r_dist = FLT_MAX;
-
-    xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
+    if(bvh) {
+      walker.init(bvh, r->base, minusZ, std::min(BC->front, 0.0F) - kR_SMALL4,
+                  &BC->bvh_stats);
+      elist = bvh->EList.data();
+    } else {
+      xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
+      elist = BI->Map->EList;
+    }
 
     MapCacheReset(cache);
 
-    elist = BI->Map->EList;
-
-    while(c >= MapBorder) {
-      h = *xxtmp;
+    while(1) {
+      if(bvh) {                 /* nearest leaf which can still beat r_dist */
+        if(!(h = walker.next(std::min(H.r_dist, BC->back))))
+          break;
+      } else {
+        if(c < MapBorder)
+          break;
+        h = *xxtmp;
+      }
       if((h > 0) && (h < n_eElem)) {
         ip = elist + h;
         i = *(ip++);
@@ -2059,320 +2539,93 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
           do_loop = ((ii >= 0) && (ii < n_vert));
 
           if((v2p != except1) && (v2p != except2) && (!MapCached(cache, v2p))) {
-            CPrimitive *prm = BC->prim + v2p;
             MapCache(cache, v2p);
-
-            switch (prm->type) {
-            case cPrimTriangle:
-            case cPrimCharacter:
-              if(!prm->cull) {
-                float *pre = BI->Precomp + BI->Vert2Normal[i] * 3;
-
-                if(pre[6]) {
-                  float *vert0 = BI->Vertex + prm->vert * 3;
-
-                  float tvec0 = vt[0] - vert0[0];
-                  float tvec1 = vt[1] - vert0[1];
-
-                  tri1 = (tvec0 * pre[4] - tvec1 * pre[3]) * pre[7];
-                  tri2 = -(tvec0 * pre[1] - tvec1 * pre[0]) * pre[7];
-
-                  if(!((tri1 < BasisFudge0) || (tri2 < BasisFudge0) ||
-                       (tri1 > BasisFudge1) || ((tri1 + tri2) > BasisFudge1))) {
-                    dist = (r->base[2] - (tri1 * pre[2]) - (tri2 * pre[5]) - vert0[2]);
-
-                    if((dist < r_dist) && (dist >= front) &&
-                       (dist <= back) && (prm->trans != _1)) {
-                      minIndex = prm->vert;
-                      r_tri1 = tri1;
-                      r_tri2 = tri2;
-                      r_dist = dist;
-                    }
-                  }
-                }
-              }
-              break;
-
-            case cPrimSphere:
-              oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
-              if(oppSq <= BI->Radius2[i]) {
-                dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-
-                if((dist < r_dist) && (prm->trans != _1)) {
-                  if((dist >= front) && (dist <= back)) {
-                    minIndex = prm->vert;
-                    r_dist = dist;
-                  } else if(check_interior_flag) {
-                    if(diffsq3f(vt, BI->Vertex + i * 3) < BI->Radius2[i]) {
-                      local_iflag = true;
-                      r_prim = prm;
-                      r_dist = front;
-                      minIndex = prm->vert;
-                    }
-                  }
-                }
-              }
-              break;
-            case cPrimEllipsoid:
-              oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
-              if(oppSq <= BI->Radius2[i]) {
-
-                dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-
-                if((dist < r_dist) && (prm->trans != _1)) {
-                  float *n1 = BI->Normal + BI->Vert2Normal[i] * 3;
-                  if(LineClipEllipsoidPoint(r->base, minusZ,
-                                            BI->Vertex + i * 3, &dist,
-                                            BI->Radius[i], BI->Radius2[i],
-                                            prm->n0, n1, n1 + 3, n1 + 6)) {
-                    if(dist < r_dist) {
-                      if((dist >= _0) && (dist <= back)) {
-                        minIndex = prm->vert;
-                        r_dist = dist;
-                      }
-                    }
-                  }
-                }
-              }
-              break;
-
-            case cPrimCylinder:
-              if(ZLineToSphereCapped(r->base, BI->Vertex + i * 3,
-                                     BI->Normal + BI->Vert2Normal[i] * 3,
-                                     BI->Radius[i], prm->l1, sph, &tri1, prm->cap1,
-                                     prm->cap2, BI->Precomp + BI->Vert2Normal[i] * 3)) {
-                oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
-                if(oppSq <= BI->Radius2[i]) {
-                  dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-
-                  if((dist < r_dist) && (prm->trans != _1)) {
-                    if((dist >= front) && (dist <= back)) {
-                      if(prm->l1 > kR_SMALL4)
-                        r_tri1 = tri1 / prm->l1;
-
-                      r_sphere0 = sph[0];
-                      r_sphere1 = sph[1];
-                      r_sphere2 = sph[2];
-                      minIndex = prm->vert;
-                      r_dist = dist;
-                    } else if(check_interior_flag) {
-                      if(FrontToInteriorSphereCapped(vt,
-                                                     BI->Vertex + i * 3,
-                                                     BI->Normal + BI->Vert2Normal[i] * 3,
-                                                     BI->Radius[i],
-                                                     BI->Radius2[i],
-                                                     prm->l1, prm->cap1, prm->cap2)) {
-                        local_iflag = true;
-                        r_prim = prm;
-                        r_dist = front;
-                        minIndex = prm->vert;
-                      }
-                    }
-                  }
-                }
-              }
-              break;
-            case cPrimCone:
-              {
-                float sph_rad, sph_rad_sq;
-                if(ConeLineToSphereCapped(r->base, minusZ, BI->Vertex + i * 3,
-                                          BI->Normal + BI->Vert2Normal[i] * 3,
-                                          BI->Radius[i], prm->r2, prm->l1, sph, &tri1,
-                                          &sph_rad, &sph_rad_sq, prm->cap1, prm->cap2)) {
-
-                  oppSq = ZLineClipPoint(r->base, sph, &dist, sph_rad);
-                  if(oppSq <= sph_rad_sq) {
-                    dist = (float) (sqrt1f(dist) - sqrt1f((sph_rad_sq - oppSq)));
-
-                    if((dist < r_dist) && (prm->trans != _1)) {
-                      if((dist >= front) && (dist <= back)) {
-                        if(prm->l1 > kR_SMALL4)
-                          r_tri1 = tri1 / prm->l1;
-
-                        r_sphere0 = sph[0];
-                        r_sphere1 = sph[1];
-                        r_sphere2 = sph[2];
-                        minIndex = prm->vert;
-                        r_dist = dist;
-                      } else if(check_interior_flag) {
-                        if(FrontToInteriorSphereCapped(vt,
-                                                       BI->Vertex + i * 3,
-                                                       BI->Normal +
-                                                       BI->Vert2Normal[i] * 3, sph_rad,
-                                                       sph_rad_sq, prm->l1, prm->cap1,
-                                                       prm->cap2)) {
-                          local_iflag = true;
-                          r_prim = prm;
-                          r_dist = front;
-                          minIndex = prm->vert;
-                        }
-                      }
-                    }
-                  }
-                }
-              }
-              break;
-            case cPrimSausage:
-              if(ZLineToSphere
-                 (r->base, BI->Vertex + i * 3, BI->Normal + BI->Vert2Normal[i] * 3,
-                  BI->Radius[i], prm->l1, sph, &tri1,
-                  BI->Precomp + BI->Vert2Normal[i] * 3)) {
-                oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
-                if(oppSq <= BI->Radius2[i]) {
-                  int tmp_flag = false;
-
-                  dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-                  if((dist < r_dist) && (prm->trans != _1)) {
-                    if((dist >= front) && (dist <= back)) {
-                      tmp_flag = true;
-                      if(excl_trans_flag) {
-                        if((prm->trans > _0) && (dist < excl_trans))
-                          tmp_flag = false;
-                      }
-                      if(tmp_flag) {
-                        if(prm->l1 > kR_SMALL4)
-                          r_tri1 = tri1 / prm->l1;
-
-                        r_sphere0 = sph[0];
-                        r_sphere1 = sph[1];
-                        r_sphere2 = sph[2];
-                        minIndex = prm->vert;
-                        r_dist = dist;
-                      }
-                    } else if(check_interior_flag) {
-                      if(FrontToInteriorSphere
-                         (vt, BI->Vertex + i * 3, BI->Normal + BI->Vert2Normal[i] * 3,
-                          BI->Radius[i], BI->Radius2[i], prm->l1)) {
-                        local_iflag = true;
-                        r_prim = prm;
-                        r_dist = front;
-                        minIndex = prm->vert;
-                      }
-                    }
-                  }
-                }
-              }
-              break;
-            }                   /* end of switch */
+            OrthoHitPrim(BC, &H, BC->prim + v2p, i);
           }
-          /* end of if */
           i = ii;
-
-        }                       /* end of while */
+        }
       }
 
       /* and of course stop when we hit the edge of the map */
 
-      if(local_iflag)
+      if(H.local_iflag)
         break;
 
-      /* we've processed all primitives associated with this voxel, 
-         so if an intersection has been found which occurs in front of
-         the next voxel, then we can stop */
-
-      if(minIndex > -1) {
-        int aa, bb, cc;
+      if(bvh)                   /* the walker already culls by r_dist */
+        continue;
 
-        vt[2] = r->base[2] - r_dist;
-        MapLocus(BI->Map, vt, &aa, &bb, &cc);
-        if(cc > c)
-          break;
-        else
-          vt[2] = r->base[2] - front;
-      }
+      if(OrthoHitInFront(BC, &H, c))
+        break;
 
       c--;
       xxtmp--;
 
     }                           /* end of while */
 
-    if(minIndex > -1) {
-      r_prim = BC->prim + vert2prim[minIndex];
-
-      if((r_prim->type == cPrimSphere) || (r_prim->type == cPrimEllipsoid)) {
-        const float *vv = BI->Vertex + minIndex * 3;
-        r_sphere0 = vv[0];
-        r_sphere1 = vv[1];
-        r_sphere2 = vv[2];
-      }
-    }
-
-    BC->interior_flag = local_iflag;
-    r->tri1 = r_tri1;
-    r->tri2 = r_tri2;
-    r->prim = r_prim;
-    r->dist = r_dist;
-    r->sphere[0] = r_sphere0;
-    r->sphere[1] = r_sphere1;
-    r->sphere[2] = r_sphere2;
-    return (minIndex);
+    BC->interior_flag = H.local_iflag;
+    return OrthoHitFinish(BC, &H);
   }                             /* end of if */
-  BC->interior_flag = local_iflag;
+  BC->interior_flag = false;
   return (-1);
 }
 
-int BasisHitShadow(BasisCallRec * BC)
+/**
+ * BasisHitOrthoscopic for a packet of n <= cBasisPacketMax rays which enter
+ * the map in the same voxel (see BasisGetVoxel). The voxel column and the
+ * primitive cache are shared, spheres are tested for all rays at once.
+ * BC->rr is ignored, results go to r[k], hit[k] and interior[k].
+ */
+void BasisHitOrthoscopicPacket(BasisCallRec * BC, int width, RayInfo * r, int n,
+                               int *hit, int *interior)
 {
-  const float _0 = 0.0F;
-  const float _1 = 1.0F;
-  float oppSq, dist = _0, tri1, tri2;
-  float sph[3], vt[3];
-  int h, *ip;
-  int a, b, c;
-  int *elist, local_iflag = false;
-  float minusZ[3] = { 0.0F, 0.0F, -1.0F };
-  /* local copies (eliminate these extra copies later on) */
-
   CBasis *BI = BC->Basis;
-  RayInfo *r = BC->rr;
-
-  if(MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
-    int minIndex = -1;
-    int v2p;
-    int i, ii;
-    int *xxtmp;
+  MapType *map = BI->Map;
+  ZSpherePacketFn *zsphere = ZSpherePacketGet(width);
+  OrthoHitRec H[cBasisPacketMax];
+  float bx[cBasisPacketMax] = {}, by[cBasisPacketMax] = {}, bz[cBasisPacketMax] = {};
+  float dist[cBasisPacketMax];
+  int sphere_hit[cBasisPacketMax];
+  int done[cBasisPacketMax];
+  int a, b, c, h, k, n_active;
+
+  if(!map || !MapInsideXY(map, r[0].base, &a, &b, &c)) {
+    for(k = 0; k < n; k++) {
+      hit[k] = -1;
+      interior[k] = false;
+    }
+    return;
+  }
 
-    int n_vert = BI->NVertex, n_eElem = BI->Map->NEElem;
+  {
+    int i, ii, v2p, do_loop, *ip;
     int except1 = BC->except1;
     int except2 = BC->except2;
+    int n_vert = BI->NVertex;
+    int n_eElem = map->NEElem;
+    int *elist = map->EList;
+    int *xxtmp = map->EHead + (a * map->D1D2) + (b * map->Dim[2]) + c;
     const int *vert2prim = BC->vert2prim;
-    const int trans_shadows = BC->trans_shadows;
-    const int nearest_shadow = BC->nearest_shadow;
-    const float BasisFudge0 = BC->fudge0;
-    const float BasisFudge1 = BC->fudge1;
-    const int label_shadow_mode = BC->label_shadow_mode;
     MapCache *cache = &BC->cache;
-    int *cache_cache = cache->Cache;
-    int *cache_CacheLink = cache->CacheLink;
-    CPrimitive *BC_prim = BC->prim;
-
-    float r_tri1 = _0, r_tri2 = _0, r_dist;    /* zero inits to suppress compiler warnings */
-    float r_sphere0 = _0, r_sphere1 = _0, r_sphere2 = _0;
-    float r_trans = _0;
-    CPrimitive *r_prim = NULL;
 
-    /* assumption: always heading in the negative Z direction with our vector... */
-    vt[0] = r->base[0];
-    vt[1] = r->base[1];
+    for(k = 0; k < n; k++) {
+      OrthoHitInit(BC, H + k, r + k);
+      bx[k] = r[k].base[0];
+      by[k] = r[k].base[1];
+      bz[k] = r[k].base[2];
+      done[k] = false;
+    }
+    n_active = n;
 
     if(except1 >= 0)
       except1 = vert2prim[except1];
     if(except2 >= 0)
       except2 = vert2prim[except2];
 
-    r_trans = _1;
-    r_dist = FLT_MAX;
-
-    xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
-
     MapCacheReset(cache);
 
-    elist = BI->Map->EList;
-
-    while(c >= MapBorder) {
+    while(n_active && (c >= MapBorder)) {
       h = *xxtmp;
       if((h > 0) && (h < n_eElem)) {
-        int do_loop;
         ip = elist + h;
         i = *(ip++);
         do_loop = ((i >= 0) && (i < n_vert));
@@ -2380,380 +2633,576 @@ int BasisHitShadow(BasisCallRec * BC)
           ii = *(ip++);
           v2p = vert2prim[i];
           do_loop = ((ii >= 0) && (ii < n_vert));
-          if((v2p != except1) && (v2p != except2) && !MapCached(cache, v2p)) {
-            CPrimitive *prm = BC_prim + v2p;
-            int prm_type;
 
-            /*MapCache(cache,v2p); */
-            cache_cache[v2p] = 1;
-            prm_type = prm->type;
-            cache_CacheLink[v2p] = cache->CacheStart;
-            cache->CacheStart = v2p;
-
-            switch (prm_type) {
-            case cPrimCharacter:       /* will need special handling for character shadows */
-              if(label_shadow_mode & 0x2) {     /* if labels case shadows... */
-                float *pre = BI->Precomp + BI->Vert2Normal[i] * 3;
-
-                if(pre[6]) {
-                  float *vert0 = BI->Vertex + prm->vert * 3;
-
-                  float tvec0 = vt[0] - vert0[0];
-                  float tvec1 = vt[1] - vert0[1];
-
-                  tri1 = (tvec0 * pre[4] - tvec1 * pre[3]) * pre[7];
-                  tri2 = -(tvec0 * pre[1] - tvec1 * pre[0]) * pre[7];
-
-                  if(!((tri1 < BasisFudge0) ||
-                       (tri2 < BasisFudge0) ||
-                       (tri1 > BasisFudge1) || ((tri1 + tri2) > BasisFudge1))) {
-                    dist = (r->base[2] - (tri1 * pre[2]) - (tri2 * pre[5]) - vert0[2]);
-
-                    {
-                      float fc[3];
-                      float trans;
-
-                      r->tri1 = tri1;
-                      r->tri2 = tri2;
-                      r->dist = dist;
-                      r->prim = prm;
-
-                      {
-                        float w2;
-                        w2 = _1 - (r->tri1 + r->tri2);
-
-                        fc[0] =
-                          (prm->c2[0] * r->tri1) + (prm->c3[0] * r->tri2) +
-                          (prm->c1[0] * w2);
-                        fc[1] =
-                          (prm->c2[1] * r->tri1) + (prm->c3[1] * r->tri2) +
-                          (prm->c1[1] * w2);
-                        fc[2] =
-                          (prm->c2[2] * r->tri1) + (prm->c3[2] * r->tri2) +
-                          (prm->c1[2] * w2);
-                      }
+          if((v2p != except1) && (v2p != except2) && (!MapCached(cache, v2p))) {
+            CPrimitive *prm = BC->prim + v2p;
+            MapCache(cache, v2p);
 
-                      trans = CharacterInterpolate(BI->G, prm->char_id, fc);
-
-                      if(trans == _0) { /* opaque? return immed. */
-                        if(dist > -kR_SMALL4) {
-                          if(nearest_shadow) {
-                            if(dist < r_dist) {
-                              minIndex = prm->vert;
-                              r_tri1 = tri1;
-                              r_tri2 = tri2;
-                              r_dist = dist;
-                              r_trans = (r->trans = trans);
-                            }
-                          } else {
-                            r->prim = prm;
-                            r->trans = _0;
-                            r->dist = dist;
-                            return (1);
-                          }
-                        }
-                      } else if(trans_shadows) {
-                        if((dist > -kR_SMALL4) &&
-                           ((r_trans > trans) ||
-                            (nearest_shadow && (dist < r_dist) && (r_trans >= trans)))) {
-                          minIndex = prm->vert;
-                          r_tri1 = tri1;
-                          r_tri2 = tri2;
-                          r_dist = dist;
-                          r_trans = (r->trans = trans);
-                        }
-                      }
-                    }
-                  }
-                }
+            if(prm->type == cPrimSphere) {
+              zsphere(n, bx, by, bz, BI->Vertex + i * 3, BI->Radius[i], BI->Radius2[i],
+                      dist, sphere_hit);
+              for(k = 0; k < n; k++) {
+                if(!done[k] && sphere_hit[k])
+                  OrthoHitSphere(BC, H + k, prm, i, dist[k]);
               }
-              break;
+            } else {
+              for(k = 0; k < n; k++) {
+                if(!done[k])
+                  OrthoHitPrim(BC, H + k, prm, i);
+              }
+            }
+          }
+          i = ii;
+        }
+      }
 
-            case cPrimTriangle:
-              {
-                float *pre = BI->Precomp + BI->Vert2Normal[i] * 3;
+      for(k = 0; k < n; k++) {
+        if(!done[k] && (H[k].local_iflag || OrthoHitInFront(BC, H + k, c))) {
+          done[k] = true;
+          n_active--;
+        }
+      }
 
-                if(pre[6]) {
-                  float *vert0 = BI->Vertex + prm->vert * 3;
+      c--;
+      xxtmp--;
+    }
+  }
 
-                  float tvec0 = vt[0] - vert0[0];
-                  float tvec1 = vt[1] - vert0[1];
+  for(k = 0; k < n; k++) {
+    hit[k] = OrthoHitFinish(BC, H + k);
+    interior[k] = H[k].local_iflag;
+  }
+}
 
-                  tri1 = (tvec0 * pre[4] - tvec1 * pre[3]) * pre[7];
-                  tri2 = -(tvec0 * pre[1] - tvec1 * pre[0]) * pre[7];
-                  if(!((tri1 < BasisFudge0) ||
-                       (tri2 < BasisFudge0) ||
-                       (tri1 > BasisFudge1) || ((tri1 + tri2) > BasisFudge1))) {
-                    float *tr = prm->tr;
-                    float trans = _0;
+/*========================================================================*/
+/*
+ * State of one ray in BasisHitShadow, see OrthoHitRec
+ */
+typedef struct {
+  RayInfo *r;
+  float vt[3];
+  float r_tri1, r_tri2, r_dist, r_trans;
+  float r_sphere0, r_sphere1, r_sphere2;
+  CPrimitive *r_prim;
+  int minIndex;
+} ShadowHitRec;
+
+static void ShadowHitInit(ShadowHitRec * H, RayInfo * r)
+{
+  H->r = r;
+
+  /* assumption: always heading in the negative Z direction with our vector... */
+  H->vt[0] = r->base[0];
+  H->vt[1] = r->base[1];
+  H->vt[2] = 0.0F;
+
+  H->r_tri1 = H->r_tri2 = 0.0F;         /* zero inits to suppress compiler warnings */
+  H->r_sphere0 = H->r_sphere1 = H->r_sphere2 = 0.0F;
+  H->r_trans = 1.0F;
+  H->r_dist = FLT_MAX;
+  H->r_prim = NULL;
+  H->minIndex = -1;
+}
 
-                    dist = (r->base[2] - (tri1 * pre[2]) - (tri2 * pre[5]) - vert0[2]);
+static int ShadowHitFinish(const BasisCallRec * BC, ShadowHitRec * H)
+{
+  RayInfo *r = H->r;
 
-                    if(prm->trans != _0) {
-                      trans =
-                        (tr[1] * tri1) + (tr[2] * tri2) + (tr[0] * (_1 - (tri1 + tri2)));
-                    }
+  if(H->minIndex > -1) {
+    H->r_prim = BC->prim + BC->vert2prim[H->minIndex];
 
-                    if(trans == _0) {
-                      if(dist > -kR_SMALL4) {
-                        if(nearest_shadow) {    /* do we need the nearest shadow? */
-                          if(dist < r_dist) {
-                            minIndex = prm->vert;
-                            r_tri1 = tri1;
-                            r_tri2 = tri2;
-                            r_dist = dist;
-                            r_trans = (r->trans = trans);
-                          }
-                        } else {
-                          r->prim = prm;
-                          r->trans = _0;
-                          r->dist = dist;
-                          return (1);
-                        }
-                      }
-                    } else if(trans_shadows) {
-                      if((dist > -kR_SMALL4) &&
-                         ((r_trans > trans) ||
-                          (nearest_shadow && (dist < r_dist) && (r_trans >= trans)))) {
-                        minIndex = prm->vert;
-                        r_tri1 = tri1;
-                        r_tri2 = tri2;
-                        r_dist = dist;
-                        r_trans = (r->trans = trans);
-                      }
-                    }
+    if((H->r_prim->type == cPrimSphere) || (H->r_prim->type == cPrimEllipsoid)) {
+      const float *vv = BC->Basis->Vertex + H->minIndex * 3;
+      H->r_sphere0 = vv[0];
+      H->r_sphere1 = vv[1];
+      H->r_sphere2 = vv[2];
+    }
+  }
+
+  r->tri1 = H->r_tri1;
+  r->tri2 = H->r_tri2;
+  r->prim = H->r_prim;
+  r->dist = H->r_dist;
+  r->trans = H->r_trans;
+  r->sphere[0] = H->r_sphere0;
+  r->sphere[1] = H->r_sphere1;
+  r->sphere[2] = H->r_sphere2;
+  return (H->minIndex);
+}
+
+/* returns true if the ray is done (opaque hit and no need for the nearest one) */
+static inline int ShadowHitDist(BasisCallRec * BC, ShadowHitRec * H,
+                                CPrimitive * prm, float dist, float trans)
+{
+  const float _0 = 0.0F;
+  RayInfo *r = H->r;
+
+  if(trans == _0) {
+    if(dist > -kR_SMALL4) {
+      if(BC->nearest_shadow) {
+        if(dist < H->r_dist) {
+          H->minIndex = prm->vert;
+          H->r_dist = dist;
+          H->r_trans = (r->trans = trans);
+        }
+      } else {
+        r->prim = prm;
+        r->trans = trans;
+        r->dist = dist;
+        return (1);
+      }
+    }
+  } else if(BC->trans_shadows) {
+    if((dist > -kR_SMALL4) &&
+       ((H->r_trans > trans) ||
+        (BC->nearest_shadow && (dist < H->r_dist) && (H->r_trans >= trans)))) {
+      H->minIndex = prm->vert;
+      H->r_dist = dist;
+      H->r_trans = (r->trans = trans);
+    }
+  }
+  return (0);
+}
+
+static inline int ShadowHitSphere(BasisCallRec * BC, ShadowHitRec * H,
+                                  CPrimitive * prm, float dist)
+{
+  return ShadowHitDist(BC, H, prm, dist, prm->trans);
+}
+
+/* returns true if the ray is done, see ShadowHitSphere */
+static inline int ShadowHitPrim(BasisCallRec * BC, ShadowHitRec * H,
+                                CPrimitive * prm, int i)
+{
+  const float _0 = 0.0F;
+  const float _1 = 1.0F;
+  float oppSq, dist = _0, tri1, tri2;
+  float sph[3];
+  float minusZ[3] = { 0.0F, 0.0F, -1.0F };
+  CBasis *BI = BC->Basis;
+  RayInfo *r = H->r;
+  float *vt = H->vt;
+  const int trans_shadows = BC->trans_shadows;
+  const int nearest_shadow = BC->nearest_shadow;
+  const float BasisFudge0 = BC->fudge0;
+  const float BasisFudge1 = BC->fudge1;
+  const int label_shadow_mode = BC->label_shadow_mode;
+
+  switch (prm->type) {
+  case cPrimCharacter:       /* will need special handling for character shadows */
+    if(label_shadow_mode & 0x2) {     /* if labels case shadows... */
+      float *pre = BI->Precomp + BI->Vert2Normal[i] * 3;
+
+      if(pre[6]) {
+        float *vert0 = BI->Vertex + prm->vert * 3;
+
+        float tvec0 = vt[0] - vert0[0];
+        float tvec1 = vt[1] - vert0[1];
+
+        tri1 = (tvec0 * pre[4] - tvec1 * pre[3]) * pre[7];
+        tri2 = -(tvec0 * pre[1] - tvec1 * pre[0]) * pre[7];
+
+        if(!((tri1 < BasisFudge0) ||
+             (tri2 < BasisFudge0) ||
+             (tri1 > BasisFudge1) || ((tri1 + tri2) > BasisFudge1))) {
+          dist = (r->base[2] - (tri1 * pre[2]) - (tri2 * pre[5]) - vert0[2]);
+
+          {
+            float fc[3];
+            float trans;
+
+            r->tri1 = tri1;
+            r->tri2 = tri2;
+            r->dist = dist;
+            r->prim = prm;
+
+            {
+              float w2;
+              w2 = _1 - (r->tri1 + r->tri2);
+
+              fc[0] =
+                (prm->c2[0] * r->tri1) + (prm->ext->c3[0] * r->tri2) +
+                (prm->c1[0] * w2);
+              fc[1] =
+                (prm->c2[1] * r->tri1) + (prm->ext->c3[1] * r->tri2) +
+                (prm->c1[1] * w2);
+              fc[2] =
+                (prm->c2[2] * r->tri1) + (prm->ext->c3[2] * r->tri2) +
+                (prm->c1[2] * w2);
+            }
+
+            trans = CharacterInterpolate(BI->G, prm->ext->char_id, fc);
+
+            if(trans == _0) { /* opaque? return immed. */
+              if(dist > -kR_SMALL4) {
+                if(nearest_shadow) {
+                  if(dist < H->r_dist) {
+                    H->minIndex = prm->vert;
+                    H->r_tri1 = tri1;
+                    H->r_tri2 = tri2;
+                    H->r_dist = dist;
+                    H->r_trans = (r->trans = trans);
                   }
+                } else {
+                  r->prim = prm;
+                  r->trans = _0;
+                  r->dist = dist;
+                  return (1);
                 }
               }
-              break;
+            } else if(trans_shadows) {
+              if((dist > -kR_SMALL4) &&
+                 ((H->r_trans > trans) ||
+                  (nearest_shadow && (dist < H->r_dist) && (H->r_trans >= trans)))) {
+                H->minIndex = prm->vert;
+                H->r_tri1 = tri1;
+                H->r_tri2 = tri2;
+                H->r_dist = dist;
+                H->r_trans = (r->trans = trans);
+              }
+            }
+          }
+        }
+      }
+    }
+    break;
 
-            case cPrimSphere:
+  case cPrimTriangle:
+    {
+      float *pre = BI->Precomp + BI->Vert2Normal[i] * 3;
 
-              oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
-              if(oppSq <= BI->Radius2[i]) {
-                dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+      if(pre[6]) {
+        float *vert0 = BI->Vertex + prm->vert * 3;
 
-                if(prm->trans == _0) {
-                  if(dist > -kR_SMALL4) {
-                    if(nearest_shadow) {
-                      if(dist < r_dist) {
-                        minIndex = prm->vert;
-                        r_dist = dist;
-                        r_trans = (r->trans = prm->trans);
-                      }
-                    } else {
-                      r->prim = prm;
-                      r->trans = prm->trans;
-                      r->dist = dist;
-                      return (1);
-                    }
-                  }
-                } else if(trans_shadows) {
-                  if((dist > -kR_SMALL4) &&
-                     ((r_trans > prm->trans) ||
-                      (nearest_shadow && (dist < r_dist) && (r_trans >= prm->trans)))) {
-                    minIndex = prm->vert;
-                    r_dist = dist;
-                    r_trans = (r->trans = prm->trans);
-                  }
+        float tvec0 = vt[0] - vert0[0];
+        float tvec1 = vt[1] - vert0[1];
+
+        tri1 = (tvec0 * pre[4] - tvec1 * pre[3]) * pre[7];
+        tri2 = -(tvec0 * pre[1] - tvec1 * pre[0]) * pre[7];
+        if(!((tri1 < BasisFudge0) ||
+             (tri2 < BasisFudge0) ||
+             (tri1 > BasisFudge1) || ((tri1 + tri2) > BasisFudge1))) {
+          float *tr = prm->ext->tr;
+          float trans = _0;
+
+          dist = (r->base[2] - (tri1 * pre[2]) - (tri2 * pre[5]) - vert0[2]);
+
+          if(prm->trans != _0) {
+            trans =
+              (tr[1] * tri1) + (tr[2] * tri2) + (tr[0] * (_1 - (tri1 + tri2)));
+          }
+
+          if(trans == _0) {
+            if(dist > -kR_SMALL4) {
+              if(nearest_shadow) {    /* do we need the nearest shadow? */
+                if(dist < H->r_dist) {
+                  H->minIndex = prm->vert;
+                  H->r_tri1 = tri1;
+                  H->r_tri2 = tri2;
+                  H->r_dist = dist;
+                  H->r_trans = (r->trans = trans);
                 }
+              } else {
+                r->prim = prm;
+                r->trans = _0;
+                r->dist = dist;
+                return (1);
               }
-              break;
+            }
+          } else if(trans_shadows) {
+            if((dist > -kR_SMALL4) &&
+               ((H->r_trans > trans) ||
+                (nearest_shadow && (dist < H->r_dist) && (H->r_trans >= trans)))) {
+              H->minIndex = prm->vert;
+              H->r_tri1 = tri1;
+              H->r_tri2 = tri2;
+              H->r_dist = dist;
+              H->r_trans = (r->trans = trans);
+            }
+          }
+        }
+      }
+    }
+    break;
 
-            case cPrimEllipsoid:
-
-              oppSq =
-                ZLineClipPointNoZCheck(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
-              if(oppSq <= BI->Radius2[i]) {
-                dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-
-                if((dist < r_dist) || (trans_shadows && (r_trans != _0))) {
-                  float *n1 = BI->Normal + BI->Vert2Normal[i] * 3;
-                  if(LineClipEllipsoidPoint(r->base, minusZ,
-                                            BI->Vertex + i * 3, &dist,
-                                            BI->Radius[i], BI->Radius2[i],
-                                            prm->n0, n1, n1 + 3, n1 + 6)) {
-
-                    if(prm->trans == _0) {
-                      if(dist > -kR_SMALL4) {
-                        if(nearest_shadow) {
-                          if(dist < r_dist) {
-                            minIndex = prm->vert;
-                            r_dist = dist;
-                            r_trans = (r->trans = prm->trans);
-                          }
-                        } else {
-                          r->prim = prm;
-                          r->trans = prm->trans;
-                          r->dist = dist;
-                          return (1);
-                        }
-                      }
-                    } else if(trans_shadows) {
-                      if((dist > -kR_SMALL4) &&
-                         ((r_trans > prm->trans) ||
-                          (nearest_shadow && (dist < r_dist)
-                           && (r_trans >= prm->trans)))) {
-                        minIndex = prm->vert;
-                        r_dist = dist;
-                        r_trans = (r->trans = prm->trans);
-                      }
-                    }
-                  }
+  case cPrimSphere:
+
+    oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
+    if(oppSq <= BI->Radius2[i]) {
+      dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+      return ShadowHitSphere(BC, H, prm, dist);
+    }
+    break;
+
+  case cPrimEllipsoid:
+
+    oppSq =
+      ZLineClipPointNoZCheck(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
+    if(oppSq <= BI->Radius2[i]) {
+      dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+
+      if((dist < H->r_dist) || (trans_shadows && (H->r_trans != _0))) {
+        float *n1 = BI->Normal + BI->Vert2Normal[i] * 3;
+        if(LineClipEllipsoidPoint(r->base, minusZ,
+                                  BI->Vertex + i * 3, &dist,
+                                  BI->Radius[i], BI->Radius2[i],
+                                  prm->ext->n0, n1, n1 + 3, n1 + 6)) {
+
+          if(prm->trans == _0) {
+            if(dist > -kR_SMALL4) {
+              if(nearest_shadow) {
+                if(dist < H->r_dist) {
+                  H->minIndex = prm->vert;
+                  H->r_dist = dist;
+                  H->r_trans = (r->trans = prm->trans);
                 }
+              } else {
+                r->prim = prm;
+                r->trans = prm->trans;
+                r->dist = dist;
+                return (1);
               }
-              break;
-            case cPrimCone:
-              {
-                float sph_rad, sph_rad_sq;
-                if(ConeLineToSphereCapped(r->base, minusZ, BI->Vertex + i * 3,
-                                          BI->Normal + BI->Vert2Normal[i] * 3,
-                                          BI->Radius[i], prm->r2, prm->l1, sph, &tri1,
-                                          &sph_rad, &sph_rad_sq, cCylCap::Flat, cCylCap::Flat)) {
-
-                  oppSq = ZLineClipPoint(r->base, sph, &dist, sph_rad);
-                  if(oppSq <= sph_rad_sq) {
-                    dist = (float) (sqrt1f(dist) - sqrt1f((sph_rad_sq - oppSq)));
-
-                    if(prm->trans == _0) {
-                      if(dist > -kR_SMALL4) {
-                        if(nearest_shadow) {
-                          if(dist < r_dist) {
-                            if(prm->l1 > kR_SMALL4)
-                              r_tri1 = tri1 / prm->l1;
-                            r_sphere0 = sph[0];
-                            r_sphere1 = sph[1];
-                            r_sphere2 = sph[2];
-                            minIndex = prm->vert;
-                            r->trans = prm->trans;
-                            r_dist = dist;
-                            r_trans = (r->trans = prm->trans);
-                          }
-                        } else {
-                          r->prim = prm;
-                          r->trans = prm->trans;
-                          r->dist = dist;
-                          return (1);
-                        }
-                      }
-                    } else if(trans_shadows) {
-                      if((dist > -kR_SMALL4) &&
-                         ((r_trans > prm->trans) ||
-                          (nearest_shadow && (dist < r_dist)
-                           && (r_trans >= prm->trans)))) {
-                        if(prm->l1 > kR_SMALL4)
-                          r_tri1 = tri1 / prm->l1;
-                        r_sphere0 = sph[0];
-                        r_sphere1 = sph[1];
-                        r_sphere2 = sph[2];
-                        minIndex = prm->vert;
-                        r->trans = prm->trans;
-                        r_dist = dist;
-                        r_trans = (r->trans = prm->trans);
-                      }
-                    }
-                  }
+            }
+          } else if(trans_shadows) {
+            if((dist > -kR_SMALL4) &&
+               ((H->r_trans > prm->trans) ||
+                (nearest_shadow && (dist < H->r_dist)
+                 && (H->r_trans >= prm->trans)))) {
+              H->minIndex = prm->vert;
+              H->r_dist = dist;
+              H->r_trans = (r->trans = prm->trans);
+            }
+          }
+        }
+      }
+    }
+    break;
+  case cPrimCone:
+    {
+      float sph_rad, sph_rad_sq;
+      if(ConeLineToSphereCapped(r->base, minusZ, BI->Vertex + i * 3,
+                                BI->Normal + BI->Vert2Normal[i] * 3,
+                                BI->Radius[i], prm->r2, prm->l1, sph, &tri1,
+                                &sph_rad, &sph_rad_sq, cCylCap::Flat, cCylCap::Flat)) {
+
+        oppSq = ZLineClipPoint(r->base, sph, &dist, sph_rad);
+        if(oppSq <= sph_rad_sq) {
+          dist = (float) (sqrt1f(dist) - sqrt1f((sph_rad_sq - oppSq)));
+
+          if(prm->trans == _0) {
+            if(dist > -kR_SMALL4) {
+              if(nearest_shadow) {
+                if(dist < H->r_dist) {
+                  if(prm->l1 > kR_SMALL4)
+                    H->r_tri1 = tri1 / prm->l1;
+                  H->r_sphere0 = sph[0];
+                  H->r_sphere1 = sph[1];
+                  H->r_sphere2 = sph[2];
+                  H->minIndex = prm->vert;
+                  r->trans = prm->trans;
+                  H->r_dist = dist;
+                  H->r_trans = (r->trans = prm->trans);
                 }
+              } else {
+                r->prim = prm;
+                r->trans = prm->trans;
+                r->dist = dist;
+                return (1);
               }
-              break;
-            case cPrimCylinder:
-              if(ZLineToSphereCapped(r->base, BI->Vertex + i * 3,
-                                     BI->Normal + BI->Vert2Normal[i] * 3,
-                                     BI->Radius[i], prm->l1, sph, &tri1, prm->cap1,
-                                     prm->cap2, BI->Precomp + BI->Vert2Normal[i] * 3)) {
-
-                oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
-                if(oppSq <= BI->Radius2[i]) {
-                  dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-
-                  if(prm->trans == _0) {
-                    if(dist > -kR_SMALL4) {
-                      if(nearest_shadow) {
-                        if(dist < r_dist) {
-                          if(prm->l1 > kR_SMALL4)
-                            r_tri1 = tri1 / prm->l1;
-                          r_sphere0 = sph[0];
-                          r_sphere1 = sph[1];
-                          r_sphere2 = sph[2];
-                          minIndex = prm->vert;
-                          r->trans = prm->trans;
-                          r_dist = dist;
-                          r_trans = (r->trans = prm->trans);
-                        }
-                      } else {
-                        r->prim = prm;
-                        r->trans = prm->trans;
-                        r->dist = dist;
-                        return (1);
-                      }
-                    }
-                  } else if(trans_shadows) {
-                    if((dist > -kR_SMALL4) &&
-                       ((r_trans > prm->trans) ||
-                        (nearest_shadow && (dist < r_dist) && (r_trans >= prm->trans)))) {
-                      if(prm->l1 > kR_SMALL4)
-                        r_tri1 = tri1 / prm->l1;
-                      r_sphere0 = sph[0];
-                      r_sphere1 = sph[1];
-                      r_sphere2 = sph[2];
-                      minIndex = prm->vert;
-                      r->trans = prm->trans;
-                      r_dist = dist;
-                      r_trans = (r->trans = prm->trans);
-                    }
-                  }
-                }
+            }
+          } else if(trans_shadows) {
+            if((dist > -kR_SMALL4) &&
+               ((H->r_trans > prm->trans) ||
+                (nearest_shadow && (dist < H->r_dist)
+                 && (H->r_trans >= prm->trans)))) {
+              if(prm->l1 > kR_SMALL4)
+                H->r_tri1 = tri1 / prm->l1;
+              H->r_sphere0 = sph[0];
+              H->r_sphere1 = sph[1];
+              H->r_sphere2 = sph[2];
+              H->minIndex = prm->vert;
+              r->trans = prm->trans;
+              H->r_dist = dist;
+              H->r_trans = (r->trans = prm->trans);
+            }
+          }
+        }
+      }
+    }
+    break;
+  case cPrimCylinder:
+    if(ZLineToSphereCapped(r->base, BI->Vertex + i * 3,
+                           BI->Normal + BI->Vert2Normal[i] * 3,
+                           BI->Radius[i], prm->l1, sph, &tri1, prm->cap1,
+                           prm->cap2, BI->Precomp + BI->Vert2Normal[i] * 3)) {
+
+      oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
+      if(oppSq <= BI->Radius2[i]) {
+        dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+
+        if(prm->trans == _0) {
+          if(dist > -kR_SMALL4) {
+            if(nearest_shadow) {
+              if(dist < H->r_dist) {
+                if(prm->l1 > kR_SMALL4)
+                  H->r_tri1 = tri1 / prm->l1;
+                H->r_sphere0 = sph[0];
+                H->r_sphere1 = sph[1];
+                H->r_sphere2 = sph[2];
+                H->minIndex = prm->vert;
+                r->trans = prm->trans;
+                H->r_dist = dist;
+                H->r_trans = (r->trans = prm->trans);
               }
-              break;
-
-            case cPrimSausage:
-              if(ZLineToSphere
-                 (r->base, BI->Vertex + i * 3, BI->Normal + BI->Vert2Normal[i] * 3,
-                  BI->Radius[i], prm->l1, sph, &tri1,
-                  BI->Precomp + BI->Vert2Normal[i] * 3)) {
-                oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
-                if(oppSq <= BI->Radius2[i]) {
-                  dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
-
-                  if(prm->trans == _0) {
-                    if(dist > -kR_SMALL4) {
-                      if(nearest_shadow) {
-                        if(dist < r_dist) {
-                          if(prm->l1 > kR_SMALL4)
-                            r_tri1 = tri1 / prm->l1;
-                          r_sphere0 = sph[0];
-                          r_sphere1 = sph[1];
-                          r_sphere2 = sph[2];
-                          minIndex = prm->vert;
-                          r_dist = dist;
-                          r_trans = (r->trans = prm->trans);
-                        }
-                      } else {
-                        r->prim = prm;
-                        r->trans = prm->trans;
-                        r->dist = dist;
-                        return (1);
-                      }
-                    }
-                  } else if(trans_shadows) {
-                    if((dist > -kR_SMALL4) &&
-                       ((r_trans > prm->trans) ||
-                        (nearest_shadow && (dist < r_dist) && (r_trans >= prm->trans)))) {
-                      if(prm->l1 > kR_SMALL4)
-                        r_tri1 = tri1 / prm->l1;
-
-                      r_sphere0 = sph[0];
-                      r_sphere1 = sph[1];
-                      r_sphere2 = sph[2];
-                      minIndex = prm->vert;
-                      r_dist = dist;
-                      r_trans = (r->trans = prm->trans);
-                    }
-                  }
-                }
+            } else {
+              r->prim = prm;
+              r->trans = prm->trans;
+              r->dist = dist;
+              return (1);
+            }
+          }
+        } else if(trans_shadows) {
+          if((dist > -kR_SMALL4) &&
+             ((H->r_trans > prm->trans) ||
+              (nearest_shadow && (dist < H->r_dist) && (H->r_trans >= prm->trans)))) {
+            if(prm->l1 > kR_SMALL4)
+              H->r_tri1 = tri1 / prm->l1;
+            H->r_sphere0 = sph[0];
+            H->r_sphere1 = sph[1];
+            H->r_sphere2 = sph[2];
+            H->minIndex = prm->vert;
+            r->trans = prm->trans;
+            H->r_dist = dist;
+            H->r_trans = (r->trans = prm->trans);
+          }
+        }
+      }
+    }
+    break;
+
+  case cPrimSausage:
+    if(ZLineToSphere
+       (r->base, BI->Vertex + i * 3, BI->Normal + BI->Vert2Normal[i] * 3,
+        BI->Radius[i], prm->l1, sph, &tri1,
+        BI->Precomp + BI->Vert2Normal[i] * 3)) {
+      oppSq = ZLineClipPoint(r->base, sph, &dist, BI->Radius[i]);
+      if(oppSq <= BI->Radius2[i]) {
+        dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
+
+        if(prm->trans == _0) {
+          if(dist > -kR_SMALL4) {
+            if(nearest_shadow) {
+              if(dist < H->r_dist) {
+                if(prm->l1 > kR_SMALL4)
+                  H->r_tri1 = tri1 / prm->l1;
+                H->r_sphere0 = sph[0];
+                H->r_sphere1 = sph[1];
+                H->r_sphere2 = sph[2];
+                H->minIndex = prm->vert;
+                H->r_dist = dist;
+                H->r_trans = (r->trans = prm->trans);
               }
-              break;
-            }                   /* end of switch */
+            } else {
+              r->prim = prm;
+              r->trans = prm->trans;
+              r->dist = dist;
+              return (1);
+            }
+          }
+        } else if(trans_shadows) {
+          if((dist > -kR_SMALL4) &&
+             ((H->r_trans > prm->trans) ||
+              (nearest_shadow && (dist < H->r_dist) && (H->r_trans >= prm->trans)))) {
+            if(prm->l1 > kR_SMALL4)
+              H->r_tri1 = tri1 / prm->l1;
+
+            H->r_sphere0 = sph[0];
+            H->r_sphere1 = sph[1];
+            H->r_sphere2 = sph[2];
+            H->minIndex = prm->vert;
+            H->r_dist = dist;
+            H->r_trans = (r->trans = prm->trans);
+          }
+        }
+      }
+    }
+    break;
+  }                   /* end of switch */
+  return (0);
+}
+
+int BasisHitShadow(BasisCallRec * BC)
+{
+  int h, *ip;
+  int a, b, c;
+  int *elist;
+  float minusZ[3] = { 0.0F, 0.0F, -1.0F };
+  /* local copies (eliminate these extra copies later on) */
+
+  CBasis *BI = BC->Basis;
+  RayInfo *r = BC->rr;
+  BVHType *bvh = BI->BVH;
+
+  if(bvh || MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
+    ShadowHitRec H;
+    int v2p;
+    int i, ii;
+    int *xxtmp = NULL;
+
+    int n_vert = BI->NVertex;
+    int n_eElem = bvh ? (int) bvh->EList.size() : BI->Map->NEElem;
+    BVHWalker walker;
+    int except1 = BC->except1;
+    int except2 = BC->except2;
+    const int *vert2prim = BC->vert2prim;
+    MapCache *cache = &BC->cache;
+    int *cache_cache = cache->Cache;
+    int *cache_CacheLink = cache->CacheLink;
+    CPrimitive *BC_prim = BC->prim;
+
+    ShadowHitInit(&H, r);
+
+    if(except1 >= 0)
+      except1 = vert2prim[except1];
+    if(except2 >= 0)
+      except2 = vert2prim[except2];
+
+    if(bvh) {
+      walker.init(bvh, r->base, minusZ, -kR_SMALL4, &BC->bvh_stats);
+      elist = bvh->EList.data();
+    } else {
+      xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
+      elist = BI->Map->EList;
+    }
+
+    MapCacheReset(cache);
+
+    while(1) {
+      if(bvh) {                 /* can't cull by r_dist, see below */
+        if(!(h = walker.next(FLT_MAX)))
+          break;
+      } else {
+        if(c < MapBorder)
+          break;
+        h = *xxtmp;
+      }
+      if((h > 0) && (h < n_eElem)) {
+        int do_loop;
+        ip = elist + h;
+        i = *(ip++);
+        do_loop = ((i >= 0) && (i < n_vert));
+        while(do_loop) {
+          ii = *(ip++);
+          v2p = vert2prim[i];
+          do_loop = ((ii >= 0) && (ii < n_vert));
+          if((v2p != except1) && (v2p != except2) && !MapCached(cache, v2p)) {
+            /*MapCache(cache,v2p); */
+            cache_cache[v2p] = 1;
+            cache_CacheLink[v2p] = cache->CacheStart;
+            cache->CacheStart = v2p;
+
+            if(ShadowHitPrim(BC, &H, BC_prim + v2p, i))
+              return (1);
           }
           /* end of if */
           i = ii;
@@ -2762,8 +3211,8 @@ int BasisHitShadow(BasisCallRec * BC)
 
       /* and of course stop when we hit the edge of the map */
 
-      if(local_iflag)
-        break;
+      if(bvh)
+        continue;
 
       /* we've processed all primitives associated with this voxel, 
          so if an intersection has been found which occurs in front of
@@ -2787,32 +3236,421 @@ int BasisHitShadow(BasisCallRec * BC)
 
     }                           /* end of while */
 
-    if(minIndex > -1) {
-      r_prim = BC->prim + vert2prim[minIndex];
+    BC->interior_flag = false;
+    return ShadowHitFinish(BC, &H);
+  }                             /* end of if */
+  BC->interior_flag = false;
+  return (-1);
+}
+
+/**
+ * BasisHitShadow for a packet of n <= cBasisPacketMax rays which enter the
+ * map in the same voxel, with one except1 vertex per ray (BC->except1 is
+ * ignored). Results go to r[k] and hit[k], see BasisHitOrthoscopicPacket.
+ */
+void BasisHitShadowPacket(BasisCallRec * BC, int width, RayInfo * r,
+                          const int *except1, int n, int *hit)
+{
+  CBasis *BI = BC->Basis;
+  MapType *map = BI->Map;
+  ZSpherePacketFn *zsphere = ZSpherePacketGet(width);
+  ShadowHitRec H[cBasisPacketMax];
+  float bx[cBasisPacketMax] = {}, by[cBasisPacketMax] = {}, bz[cBasisPacketMax] = {};
+  float dist[cBasisPacketMax];
+  int sphere_hit[cBasisPacketMax];
+  int except[cBasisPacketMax];
+  int done[cBasisPacketMax];
+  int a, b, c, h, k, n_active;
+
+  for(k = 0; k < n; k++)
+    hit[k] = -1;
+
+  if(!map || !MapInsideXY(map, r[0].base, &a, &b, &c))
+    return;
+
+  {
+    int i, ii, v2p, do_loop, *ip;
+    int except2 = BC->except2;
+    int n_vert = BI->NVertex;
+    int n_eElem = map->NEElem;
+    int *elist = map->EList;
+    int *xxtmp = map->EHead + (a * map->D1D2) + (b * map->Dim[2]) + c;
+    const int *vert2prim = BC->vert2prim;
+    MapCache *cache = &BC->cache;
+
+    for(k = 0; k < n; k++) {
+      ShadowHitInit(H + k, r + k);
+      bx[k] = r[k].base[0];
+      by[k] = r[k].base[1];
+      bz[k] = r[k].base[2];
+      except[k] = (except1[k] >= 0) ? vert2prim[except1[k]] : -1;
+      done[k] = false;
+    }
+    n_active = n;
+
+    if(except2 >= 0)
+      except2 = vert2prim[except2];
+
+    MapCacheReset(cache);
+
+    while(n_active && (c >= MapBorder)) {
+      h = *xxtmp;
+      if((h > 0) && (h < n_eElem)) {
+        ip = elist + h;
+        i = *(ip++);
+        do_loop = ((i >= 0) && (i < n_vert));
+        while(n_active && do_loop) {
+          ii = *(ip++);
+          v2p = vert2prim[i];
+          do_loop = ((ii >= 0) && (ii < n_vert));
+
+          if((v2p != except2) && (!MapCached(cache, v2p))) {
+            CPrimitive *prm = BC->prim + v2p;
+            MapCache(cache, v2p);
+
+            if(prm->type == cPrimSphere) {
+              zsphere(n, bx, by, bz, BI->Vertex + i * 3, BI->Radius[i], BI->Radius2[i],
+                      dist, sphere_hit);
+              for(k = 0; k < n; k++) {
+                if(!done[k] && (v2p != except[k]) && sphere_hit[k] &&
+                   ShadowHitSphere(BC, H + k, prm, dist[k])) {
+                  done[k] = true;
+                  hit[k] = 1;
+                  n_active--;
+                }
+              }
+            } else {
+              for(k = 0; k < n; k++) {
+                if(!done[k] && (v2p != except[k]) && ShadowHitPrim(BC, H + k, prm, i)) {
+                  done[k] = true;
+                  hit[k] = 1;
+                  n_active--;
+                }
+              }
+            }
+          }
+          i = ii;
+        }
+      }
+
+      c--;
+      xxtmp--;
+    }
+  }
+
+  for(k = 0; k < n; k++) {
+    if(!done[k])
+      hit[k] = ShadowHitFinish(BC, H + k);
+  }
+}
 
-      if((r_prim->type == cPrimSphere) || (r_prim->type == cPrimEllipsoid)) {
-        const float *vv = BI->Vertex + minIndex * 3;
-        r_sphere0 = vv[0];
-        r_sphere1 = vv[1];
-        r_sphere2 = vv[2];
+/*========================================================================*/
+/* returns true if the ray is done, see ShadowHitSphere */
+static int ShadowHitLinePrim(BasisCallRec * BC, ShadowHitRec * H,
+                             CPrimitive * prm, int i)
+{
+  const float _0 = 0.0F, _1 = 1.0F;
+  CBasis *BI = BC->Basis;
+  RayInfo *r = H->r;
+  float *v = BI->Vertex + i * 3;
+  float dist, tri1, sph[3];
+  float trans = prm->trans;
+
+  switch (prm->type) {
+  case cPrimTriangle:
+    {
+      /* same as in BasisHitPerspective */
+      const float *d10 = BI->Precomp + BI->Vert2Normal[i] * 3;
+      const float *d20 = d10 + 3;
+      float pvec[3], tvec[3], qvec[3], det, tri2;
+
+      cross_product3f(r->dir, d20, pvec);
+      det = dot_product3f(pvec, d10);
+      if((det < EPSILON) && (det > -EPSILON))
+        return 0;
+      subtract3f(r->base, v, tvec);
+      tri1 = dot_product3f(tvec, pvec) / det;
+      if((tri1 < BC->fudge0) || (tri1 > BC->fudge1))
+        return 0;
+      cross_product3f(tvec, d10, qvec);
+      tri2 = dot_product3f(r->dir, qvec) / det;
+      if((tri2 < BC->fudge0) || ((tri1 + tri2) > BC->fudge1))
+        return 0;
+      dist = dot_product3f(d20, qvec) / det;
+      if(trans != _0) {
+        const float *tr = prm->ext->tr;
+        trans = (tr[1] * tri1) + (tr[2] * tri2) + (tr[0] * (_1 - (tri1 + tri2)));
       }
     }
+    break;
+  case cPrimSphere:
+    if(!LineClipPoint(r->base, r->dir, v, &dist, BI->Radius[i], BI->Radius2[i]))
+      return 0;
+    break;
+  case cPrimEllipsoid:
+    {
+      float *n1 = BI->Normal + BI->Vert2Normal[i] * 3;
+      if(!LineClipPoint(r->base, r->dir, v, &dist, BI->Radius[i], BI->Radius2[i]) ||
+         !LineClipEllipsoidPoint(r->base, r->dir, v, &dist,
+                                 BI->Radius[i], BI->Radius2[i],
+                                 prm->ext->n0, n1, n1 + 3, n1 + 6))
+        return 0;
+    }
+    break;
+  case cPrimCone:
+    {
+      float sph_rad, sph_rad_sq;
+      if(!ConeLineToSphereCapped(r->base, r->dir, v,
+                                 BI->Normal + BI->Vert2Normal[i] * 3,
+                                 BI->Radius[i], prm->r2, prm->l1, sph, &tri1,
+                                 &sph_rad, &sph_rad_sq, cCylCap::Flat, cCylCap::Flat) ||
+         !LineClipPoint(r->base, r->dir, sph, &dist, sph_rad, sph_rad_sq))
+        return 0;
+    }
+    break;
+  case cPrimCylinder:
+    if(!LineToSphereCapped(r->base, r->dir, v, BI->Normal + BI->Vert2Normal[i] * 3,
+                           BI->Radius[i], prm->l1, sph, &tri1, prm->cap1, prm->cap2) ||
+       !LineClipPoint(r->base, r->dir, sph, &dist, BI->Radius[i], BI->Radius2[i]))
+      return 0;
+    break;
+  case cPrimSausage:
+    if(!LineToSphere(r->base, r->dir, v, BI->Normal + BI->Vert2Normal[i] * 3,
+                     BI->Radius[i], prm->l1, sph, &tri1) ||
+       !LineClipPoint(r->base, r->dir, sph, &dist, BI->Radius[i], BI->Radius2[i]))
+      return 0;
+    break;
+  default:                     /* labels don't get instanced */
+    return 0;
+  }
 
-    BC->interior_flag = local_iflag;
-    r->tri1 = r_tri1;
-    r->tri2 = r_tri2;
-    r->prim = r_prim;
-    r->dist = r_dist;
-    r->trans = r_trans;
-    r->sphere[0] = r_sphere0;
-    r->sphere[1] = r_sphere1;
-    r->sphere[2] = r_sphere2;
-    return (minIndex);
-  }                             /* end of if */
-  BC->interior_flag = local_iflag;
-  return (-1);
+  return ShadowHitDist(BC, H, prm, dist, trans);
+}
+
+/**
+ * BasisHitShadow for a ray along r->dir (normalized) instead of -Z. Only
+ * works with a BVH and the perspective triangle precomputation, this is
+ * what the ray tracer uses for instanced primitives (see RayInstance.h).
+ */
+int BasisHitShadowLine(BasisCallRec * BC)
+{
+  CBasis *BI = BC->Basis;
+  RayInfo *r = BC->rr;
+  BVHType *bvh = BI->BVH;
+  const int *vert2prim = BC->vert2prim;
+  const int *elist = bvh->EList.data();
+  int except1 = BC->except1;
+  int except2 = BC->except2;
+  MapCache *cache = &BC->cache;
+  ShadowHitRec H;
+  BVHWalker walker;
+  int h;
+
+  ShadowHitInit(&H, r);
+
+  if(except1 >= 0)
+    except1 = vert2prim[except1];
+  if(except2 >= 0)
+    except2 = vert2prim[except2];
+
+  MapCacheReset(cache);
+  walker.init(bvh, r->base, r->dir, -kR_SMALL4, &BC->bvh_stats);
+
+  /* transparent blockers may be behind the nearest one, so only opaque
+     nearest-shadow rays can be cut short */
+  while((h = walker.next((BC->nearest_shadow && H.minIndex > -1 &&
+                          H.r_trans == 0.0F) ? H.r_dist : FLT_MAX))) {
+    int i;
+    for(const int *ip = elist + h; (i = *ip) >= 0; ip++) {
+      int v2p = vert2prim[i];
+      if((v2p != except1) && (v2p != except2) && !MapCached(cache, v2p)) {
+        MapCache(cache, v2p);
+        if(ShadowHitLinePrim(BC, &H, BC->prim + v2p, i))
+          return (1);
+      }
+    }
+  }
+
+  BC->interior_flag = false;
+  return ShadowHitFinish(BC, &H);
+}
+
+/*========================================================================*/
+/*
+ * Box of the primitive which starts at vertex `a`, padded for the slab test
+ */
+static int BasisPrimitiveBounds(CBasis * I, CPrimitive * prm, int a,
+                                float *lo, float *hi)
+{
+  const float *v = I->Vertex;
+  float pad;
+  int b;
+
+  switch (prm->type) {
+  case cPrimTriangle:
+  case cPrimCharacter:
+    copy3f(v + a * 3, lo);
+    copy3f(v + a * 3, hi);
+    for(b = 1; b < 3; b++) {
+      const float *vv = v + (a + b) * 3;
+      lo[0] = std::min(lo[0], vv[0]);
+      lo[1] = std::min(lo[1], vv[1]);
+      lo[2] = std::min(lo[2], vv[2]);
+      hi[0] = std::max(hi[0], vv[0]);
+      hi[1] = std::max(hi[1], vv[1]);
+      hi[2] = std::max(hi[2], vv[2]);
+    }
+    /* flat boxes need some thickness for the slab test */
+    pad = kR_SMALL4 + kR_SMALL4 * (float) diff3f(lo, hi);
+    break;
+  case cPrimCone:
+  case cPrimCylinder:
+  case cPrimSausage:
+    {
+      const float *n = I->Normal + I->Vert2Normal[a] * 3;
+      float end[3];
+      scale3f(n, prm->l1, end);
+      add3f(v + a * 3, end, end);
+      lo[0] = std::min(v[a * 3], end[0]);
+      lo[1] = std::min(v[a * 3 + 1], end[1]);
+      lo[2] = std::min(v[a * 3 + 2], end[2]);
+      hi[0] = std::max(v[a * 3], end[0]);
+      hi[1] = std::max(v[a * 3 + 1], end[1]);
+      hi[2] = std::max(v[a * 3 + 2], end[2]);
+      pad = std::max(I->Radius[a], prm->r2) + kR_SMALL4;
+    }
+    break;
+  case cPrimEllipsoid:
+  case cPrimSphere:
+    copy3f(v + a * 3, lo);
+    copy3f(v + a * 3, hi);
+    pad = I->Radius[a] + kR_SMALL4;
+    break;
+  default:
+    return false;
+  }
+
+  for(b = 0; b < 3; b++) {
+    lo[b] -= pad;
+    hi[b] += pad;
+  }
+  return true;
 }
 
+/*========================================================================*/
+/*
+ * Bounding volume hierarchy over the primitives (ray_bvh). Each primitive
+ * enters the hierarchy once with its own box, so unlike the voxel map there
+ * is no need to remap large primitives onto extra vertices.
+ */
+static int BasisMakeBVH(CBasis * I, int *vert2prim, CPrimitive * prim,
+                        float *volume, int perspective)
+{
+  double timing = UtilGetSeconds(I->G);
+  std::vector<float> bounds;
+  std::vector<int> ids;
+  int a;
+
+  bounds.reserve(6 * I->NVertex);
+  ids.reserve(I->NVertex);
+
+  for(a = 0; a < I->NVertex; a++) {
+    CPrimitive *prm = prim + vert2prim[a];
+    float lo[3], hi[3];
+
+    if(a != prm->vert)          /* one entry per primitive */
+      continue;
+
+    if(!BasisPrimitiveBounds(I, prm, a, lo, hi))
+      continue;
+
+    if(volume && !perspective) {
+      /* orthoscopic rays never leave the viewing volume in X and Y */
+      if((hi[0] < volume[0]) || (lo[0] > volume[1]) ||
+         (hi[1] < volume[2]) || (lo[1] > volume[3]))
+        continue;
+    }
+
+    bounds.insert(bounds.end(), lo, lo + 3);
+    bounds.insert(bounds.end(), hi, hi + 3);
+    ids.push_back(a);
+  }
+
+  delete I->BVH;
+  I->BVH = new BVHType;
+  I->BVH->build(ids.size(), bounds.data(), ids.data());
+
+  PRINTFB(I->G, FB_Ray, FB_Blather)
+    " BasisMakeBVH: %d primitives, %d nodes, %d KB, %4.3f sec.\n",
+    (int) ids.size(), (int) I->BVH->Nodes.size(),
+    (int) (I->BVH->memory() / 1024), UtilGetSeconds(I->G) - timing ENDFB(I->G);
+
+  return true;
+}
+
+/*========================================================================*/
+/*
+ * Reuses the topology of a BVH built by BasisMakeBVH for the same primitives
+ * in other coordinates, e.g. after a rotation of the camera. Takes ownership
+ * of bvh.
+ */
+int BasisRefitBVH(CBasis * I, int *vert2prim, CPrimitive * prim, BVHType * bvh)
+{
+  double timing = UtilGetSeconds(I->G);
+
+  bvh->refit([&](int a, float *lo, float *hi) {
+    return BasisPrimitiveBounds(I, prim + vert2prim[a], a, lo, hi) != 0;
+  });
+
+  delete I->BVH;
+  I->BVH = bvh;
+
+  PRINTFB(I->G, FB_Ray, FB_Blather)
+    " BasisRefitBVH: %d nodes, %4.3f sec.\n",
+    (int) bvh->Nodes.size(), UtilGetSeconds(I->G) - timing ENDFB(I->G);
+
+  return true;
+}
+
+/*========================================================================*/
+/*
+ * BVH over the primitives of the vertex range [v_start, v_stop) only, for
+ * instanced primitives. The box of the whole range goes to box_min/box_max.
+ */
+void BasisMakeRangeBVH(CBasis * I, int *vert2prim, CPrimitive * prim,
+                       int v_start, int v_stop, BVHType * bvh,
+                       float *box_min, float *box_max)
+{
+  std::vector<float> bounds;
+  std::vector<int> ids;
+  int a, b;
+
+  for(b = 0; b < 3; b++) {
+    box_min[b] = FLT_MAX;
+    box_max[b] = -FLT_MAX;
+  }
+
+  for(a = v_start; a < v_stop; a++) {
+    CPrimitive *prm = prim + vert2prim[a];
+    float lo[3], hi[3];
+
+    if(a != prm->vert || !BasisPrimitiveBounds(I, prm, a, lo, hi))
+      continue;
+
+    for(b = 0; b < 3; b++) {
+      box_min[b] = std::min(box_min[b], lo[b]);
+      box_max[b] = std::max(box_max[b], hi[b]);
+    }
+
+    bounds.insert(bounds.end(), lo, lo + 3);
+    bounds.insert(bounds.end(), hi, hi + 3);
+    ids.push_back(a);
+  }
+
+  bvh->build(ids.size(), bounds.data(), ids.data());
+}
+
+
 /*========================================================================*/
 int BasisMakeMap(CBasis * I, int *vert2prim, CPrimitive * prim, int n_prim,
 		 float *volume,
@@ -2848,6 +3686,9 @@ int BasisMakeMap(CBasis * I, int *vert2prim, CPrimitive * prim, int n_prim,
     I->Vertex[0], I->Vertex[1], I->Vertex[2]
     ENDFD;
 
+  if(SettingGetGlobal_b(I->G, cSetting_ray_bvh))
+    return BasisMakeBVH(I, vert2prim, prim, volume, perspective);
+
   sep = I->MinVoxel;
   if(sep == _0) {
     remapMode = false;
@@ -3590,12 +4431,23 @@ int BasisInit(PyMOLGlobals * G, CBasis * I, int group_id)
     I->Precomp = VLACacheAlloc(I->G, float, 1, group_id, cCache_basis_precomp);
   CHECKOK(ok, I->Precomp);
   I->Map = NULL;
+  I->BVH = NULL;
   I->NVertex = 0;
   I->NNormal = 0;
   return ok;
 }
 
 
+/*========================================================================*/
+int BasisCacheInit(CBasis * I, MapCache * M, int group_id, int block_base)
+{
+  /* both the voxel map and the BVH list vertex indices, so size by vertex count */
+  if(I->BVH)
+    return MapCacheInitSize(M, I->G, I->NVertex, group_id, block_base);
+  return MapCacheInit(M, I->Map, group_id, block_base);
+}
+
+
 /*========================================================================*/
 void BasisFinish(CBasis * I, int group_id)
 {
@@ -3603,6 +4455,8 @@ void BasisFinish(CBasis * I, int group_id)
     MapFree(I->Map);
     I->Map = NULL;
   }
+  delete I->BVH;
+  I->BVH = NULL;
   VLACacheFreeP(I->G, I->Radius2, group_id, cCache_basis_radius2, false);
   VLACacheFreeP(I->G, I->Radius, group_id, cCache_basis_radius, false);
   VLACacheFreeP(I->G, I->Vertex, group_id, cCache_basis_vertex, false);
@@ -18,6 +18,7 @@ Z* -------------------------------------------------------------------
 #define _H_Basis
 
 #include"Map.h"
+#include"BVH.h"
 #include"Vector.h"
 
 #define cPrimSphere 1
@@ -42,7 +43,7 @@ Z* -------------------------------------------------------------------
 #undef None
 #endif
 
-enum class cCylCap {
+enum class cCylCap : unsigned char {
   None = 0,
   Flat = 1,
   Round = 2,
@@ -66,24 +67,32 @@ constexpr auto cCylCapRound = cCylCap::Round;
 
 #define cCylShaderMask 0x1F
 
+/* fields which are only needed by triangles, characters and ellipsoids */
+typedef struct {
+  float v3[3];
+  float n0[3], n1[3], n2[3], n3[3];     /* ellipsoids: n0 = axis lengths, n1-n3 = axes */
+  float c3[3], tr[3];                   /* tr = transparency */
+  int char_id;
+} CPrimitiveExt;                /* 88 bytes */
+
 typedef struct {
   int vert;
-  float v1[3], v2[3], v3[3];
-  float n0[3], n1[3], n2[3], n3[3];
-  float c1[3], c2[3], c3[3], ic[3], tr[3];      /* ic = interior color, tr = transparency */
+  float v1[3], v2[3];
+  float c1[3], c2[3], ic[3];    /* ic = interior color */
   float r1, r2, l1;
   float trans;
-  int char_id;
+  CPrimitiveExt *ext;           /* NULL for spheres, cylinders, sausages and cones */
   char type;
   cCylCap cap1, cap2;
-  int cull;
+  char cull;
   char wobble, ramped, no_lighting;
   /* float wobble_param[3] eliminated to save space */
-} CPrimitive;                   /* currently 172 bytes -> appoximately 6.5 million primitives per gigabyte */
+} CPrimitive;                   /* currently 96 bytes (+88 for triangles) -> approximately 11 million spheres per gigabyte */
 
 typedef struct {
   PyMOLGlobals *G;
   MapType *Map;
+  BVHType *BVH;                 /* alternative to Map, see ray_bvh */
   float *Vertex, *Normal, *Precomp;
   float *Radius, *Radius2, MaxRadius, MinVoxel;
   int *Vert2Normal;
@@ -130,14 +139,17 @@ typedef struct {
   int interior_flag;
   int pass;
   float back_dist;
+  BVHStats bvh_stats;            /* traversal counters */
 } BasisCallRec;
 
 int BasisInit(PyMOLGlobals * G, CBasis * I, int group_id);
 void BasisFinish(CBasis * I, int group_id);
+int BasisCacheInit(CBasis * I, MapCache * M, int group_id, int block_base);
 int BasisMakeMap(CBasis * I, int *vert2prim, CPrimitive * prim, int n_prim,
 		 float *volume,
 		 int group_id, int block_base,
 		 int perspective, float front, float size_hint);
+int BasisRefitBVH(CBasis * I, int *vert2prim, CPrimitive * prim, BVHType * bvh);
 
 void BasisSetupMatrix(CBasis * I);
 void BasisGetTriangleNormal(CBasis * I, RayInfo * r, int i, float *fc, int perspective);
@@ -149,6 +161,22 @@ int BasisHitPerspective(BasisCallRec * BC);
 int BasisHitOrthoscopic(BasisCallRec * BC);
 int BasisHitShadow(BasisCallRec * BC);
 
+/* instanced primitives, see RayInstance.h */
+int BasisHitShadowLine(BasisCallRec * BC);
+void BasisMakeRangeBVH(CBasis * I, int *vert2prim, CPrimitive * prim,
+                       int v_start, int v_stop, BVHType * bvh,
+                       float *box_min, float *box_max);
+
+/* packet traversal of coherent orthoscopic rays, see ray_packet_size */
+#define cBasisPacketMax 8
+
+int BasisPacketWidth(PyMOLGlobals * G);
+int BasisGetVoxel(CBasis * I, const float *v);
+void BasisHitOrthoscopicPacket(BasisCallRec * BC, int width, RayInfo * r, int n,
+                               int *hit, int *interior);
+void BasisHitShadowPacket(BasisCallRec * BC, int width, RayInfo * r,
+                          const int *except1, int n, int *hit);
+
 void BasisGetTriangleFlatDotgle(CBasis * I, RayInfo * r, int i);
 void BasisGetTriangleFlatDotglePerspective(CBasis * I, RayInfo * r, int i);
 
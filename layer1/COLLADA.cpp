@@ -1028,8 +1028,8 @@ void RayRenderCOLLADA(CRay * I, int width, int height,
           switch (prim->type) {
             /* 3 vertices defined */
             case cPrimTriangle:
-              if (largest_dim < prim->v3[i]) {
-                largest_dim = prim->v3[i];
+              if (largest_dim < prim->ext->v3[i]) {
+                largest_dim = prim->ext->v3[i];
               }
               /* 2 vertices defined */
             case cPrimCone:
@@ -1539,15 +1539,15 @@ void RayRenderCOLLADA(CRay * I, int width, int height,
             sprintf(next, "%6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f ",
                 prim->v1[0], prim->v1[1], prim->v1[2],
                 prim->v2[0], prim->v2[1], prim->v2[2],
-                prim->v3[0], prim->v3[1], prim->v3[2]);
+                prim->ext->v3[0], prim->ext->v3[1], prim->ext->v3[2]);
             UtilConcatVLA(&positions_str, &pos_str_cc, (char *)next);
 
             /*** Normals ***/
             /* prim->n0 is a face normal; prim->n1/2/3 are vertex normals. */
             sprintf(next, "%6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f ",
-                prim->n1[0], prim->n1[1], prim->n1[2],
-                prim->n2[0], prim->n2[1], prim->n2[2],
-                prim->n3[0], prim->n3[1], prim->n3[2]);
+                prim->ext->n1[0], prim->ext->n1[1], prim->ext->n1[2],
+                prim->ext->n2[0], prim->ext->n2[1], prim->ext->n2[2],
+                prim->ext->n3[0], prim->ext->n3[1], prim->ext->n3[2]);
             UtilConcatVLA(&normals_str, &norm_str_cc, (char *)next);
 
             /* Colors */
@@ -1555,7 +1555,7 @@ void RayRenderCOLLADA(CRay * I, int width, int height,
             sprintf(next, "%6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f %6.4f ",
                 prim->c1[0], prim->c1[1], prim->c1[2],    // vertex 1
                 prim->c2[0], prim->c2[1], prim->c2[2],    // vertex 2
-                prim->c3[0], prim->c3[1], prim->c3[2]);   // vertex 3
+                prim->ext->c3[0], prim->ext->c3[1], prim->ext->c3[2]);   // vertex 3
             UtilConcatVLA(&colors_str, &col_str_cc, next);
 
             /* <p> indices */
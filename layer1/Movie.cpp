@@ -27,6 +27,7 @@ Z* -------------------------------------------------------------------
 #include"Movie.h"
 #include"Scene.h"
 #include"MyPNG.h"
+#include"MovieEncoder.h"
 #include"P.h"
 #include"Setting.h"
 #include"main.h"
@@ -656,6 +657,13 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
       SceneSetFrame(G, 0, 0);
     MoviePlay(G, cMoviePlay);
     VecCheck(I->Image, M->nFrame);
+    {
+      /* encode and write frames while the next ones get rendered, with at
+         most two frames per thread in flight */
+      int n_thread = SettingGetGlobal_i(G, cSetting_movie_png_threads);
+      if(n_thread > 0)
+        M->encoder = std::make_shared<CMovieEncoder>(n_thread, 2 * n_thread);
+    }
     M->frame = 0;
     M->stage = 1;
     if(G->Interrupt) {
@@ -736,7 +744,17 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
       PRINTFB(G, FB_Movie, FB_Errors)
         "MoviePNG-Error: Missing rendered image.\n" ENDFB(G);
     } else {
-      if (!MyPNGWrite(M->fname.c_str(), *I->Image[M->image],
+      if(M->encoder) {
+        /* blocks while the queue is full */
+        M->encoder->push({M->fname, I->Image[M->image],
+            SettingGetGlobal_f(G, cSetting_image_dots_per_inch), M->format,
+            SettingGetGlobal_f(G, cSetting_png_screen_gamma),
+            SettingGetGlobal_f(G, cSetting_png_file_gamma)});
+        for(auto& fname : M->encoder->takeFailures()) {
+          PRINTFB(G, FB_Movie, FB_Errors)
+            " MoviePNG-Error: unable to write '%s'\n", fname.c_str() ENDFB(G);
+        }
+      } else if (!MyPNGWrite(M->fname.c_str(), *I->Image[M->image],
               SettingGetGlobal_f(G, cSetting_image_dots_per_inch), M->format,
               M->quiet, SettingGetGlobal_f(G, cSetting_png_screen_gamma),
               SettingGetGlobal_f(G, cSetting_png_file_gamma))) {
@@ -793,6 +811,15 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
   switch (M->stage) {
   case 5:                      /* finish up */
 
+    if(M->encoder) {            /* frames still being written */
+      M->encoder->finish();
+      for(auto& fname : M->encoder->takeFailures()) {
+        PRINTFB(G, FB_Movie, FB_Errors)
+          " MoviePNG-Error: unable to write '%s'\n", fname.c_str() ENDFB(G);
+      }
+      M->encoder = nullptr;
+    }
+
     SceneInvalidate(G);         /* important */
     PRINTFB(G, FB_Movie, FB_Debugging)
       " MoviePNG-DEBUG: done.\n" ENDFB(G);
@@ -24,6 +24,8 @@ Z* -------------------------------------------------------------------
 #include"Scene.h"
 #include"View.h"
 
+class CMovieEncoder;
+
 struct CMovieModal {
   int stage = 0;
 
@@ -50,6 +52,7 @@ struct CMovieModal {
   int format = 0;
   int quiet = 0;
   std::string fname;
+  std::shared_ptr<CMovieEncoder> encoder; /* see movie_png_threads */
 };
 
 struct CMovie : public Block {
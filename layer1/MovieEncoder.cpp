@@ -0,0 +1,92 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include <algorithm>
+
+#include "MovieEncoder.h"
+#include "MyPNG.h"
+
+CMovieEncoder::CMovieEncoder(int n_worker, int capacity)
+    : m_capacity(std::max(capacity, 1))
+{
+  for (int a = 0; a < std::max(n_worker, 1); ++a) {
+    m_workers.emplace_back([this]() { work(); });
+  }
+}
+
+CMovieEncoder::~CMovieEncoder()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void CMovieEncoder::push(CMovieEncoderJob job)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() { return m_in_flight < m_capacity; });
+    m_jobs.push_back(std::move(job));
+    ++m_in_flight;
+  }
+  m_cond.notify_all();
+}
+
+std::vector<std::string> CMovieEncoder::takeFailures()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::string> failures;
+  failures.swap(m_failures);
+  return failures;
+}
+
+void CMovieEncoder::finish()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this]() { return m_in_flight == 0; });
+}
+
+void CMovieEncoder::work()
+{
+  for (;;) {
+    CMovieEncoderJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+      if (m_jobs.empty())
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    int ok = MyPNGWrite(job.fname.c_str(), *job.image, job.dpi, job.format,
+        true, job.screen_gamma, job.file_gamma);
+    job.image = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!ok)
+        m_failures.push_back(job.fname);
+      --m_in_flight;
+    }
+    m_cond.notify_all();
+  }
+}
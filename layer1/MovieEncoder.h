@@ -0,0 +1,72 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_MovieEncoder
+#define _H_MovieEncoder
+
+/* Background image file writers for movie export (movie_png_threads).
+ *
+ * The render loop hands over each finished frame and goes on with the next
+ * one while worker threads encode and write the files. At most "capacity"
+ * frames are queued or being written; push() blocks beyond that, which
+ * caps the memory held by frames in flight. Workers don't touch
+ * PyMOLGlobals, failures are collected and reported by the render loop. */
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Image.h"
+
+struct CMovieEncoderJob {
+  std::string fname;
+  std::shared_ptr<pymol::Image> image;
+  float dpi;
+  int format;
+  float screen_gamma, file_gamma;
+};
+
+class CMovieEncoder
+{
+public:
+  CMovieEncoder(int n_worker, int capacity);
+  ~CMovieEncoder();
+
+  void push(CMovieEncoderJob job);
+
+  /* file names which could not be written since the last call */
+  std::vector<std::string> takeFailures();
+
+  /* waits until all queued frames are written */
+  void finish();
+
+private:
+  void work();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<CMovieEncoderJob> m_jobs;
+  std::vector<std::string> m_failures;
+  std::vector<std::thread> m_workers;
+  int m_capacity;
+  int m_in_flight = 0;          /* queued or being written */
+  bool m_stop = false;
+};
+
+#endif
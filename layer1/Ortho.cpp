@@ -48,6 +48,7 @@ Z* -------------------------------------------------------------------
 #include"PyMOLOptions.h"
 #include"PyMOL.h"
 #include"Movie.h"
+#include"ThreadPool.h"
 #include "ShaderMgr.h"
 #include "Vector.h"
 #include "CGO.h"
@@ -541,6 +542,10 @@ void OrthoBusyMessage(PyMOLGlobals * G, const char *message)
 void OrthoBusySlow(PyMOLGlobals * G, int progress, int total)
 {
   COrtho *I = G->Ortho;
+
+  if(pymol::ThreadPoolIsWorker())
+    return;                     /* only the calling thread reports progress */
+
   double time_yet = (-I->BusyLastUpdate) + UtilGetSeconds(G);
 
   PRINTFD(G, FB_Ortho)
@@ -571,6 +576,10 @@ void OrthoBusySlow(PyMOLGlobals * G, int progress, int total)
 void OrthoBusyFast(PyMOLGlobals * G, int progress, int total)
 {
   COrtho *I = G->Ortho;
+
+  if(pymol::ThreadPoolIsWorker())
+    return;                     /* only the calling thread reports progress */
+
   double time_yet = (-I->BusyLastUpdate) + UtilGetSeconds(G);
   short finished = progress == total;
   PRINTFD(G, FB_Ortho)
@@ -1237,8 +1237,10 @@ ov_status PCacheSet(PyMOLGlobals * G, PyObject * entry, PyObject * output)
     PyList_SetItem(entry, 0, PyInt_FromLong(tot_size)); /* update total size */
     PyList_SetItem(entry, 3, PXIncRef(output));
     PXDecRef(PYOBJECT_CALLMETHOD(G->P_inst->cmd, "_cache_set",
-                                 "OiO", entry, SettingGetGlobal_i(G, cSetting_cache_max),
-                                 G->P_inst->cmd));
+                                 "OiOsi", entry, SettingGetGlobal_i(G, cSetting_cache_max),
+                                 G->P_inst->cmd,
+                                 SettingGetGlobal_s(G, cSetting_cache_dir),
+                                 SettingGetGlobal_i(G, cSetting_cache_disk_max)));
     /* compute the hash codes */
   }
   if(PyErr_Occurred())
@@ -1258,7 +1260,9 @@ ov_status PCacheGet(PyMOLGlobals * G,
 
     if(OV_OK(CacheCreateEntry(&entry, input))) {
       output = PYOBJECT_CALLMETHOD(G->P_inst->cmd, "_cache_get",
-                                   "OOO", entry, Py_None, G->P_inst->cmd);
+                                   "OOOsi", entry, Py_None, G->P_inst->cmd,
+                                   SettingGetGlobal_s(G, cSetting_cache_dir),
+                                   SettingGetGlobal_i(G, cSetting_cache_max));
       if(output == Py_None) {
         Py_DECREF(output);
         output = NULL;
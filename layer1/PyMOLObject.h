@@ -165,8 +165,6 @@ int ObjectMotionModify(pymol::CObject *I,int action, int index, int count,int ta
 void ObjectMotionReinterpolate(pymol::CObject *I);
 int ObjectMotionGetLength(pymol::CObject *I);
 
-typedef struct _CObjectUpdateThreadInfo CObjectUpdateThreadInfo;
-
 #define cObjectTypeAll                    0
 #define cObjectTypeObjects                1
 #define cObjectTypeSelections             2
@@ -44,6 +44,8 @@ Z* -------------------------------------------------------------------
 #define SettingGetfv SettingGetGlobal_3fv
 
 #include"Basis.h"
+#include"ThreadPool.h"
+#include"RayProgress.h"
 
 #ifndef RAY_SMALL
 #define RAY_SMALL 0.00001
@@ -60,6 +62,10 @@ Z* -------------------------------------------------------------------
    number of lights */
 #define MAX_BASIS 12
 
+/* edge length (pixels) of the square tiles which the tracer threads steal
+   from each other */
+#define RAY_TILE_SIZE 32
+
 typedef float float3[3];
 typedef float float4[4];
 
@@ -77,14 +83,23 @@ struct _CRayThreadInfo {
   int phase, n_thread;
   int x_start, x_stop;
   int y_start, y_stop;
+  int n_tile_x;
+  pymol::WorkStealingQueue *tiles;
   unsigned int *edging;
   unsigned int edging_cutoff;
+  int edging_grid;              /* sub-samples per axis, 0: five point pattern */
+  size_t n_edge;                /* pixels oversampled by this thread */
   int perspective;
   float fov, pos[3];
   float *depth;
+  float *normal;                /* surface normal per pixel, for edge detection */
+  CRayProgress *progress;       /* publishes finished tiles, see ray_progressive */
+  int progress_mag;
   
   int bgWidth, bgHeight;
   void *bkrd_data; /* used for image-based background */
+
+  size_t bvh_nodes, bvh_leaves; /* BVH traversal counters (ray_bvh) */
 };
 
 struct _CRayHashThreadInfo {
@@ -100,6 +115,7 @@ struct _CRayHashThreadInfo {
   float front;
   int phase;
   float size_hint;
+  BVHType *refit;               /* retained BVH to refit instead of a new map */
   CRay *ray;
   float *bkrd_top, *bkrd_bottom;
   short bkrd_is_gradient; /* if not gradient, use bkrd_top as bkrd */
@@ -113,6 +129,7 @@ struct _CRayAntiThreadInfo {
   unsigned int width, height;
   int mag;
   int phase, n_thread;
+  pymol::WorkStealingQueue *rows;
   CRay *ray;
 };
 
@@ -138,6 +155,7 @@ float RayGetScreenVertexScale(CRay * I, float *v1)
 
   float vt[3];
   float ratio;
+  I->ViewDependent = true;
   RayApplyMatrix33(1, (float3 *) vt, I->ModelView, (float3 *) v1);
 
   if(I->Ortho) {
@@ -159,6 +177,8 @@ static void RayApplyContextToVertex(CRay * I, float *v)
       float tw;
       float th;
 
+      I->ViewDependent = true;
+
       if(I->AspRatio > 1.0F) {
         tw = I->AspRatio;
         th = 1.0F;
@@ -198,6 +218,7 @@ static void RayApplyContextToNormal(CRay * I, float *v)
 {
   switch (I->context) {
   case pymol::RenderContext::UnitWindow:
+    I->ViewDependent = true;
     RayTransformInverseNormals33(1, (float3 *) v, I->ModelView, (float3 *) v);
     break;
   }
@@ -633,19 +654,19 @@ int RayExpandPrimitives(CRay * I)
       basis->Vert2Normal[nVert] = nNorm;
       basis->Vert2Normal[nVert + 1] = nNorm;
       basis->Vert2Normal[nVert + 2] = nNorm;
-      n1 = I->Primitive[a].n0;
+      n1 = I->Primitive[a].ext->n0;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
-      n1 = I->Primitive[a].n1;
+      n1 = I->Primitive[a].ext->n1;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
-      n1 = I->Primitive[a].n2;
+      n1 = I->Primitive[a].ext->n2;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
-      n1 = I->Primitive[a].n3;
+      n1 = I->Primitive[a].ext->n3;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
@@ -658,7 +679,7 @@ int RayExpandPrimitives(CRay * I)
       (*v0++) = (*v1++);
       (*v0++) = (*v1++);
       (*v0++) = (*v1++);
-      v1 = I->Primitive[a].v3;
+      v1 = I->Primitive[a].ext->v3;
       (*v0++) = (*v1++);
       (*v0++) = (*v1++);
       (*v0++) = (*v1++);
@@ -690,15 +711,15 @@ int RayExpandPrimitives(CRay * I)
       (*v0++) = (*v1++);
       (*v0++) = (*v1++);
       nVert++;
-      n1 = I->Primitive[a].n1;
+      n1 = I->Primitive[a].ext->n1;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
-      n1 = I->Primitive[a].n2;
+      n1 = I->Primitive[a].ext->n2;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
-      n1 = I->Primitive[a].n3;
+      n1 = I->Primitive[a].ext->n3;
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
       (*n0++) = (*n1++);
@@ -734,6 +755,10 @@ int RayExpandPrimitives(CRay * I)
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: minvoxel  %8.3f\n Ray: NPrimit  %d nvert %d\n", basis->MinVoxel, I->NPrimitive,
     nVert ENDFB(I->G);
+  PRINTFB(I->G, FB_Ray, FB_Blather)
+    " Ray: primitive storage %zu bytes (%zu extended)\n",
+    I->NPrimitive * sizeof(CPrimitive) + I->PrimitiveExt.size() * sizeof(CPrimitiveExt),
+    I->PrimitiveExt.size() ENDFB(I->G);
   return ok;
 }
 
@@ -1221,10 +1246,10 @@ int TriangleReverse(CPrimitive * p)
   float s1[3], s2[3], n0[3];
 
   subtract3f(p->v1, p->v2, s1);
-  subtract3f(p->v3, p->v2, s2);
+  subtract3f(p->ext->v3, p->v2, s2);
   cross_product3f(s1, s2, n0);
 
-  if(dot_product3f(p->n0, n0) < 0.0F)
+  if(dot_product3f(p->ext->n0, n0) < 0.0F)
     return 0;
   else
     return 1;
@@ -1368,7 +1393,7 @@ void RayRenderVRML2(CRay * I, int width, int height,
                   "%6.4f %6.4f %6.4f,\n",
                   cprim->c1[0], cprim->c1[1], cprim->c1[2],
                   cprim->c2[0], cprim->c2[1], cprim->c2[2],
-                  cprim->c3[0], cprim->c3[1], cprim->c3[2]);
+                  cprim->ext->c3[0], cprim->ext->c3[1], cprim->ext->c3[2]);
           UtilConcatVLA(&vla, &cc, buffer);
         }
 
@@ -1582,7 +1607,7 @@ void RayRenderVRML2(CRay * I, int width, int height,
                 "%6.4f %6.4f %6.4f,\n",
                 cprim->c1[0], cprim->c1[1], cprim->c1[2],
                 cprim->c2[0], cprim->c2[1], cprim->c2[2],
-                cprim->c3[0], cprim->c3[1], cprim->c3[2]);
+                cprim->ext->c3[0], cprim->ext->c3[1], cprim->ext->c3[2]);
         UtilConcatVLA(&vla, &cc, buffer);
       }
 
@@ -2293,7 +2318,7 @@ void RayRenderIDTF(CRay * I, char **node_vla, char **rsrc_vla)
                 unique_vector_add(mesh->normal_hash, norm,
                                   mesh->model_normal_list, &mesh->normal_count,
                                   mesh->face_normal_list, &face_normal_count);
-                unique_color_add(mesh->normal_hash, prim->c3,
+                unique_color_add(mesh->normal_hash, prim->ext->c3,
                                  mesh->model_diffuse_color_list, &mesh->color_count,
                                  mesh->face_color_list, &face_color_count,
                                  1.0F - prim->trans);
@@ -2330,7 +2355,7 @@ void RayRenderIDTF(CRay * I, char **node_vla, char **rsrc_vla)
                 unique_vector_add(mesh->normal_hash, norm,
                                   mesh->model_normal_list, &mesh->normal_count,
                                   mesh->face_normal_list, &face_normal_count);
-                unique_color_add(mesh->normal_hash, prim->c3,
+                unique_color_add(mesh->normal_hash, prim->ext->c3,
                                  mesh->model_diffuse_color_list, &mesh->color_count,
                                  mesh->face_color_list, &face_color_count,
                                  1.0F - prim->trans);
@@ -2492,7 +2517,7 @@ void RayRenderObjMtl(CRay * I, int width, int height, char **objVLA_ptr,
         /*
            prim->c1[0],prim->c1[1],prim->c1[2])
            prim->c2[0],prim->c2[1],prim->c2[2],
-           prim->c3[0],prim->c3[1],prim->c3[2]
+           prim->ext->c3[0],prim->ext->c3[1],prim->ext->c3[2]
            UtilConcatVLA(&vla,&oc,buffer);
            UtilConcatVLA(&vla,&oc,buffer);
          */
@@ -2779,8 +2804,8 @@ void RayRenderPOV(CRay * I, int width, int height, char **headerVLA_ptr,
                   vert[0], vert[1], vert[2], norm[0], norm[1], norm[2], prim->c1[0],
                   prim->c1[1], prim->c1[2], vert[3], vert[4], vert[5], norm[3], norm[4],
                   norm[5], prim->c2[0], prim->c2[1], prim->c2[2], vert[6], vert[7],
-                  vert[8], norm[6], norm[7], norm[8], prim->c3[0], prim->c3[1],
-                  prim->c3[2]
+                  vert[8], norm[6], norm[7], norm[8], prim->ext->c3[0], prim->ext->c3[1],
+                  prim->ext->c3[2]
             );
           UtilConcatVLA(&charVLA, &cc, buffer);
         } else {
@@ -2812,7 +2837,7 @@ void RayRenderPOV(CRay * I, int width, int height, char **headerVLA_ptr,
           UtilConcatVLA(&charVLA, &cc, buffer);
 
           sprintf(buffer, ",texture { pigment{color rgb<%6.4f1,%6.4f,%6.4f> %s}} }\n",
-                  prim->c3[0], prim->c3[1], prim->c3[2], transmit);
+                  prim->ext->c3[0], prim->ext->c3[1], prim->ext->c3[2], transmit);
           UtilConcatVLA(&charVLA, &cc, buffer);
 
           sprintf(buffer, "face_indices { 1, <0,1,2>, 0, 1, 2 } }\n");
@@ -2874,67 +2899,47 @@ void RayProjectTriangle(CRay * I, RayInfo * r, float *light, float *v0, float *n
   }
 }
 
-#ifndef _PYMOL_NOPY
 static void RayHashSpawn(CRayHashThreadInfo * Thread, int n_thread, int n_total)
 {
-  int blocked;
-  PyObject *info_list;
-  int a, c, n = 0;
   CRay *I = Thread->ray;
-  PyMOLGlobals *G = I->G;
 
-  blocked = PAutoBlock(G);
+  if(n_thread > n_total)
+    n_thread = n_total;
 
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: filling voxels with %d threads...\n", n_thread ENDFB(I->G);
-  while(n < n_total) {
-    c = n;
-    info_list = PyList_New(n_thread);
-    for(a = 0; a < n_thread; a++) {
-      if((c + a) < n_total) {
-        PyList_SetItem(
-            info_list, a, PyCapsule_New(Thread + c + a, nullptr, nullptr));
-      } else {
-        PyList_SetItem(info_list, a, PConvAutoNone(NULL));
-      }
-      n++;
-    }
-    PXDecRef(PYOBJECT_CALLMETHOD
-             (G->P_inst->cmd, "_ray_hash_spawn", "OO", info_list, G->P_inst->cmd));
-    Py_DECREF(info_list);
-  }
-  PAutoUnblock(G, blocked);
+
+  /* one task per basis, idle threads pick up the remaining maps */
+  pymol::ThreadPoolRunTasks(n_thread, n_total, [Thread](int, size_t a) {
+    RayHashThread(Thread + a);
+  });
 }
-#endif
 
-#ifndef _PYMOL_NOPY
 static void RayAntiSpawn(CRayAntiThreadInfo * Thread, int n_thread)
 {
-  int blocked;
-  PyObject *info_list;
-  int a;
   CRay *I = Thread->ray;
-  PyMOLGlobals *G = I->G;
-
-  blocked = PAutoBlock(G);
+  int height = (Thread->height / Thread->mag) - 2;
+  pymol::WorkStealingQueue rows(height > 0 ? height : 0, n_thread);
+  int a;
 
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: antialiasing with %d threads...\n", n_thread ENDFB(I->G);
-  info_list = PyList_New(n_thread);
+
   for(a = 0; a < n_thread; a++) {
-    PyList_SetItem(info_list, a, PyCapsule_New(Thread + a, nullptr, nullptr));
+    Thread[a].rows = &rows;
   }
-  PXDecRef(PYOBJECT_CALLMETHOD
-           (G->P_inst->cmd, "_ray_anti_spawn", "OO", info_list, G->P_inst->cmd));
-  Py_DECREF(info_list);
-  PAutoUnblock(G, blocked);
+  pymol::ThreadPoolRun(n_thread, [Thread](int a) {
+    RayAntiThread(Thread + a);
+  });
 }
-#endif
 
 int RayHashThread(CRayHashThreadInfo * T)
 {
-  BasisMakeMap(T->basis, T->vert2prim, T->prim, T->n_prim, T->clipBox, T->phase,
-               cCache_ray_map, T->perspective, T->front, T->size_hint);
+  if(T->refit)
+    BasisRefitBVH(T->basis, T->vert2prim, T->prim, T->refit);
+  else
+    BasisMakeMap(T->basis, T->vert2prim, T->prim, T->n_prim, T->clipBox, T->phase,
+                 cCache_ray_map, T->perspective, T->front, T->size_hint);
 
   /* utilize a little extra wasted CPU time in thread 0 which computes the smaller map... */
   if(!T->phase) {
@@ -2950,33 +2955,57 @@ int RayHashThread(CRayHashThreadInfo * T)
   return 1;
 }
 
-#ifndef _PYMOL_NOPY
+/*
+ * Splits the traced region into RAY_TILE_SIZE tiles and runs RayTraceThread
+ * on n_thread native threads, which balance the load by stealing tiles.
+ */
 static void RayTraceSpawn(CRayThreadInfo * Thread, int n_thread)
 {
-  int blocked;
-  PyObject *info_list;
-  int a;
   CRay *I = Thread->ray;
-  PyMOLGlobals *G = I->G;
+  int n_tile_x = 0, n_tile_y = 0;
+  int a;
+
+  if(Thread->x_stop > Thread->x_start)
+    n_tile_x = (Thread->x_stop - Thread->x_start + RAY_TILE_SIZE - 1) / RAY_TILE_SIZE;
+  if(Thread->y_stop > Thread->y_start)
+    n_tile_y = (Thread->y_stop - Thread->y_start + RAY_TILE_SIZE - 1) / RAY_TILE_SIZE;
 
-  blocked = PAutoBlock(G);
+  pymol::WorkStealingQueue tiles(n_tile_x * (size_t) n_tile_y, n_thread);
 
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: rendering with %d threads...\n", n_thread ENDFB(I->G);
-  info_list = PyList_New(n_thread);
+
   for(a = 0; a < n_thread; a++) {
-    PyList_SetItem(info_list, a, PyCapsule_New(Thread + a, nullptr, nullptr));
+    Thread[a].n_tile_x = n_tile_x;
+    Thread[a].tiles = &tiles;
   }
-  PXDecRef(PYOBJECT_CALLMETHOD
-           (G->P_inst->cmd, "_ray_spawn", "OO", info_list, G->P_inst->cmd));
-  Py_DECREF(info_list);
-  PAutoUnblock(G, blocked);
+  pymol::ThreadPoolRun(n_thread, [Thread](int a) {
+    RayTraceThread(Thread + a);
+  });
+}
 
+/*
+ * Offset in pixels of sub-sample k of an n x n grid (adaptive antialiasing).
+ * For odd n, the center is skipped because the pixel itself has been traced.
+ */
+static void RayEdgeSampleOffset(int n, int k, float *dx, float *dy)
+{
+  if((n & 1) && k >= (n * n) / 2)
+    k++;
+  *dx = ((k % n) + 0.5F) / n - 0.5F;
+  *dy = ((k / n) + 0.5F) / n - 0.5F;
 }
-#endif
 
-static int find_edge(unsigned int *ptr, float *depth, unsigned int width,
-                     int threshold, int back)
+/* samples per edge pixel, including the pixel center */
+static int RayEdgeSampleCount(int n)
+{
+  if(!n)
+    return 5;
+  return n * n + 1 - (n & 1);
+}
+
+static int find_edge(unsigned int *ptr, float *depth, float *normal,
+                     unsigned int width, int threshold, int back)
 {                               /* can only be called for a pixel NOT on the edge */
   {                             /* color testing */
     int compare0, compare1, compare2, compare3, compare4, compare5, compare6,
@@ -3088,6 +3117,18 @@ static int find_edge(unsigned int *ptr, float *depth, unsigned int width,
        printf("%8.3f \n",compare0-compare8); */
 
   }
+
+  if(normal) {                  /* normal testing, background has a zero normal */
+    const int offset[8] = { -1, 1, -(int) width, (int) width,
+      -(int) width - 1, -(int) width + 1, (int) width - 1, (int) width + 1
+    };
+    float ncutoff = 1.0F - threshold / 1024.0F;
+    int a;
+    for(a = 0; a < 8; a++) {
+      if(dot_product3f(normal, normal + 3 * offset[a]) < ncutoff)
+        return 1;
+    }
+  }
   return 0;
 }
 
@@ -3113,7 +3154,7 @@ static void RayPrimGetColorRamped(PyMOLGlobals * G, float *matrix, RayInfo * r,
       ColorGetRamped(G, (int) (c2[0] - _01), back_pact, fc2, -1);
       c2 = fc2;
     }
-    c3 = lprim->c3;
+    c3 = lprim->ext->c3;
     if(c3[0] <= _0) {
       ColorGetRamped(G, (int) (c3[0] - _01), back_pact, fc3, -1);
       c3 = fc3;
@@ -3163,10 +3204,103 @@ static void RayPrimGetColorRamped(PyMOLGlobals * G, float *matrix, RayInfo * r,
   }
 }
 
+/*
+ * First pass of one scan line of a tile, traced in packets of coherent
+ * orthoscopic rays. The shadow rays of the hits are traced in packets as
+ * well. RayTraceThread only uses these results where its own rays turn out
+ * to be identical, so they never change the image.
+ */
+typedef struct {
+  int width;                    /* rays per packet */
+  RayInfo r1[RAY_TILE_SIZE];
+  int hit[RAY_TILE_SIZE];
+  int interior[RAY_TILE_SIZE];
+  RayInfo r2[MAX_BASIS][RAY_TILE_SIZE];
+  int shadow_hit[MAX_BASIS][RAY_TILE_SIZE];
+  int shadow_valid[MAX_BASIS][RAY_TILE_SIZE];
+} CRayPacketLine;
+
+static void RayPacketTraceLine(CRay * I, CRayPacketLine * P, BasisCallRec * BasisCall,
+                               const float *base_x, float base_y, int n, float front,
+                               int shadows, float shadow_fudge, int label_shadow_mode)
+{
+  const int width = P->width;
+  int k, k0, voxel, bc;
+
+  BasisCall[0].except1 = -1;
+  BasisCall[0].except2 = -1;
+  BasisCall[0].front = front;
+  BasisCall[0].excl_trans = 0.0F;
+  BasisCall[0].interior_flag = false;
+  BasisCall[0].pass = 0;
+
+  for(k = 0; k < n; k++) {
+    P->r1[k].base[0] = base_x[k];
+    P->r1[k].base[1] = base_y;
+    P->r1[k].base[2] = 0.0F;
+  }
+
+  for(k0 = 0; k0 < n; k0 = k) {
+    voxel = BasisGetVoxel(I->Basis + 1, P->r1[k0].base);
+    for(k = k0 + 1; (k < n) && (k - k0 < width); k++) {
+      if(BasisGetVoxel(I->Basis + 1, P->r1[k].base) != voxel)
+        break;
+    }
+    BasisHitOrthoscopicPacket(BasisCall, width, P->r1 + k0, k - k0,
+                              P->hit + k0, P->interior + k0);
+  }
+
+  if(!shadows)
+    return;
+
+  for(bc = 2; bc < I->NBasis; bc++) {
+    CBasis *bp = I->Basis + bc;
+    RayInfo r2[RAY_TILE_SIZE];
+    int except1[RAY_TILE_SIZE], lane[RAY_TILE_SIZE], hit[RAY_TILE_SIZE];
+    int m = 0;
+
+    for(k = 0; k < n; k++) {
+      const RayInfo *r1 = P->r1 + k;
+      float impact[3];
+
+      P->shadow_valid[bc][k] = false;
+      if((P->hit[k] < 0) || P->interior[k] || r1->prim->no_lighting ||
+         ((r1->prim->type == cPrimCharacter) && !(label_shadow_mode & 0x1)))
+        continue;
+
+      /* point of impact as computed by RayGetSphereNormal() et al. */
+      impact[0] = r1->base[0];
+      impact[1] = r1->base[1];
+      impact[2] = r1->base[2] - r1->dist;
+      matrix_transform33f3f(bp->Matrix, impact, r2[m].base);
+      r2[m].base[2] -= shadow_fudge;
+      except1[m] = P->hit[k];
+      lane[m++] = k;
+    }
+
+    BasisCall[bc].except2 = -1;
+    for(k0 = 0; k0 < m; k0 = k) {
+      voxel = BasisGetVoxel(bp, r2[k0].base);
+      for(k = k0 + 1; (k < m) && (k - k0 < width); k++) {
+        if(BasisGetVoxel(bp, r2[k].base) != voxel)
+          break;
+      }
+      BasisHitShadowPacket(BasisCall + bc, width, r2 + k0, except1 + k0, k - k0,
+                           hit + k0);
+    }
+
+    for(k = 0; k < m; k++) {
+      P->r2[bc][lane[k]] = r2[k];
+      P->shadow_hit[bc][lane[k]] = hit[k];
+      P->shadow_valid[bc][lane[k]] = true;
+    }
+  }
+}
+
 int RayTraceThread(CRayThreadInfo * T)
 {
   CRay *I = T->ray;
-  int x, y, yy;
+  int x, y;
   float excess = 0.0F;
   float dotgle;
   float bright, direct_cmp, reflect_cmp, fc[4];
@@ -3214,9 +3348,10 @@ int RayTraceThread(CRayThreadInfo * T)
   float invWdthRange, vol0;
   float vol2;
   CBasis *bp1, *bp2;
-  int render_height;
-  int offset = 0;
+  int tile_x_start = 0, tile_x_stop = 0, tile_y_start = 0, tile_y_stop = 0;
   BasisCallRec BasisCall[MAX_BASIS];
+  std::unique_ptr<CRayPacketLine> packet;
+  std::unique_ptr<RayInstanceThread> inst_thread;
   float border_offset;
   int edge_sampling = false;
   unsigned int edge_avg[4] = { 0, 0, 0, 0 };
@@ -3226,6 +3361,7 @@ int RayTraceThread(CRayThreadInfo * T)
   float interior_normal[3] = {0.0F, 0.0F, 0.0F};
   float edge_width = 0.35356F;
   float edge_height = 0.35356F;
+  const int edge_total = RayEdgeSampleCount(T->edging_grid);
   float trans_spec_cut, trans_spec_scale, trans_oblique, oblique_power;
   float direct_shade;
   float red_blend = 0.0F;
@@ -3451,12 +3587,6 @@ int RayTraceThread(CRayThreadInfo * T)
   else
     bp2 = NULL;
 
-  render_height = T->y_stop - T->y_start;
-
-  if(render_height) {
-    offset = (T->phase * render_height / T->n_thread);
-    offset = offset - (offset % T->n_thread) + T->phase;
-  }
   if((interior_color != -1) || I->CheckInterior) {
 
     if(interior_color != -1)
@@ -3489,7 +3619,7 @@ int RayTraceThread(CRayThreadInfo * T)
   BasisCall[0].fudge0 = BasisFudge0;
   BasisCall[0].fudge1 = BasisFudge1;
 
-  MapCacheInit(&BasisCall[0].cache, I->Basis[1].Map, T->phase, cCache_map_scene_cache);
+  BasisCacheInit(I->Basis + 1, &BasisCall[0].cache, T->phase, cCache_map_scene_cache);
 
   if(shadows && (n_basis > 2)) {
     int bc;
@@ -3508,8 +3638,8 @@ int RayTraceThread(CRayThreadInfo * T)
       BasisCall[bc].fudge0 = BasisFudge0;
       BasisCall[bc].fudge1 = BasisFudge1;
       BasisCall[bc].label_shadow_mode = label_shadow_mode;
-      MapCacheInit(&BasisCall[bc].cache, I->Basis[bc].Map, T->phase,
-                   cCache_map_shadow_cache);
+      BasisCacheInit(I->Basis + bc, &BasisCall[bc].cache, T->phase,
+                     cCache_map_shadow_cache);
     }
   }
 
@@ -3528,7 +3658,23 @@ int RayTraceThread(CRayThreadInfo * T)
 	back_mask = 0xFF000000;
     }
   }
-  for(yy = T->y_start; (yy < T->y_stop); yy++) {
+
+  if(!I->Instances.empty()) {
+    inst_thread.reset(new RayInstanceThread);
+    RayInstanceThreadInit(I, inst_thread.get(), T->phase, BasisCall);
+  }
+
+  /* packets need the voxel map and rays along -Z, and the edge pass only
+     traces a few scattered pixels; copies aren't traced in packets */
+  if(!perspective && !T->edging && !I->Basis[1].BVH && !inst_thread) {
+    int width = BasisPacketWidth(I->G);
+    if(width > 1) {
+      packet.reset(new CRayPacketLine);
+      packet->width = width;
+    }
+  }
+
+  for(y = 0;; y++) {
     float perc, bkrd[4] = {0.f, 0.f, 0.f, 1.f};
     unsigned int bkrd_value = 0;
     short isOutsideInY = 0;
@@ -3536,7 +3682,37 @@ int RayTraceThread(CRayThreadInfo * T)
     if(I->G->Interrupt)
       break;
 
-    y = T->y_start + ((yy - T->y_start) + offset) % (render_height);    /* make sure threads write to different pages */
+    if(y >= tile_y_stop) {      /* done with this tile, steal the next one */
+      size_t tile;
+      int tile_x, tile_y;
+      if(T->progress && (tile_y_stop > tile_y_start)) {
+        T->progress->publishTile(T->image, T->width, T->progress_mag,
+                                 tile_x_start, tile_x_stop, tile_y_start, tile_y_stop,
+                                 T->edging ? cRayProgressEdge : cRayProgressTrace);
+      }
+      if(!T->tiles->pop(T->phase, tile))
+        break;
+      tile_x = (int) (tile % T->n_tile_x);
+      tile_y = (int) (tile / T->n_tile_x);
+      tile_x_start = T->x_start + tile_x * RAY_TILE_SIZE;
+      tile_x_stop = std::min(tile_x_start + RAY_TILE_SIZE, T->x_stop);
+      y = T->y_start + tile_y * RAY_TILE_SIZE;
+      tile_y_start = y;
+      tile_y_stop = std::min(y + RAY_TILE_SIZE, T->y_stop);
+
+      if(!T->phase) {           /* only the calling thread may report progress */
+        int progress = (int) ((T->height * T->tiles->done()) / T->tiles->size());
+        if(T->edging_cutoff) {
+          if(T->edging) {
+            OrthoBusyFast(I->G, (int) (2.5F * T->height / 3 + 0.5F * progress), 4 * T->height / 3);
+          } else {
+            OrthoBusyFast(I->G, (int) (T->height / 3 + 0.5F * progress), 4 * T->height / 3);
+          }
+        } else {
+          OrthoBusyFast(I->G, T->height / 3 + progress, 4 * T->height / 3);
+        }
+      }
+    }
     if (T->bkrd_data){
       switch (bg_image_mode){
       case 1: // isCentered
@@ -3585,23 +3761,22 @@ int RayTraceThread(CRayThreadInfo * T)
 	bkrd[3] = 0.f;
       }
     }
-    if((!T->phase) && !(yy & 0xF)) {    /* don't slow down rendering too much */
-      if(T->edging_cutoff) {
-        if(T->edging) {
-          OrthoBusyFast(I->G, (int) (2.5F * T->height / 3 + 0.5F * y), 4 * T->height / 3);
-        } else {
-          OrthoBusyFast(I->G, (int) (T->height / 3 + 0.5F * y), 4 * T->height / 3);
-        }
-      } else {
-        OrthoBusyFast(I->G, T->height / 3 + y, 4 * T->height / 3);
-      }
-    }
-    pixel = T->image + (T->width * y) + T->x_start;
+    pixel = T->image + (T->width * y) + tile_x_start;
 
-    if((y % T->n_thread) == T->phase) { /* this is my scan line */
+    {                           /* scan line of the current tile */
       pixel_base[1] = ((y + 0.5F + border_offset) * invHgtRange) + vol2;
 
-      for(x = T->x_start; (x < T->x_stop); x++) {
+      if(packet) {
+        float base_x[RAY_TILE_SIZE];
+        for(x = tile_x_start; (x < tile_x_stop); x++) {
+          base_x[x - tile_x_start] = (((x + 0.5F + border_offset)) * invWdthRange) + vol0;
+        }
+        RayPacketTraceLine(I, packet.get(), BasisCall, base_x, pixel_base[1],
+                           tile_x_stop - tile_x_start, T->front,
+                           shadows && (n_basis > 2), shadow_fudge, label_shadow_mode);
+      }
+
+      for(x = tile_x_start; (x < tile_x_stop); x++) {
 	if (T->bkrd_data){
 	  // Need to compute background for every pixel if image-based
 	  unsigned char bkrd_uc[4];
@@ -3634,11 +3809,13 @@ int RayTraceThread(CRayThreadInfo * T)
               if(x && y && (x < (T->width - 1)) && (y < (T->height - 1))) {     /* not on the edge... */
                 if(find_edge(T->edging + (pixel - T->image),
                              depth + (pixel - T->image),
+                             T->normal ? T->normal + 3 * (pixel - T->image) : NULL,
                              T->width, T->edging_cutoff, bkrd_value)) {
                   unsigned char *pixel_c = (unsigned char *) pixel;
                   unsigned int c1, c2, c3, c4;
                   edge_cnt = 1;
                   edge_sampling = true;
+                  T->n_edge++;
 
                   edge_avg[0] = (c1 = pixel_c[0]);
                   edge_avg[1] = (c2 = pixel_c[1]);
@@ -3656,7 +3833,7 @@ int RayTraceThread(CRayThreadInfo * T)
               }
             }
             if(edge_sampling) {
-              if(edge_cnt == 5) {
+              if(edge_cnt == edge_total) {
                 /* done with edging, so store averaged value */
 
                 unsigned char *pixel_c = (unsigned char *) pixel;
@@ -3699,7 +3876,12 @@ int RayTraceThread(CRayThreadInfo * T)
               } else {
                 *pixel = 0;
 		//                *pixel = bkrd_value;
-                switch (edge_cnt) {
+                if(T->edging_grid) {
+                  float dx, dy;
+                  RayEdgeSampleOffset(T->edging_grid, edge_cnt - 1, &dx, &dy);
+                  r1.base[0] = edge_base[0] + dx * invWdthRange;
+                  r1.base[1] = edge_base[1] + dy * invHgtRange;
+                } else switch (edge_cnt) {
                 case 1:
                   r1.base[0] = edge_base[0] + edge_width;
                   r1.base[1] = edge_base[1] + edge_height;
@@ -3772,9 +3954,24 @@ int RayTraceThread(CRayThreadInfo * T)
               }
               BasisCall[0].back_dist = -(T->back + r1.base[2]) / r1.dir[2];
               i = BasisHitPerspective(&BasisCall[0]);
+            } else if(packet && !pass &&
+                      (r1.base[0] == packet->r1[x - tile_x_start].base[0]) &&
+                      (r1.base[1] == packet->r1[x - tile_x_start].base[1])) {
+              const RayInfo *pr = packet->r1 + (x - tile_x_start);
+              i = packet->hit[x - tile_x_start];
+              BasisCall[0].interior_flag = packet->interior[x - tile_x_start];
+              if((i >= 0) || BasisCall[0].interior_flag) {
+                r1.tri1 = pr->tri1;
+                r1.tri2 = pr->tri2;
+                r1.prim = pr->prim;
+                r1.dist = pr->dist;
+                copy3f(pr->sphere, r1.sphere);
+              }
             } else {
               i = BasisHitOrthoscopic(&BasisCall[0]);
             }
+            if(inst_thread)
+              i = RayInstanceHit(I, inst_thread.get(), &BasisCall[0], i, perspective);
             interior_flag = BasisCall[0].interior_flag && (!pass);
 
             if(((i >= 0) || interior_flag) && (pass < max_pass)) {
@@ -3844,7 +4041,7 @@ int RayTraceThread(CRayThreadInfo * T)
                 case cPrimCharacter:
                   BasisGetTriangleNormal(bp1, &r1, i, fc, perspective);
 
-                  r1.trans = CharacterInterpolate(I->G, r1.prim->char_id, fc);
+                  r1.trans = CharacterInterpolate(I->G, r1.prim->ext->char_id, fc);
 		  fogFlagTmp = false;
                   RayReflectAndTexture(I, &r1, perspective);
                   BasisGetTriangleFlatDotgle(bp1, &r1, i);
@@ -4007,7 +4204,23 @@ int RayTraceThread(CRayThreadInfo * T)
                     r2.base[2] -= shadow_fudge;
                     BasisCall[bc].except2 = -1;
                     BasisCall[bc].except1 = i;  /* exclude current prim from shadow comp */
-                    if(BasisHitShadow(&BasisCall[bc]) > -1) {
+                    int shadow_hit;
+                    const int k = x - tile_x_start;
+                    if(packet && packet->shadow_valid[bc][k] && (packet->hit[k] == i) &&
+                       (r2.base[0] == packet->r2[bc][k].base[0]) &&
+                       (r2.base[1] == packet->r2[bc][k].base[1]) &&
+                       (r2.base[2] == packet->r2[bc][k].base[2])) {
+                      /* same ray as traced with the packet */
+                      shadow_hit = packet->shadow_hit[bc][k];
+                      r2.dist = packet->r2[bc][k].dist;
+                      r2.trans = packet->r2[bc][k].trans;
+                    } else {
+                      shadow_hit = BasisHitShadow(&BasisCall[bc]);
+                    }
+                    if(inst_thread)
+                      shadow_hit = RayInstanceHitShadow(I, inst_thread.get(),
+                                                        &BasisCall[bc], bc, shadow_hit);
+                    if(shadow_hit > -1) {
                       if((!clip_shadows) || (bp->LightNormal[2] >= _0) ||
                          ((T->front + r1.impact[2] - (r2.dist * bp->LightNormal[2])) <
                           _0)) {
@@ -4361,6 +4574,8 @@ int RayTraceThread(CRayThreadInfo * T)
             if(depth && (i >= 0) &&
                (r1.trans < trans_cutoff) && (persist > persist_cutoff)) {
               depth[pixel - T->image] = (T->front + r1.impact[2]);
+              if(T->normal && !T->edging)
+                copy3f(r1.surfnormal, T->normal + 3 * (pixel - T->image));
             }
 
             if(i >= 0) {
@@ -4505,11 +4720,21 @@ int RayTraceThread(CRayThreadInfo * T)
   /*  if(T->n_thread>1) 
      printf(" Ray: Thread %d: Complete.\n",T->phase+1); */
   MapCacheFree(&BasisCall[0].cache, T->phase, cCache_map_scene_cache);
+  T->bvh_nodes += BasisCall[0].bvh_stats.NNode;
+  T->bvh_leaves += BasisCall[0].bvh_stats.NLeaf;
+
+  if(inst_thread) {
+    RayInstanceThreadFree(inst_thread.get(), T->phase);
+    T->bvh_nodes += inst_thread->Call.bvh_stats.NNode;
+    T->bvh_leaves += inst_thread->Call.bvh_stats.NLeaf;
+  }
 
   if(shadows && (I->NBasis > 2)) {
     int bc;
     for(bc = 2; bc < I->NBasis; bc++) {
       MapCacheFree(&BasisCall[bc].cache, T->phase, cCache_map_shadow_cache);
+      T->bvh_nodes += BasisCall[bc].bvh_stats.NNode;
+      T->bvh_leaves += BasisCall[bc].bvh_stats.NLeaf;
     }
   }
   return (n_hit);
@@ -4624,25 +4849,24 @@ int RayAntiThread(CRayAntiThreadInfo * T)
   unsigned int *pDst;
   /*   unsigned int m00FF=0x00FF,mFF00=0xFF00,mFFFF=0xFFFF; */
   int width;
-  int height;
-  int x, y, yy;
+  int x, y;
+  size_t row;
   unsigned int *p;
-  int offset = 0;
   CRay *I = T->ray;
 
-  OrthoBusyFast(I->G, 9, 10);
+  if(!T->phase)                 /* only the calling thread may report progress */
+    OrthoBusyFast(I->G, 9, 10);
   width = (T->width / T->mag) - 2;
-  height = (T->height / T->mag) - 2;
 
   src_row_pixels = T->width;
 
-  offset = (T->phase * height) / T->n_thread;
-  offset = offset - (offset % T->n_thread) + T->phase;
+  while(T->rows->pop(T->phase, row)) {
+    y = (int) row;
 
-  for(yy = 0; yy < height; yy++) {
-    y = (yy + offset) % height; /* make sure threads write to different pages */
+    if(I->G->Interrupt)
+      break;
 
-    if((y % T->n_thread) == T->phase) { /* this is my scan line */
+    {                           /* this is my scan line */
       unsigned long c1, c2, c3, c4, a;
       unsigned char *c;
 
@@ -5523,6 +5747,74 @@ float *rayDepthPixels = NULL;
 int rayVolume = 0, rayWidth = 0, rayHeight = 0;
 
 /*========================================================================*/
+/*
+ * Coarse trace of the whole view at 1/factor of the output size, for
+ * progressive rendering. Uses copies of the thread setup of the full trace.
+ */
+static void RayTracePreview(CRay * I, const CRayThreadInfo * rt, int n_thread,
+                            int factor, int width, int height)
+{
+  int pw = std::max(width / factor, 1);
+  int ph = std::max(height / factor, 1);
+  std::vector<unsigned int> preview(pw * (size_t) ph, rt->background);
+  std::vector<CRayThreadInfo> prt(rt, rt + n_thread);
+
+  for(auto &t : prt) {
+    t.width = pw;
+    t.height = ph;
+    t.image = preview.data();
+    t.border = 0;
+    t.x_start = 0;
+    t.x_stop = pw;
+    t.y_start = 0;
+    t.y_stop = ph;
+    t.edging = NULL;
+    t.depth = NULL;
+    t.normal = NULL;
+    t.progress = NULL;
+  }
+
+  RayTraceSpawn(prt.data(), n_thread);
+
+  if(!I->G->Interrupt)
+    I->Progress->publishPreview(preview.data(), pw, ph);
+}
+
+/*
+ * Drops the view-dependent bases of a previous render of the same
+ * primitives. With "retain", their BVHs are kept for refitting.
+ */
+static void RayResetBases(CRay * I, int retain)
+{
+  int bc;
+
+  I->RetainedBVH.resize(MAX_BASIS);
+  for(bc = 1; bc < I->NBasis; bc++) {
+    if(retain && I->Basis[bc].BVH) {
+      I->RetainedBVH[bc].reset(I->Basis[bc].BVH);
+      I->Basis[bc].BVH = NULL;
+    }
+    if(bc > 1) {
+      BasisFinish(I->Basis + bc, bc);
+    } else {
+      if(I->Basis[bc].Map) {
+        MapFree(I->Basis[bc].Map);
+        I->Basis[bc].Map = NULL;
+      }
+      delete I->Basis[bc].BVH;
+      I->Basis[bc].BVH = NULL;
+    }
+  }
+  I->NBasis = 2;
+}
+
+static BVHType *RayTakeRetainedBVH(CRay * I, int bc)
+{
+  if(bc < (int) I->RetainedBVH.size())
+    return I->RetainedBVH[bc].release();
+  return NULL;
+}
+
 void RayRender(CRay * I, unsigned int *image, double timing,
                float angle, int antialias, unsigned int *return_bg)
 {
@@ -5536,11 +5828,13 @@ void RayRender(CRay * I, unsigned int *image, double timing,
   const float *bkrd_ptr;
   float bkrd_top[3], bkrd_bottom[3];
   short bkrd_is_gradient; /* if not gradient, use bkrd_top as bkrd */
-  double now;
+  double now, phase_start = 0.0;
   int shadows;
   int n_thread;
   int mag = 1;
   int oversample_cutoff;
+  int edge_grid = 0;
+  float *normal = NULL;
   int perspective = SettingGetGlobal_i(I->G, cSetting_ray_orthoscopic);
   int n_light = SettingGetGlobal_i(I->G, cSetting_light_count);
   float ambient;
@@ -5608,6 +5902,15 @@ void RayRender(CRay * I, unsigned int *image, double timing,
   if((!antialias) || ray_trace_mode)
     oversample_cutoff = 0;
 
+  if((antialias > 1) && oversample_cutoff &&
+     SettingGetGlobal_b(I->G, cSetting_ray_antialias_adaptive)) {
+    /* trace at 1x and supersample edge pixels only, on an antialias^2 grid */
+    edge_grid = antialias;
+    antialias = 1;
+  }
+
+  I->Timing = RayTiming();
+
   mag = antialias;
   if(mag < 1)
     mag = 1;
@@ -5627,6 +5930,9 @@ void RayRender(CRay * I, unsigned int *image, double timing,
   } else if(oversample_cutoff) {
     depth = pymol::calloc<float>(width * height);
   }
+  if(edge_grid) {
+    normal = pymol::calloc<float>(3 * width * height);
+  }
   ambient = SettingGetGlobal_f(I->G, cSetting_ambient);
 
   bkrd_is_gradient = SettingGetGlobal_b(I->G, cSetting_bg_gradient);
@@ -5773,23 +6079,33 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       fill(image, background, width * (unsigned int) height);
     }
   } else {
+    float prim_size = 0.0F;
+    int refit = I->RetainGeometry && SettingGetGlobal_b(I->G, cSetting_ray_bvh);
 
     if(I->PrimSizeCnt) {
       float factor = SettingGetGlobal_f(I->G, cSetting_ray_hint_camera);
-      I->PrimSize = I->PrimSize / (I->PrimSizeCnt * factor);
-      /*      printf("avg dist %8.7f\n",I->PrimSize); */
-    } else {
-      I->PrimSize = 0.0F;
+      prim_size = I->PrimSize / (I->PrimSizeCnt * factor);
+      /*      printf("avg dist %8.7f\n",prim_size); */
     }
+    I->Timing.NPrimitive = I->NPrimitive;
+    I->Timing.NThread = n_thread;
+    phase_start = UtilGetSeconds(I->G);
+
+    if(I->Rendered)
+      RayResetBases(I, refit);
     ok &= !I->G->Interrupt;
-    if (ok)
+    if (ok && I->NExpanded != I->NPrimitive) {
       ok &= RayExpandPrimitives(I);
+      I->NExpanded = I->NPrimitive;
+    }
     if (ok)
       ok &= RayTransformFirst(I, perspective, false);
 
     OrthoBusyFast(I->G, 3, 20);
 
     now = UtilGetSeconds(I->G) - timing;
+    I->Timing.Expand = UtilGetSeconds(I->G) - phase_start;
+    phase_start = UtilGetSeconds(I->G);
 
     PRINTFB(I->G, FB_Ray, FB_Blather)
       " Ray: processed %i graphics primitives in %4.2f sec.\n", I->NPrimitive, now
@@ -5872,7 +6188,6 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     }
 
     OrthoBusyFast(I->G, 4, 20);
-#ifndef _PYMOL_NOPY
     if(shadows && (n_thread > 1)) {     /* parallel execution */
 
       CRayHashThreadInfo *thread_info = pymol::calloc<CRayHashThreadInfo>(I->NBasis);
@@ -5884,7 +6199,8 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       thread_info[0].vert2prim = vert2prim_ptr;
       thread_info[0].prim = I->Primitive;
       thread_info[0].n_prim = I->NPrimitive;
-      thread_info[0].clipBox = I->Volume;
+      thread_info[0].clipBox = refit ? NULL : I->Volume;
+      thread_info[0].refit = RayTakeRetainedBVH(I, 1);
       thread_info[0].phase = 0;
       thread_info[0].perspective = perspective;
       thread_info[0].front = front;
@@ -5905,7 +6221,7 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       }
       thread_info[0].bytes = width * (unsigned int) height;
       thread_info[0].ray = I;   /* for compute box */
-      thread_info[0].size_hint = I->PrimSize;
+      thread_info[0].size_hint = prim_size;
       /* shadow map */
 
       {
@@ -5918,11 +6234,12 @@ void RayRender(CRay * I, unsigned int *image, double timing,
           thread_info[bc - 1].prim = I->Primitive;
           thread_info[bc - 1].n_prim = I->NPrimitive;
           thread_info[bc - 1].clipBox = NULL;
+          thread_info[bc - 1].refit = RayTakeRetainedBVH(I, bc);
           thread_info[bc - 1].phase = bc - 1;
           thread_info[bc - 1].perspective = false;
           thread_info[bc - 1].front = _0;
           /* allowing these maps to be more fine helps performance */
-          thread_info[bc - 1].size_hint = I->PrimSize * factor;
+          thread_info[bc - 1].size_hint = prim_size * factor;
         }
       }
 
@@ -5932,20 +6249,24 @@ void RayRender(CRay * I, unsigned int *image, double timing,
 
       FreeP(thread_info);
     } else
-#endif
     if (ok){ 
-#ifdef _PYMOL_NOPY
-      n_thread = 1;          /* serial execution */
-#endif
       int* vert2prim_ptr = I->Vert2Prim.empty() ? nullptr : I->Vert2Prim.data();
-      ok &= BasisMakeMap(I->Basis + 1, vert2prim_ptr, I->Primitive, I->NPrimitive,
-			 I->Volume, 0, cCache_ray_map, perspective, front, I->PrimSize);
+      BVHType *bvh = RayTakeRetainedBVH(I, 1);
+      if(bvh)
+        ok &= BasisRefitBVH(I->Basis + 1, vert2prim_ptr, I->Primitive, bvh);
+      else
+        ok &= BasisMakeMap(I->Basis + 1, vert2prim_ptr, I->Primitive, I->NPrimitive,
+                           refit ? NULL : I->Volume, 0, cCache_ray_map, perspective,
+                           front, prim_size);
       if(ok && shadows) {
         int bc;
         float factor = SettingGetGlobal_f(I->G, cSetting_ray_hint_shadow);
         for(bc = 2; ok && bc < I->NBasis; bc++) {
-          ok &= BasisMakeMap(I->Basis + bc, vert2prim_ptr, I->Primitive, I->NPrimitive,
-			     NULL, bc - 1, cCache_ray_map, false, _0, I->PrimSize * factor);
+          if((bvh = RayTakeRetainedBVH(I, bc)))
+            ok &= BasisRefitBVH(I->Basis + bc, vert2prim_ptr, I->Primitive, bvh);
+          else
+            ok &= BasisMakeMap(I->Basis + bc, vert2prim_ptr, I->Primitive, I->NPrimitive,
+                               NULL, bc - 1, cCache_ray_map, false, _0, prim_size * factor);
         }
       }
 
@@ -5968,7 +6289,11 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     now = UtilGetSeconds(I->G) - timing;
 
     if (ok){
-      if(shadows) {
+      if(I->Basis[1].BVH) {
+	PRINTFB(I->G, FB_Ray, FB_Blather)
+	  " Ray: BVH: %d nodes, %4.2f sec.\n",
+	  (int) I->Basis[1].BVH->Nodes.size(), now ENDFB(I->G);
+      } else if(shadows) {
 	PRINTFB(I->G, FB_Ray, FB_Blather)
 	  " Ray: voxels: [%4.2f:%dx%dx%d], [%4.2f:%dx%dx%d], %4.2f sec.\n",
 	  I->Basis[1].Map->Div, I->Basis[1].Map->Dim[0],
@@ -5982,6 +6307,13 @@ void RayRender(CRay * I, unsigned int *image, double timing,
 	  I->Basis[1].Map->Dim[1], I->Basis[1].Map->Dim[2], now ENDFB(I->G);
       }
     }
+
+    if(ok && !I->Instances.empty())
+      ok &= RayInstancesPrepare(I, shadows, n_thread);
+
+    I->Timing.Map = UtilGetSeconds(I->G) - phase_start;
+    phase_start = UtilGetSeconds(I->G);
+
     /* IMAGING */
 
     if (ok){
@@ -6099,6 +6431,8 @@ void RayRender(CRay * I, unsigned int *image, double timing,
         rt[a].n_thread = n_thread;
         rt[a].edging = NULL;
         rt[a].edging_cutoff = oversample_cutoff;        /* info needed for busy indicator */
+        rt[a].edging_grid = edge_grid;
+        rt[a].normal = normal;
         rt[a].perspective = perspective;
         rt[a].fov = fov;
         rt[a].pos[2] = pos[2];
@@ -6108,16 +6442,31 @@ void RayRender(CRay * I, unsigned int *image, double timing,
           rt[a].bgHeight = I->bkgrd_data->getHeight();
         }
         rt[a].bkrd_data = I->bkgrd_data ? I->bkgrd_data->bits() : nullptr;
+        rt[a].progress = I->Progress;
+        rt[a].progress_mag = mag;
       }
 
-#ifndef _PYMOL_NOPY
-      if(n_thread > 1)
+      if(I->Progress) {
+        I->Progress->begin((mag > 1) ? width / mag - 2 : width,
+                           (mag > 1) ? height / mag - 2 : height);
+        int preview = SettingGetGlobal_i(I->G, cSetting_ray_progressive);
+        if(preview > 1) {
+          RayTracePreview(I, rt, n_thread, preview,
+                          (mag > 1) ? width / mag - 2 : width,
+                          (mag > 1) ? height / mag - 2 : height);
+        } else {              /* just the background */
+          I->Progress->publishTile(image, width, mag, 0, width, 0, height,
+                                   cRayProgressPreview);
+        }
+      }
+
+      if(!I->G->Interrupt)
         RayTraceSpawn(rt, n_thread);
-      else
-#endif
-        RayTraceThread(rt);
 
-      if(oversample_cutoff) {   /* perform edge oversampling, if requested */
+      I->Timing.Trace = UtilGetSeconds(I->G) - phase_start;
+      phase_start = UtilGetSeconds(I->G);
+
+      if(oversample_cutoff && !I->G->Interrupt) {   /* perform edge oversampling, if requested */
         unsigned int *edging;
 
         edging = CacheAlloc(I->G, unsigned int, buffer_size, 0, cCache_ray_edging_buffer);
@@ -6128,14 +6477,31 @@ void RayRender(CRay * I, unsigned int *image, double timing,
           rt[a].edging = edging;
         }
 
-#ifndef _PYMOL_NOPY
-        if(n_thread > 1)
-          RayTraceSpawn(rt, n_thread);
-        else
-#endif
-          RayTraceThread(rt);
+        RayTraceSpawn(rt, n_thread);
 
         CacheFreeP(I->G, edging, 0, cCache_ray_edging_buffer, false);
+
+        if(edge_grid) {
+          size_t n_edge = 0;
+          for(a = 0; a < n_thread; a++)
+            n_edge += rt[a].n_edge;
+          PRINTFB(I->G, FB_Ray, FB_Blather)
+            " Ray: adaptive antialiasing: %.0f of %d pixels with %d samples.\n",
+            (double) n_edge, (int) (width * height), RayEdgeSampleCount(edge_grid)
+            ENDFB(I->G);
+        }
+      }
+      I->Timing.Edge = UtilGetSeconds(I->G) - phase_start;
+
+      if(I->Basis[1].BVH) {
+        size_t bvh_nodes = 0, bvh_leaves = 0;
+        for(a = 0; a < n_thread; a++) {
+          bvh_nodes += rt[a].bvh_nodes;
+          bvh_leaves += rt[a].bvh_leaves;
+        }
+        PRINTFB(I->G, FB_Ray, FB_Blather)
+          " Ray: BVH traversal: %.0f nodes, %.0f leaves visited.\n",
+          (double) bvh_nodes, (double) bvh_leaves ENDFB(I->G);
       }
       FreeP(rt);
     }
@@ -6507,6 +6873,8 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     /* now spawn threads as needed */
     CRayAntiThreadInfo *rt = pymol::calloc<CRayAntiThreadInfo>(n_thread);
 
+    phase_start = UtilGetSeconds(I->G);
+
     for(a = 0; a < n_thread; a++) {
       rt[a].width = width;
       rt[a].height = height;
@@ -6518,15 +6886,11 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       rt[a].ray = I;
     }
 
-#ifndef _PYMOL_NOPY
-    if(n_thread > 1)
-      RayAntiSpawn(rt, n_thread);
-    else
-#endif
-      RayAntiThread(rt);
+    RayAntiSpawn(rt, n_thread);
     FreeP(rt);
     CacheFreeP(I->G, image, 0, cCache_ray_antialias_buffer, false);
     image = image_copy;
+    I->Timing.Antialias = UtilGetSeconds(I->G) - phase_start;
   }
 
   PRINTFD(I->G, FB_Ray)
@@ -6561,7 +6925,9 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     } else 
       FreeP(depth);
   }
+  FreeP(normal);
   I->bkgrd_data = nullptr;
+  I->Rendered = true;
 }
 
 
@@ -6647,6 +7013,16 @@ void CRay::color3fv(const float *v)
 }
 
 
+/*========================================================================*/
+static CPrimitiveExt *RayNewPrimitiveExt(CRay * I)
+{
+  /* std::deque never moves its elements, so CPrimitive::ext stays valid
+   * while the primitive VLA grows */
+  I->PrimitiveExt.emplace_back();
+  return &I->PrimitiveExt.back();
+}
+
+
 /*========================================================================*/
 int CRay::sphere3fv(const float *v, float r)
 {
@@ -6662,6 +7038,7 @@ int CRay::sphere3fv(const float *v, float r)
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimSphere;
+  p->ext = NULL;
   p->r1 = r;
   p->trans = I->Trans;
   p->wobble = I->Wobble;
@@ -6748,8 +7125,9 @@ int CRay::character(int char_id)
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimCharacter;
+  p->ext = RayNewPrimitiveExt(I);
   p->trans = I->Trans;
-  p->char_id = char_id;
+  p->ext->char_id = char_id;
   p->wobble = I->Wobble;
   p->ramped = 0;
   p->no_lighting = 0;
@@ -6809,34 +7187,36 @@ int CRay::character(int char_id)
     scale = v_scale * height;
     scale3f(yn, scale, yn);
 
-    copy3f(zn, p->n0);
-    copy3f(zn, p->n1);
-    copy3f(zn, p->n2);
-    copy3f(zn, p->n3);
+    copy3f(zn, p->ext->n0);
+    copy3f(zn, p->ext->n1);
+    copy3f(zn, p->ext->n2);
+    copy3f(zn, p->ext->n3);
 
     *(pp) = (*p);
+    pp->ext = RayNewPrimitiveExt(I);
+    *(pp->ext) = *(p->ext);
 
     /* define coordinates of first triangle */
 
     add3f(p->v1, xn, p->v2);
-    add3f(p->v1, yn, p->v3);
+    add3f(p->v1, yn, p->ext->v3);
 
     I->PrimSize +=
-      2 * (diff3f(p->v1, p->v2) + diff3f(p->v1, p->v3) + diff3f(p->v2, p->v3));
+      2 * (diff3f(p->v1, p->v2) + diff3f(p->v1, p->ext->v3) + diff3f(p->v2, p->ext->v3));
     I->PrimSizeCnt += 6;
 
     /* encode characters coordinates in the colors  */
 
     zero3f(p->c1);
     set3f(p->c2, width, 0.0F, 0.0F);
-    set3f(p->c3, 0.0F, height, 0.0F);
+    set3f(p->ext->c3, 0.0F, height, 0.0F);
 
     /* define coordinates of second triangle */
 
     add3f(yn, xn, pp->v1);
     add3f(p->v1, pp->v1, pp->v1);
     add3f(p->v1, yn, pp->v2);
-    add3f(p->v1, xn, pp->v3);
+    add3f(p->v1, xn, pp->ext->v3);
 
     {
       float *v, *vv;
@@ -6856,7 +7236,7 @@ int CRay::character(int char_id)
 
     set3f(pp->c1, width, height, 0.0F);
     set3f(pp->c2, 0.0F, height, 0.0F);
-    set3f(pp->c3, width, 0.0F, 0.0F);
+    set3f(pp->ext->c3, width, 0.0F, 0.0F);
 
   }
 
@@ -6888,6 +7268,7 @@ int CRay::cylinder3fv(const float *v1, const float *v2, float r, const float *c1
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimCylinder;
+  p->ext = NULL;
   p->r1 = r;
   p->cap1 = cCylCapFlat;
   p->cap2 = cCylCapFlat;
@@ -6984,6 +7365,7 @@ int CRay::customCylinder3fv(const float *v1, const float *v2, float r,
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimCylinder;
+  p->ext = NULL;
   p->r1 = r;
   p->cap1 = cap1;
   p->cap2 = cap2;
@@ -7063,6 +7445,7 @@ int CRay::cone3fv(const float *v1, const float *v2, float r1, float r2,
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimCone;
+  p->ext = NULL;
   p->r1 = r1;
   p->r2 = r2;
   p->trans = I->Trans;
@@ -7138,6 +7521,7 @@ int CRay::sausage3fv(const float *v1, const float *v2, float r, const float *c1,
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimSausage;
+  p->ext = NULL;
   p->r1 = r;
   p->trans = I->Trans;
   p->wobble = I->Wobble;
@@ -7203,6 +7587,7 @@ int CRay::ellipsoid3fv(const float *v, float r, const float *n1, const float *n2
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimEllipsoid;
+  p->ext = RayNewPrimitiveExt(I);
   p->r1 = r;                    /* maximum extent */
   p->trans = I->Trans;
   p->wobble = I->Wobble;
@@ -7212,7 +7597,7 @@ int CRay::ellipsoid3fv(const float *v, float r, const float *n1, const float *n2
   I->PrimSize += 2 * r;
   I->PrimSizeCnt++;
 
-  vv = p->n0;                   /* storing lengths of the direction vectors in n0 */
+  vv = p->ext->n0;                   /* storing lengths of the direction vectors in n0 */
 
   (*vv++) = length3f(n1);
   (*vv++) = length3f(n2);
@@ -7220,10 +7605,10 @@ int CRay::ellipsoid3fv(const float *v, float r, const float *n1, const float *n2
 
   /* normalize the ellipsoid axes */
 
-  vv = p->n1;
-  if(p->n0[0] > R_SMALL8) {
+  vv = p->ext->n1;
+  if(p->ext->n0[0] > R_SMALL8) {
     float factor;
-    factor = 1.0F / p->n0[0];
+    factor = 1.0F / p->ext->n0[0];
     (*vv++) = (*n1++) * factor;
     (*vv++) = (*n1++) * factor;
     (*vv++) = (*n1++) * factor;
@@ -7233,10 +7618,10 @@ int CRay::ellipsoid3fv(const float *v, float r, const float *n1, const float *n2
     (*vv++) = 0.0F;
   }
 
-  vv = p->n2;
-  if(p->n0[1] > R_SMALL8) {
+  vv = p->ext->n2;
+  if(p->ext->n0[1] > R_SMALL8) {
     float factor;
-    factor = 1.0F / p->n0[1];
+    factor = 1.0F / p->ext->n0[1];
     (*vv++) = (*n2++) * factor;
     (*vv++) = (*n2++) * factor;
     (*vv++) = (*n2++) * factor;
@@ -7246,10 +7631,10 @@ int CRay::ellipsoid3fv(const float *v, float r, const float *n1, const float *n2
     (*vv++) = 0.0F;
   }
 
-  vv = p->n3;
-  if(p->n0[2] > R_SMALL8) {
+  vv = p->ext->n3;
+  if(p->ext->n0[2] > R_SMALL8) {
     float factor;
-    factor = 1.0F / p->n0[2];
+    factor = 1.0F / p->ext->n0[2];
     (*vv++) = (*n3++) * factor;
     (*vv++) = (*n3++) * factor;
     (*vv++) = (*n3++) * factor;
@@ -7279,15 +7664,15 @@ int CRay::ellipsoid3fv(const float *v, float r, const float *n1, const float *n2
   if(I->TTTFlag) {
     p->r1 *= length3f(glm::value_ptr(I->TTT));
     transformTTT44f3f(glm::value_ptr(I->TTT), p->v1, p->v1);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n1, p->n1);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n2, p->n2);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n3, p->n3);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n1, p->ext->n1);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n2, p->ext->n2);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n3, p->ext->n3);
   }
 
   RayApplyContextToVertex(I, p->v1);
-  RayApplyContextToNormal(I, p->n1);
-  RayApplyContextToNormal(I, p->n2);
-  RayApplyContextToNormal(I, p->n3);
+  RayApplyContextToNormal(I, p->ext->n1);
+  RayApplyContextToNormal(I, p->ext->n2);
+  RayApplyContextToNormal(I, p->ext->n3);
 
   I->NPrimitive++;
   return true;
@@ -7334,10 +7719,11 @@ int CRay::triangle3fv(
   p = I->Primitive + I->NPrimitive;
 
   p->type = cPrimTriangle;
+  p->ext = RayNewPrimitiveExt(I);
   p->trans = I->Trans;
-  p->tr[0] = I->Trans;
-  p->tr[1] = I->Trans;
-  p->tr[2] = I->Trans;
+  p->ext->tr[0] = I->Trans;
+  p->ext->tr[1] = I->Trans;
+  p->ext->tr[2] = I->Trans;
   p->wobble = I->Wobble;
   p->ramped = ((c1[0] < 0.0F) || (c2[0] < 0.0F) || (c3[0] < 0.0F));
   p->no_lighting = 0;
@@ -7362,7 +7748,7 @@ int CRay::triangle3fv(
   }
   normalize3f(n0);
 
-  vv = p->n0;
+  vv = p->ext->n0;
   (*vv++) = n0[0];
   (*vv++) = n0[1];
   (*vv++) = n0[2];
@@ -7396,12 +7782,12 @@ int CRay::triangle3fv(
   (*vv++) = (*v2++);
   (*vv++) = (*v2++);
   (*vv++) = (*v2++);
-  vv = p->v3;
+  vv = p->ext->v3;
   (*vv++) = (*v3++);
   (*vv++) = (*v3++);
   (*vv++) = (*v3++);
 
-  I->PrimSize += diff3f(p->v1, p->v2) + diff3f(p->v1, p->v3) + diff3f(p->v2, p->v3);
+  I->PrimSize += diff3f(p->v1, p->v2) + diff3f(p->v1, p->ext->v3) + diff3f(p->v2, p->ext->v3);
   I->PrimSizeCnt += 3;
 
   vv = p->c1;
@@ -7412,7 +7798,7 @@ int CRay::triangle3fv(
   (*vv++) = (*c2++);
   (*vv++) = (*c2++);
   (*vv++) = (*c2++);
-  vv = p->c3;
+  vv = p->ext->c3;
   (*vv++) = (*c3++);
   (*vv++) = (*c3++);
   (*vv++) = (*c3++);
@@ -7426,28 +7812,28 @@ int CRay::triangle3fv(
   }
 
   if (normals_exist){
-    vv = p->n1;
+    vv = p->ext->n1;
     (*vv++) = (*n1++);
     (*vv++) = (*n1++);
     (*vv++) = (*n1++);
-    vv = p->n2;
+    vv = p->ext->n2;
     (*vv++) = (*n2++);
     (*vv++) = (*n2++);
     (*vv++) = (*n2++);
-    vv = p->n3;
+    vv = p->ext->n3;
     (*vv++) = (*n3++);
     (*vv++) = (*n3++);
     (*vv++) = (*n3++);
   } else {
-    vv = p->n1;
+    vv = p->ext->n1;
     (*vv++) = n0[0];
     (*vv++) = n0[1];
     (*vv++) = n0[2];
-    vv = p->n2;
+    vv = p->ext->n2;
     (*vv++) = n0[0];
     (*vv++) = n0[1];
     (*vv++) = n0[2];
-    vv = p->n3;
+    vv = p->ext->n3;
     (*vv++) = n0[0];
     (*vv++) = n0[1];
     (*vv++) = n0[2];
@@ -7456,20 +7842,20 @@ int CRay::triangle3fv(
   if(I->TTTFlag) {
     transformTTT44f3f(glm::value_ptr(I->TTT), p->v1, p->v1);
     transformTTT44f3f(glm::value_ptr(I->TTT), p->v2, p->v2);
-    transformTTT44f3f(glm::value_ptr(I->TTT), p->v3, p->v3);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n0, p->n0);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n1, p->n1);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n2, p->n2);
-    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->n3, p->n3);
+    transformTTT44f3f(glm::value_ptr(I->TTT), p->ext->v3, p->ext->v3);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n0, p->ext->n0);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n1, p->ext->n1);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n2, p->ext->n2);
+    transform_normalTTT44f3f(glm::value_ptr(I->TTT), p->ext->n3, p->ext->n3);
   }
 
   RayApplyContextToVertex(I, p->v1);
   RayApplyContextToVertex(I, p->v2);
-  RayApplyContextToVertex(I, p->v3);
-  RayApplyContextToNormal(I, p->n0);
-  RayApplyContextToNormal(I, p->n1);
-  RayApplyContextToNormal(I, p->n2);
-  RayApplyContextToNormal(I, p->n3);
+  RayApplyContextToVertex(I, p->ext->v3);
+  RayApplyContextToNormal(I, p->ext->n0);
+  RayApplyContextToNormal(I, p->ext->n1);
+  RayApplyContextToNormal(I, p->ext->n2);
+  RayApplyContextToNormal(I, p->ext->n3);
 
   I->NPrimitive++;
   return true;
@@ -7488,9 +7874,9 @@ int CRay::triangleTrans3fv(
     return false;
   p = I->Primitive + I->NPrimitive - 1;
 
-  p->tr[0] = t1;
-  p->tr[1] = t2;
-  p->tr[2] = t3;
+  p->ext->tr[0] = t1;
+  p->ext->tr[1] = t2;
+  p->ext->tr[2] = t3;
   p->trans = (t1 + t2 + t3) / 3.0F;
   return true;
 }
@@ -7611,8 +7997,10 @@ void RayPrepare(CRay * I, float v0, float v1, float v2,
   I->PixelRatio = pixel_ratio;
   I->Magnified = magnified;
   I->FrontBackRatio = front_back_ratio;
-  I->PrimSizeCnt = 0;
-  I->PrimSize = 0.0;
+  if(!I->NPrimitive) {          /* keep the sizes of retained geometry */
+    I->PrimSizeCnt = 0;
+    I->PrimSize = 0.0;
+  }
   I->Fov = fov;
   I->Pos = pos;
 
@@ -7656,6 +8044,11 @@ void RayRelease(CRay * I)
   }
   I->NBasis = 0;
   VLACacheFreeP(I->G, I->Primitive, 0, cCache_ray_primitive, false);
+  I->PrimitiveExt.clear();
+  I->Instances.clear();
+  I->RetainedBVH.clear();
+  I->NExpanded = 0;
+  I->Rendered = false;
 }
 
 
@@ -7755,6 +8148,7 @@ static void RayTransformInverseNormals33(unsigned int n, float3 * q, const float
   }
 }
 void RayGetScreenVertex(CRay * I, float *v, float *res){
+  I->ViewDependent = true;
   MatrixTransformC44f4f(I->ModelView, v, res);
   normalize4f(res);
 }
@@ -7767,6 +8161,7 @@ void RayAdjustZtoScreenZ(CRay * ray, float *pos, float zarg){
   float zInPreProj = -(z * clipRange + FrontSafe);
   float pos4[4], tpos[4], npos[4];
   float InvModMatrix[16];
+  ray->ViewDependent = true;
   copy3f(pos, pos4);
   pos4[3] = 1.f;
   MatrixTransformC44f4f(ray->ModelView, pos4, tpos);
@@ -7842,5 +8237,6 @@ float RayGetScaledAllAxesAtPoint(CRay * I, float *pt, float *xn, float *yn, floa
   return v_scale;
 }
 float* RayGetProMatrix(CRay * I){
+  I->ViewDependent = true;
   return I->ProMatrix;
 }
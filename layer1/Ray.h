@@ -17,6 +17,7 @@ Z* -------------------------------------------------------------------
 #ifndef _H_Ray
 #define _H_Ray
 
+#include <deque>
 #include <memory>
 #include <vector>
 #include <glm/glm.hpp>
@@ -27,9 +28,23 @@ Z* -------------------------------------------------------------------
 #include"PyMOLGlobals.h"
 #include"Image.h"
 #include"RenderContext.h"
+#include"RayInstance.h"
 
 #define cRayMaxBasis 10
 
+/* wall clock seconds per phase of the last render (see cmd.get_ray_timing) */
+struct RayTiming {
+  double Geometry;              /* reps -> primitives, set by SceneRay */
+  double Expand;                /* primitive expansion and transformation */
+  double Map;                   /* voxel maps or BVHs, incl. light sources */
+  double Trace;                 /* primary and shadow rays */
+  double Edge;                  /* edge oversampling */
+  double Antialias;             /* folding of the oversampled image */
+  double Total;                 /* all of SceneRay */
+  int NPrimitive;
+  int NThread;
+};
+
 typedef struct _CRayAntiThreadInfo CRayAntiThreadInfo;
 typedef struct _CRayHashThreadInfo CRayHashThreadInfo;
 typedef struct _CRayThreadInfo CRayThreadInfo;
@@ -135,11 +150,15 @@ struct _CRay {
   void interiorColor3fv(const float *v, int passive);
   int ellipsoid3fv(const float *v, float r, const float *n1, const float *n2, const float *n3);
   int setLastToNoLighting(char no_lighting);
+  int instanceBegin();
+  int instanceEnd();
+  int instance(int proto, const float *matrix);
 
   /* everything below should be private */
   PyMOLGlobals *G;
   CPrimitive *Primitive;
   int NPrimitive;
+  std::deque<CPrimitiveExt> PrimitiveExt; /* pointed to by CPrimitive::ext */
   CBasis *Basis;
   int NBasis;
   std::vector<int> Vert2Prim;
@@ -174,6 +193,18 @@ struct _CRay {
   float Fov;
   glm::vec3 Pos;
   std::shared_ptr<pymol::Image> bkgrd_data;
+  RayInstanceSet Instances;     /* see ray_instancing */
+
+  /* geometry reuse across renders with a different camera orientation,
+   * see ray_reuse_geometry */
+  int ViewDependent;            /* reps have asked for the view */
+  int RetainGeometry;           /* build BVHs which survive a rotation */
+  int NExpanded;                /* primitives already in Basis[0] */
+  int Rendered;
+  std::vector<std::unique_ptr<BVHType>> RetainedBVH; /* by basis */
+
+  CRayProgress *Progress = nullptr; /* see ray_progressive */
+  RayTiming Timing {};
 
 private:
   int cylinder3fv(const float *v1, const float *v2, float r, const float *c1, const float *c2,
@@ -0,0 +1,595 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "RayInstance.h"
+#include "Ray.h"
+#include "Err.h"
+#include "Feedback.h"
+#include "MemoryDebug.h"
+#include "MemoryCache.h"
+#include "Util.h"
+#include "Vector.h"
+
+static const float kR_SMALL4 = 0.0001F;
+
+/* copies need a rotation matrix which is orthonormal within this tolerance */
+static const float kOrthoTolerance = 0.001F;
+
+/*
+ * Row-major 3x4 affine transforms (rotation | translation)
+ */
+static void AffineApply(const float *m, const float *p, float *q)
+{
+  const float p0 = p[0], p1 = p[1], p2 = p[2];
+  q[0] = m[0] * p0 + m[1] * p1 + m[2] * p2 + m[3];
+  q[1] = m[4] * p0 + m[5] * p1 + m[6] * p2 + m[7];
+  q[2] = m[8] * p0 + m[9] * p1 + m[10] * p2 + m[11];
+}
+
+static void AffineRotate(const float *m, const float *p, float *q)
+{
+  const float p0 = p[0], p1 = p[1], p2 = p[2];
+  q[0] = m[0] * p0 + m[1] * p1 + m[2] * p2;
+  q[1] = m[4] * p0 + m[5] * p1 + m[6] * p2;
+  q[2] = m[8] * p0 + m[9] * p1 + m[10] * p2;
+}
+
+/* inverse of a rigid transform: transposed rotation */
+static void AffineInvertRigid(const float *m, float *inv)
+{
+  for(int r = 0; r < 3; r++) {
+    for(int c = 0; c < 3; c++)
+      inv[r * 4 + c] = m[c * 4 + r];
+    inv[r * 4 + 3] = -(m[r] * m[3] + m[4 + r] * m[7] + m[8 + r] * m[11]);
+  }
+}
+
+/* product a * b, b may be a row-major 4x4 with the last row ignored */
+static void AffineMultiply(const float *a, const float *b, float *ab)
+{
+  for(int r = 0; r < 3; r++) {
+    for(int c = 0; c < 4; c++) {
+      ab[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c];
+    }
+    ab[r * 4 + 3] += a[r * 4 + 3];
+  }
+}
+
+static bool IsRigid44f(const float *m)
+{
+  for(int r = 0; r < 3; r++) {
+    for(int c = 0; c < 3; c++) {
+      float dot = m[r * 4] * m[c * 4] + m[r * 4 + 1] * m[c * 4 + 1] +
+        m[r * 4 + 2] * m[c * 4 + 2];
+      if(fabsf(dot - (r == c ? 1.0F : 0.0F)) > kOrthoTolerance)
+        return false;
+    }
+  }
+  return m[12] == 0.0F && m[13] == 0.0F && m[14] == 0.0F && m[15] == 1.0F;
+}
+
+
+/*========================================================================*/
+/**
+ * Start recording a prototype: the primitives which get added until
+ * instanceEnd() can be copied with instance().
+ * @return prototype id or -1 if instancing isn't available
+ */
+int CRay::instanceBegin()
+{
+  CRay *I = this;
+  RayInstanceSet &S = I->Instances;
+
+  if(!S.Enabled || (S.Open >= 0) || (I->context != pymol::RenderContext::Camera))
+    return -1;
+
+  S.Open = S.Proto.size();
+  S.Proto.emplace_back();
+  S.Proto.back().prim_start = I->NPrimitive;
+  return S.Open;
+}
+
+/**
+ * Finish the prototype started with instanceBegin(). Labels face the
+ * camera, so primitive ranges with labels can't be instanced.
+ * @return false if the prototype can't be used
+ */
+int CRay::instanceEnd()
+{
+  CRay *I = this;
+  RayInstanceSet &S = I->Instances;
+  int a;
+
+  if(S.Open < 0)
+    return false;
+
+  RayInstanceProto &proto = S.Proto[S.Open];
+  proto.prim_stop = I->NPrimitive;
+  S.Open = -1;
+
+  for(a = proto.prim_start; a < proto.prim_stop; a++) {
+    if(I->Primitive[a].type == cPrimCharacter)
+      break;
+  }
+
+  if((a < proto.prim_stop) || (I->context != pymol::RenderContext::Camera)) {
+    S.Proto.pop_back();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Trace the primitives of a prototype a second time, transformed by a rigid
+ * body matrix (row-major, in the coordinates which the primitives were
+ * passed in, so the current TTT applies).
+ * @return false if the matrix isn't a rigid body transformation
+ */
+int CRay::instance(int proto, const float *matrix)
+{
+  CRay *I = this;
+  RayInstanceSet &S = I->Instances;
+  RayInstance inst;
+
+  if((proto < 0) || (proto >= (int) S.Proto.size()) || (proto == S.Open))
+    return false;
+
+  if(!IsRigid44f(matrix))
+    return false;
+
+  copy44f(matrix, inst.Matrix);
+
+  if(I->TTTFlag) {
+    /* the prototype has been transformed by the TTT, so: TTT * M * TTT^-1 */
+    float ttt[16], ttt_inv[16];
+    convertTTTfR44f(glm::value_ptr(I->TTT), ttt);
+    invert_special44f44f(ttt, ttt_inv);
+    right_multiply44f44f(inst.Matrix, ttt_inv);
+    left_multiply44f44f(ttt, inst.Matrix);
+  }
+
+  inst.proto = proto;
+  S.Inst.push_back(inst);
+  return true;
+}
+
+
+/*========================================================================*/
+/**
+ * Build the prototype BVHs (in Basis[0]) and a BVH over the copies in the
+ * camera basis and in each light basis. Also reserves two hit slots per
+ * thread in Basis[1], where instance hits get transformed to for shading.
+ *
+ * Must be called after the bases and maps have been set up.
+ */
+int RayInstancesPrepare(CRay * I, int shadows, int n_thread)
+{
+  RayInstanceSet &S = I->Instances;
+  CBasis *basis0 = I->Basis;
+  CBasis *basis1 = I->Basis + 1;
+  double timing = UtilGetSeconds(I->G);
+  int a, b, f;
+  int ok = true;
+
+  if(S.empty())
+    return ok;
+
+  /* prototypes: vertex ranges, triangle precomputation for arbitrary ray
+     directions, and BVHs (world coordinates, so only once per geometry) */
+  if(!S.ProtoReady) {
+    VLACacheSize(I->G, basis0->Precomp, float, 3 * basis0->NNormal, 0,
+                 cCache_basis_precomp);
+    CHECKOK(ok, basis0->Precomp);
+  }
+
+  for(auto &proto : S.Proto) {
+    if(!ok || S.ProtoReady)
+      break;
+
+    proto.vert_start = (proto.prim_start < I->NPrimitive) ?
+      I->Primitive[proto.prim_start].vert : basis0->NVertex;
+    proto.vert_stop = (proto.prim_stop < I->NPrimitive) ?
+      I->Primitive[proto.prim_stop].vert : basis0->NVertex;
+
+    for(a = proto.prim_start; a < proto.prim_stop; a++) {
+      CPrimitive *prm = I->Primitive + a;
+      if(prm->type == cPrimTriangle) {
+        float *v = basis0->Vertex + prm->vert * 3;
+        BasisTrianglePrecomputePerspective(v, v + 3, v + 6,
+                                           basis0->Precomp +
+                                           basis0->Vert2Normal[prm->vert] * 3);
+      }
+    }
+
+    BasisMakeRangeBVH(basis0, I->Vert2Prim.data(), I->Primitive,
+                      proto.vert_start, proto.vert_stop, &proto.BVH,
+                      proto.box_min, proto.box_max);
+
+    proto.Basis = *basis0;
+    proto.Basis.Map = NULL;
+    proto.Basis.BVH = &proto.BVH;
+  }
+
+  S.ProtoReady = ok;
+
+  /* copies: basis -> prototype transforms and top-level BVHs */
+  S.Frame.clear();
+  S.Frame.resize((shadows && (I->NBasis > 2)) ? I->NBasis : 2);
+
+  for(f = 1; ok && f < (int) S.Frame.size(); f++) {
+    RayInstanceFrame &frame = S.Frame[f];
+    std::vector<float> bounds;
+    std::vector<int> ids;
+    float world_to_basis[12];
+
+    /* the camera basis is the column-major model view, the light bases
+       are rotations of it */
+    for(b = 0; b < 3; b++) {
+      for(a = 0; a < 3; a++)
+        world_to_basis[b * 4 + a] = I->ModelView[a * 4 + b];
+      world_to_basis[b * 4 + 3] = I->ModelView[12 + b];
+    }
+    if(f > 1) {
+      const Matrix33f &m = I->Basis[f].Matrix;
+      float light[12] = {
+        m[0][0], m[0][1], m[0][2], 0.0F,
+        m[1][0], m[1][1], m[1][2], 0.0F,
+        m[2][0], m[2][1], m[2][2], 0.0F
+      };
+      float tmp[12];
+      AffineMultiply(light, world_to_basis, tmp);
+      std::copy(tmp, tmp + 12, world_to_basis);
+    }
+
+    frame.ToLocal.resize(12 * S.Inst.size());
+
+    for(size_t k = 0; k < S.Inst.size(); k++) {
+      const RayInstance &inst = S.Inst[k];
+      const RayInstanceProto &proto = S.Proto[inst.proto];
+      float to_basis[12], lo[3], hi[3];
+
+      AffineMultiply(world_to_basis, inst.Matrix, to_basis);
+      AffineInvertRigid(to_basis, frame.ToLocal.data() + 12 * k);
+
+      if(proto.box_min[0] > proto.box_max[0])
+        continue;               /* nothing to trace */
+
+      for(b = 0; b < 3; b++) {
+        lo[b] = FLT_MAX;
+        hi[b] = -FLT_MAX;
+      }
+      for(a = 0; a < 8; a++) {
+        float corner[3] = {
+          (a & 1) ? proto.box_max[0] : proto.box_min[0],
+          (a & 2) ? proto.box_max[1] : proto.box_min[1],
+          (a & 4) ? proto.box_max[2] : proto.box_min[2]
+        }, v[3];
+        AffineApply(to_basis, corner, v);
+        for(b = 0; b < 3; b++) {
+          lo[b] = std::min(lo[b], v[b]);
+          hi[b] = std::max(hi[b], v[b]);
+        }
+      }
+
+      if(f == 1) {
+        /* the traced pixel range must cover the copies too */
+        for(b = 0; b < 3; b++) {
+          I->min_box[b] = std::min(I->min_box[b], lo[b]);
+          I->max_box[b] = std::max(I->max_box[b], hi[b]);
+        }
+      }
+
+      bounds.insert(bounds.end(), lo, lo + 3);
+      bounds.insert(bounds.end(), hi, hi + 3);
+      ids.push_back(k);
+    }
+
+    frame.BVH.build(ids.size(), bounds.data(), ids.data(), 2);
+    ok &= !I->G->Interrupt;
+  }
+
+  /* hit slots */
+  if(ok) {
+    int n_vert = basis1->NVertex + 2 * 3 * n_thread;
+    int n_norm = basis1->NNormal + 2 * 4 * n_thread;
+
+    S.ScratchVert = basis1->NVertex;
+    S.ScratchNorm = basis1->NNormal;
+
+    VLACacheSize(I->G, basis1->Vertex, float, 3 * n_vert, 1, cCache_basis_vertex);
+    CHECKOK(ok, basis1->Vertex);
+    if(ok)
+      VLACacheSize(I->G, basis1->Normal, float, 3 * n_norm, 1, cCache_basis_normal);
+    CHECKOK(ok, basis1->Normal);
+    if(ok)
+      VLACacheSize(I->G, basis1->Vert2Normal, int, n_vert, 1, cCache_basis_vert2normal);
+    CHECKOK(ok, basis1->Vert2Normal);
+    if(ok)
+      VLACacheSize(I->G, basis1->Radius, float, n_vert, 1, cCache_basis_radius);
+    CHECKOK(ok, basis1->Radius);
+    if(ok)
+      VLACacheSize(I->G, basis1->Radius2, float, n_vert, 1, cCache_basis_radius2);
+    CHECKOK(ok, basis1->Radius2);
+    if(ok)
+      I->Vert2Prim.resize(n_vert, -1);
+  }
+
+  PRINTFB(I->G, FB_Ray, FB_Blather)
+    " Ray: %d instances of %d prototypes, %4.3f sec.\n",
+    (int) S.Inst.size(), (int) S.Proto.size(), UtilGetSeconds(I->G) - timing
+    ENDFB(I->G);
+
+  return ok;
+}
+
+
+/*========================================================================*/
+void RayInstanceThreadInit(CRay * I, RayInstanceThread * T, int phase,
+                           const BasisCallRec * BC)
+{
+  const RayInstanceSet &S = I->Instances;
+
+  T->Call = *BC;
+  T->Call.Basis = NULL;
+  T->Call.rr = &T->Ray;
+  T->Call.vert2prim = I->Vert2Prim.data();
+  T->Call.prim = I->Primitive;
+  T->Call.check_interior = false;
+  T->Call.pass = 1;
+  T->Call.bvh_stats = BVHStats();
+  MapCacheInitSize(&T->Call.cache, I->G, I->Basis[0].NVertex, phase,
+                   cCache_map_instance_cache);
+
+  T->Slot = 0;
+  T->Vert = S.ScratchVert + 2 * 3 * phase;
+  T->Norm = S.ScratchNorm + 2 * 4 * phase;
+  T->KeyInst[0] = T->KeyInst[1] = -1;
+  T->KeyVert[0] = T->KeyVert[1] = -1;
+}
+
+void RayInstanceThreadFree(RayInstanceThread * T, int phase)
+{
+  MapCacheFree(&T->Call.cache, phase, cCache_map_instance_cache);
+}
+
+/*
+ * The prototype vertex behind a Basis[1] vertex, or -1 if it isn't one of
+ * this thread's hit slots.
+ */
+static int RayInstanceKey(const RayInstanceThread * T, int v, int *inst)
+{
+  if((v >= T->Vert) && (v < T->Vert + 2 * 3)) {
+    int slot = (v - T->Vert) / 3;
+    *inst = T->KeyInst[slot];
+    return T->KeyVert[slot];
+  }
+  *inst = -1;
+  return -1;
+}
+
+/*
+ * Copy the hit primitive of copy `k` into the next hit slot, in the camera
+ * basis, so that the regular shading code can use it.
+ */
+static int RayInstanceMaterialize(CRay * I, RayInstanceThread * T, int k, int v,
+                                  const RayInfo * hit, RayInfo * r, float offset)
+{
+  CBasis *basis0 = I->Basis, *basis1 = I->Basis + 1;
+  CPrimitive *prm = I->Primitive + I->Vert2Prim[v];
+  int slot = T->Slot;
+  int s = T->Vert + slot * 3, n = T->Norm + slot * 4;
+  int n_vert = 1, n_norm = 0;
+  float m[12];
+  int a;
+
+  AffineInvertRigid(I->Instances.Frame[1].ToLocal.data() + 12 * k, m);
+
+  switch (prm->type) {
+  case cPrimTriangle:
+    n_vert = 3;
+    n_norm = 4;
+    break;
+  case cPrimEllipsoid:
+    n_norm = 3;
+    break;
+  case cPrimCone:
+  case cPrimCylinder:
+  case cPrimSausage:
+    n_norm = 1;
+    break;
+  }
+
+  for(a = 0; a < n_vert; a++) {
+    AffineApply(m, basis0->Vertex + (v + a) * 3, basis1->Vertex + (s + a) * 3);
+    basis1->Radius[s + a] = basis0->Radius[v + a];
+    basis1->Radius2[s + a] = basis0->Radius2[v + a];
+    basis1->Vert2Normal[s + a] = n;
+  }
+  for(a = 0; a < n_norm; a++) {
+    AffineRotate(m, basis0->Normal + (basis0->Vert2Normal[v] + a) * 3,
+                 basis1->Normal + (n + a) * 3);
+  }
+
+  T->Prim[slot] = *prm;
+  T->Prim[slot].vert = s;
+  T->Prim[slot].cull = false;
+  T->KeyInst[slot] = k;
+  T->KeyVert[slot] = v;
+  T->Slot = !slot;
+
+  r->tri1 = hit->tri1;
+  r->tri2 = hit->tri2;
+  r->dist = hit->dist + offset;
+  r->prim = T->Prim + slot;
+  AffineApply(m, hit->sphere, r->sphere);
+
+  return s;
+}
+
+/**
+ * Trace the copies after the primary ray BC->rr has been traced against the
+ * regular primitives.
+ * @param i result of BasisHitPerspective/BasisHitOrthoscopic
+ * @return `i` or the Basis[1] vertex of a nearer hit
+ */
+int RayInstanceHit(CRay * I, RayInstanceThread * T, BasisCallRec * BC, int i,
+                   int perspective)
+{
+  const RayInstanceSet &S = I->Instances;
+  const RayInstanceFrame &frame = S.Frame[1];
+  const int *elist = frame.BVH.EList.data();
+  RayInfo *r = BC->rr;
+  BasisCallRec *LC = &T->Call;
+  RayInfo best_hit;
+  float org[3], dir[3], offset, limit;
+  int ex_inst1, ex_inst2, ex_vert1, ex_vert2;
+  int best = -1, best_inst = -1;
+  BVHWalker walker;
+  int h, k;
+
+  if(BC->interior_flag)
+    return i;
+
+  if(perspective) {
+    copy3f(r->base, org);
+    copy3f(r->dir, dir);
+    offset = 0.0F;
+    limit = BC->back_dist;
+  } else {
+    /* orthoscopic distances are measured from z = 0, not from the front */
+    org[0] = r->base[0];
+    org[1] = r->base[1];
+    org[2] = r->base[2] - BC->front;
+    dir[0] = dir[1] = 0.0F;
+    dir[2] = -1.0F;
+    offset = BC->front;
+    limit = BC->back - BC->front;
+  }
+  if(i >= 0)
+    limit = std::min(limit, r->dist - offset);
+
+  ex_vert1 = RayInstanceKey(T, BC->except1, &ex_inst1);
+  ex_vert2 = RayInstanceKey(T, BC->except2, &ex_inst2);
+
+  LC->excl_trans = (BC->excl_trans > offset) ? (BC->excl_trans - offset) : 0.0F;
+  LC->fudge0 = BC->fudge0;
+  LC->fudge1 = BC->fudge1;
+
+  walker.init(&frame.BVH, org, dir, -kR_SMALL4, &LC->bvh_stats);
+  while((h = walker.next(limit))) {
+    for(const int *ip = elist + h; (k = *ip) >= 0; ip++) {
+      const float *to_local = frame.ToLocal.data() + 12 * k;
+      int j;
+
+      AffineApply(to_local, org, T->Ray.base);
+      AffineRotate(to_local, dir, T->Ray.dir);
+
+      LC->Basis = const_cast<CBasis *>(&S.Proto[S.Inst[k].proto].Basis);
+      LC->except1 = (ex_inst1 == k) ? ex_vert1 : -1;
+      LC->except2 = (ex_inst2 == k) ? ex_vert2 : -1;
+      LC->back_dist = limit;
+
+      j = BasisHitPerspective(LC);
+      if((j >= 0) && (T->Ray.dist <= limit)) {
+        best = j;
+        best_inst = k;
+        best_hit = T->Ray;
+        limit = T->Ray.dist;
+      }
+    }
+  }
+
+  if(best < 0)
+    return i;
+
+  BC->interior_flag = false;
+  return RayInstanceMaterialize(I, T, best_inst, best, &best_hit, r, offset);
+}
+
+/**
+ * Trace the copies after the shadow ray BC->rr has been traced against the
+ * regular primitives in light basis `bc`. The results are merged the same
+ * way BasisHitShadow combines transparent blockers.
+ * @param shadow_hit result of BasisHitShadow
+ * @return > -1 if the ray is blocked
+ */
+int RayInstanceHitShadow(CRay * I, RayInstanceThread * T, BasisCallRec * BC,
+                         int bc, int shadow_hit)
+{
+  const RayInstanceSet &S = I->Instances;
+  const RayInstanceFrame &frame = S.Frame[bc];
+  const int *elist = frame.BVH.EList.data();
+  const float dir[3] = { 0.0F, 0.0F, -1.0F };
+  RayInfo *r = BC->rr;
+  BasisCallRec *LC = &T->Call;
+  float best_trans = 1.0F, best_dist = FLT_MAX;
+  int ex_inst, ex_vert;
+  BVHWalker walker;
+  int h, k;
+
+  if(shadow_hit > -1) {
+    if((r->trans == 0.0F) && !BC->nearest_shadow)
+      return shadow_hit;
+    best_trans = r->trans;
+    best_dist = r->dist;
+  }
+
+  ex_vert = RayInstanceKey(T, BC->except1, &ex_inst);
+
+  LC->trans_shadows = BC->trans_shadows;
+  LC->nearest_shadow = BC->nearest_shadow;
+  LC->fudge0 = BC->fudge0;
+  LC->fudge1 = BC->fudge1;
+  LC->except2 = -1;
+
+  walker.init(&frame.BVH, r->base, dir, -kR_SMALL4, &LC->bvh_stats);
+  while((h = walker.next((best_trans == 0.0F) ? best_dist : FLT_MAX))) {
+    for(const int *ip = elist + h; (k = *ip) >= 0; ip++) {
+      const float *to_local = frame.ToLocal.data() + 12 * k;
+
+      AffineApply(to_local, r->base, T->Ray.base);
+      AffineRotate(to_local, dir, T->Ray.dir);
+
+      LC->Basis = const_cast<CBasis *>(&S.Proto[S.Inst[k].proto].Basis);
+      LC->except1 = (ex_inst == k) ? ex_vert : -1;
+
+      if(BasisHitShadowLine(LC) > -1) {
+        float trans = T->Ray.trans, dist = T->Ray.dist;
+        if((shadow_hit < 0) || (trans < best_trans) ||
+           ((trans == best_trans) && (dist < best_dist))) {
+          shadow_hit = 1;
+          best_trans = trans;
+          best_dist = dist;
+        }
+        if((best_trans == 0.0F) && !BC->nearest_shadow) {
+          r->trans = best_trans;
+          r->dist = best_dist;
+          return shadow_hit;
+        }
+      }
+    }
+  }
+
+  if(shadow_hit > -1) {
+    r->trans = best_trans;
+    r->dist = best_dist;
+  }
+  return shadow_hit;
+}
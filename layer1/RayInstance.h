@@ -0,0 +1,93 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_RayInstance
+#define _H_RayInstance
+
+/* Instanced primitives for the ray tracer (ray_instancing).
+ *
+ * A prototype is a range of regular primitives (e.g. one chain of a
+ * biological assembly) which also gets traced at a number of rigid copies.
+ * The copies are not expanded into primitives: each one is a box in a
+ * top-level BVH per basis, and rays which enter a box are mapped into the
+ * prototype's frame and tested against the prototype's own BVH. */
+
+#include <vector>
+
+#include "Base.h"
+#include "Basis.h"
+#include "BVH.h"
+
+struct RayInstanceProto {
+  int prim_start, prim_stop;    /* range in CRay::Primitive */
+  int vert_start, vert_stop;    /* range in Basis[0], see RayInstancesPrepare */
+  float box_min[3], box_max[3]; /* world coordinates */
+  BVHType BVH;
+  CBasis Basis;                 /* Basis[0] with BVH pointing to the one above */
+};
+
+struct RayInstance {
+  int proto;
+  float Matrix[16];             /* row-major, prototype -> copy (world coordinates) */
+};
+
+/* one per basis (1: camera, >= 2: lights) */
+struct RayInstanceFrame {
+  BVHType BVH;                  /* over the copies, element id = index in Inst */
+  std::vector<float> ToLocal;   /* row-major 3x4 per copy: basis -> prototype */
+};
+
+struct RayInstanceSet {
+  bool Enabled = false;         /* set by the scene for the built-in renderer */
+  int Open = -1;                /* prototype which is being recorded */
+  std::vector<RayInstanceProto> Proto;
+  std::vector<RayInstance> Inst;
+  std::vector<RayInstanceFrame> Frame;
+  int ScratchVert = 0, ScratchNorm = 0; /* per-thread hit slots in Basis[1] */
+  bool ProtoReady = false;      /* prototype BVHs survive a re-render */
+
+  bool empty() const { return Inst.empty(); }
+  void clear()
+  {
+    Open = -1;
+    ProtoReady = false;
+    Proto.clear();
+    Inst.clear();
+    Frame.clear();
+  }
+};
+
+/* per tracer thread */
+struct RayInstanceThread {
+  BasisCallRec Call;            /* for the prototype BVHs */
+  RayInfo Ray;                  /* in prototype coordinates */
+  int Slot;                     /* next of the two hit slots */
+  int Vert, Norm;               /* first vertex and normal of the slots in Basis[1] */
+  int KeyInst[2], KeyVert[2];   /* what has been hit in each slot */
+  CPrimitive Prim[2];
+};
+
+int RayInstancesPrepare(CRay * I, int shadows, int n_thread);
+
+void RayInstanceThreadInit(CRay * I, RayInstanceThread * T, int phase,
+                           const BasisCallRec * BC);
+void RayInstanceThreadFree(RayInstanceThread * T, int phase);
+
+int RayInstanceHit(CRay * I, RayInstanceThread * T, BasisCallRec * BC, int i,
+                   int perspective);
+int RayInstanceHitShadow(CRay * I, RayInstanceThread * T, BasisCallRec * BC,
+                         int bc, int shadow_hit);
+
+#endif
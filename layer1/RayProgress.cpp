@@ -0,0 +1,184 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "RayProgress.h"
+
+void RayProgressInit(PyMOLGlobals * G)
+{
+  G->RayProgress = new CRayProgress;
+}
+
+void RayProgressFree(PyMOLGlobals * G)
+{
+  delete G->RayProgress;
+  G->RayProgress = nullptr;
+}
+
+void CRayProgress::setCallback(CRayProgressFn * fn, void *data)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_fn = fn;
+  m_data = data;
+}
+
+void CRayProgress::begin(int width, int height)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_width = width;
+  m_height = height;
+  m_pixels.assign(width * (size_t) height, 0);
+  m_tiles.clear();
+}
+
+void CRayProgress::notify(int x, int y, int width, int height, int pass)
+{
+  CRayProgressFn *fn;
+  void *data;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tiles.insert(m_tiles.end(), {x, y, width, height, pass});
+    fn = m_fn;
+    data = m_data;
+  }
+  if(fn)
+    fn(data, x, y, width, height, pass);
+}
+
+void CRayProgress::publishTile(const unsigned int *buffer, int buffer_width,
+                               int mag, int x0, int x1, int y0, int y1, int pass)
+{
+  int tx0, tx1, ty0, ty1;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(mag > 1) {
+      /* output pixels whose block starts in the tile, without the border */
+      tx0 = std::max((x0 + mag - 1) / mag - 1, 0);
+      ty0 = std::max((y0 + mag - 1) / mag - 1, 0);
+      tx1 = std::min((x1 + mag - 1) / mag - 1, m_width);
+      ty1 = std::min((y1 + mag - 1) / mag - 1, m_height);
+    } else {
+      tx0 = x0;
+      ty0 = y0;
+      tx1 = std::min(x1, m_width);
+      ty1 = std::min(y1, m_height);
+    }
+    if(tx0 >= tx1 || ty0 >= ty1)
+      return;
+
+    for(int y = ty0; y < ty1; y++) {
+      unsigned int *dst = m_pixels.data() + y * (size_t) m_width;
+      if(mag < 2) {
+        memcpy(dst + tx0, buffer + y * (size_t) buffer_width + tx0,
+               (tx1 - tx0) * sizeof(unsigned int));
+        continue;
+      }
+      for(int x = tx0; x < tx1; x++) {
+        /* box filter over the block of this output pixel */
+        unsigned int sum[4] = {0, 0, 0, 0};
+        for(int b = 0; b < mag; b++) {
+          const unsigned char *src = (const unsigned char *)
+            (buffer + ((y + 1) * mag + b) * (size_t) buffer_width + (x + 1) * mag);
+          for(int a = 0; a < mag; a++, src += 4) {
+            sum[0] += src[0];
+            sum[1] += src[1];
+            sum[2] += src[2];
+            sum[3] += src[3];
+          }
+        }
+        unsigned char *out = (unsigned char *) (dst + x);
+        for(int c = 0; c < 4; c++)
+          out[c] = (unsigned char) (sum[c] / (mag * mag));
+      }
+    }
+  }
+  notify(tx0, ty0, tx1 - tx0, ty1 - ty0, pass);
+}
+
+void CRayProgress::publishPreview(const unsigned int *buffer, int width,
+                                  int height)
+{
+  int w, h;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    w = m_width;
+    h = m_height;
+    if(!width || !height || !w || !h)
+      return;
+
+    /* nearest neighbor upscaling */
+    for(int y = 0; y < h; y++) {
+      const unsigned int *src = buffer + ((y * height) / h) * (size_t) width;
+      unsigned int *dst = m_pixels.data() + y * (size_t) w;
+      for(int x = 0; x < w; x++)
+        dst[x] = src[(x * width) / w];
+    }
+  }
+  notify(0, 0, w, h, cRayProgressPreview);
+}
+
+void CRayProgress::publishFinal(const unsigned int *buffer, int width,
+                                int height)
+{
+  begin(width, height);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::copy(buffer, buffer + m_pixels.size(), m_pixels.begin());
+  }
+  notify(0, 0, width, height, cRayProgressFinal);
+}
+
+std::vector<int> CRayProgress::getTiles(bool reset)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<int> tiles = m_tiles;
+  if(reset)
+    m_tiles.clear();
+  return tiles;
+}
+
+bool CRayProgress::copy(int x, int y, int width, int height, int row_bytes,
+                        void *dest)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if(x < 0 || y < 0 || width < 0 || height < 0 ||
+     x + width > m_width || y + height > m_height ||
+     row_bytes < width * (int) sizeof(unsigned int))
+    return false;
+
+  for(int b = 0; b < height; b++) {
+    memcpy((char *) dest + b * (size_t) row_bytes,
+           m_pixels.data() + (y + b) * (size_t) m_width + x,
+           width * sizeof(unsigned int));
+  }
+  return true;
+}
+
+int CRayProgress::getWidth()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_width;
+}
+
+int CRayProgress::getHeight()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_height;
+}
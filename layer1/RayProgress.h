@@ -0,0 +1,84 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_RayProgress
+#define _H_RayProgress
+
+/* Progressive ray tracing (ray_progressive).
+ *
+ * The ray tracer publishes parts of the image while it is still working: a
+ * coarse preview first, then every finished tile. Hosts either register a
+ * callback or poll the list of tiles and copy pixels out of the partial
+ * image. All methods may be called from any thread, the callback is called
+ * from the tracer threads without the lock held.
+ *
+ * Pixels have the layout of pymol::Image (RGBA, bottom row first) and are
+ * not yet gamma corrected. */
+
+#include <mutex>
+#include <vector>
+
+#include "PyMOLGlobals.h"
+
+enum {
+  cRayProgressPreview = 0,      /* coarse trace of the whole image */
+  cRayProgressTrace = 1,        /* tile of the full resolution trace */
+  cRayProgressEdge = 2,         /* tile after edge oversampling */
+  cRayProgressFinal = 3         /* the finished image */
+};
+
+typedef void CRayProgressFn(void *data, int x, int y, int width, int height,
+                            int pass);
+
+struct CRayProgress {
+  void setCallback(CRayProgressFn * fn, void *data);
+
+  /* starts a new image of the final size */
+  void begin(int width, int height);
+
+  /* tile [x0, x1) x [y0, y1) of a tracer buffer with "mag" x "mag"
+     oversampling and a border of one output pixel (see RayRender) */
+  void publishTile(const unsigned int *buffer, int buffer_width, int mag,
+                   int x0, int x1, int y0, int y1, int pass);
+
+  /* a small image which covers the whole view */
+  void publishPreview(const unsigned int *buffer, int width, int height);
+
+  void publishFinal(const unsigned int *buffer, int width, int height);
+
+  /* x, y, width, height and pass of each tile published so far */
+  std::vector<int> getTiles(bool reset);
+
+  bool copy(int x, int y, int width, int height, int row_bytes,
+            void *dest);
+
+  int getWidth();
+  int getHeight();
+
+private:
+  void notify(int x, int y, int width, int height, int pass);
+
+  std::mutex m_mutex;
+  int m_width = 0, m_height = 0;
+  std::vector<unsigned int> m_pixels;
+  std::vector<int> m_tiles;
+  CRayProgressFn *m_fn = nullptr;
+  void *m_data = nullptr;
+};
+
+void RayProgressInit(PyMOLGlobals * G);
+void RayProgressFree(PyMOLGlobals * G);
+
+#endif
@@ -59,6 +59,7 @@ Z* -------------------------------------------------------------------
 #include"ScrollBar.h"
 #include "ShaderMgr.h"
 #include "Feedback.h"
+#include "TaskGraph.h"
 
 #ifdef _PYMOL_OPENVR
 #include"OpenVRMode.h"
@@ -2219,6 +2220,7 @@ void SceneChanged(PyMOLGlobals * G)
 {
   CScene *I = G->Scene;
   I->ChangedFlag = true;
+  SceneRayInvalidateGeometry(G);
   SceneInvalidateCopy(G, false);
   SceneDirty(G);
   SeqChanged(G);
@@ -4088,6 +4090,7 @@ void SceneFree(PyMOLGlobals * G)
   I->NonGadgetObjs.clear();
 
   ScenePurgeImage(G);
+  SceneRayInvalidateGeometry(G);
   CGOFree(G->DebugCGO);
   delete G->Scene;
 }
@@ -4532,44 +4535,6 @@ int SceneRovingCheckDirty(PyMOLGlobals * G)
   return (I->RovingDirtyFlag);
 }
 
-struct _CObjectUpdateThreadInfo {
-  pymol::CObject *obj;
-};
-
-void SceneObjectUpdateThread(CObjectUpdateThreadInfo * T)
-{
-  if(T->obj) {
-    T->obj->update();
-  }
-}
-
-#ifndef _PYMOL_NOPY
-static void SceneObjectUpdateSpawn(PyMOLGlobals * G, CObjectUpdateThreadInfo * Thread,
-                                   int n_thread, int n_total)
-{
-  if(n_total == 1) {
-    SceneObjectUpdateThread(Thread);
-  } else if(n_total) {
-    int blocked;
-    PyObject *info_list;
-    int a, n = 0;
-    blocked = PAutoBlock(G);
-
-    PRINTFB(G, FB_Scene, FB_Blather)
-      " Scene: updating objects with %d threads...\n", n_thread ENDFB(G);
-    info_list = PyList_New(n_total);
-    for(a = 0; a < n_total; a++) {
-      PyList_SetItem(info_list, a, PyCapsule_New(Thread + a, nullptr, nullptr));
-      n++;
-    }
-    PXDecRef(PYOBJECT_CALLMETHOD
-             (G->P_inst->cmd, "_object_update_spawn", "Oi", info_list, n_thread));
-    Py_DECREF(info_list);
-    PAutoUnblock(G, blocked);
-  }
-}
-#endif
-
 static void SceneStencilCheck(PyMOLGlobals *G) 
 {
   CScene *I = G->Scene;
@@ -4628,64 +4593,23 @@ void SceneUpdate(PyMOLGlobals * G, int force)
       }
 
       {
-#ifndef _PYMOL_NOPY
         int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
         int multithread = SettingGetGlobal_i(G, cSetting_async_builds);
-        if(multithread && (n_thread > 1)) {
-          int min_start = -1;
-          int max_stop = -1;
-          int n_obj = 0;
-          for (auto& obj : I->Obj) {
-            int start = 0;
-            n_obj++;
-            int stop = obj->getNFrame();
-	    /* set start/stop to define the range for this object
-	     * depending upon various build settings */
-            ObjectAdjustStateRebuildRange(obj, &start, &stop);
-            if(min_start < 0) {
-              min_start = start;
-              max_stop = stop;
-            } else {
-              if(min_start > start)
-                min_start = start;
-              if(max_stop < stop)
-                max_stop = stop;
-            }
-          }
-
-          int n_frame = max_stop - min_start;
 
-          if(n_frame > n_thread) {
-            n_thread = 1;
-            /* prevent n_thread * n_thread -- only multithread within
-               individual object states (typically more balanced) */
-          } else if(n_frame > 1) {
-            n_thread = n_thread / n_frame;
-          }
-
-          if(n_thread < 1)
-            n_thread = 1;
-        }
-
-	/* Note: we might want to optimize this by doing multi-threaded updates
-	   for all objects. */
         if(multithread && (n_thread > 1)) {
-          /* multi-threaded geometry update */
-          int cnt = I->NonGadgetObjs.size();
-
-          if(cnt) {
-            CObjectUpdateThreadInfo *thread_info = pymol::malloc<CObjectUpdateThreadInfo>(cnt);
-            if(thread_info) {
-              cnt = 0;
-              for (auto& NonGadgetObj : I->NonGadgetObjs) {
-                thread_info[cnt++].obj = NonGadgetObj;
-              }
-              SceneObjectUpdateSpawn(G, thread_info, n_thread, cnt);
-              FreeP(thread_info);
+          /* multi-threaded geometry update: one task graph for all objects,
+             so representations of all objects and states build concurrently */
+          pymol::TaskGraph graph;
+          for (auto& obj : I->NonGadgetObjs) {
+            if(obj->type == cObjectMolecule) {
+              static_cast<ObjectMolecule*>(obj)->addUpdateTasks(graph);
+            } else {
+              /* may report progress or call into Python */
+              graph.add([obj] { obj->update(); }, {}, true);
             }
           }
+          graph.run(n_thread);
         } else
-#endif
           /* single-threaded update */
           for (auto& obj : I->Obj) {
             obj->update();
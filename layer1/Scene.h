@@ -208,7 +208,6 @@ void SceneGetAdjustedLightValues(PyMOLGlobals * G,
     int limit = 8);
 
 void SceneAbortAnimation(PyMOLGlobals * G);
-void SceneObjectUpdateThread(CObjectUpdateThreadInfo * T);
 int SceneCaptureWindow(PyMOLGlobals * G);
 
 void SceneZoom(PyMOLGlobals * G, float scale);
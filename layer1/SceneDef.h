@@ -23,6 +23,7 @@ Z* -------------------------------------------------------------------
 #include"Util.h"
 #include"View.h"
 #include"Image.h"
+#include"Ray.h"
 #include "Picking.h"
 #include"ScrollBar.h"
 #include"SceneElem.h"
@@ -97,6 +98,16 @@ typedef struct {
 } GridInfo;
 
 
+/* geometry of the last ray traced frame, see ray_reuse_geometry */
+struct SceneRayCache {
+  CRay *Ray{};
+  std::vector<double> Key;      /* everything but the camera orientation */
+  std::vector<const pymol::CObject*> Objects;
+  int NFrame{}, NReused{};      /* frames traced, frames with reused geometry */
+  double NReusedPrimitive{};
+  RayTiming Timing{};           /* of the last traced frame */
+};
+
 class CScene : public Block {
  public:
   std::list<pymol::CObject*> Obj, GadgetObjs, NonGadgetObjs;
@@ -187,6 +198,7 @@ class CScene : public Block {
   int do_not_clear{};
   GridInfo grid{};
   int last_grid_size{};
+  SceneRayCache RayCache;
   int n_texture_refreshes { 0 };
   CGO *offscreenCGO { nullptr };
   CGO *offscreenOIT_CGO { nullptr };
@@ -9,6 +9,7 @@
 #include"ListMacros.h"
 #include"Color.h"
 #include"P.h"
+#include"RayProgress.h"
 #include "Feedback.h"
 
 static double accumTiming = 0.0;
@@ -19,6 +20,53 @@ extern float *rayDepthPixels;
 extern int rayVolume, rayWidth, rayHeight;
 
 
+/*
+ * Frees the geometry kept from the last ray traced frame. Called whenever
+ * reps, colors, settings or the object list may have changed.
+ */
+void SceneRayInvalidateGeometry(PyMOLGlobals * G)
+{
+  CScene *I = G->Scene;
+
+  if(I && I->RayCache.Ray) {
+    RayFree(I->RayCache.Ray);
+    I->RayCache.Ray = NULL;
+  }
+}
+
+const RayTiming *SceneRayGetTiming(PyMOLGlobals * G)
+{
+  return &G->Scene->RayCache.Timing;
+}
+
+/*
+ * Everything the primitives of a frame depend on, except for the camera
+ * orientation. Returns false if the objects can't be reused at all.
+ */
+static bool SceneRayGeometryKey(PyMOLGlobals * G, CScene *I,
+    std::vector<double> &key, std::vector<const pymol::CObject*> &objects,
+    std::initializer_list<double> view)
+{
+  key.assign(view);
+  key.push_back(SceneGetState(G));
+  objects.clear();
+
+  for (auto* obj : I->Obj) {
+    if (obj->type == cObjectGroup)
+      continue;
+    if (obj->ViewElem)
+      return false;             /* animates its TTT while rendering */
+    objects.push_back(obj);
+    key.push_back(ObjectGetCurrentState(obj, false));
+    key.push_back(obj->Color);
+    key.push_back(obj->visRep);
+    key.push_back(obj->TTTFlag);
+    if (obj->TTTFlag)
+      key.insert(key.end(), obj->TTT, obj->TTT + 16);
+  }
+  return true;
+}
+
 static void SceneRaySetRayView(PyMOLGlobals * G, CScene *I, int stereo_hand,
     float *rayView, float *angle, float shift)
 {
@@ -112,6 +160,9 @@ bool SceneRay(PyMOLGlobals * G,
   int ortho = SettingGetGlobal_i(G, cSetting_ray_orthoscopic);
   int last_grid_active = I->grid.active;
   int grid_size = 0;
+  int reuse = (mode == 0) && SettingGetGlobal_b(G, cSetting_ray_reuse_geometry);
+  bool progressive = (mode == 0) && G->RayProgress &&
+    SettingGetGlobal_i(G, cSetting_ray_progressive) > 0;
 
   if(SettingGetGlobal_i(G, cSetting_defer_builds_mode) == 5)
     SceneUpdate(G, true);
@@ -187,6 +238,10 @@ bool SceneRay(PyMOLGlobals * G,
     G->ShaderMgr->ResetUniformSet();    
   }
   I->last_grid_size = grid_size;
+  if(I->grid.active)
+    reuse = false;
+  if(!reuse)
+    SceneRayInvalidateGeometry(G);
   while(1) {
     int slot;
     int tot_width = ray_width;
@@ -203,7 +258,36 @@ bool SceneRay(PyMOLGlobals * G,
         OrthoBusySlow(G, slot, I->grid.last_slot);
       }
 
-      ray = RayNew(G, antialias);
+      float pixel_scale_value = SettingGetGlobal_f(G, cSetting_ray_pixel_scale);
+      float vertex_scale = SceneGetScreenVertexScale(G, NULL);
+      std::vector<double> ray_key;
+      std::vector<const pymol::CObject*> ray_objects;
+      bool reused = false;
+
+      if(pixel_scale_value < 0)
+        pixel_scale_value = 1.0F;
+
+      pixel_scale_value *= ((float) tot_height) / I->Height;
+
+      ray = NULL;
+      if(reuse) {
+        const auto& clip = I->m_view.m_clipSafe();
+        reuse = SceneRayGeometryKey(G, I, ray_key, ray_objects,
+            {(double) ray_width, (double) ray_height, (double) tot_height,
+             (double) I->Height, (double) antialias, (double) ortho, fov,
+             I->m_view.pos().z, clip.m_front, clip.m_back, pixel_scale_value,
+             aspRat, vertex_scale});
+        I->RayCache.NFrame++;
+        if(I->RayCache.Ray && ray_key == I->RayCache.Key &&
+           ray_objects == I->RayCache.Objects) {
+          std::swap(ray, I->RayCache.Ray);
+          reused = true;
+        }
+      }
+      SceneRayInvalidateGeometry(G);
+
+      if(!ray)
+        ray = RayNew(G, antialias);
       if(!ray)
         break;
 
@@ -217,13 +301,6 @@ bool SceneRay(PyMOLGlobals * G,
       OrthoBusyFast(G, 0, 20);
 
       {
-        float pixel_scale_value = SettingGetGlobal_f(G, cSetting_ray_pixel_scale);
-
-        if(pixel_scale_value < 0)
-          pixel_scale_value = 1.0F;
-
-        pixel_scale_value *= ((float) tot_height) / I->Height;
-
         if(ortho) {
           const float _1 = 1.0F;
           RayPrepare(ray, -width, width, -height, height, I->m_view.m_clipSafe().m_front,
@@ -257,15 +334,23 @@ bool SceneRay(PyMOLGlobals * G,
                      I->m_view.m_clipSafe().m_front / I->m_view.m_clipSafe().m_back, ((float) ray_height) / I->Height);
         }
       }
-      {
+      if(reused) {
+        I->RayCache.NReused++;
+        I->RayCache.NReusedPrimitive += RayGetNPrimitives(ray);
+      } else {
         int *slot_vla = I->SlotVLA;
         int state = SceneGetState(G);
         RenderInfo info;
         info.ray = ray;
         info.ortho = ortho;
-        info.vertex_scale = SceneGetScreenVertexScale(G, NULL);
+        info.vertex_scale = vertex_scale;
+        ray->RetainGeometry = reuse;
 	info.use_shaders = SettingGetGlobal_b(G, cSetting_use_shaders);
 
+        /* only the built-in renderer knows how to trace instances */
+        ray->Instances.Enabled =
+          (mode == 0) && SettingGetGlobal_b(G, cSetting_ray_instancing);
+
         if(SettingGetGlobal_b(G, cSetting_dynamic_width)) {
           info.dynamic_width = true;
           info.dynamic_width_factor =
@@ -330,8 +415,16 @@ bool SceneRay(PyMOLGlobals * G,
           auto image = pymol::make_unique<pymol::Image>(ray_width, ray_height);
           std::uint32_t background;
 
+          /* partial images only make sense for a single view */
+          ray->Progress = (!I->grid.active && progressive) ? G->RayProgress : nullptr;
+
+          double geometry = UtilGetSeconds(G) - timing;
+
           RayRender(ray, image->pixels(), timing, angle, antialias, &background);
 
+          I->RayCache.Timing = ray->Timing;
+          I->RayCache.Timing.Geometry = geometry;
+
           /*    RayRenderColorTable(ray,ray_width,ray_height,buffer); */
           if(!I->grid.active) {
             I->Image = std::move(image);
@@ -480,7 +573,13 @@ bool SceneRay(PyMOLGlobals * G,
         break;
 
       }
-      RayFree(ray);
+      if(reuse && !ray->ViewDependent && !G->Interrupt) {
+        I->RayCache.Ray = ray;
+        I->RayCache.Key = std::move(ray_key);
+        I->RayCache.Objects = std::move(ray_objects);
+      } else {
+        RayFree(ray);
+      }
     }
     if(I->grid.active)
       GridSetRayViewport(&I->grid, -1, &ray_x, &ray_y, &ray_width, &ray_height);
@@ -488,6 +587,9 @@ bool SceneRay(PyMOLGlobals * G,
     if((mode == 0) && I->Image && !I->Image->empty()) {
       SceneApplyImageGamma(G, I->Image->pixels(), I->Image->getWidth(),
                            I->Image->getHeight());
+      if(progressive && !I->grid.active && !G->Interrupt)
+        G->RayProgress->publishFinal(I->Image->pixels(),
+                                     I->Image->getWidth(), I->Image->getHeight());
     }
 
     stereo_hand--;
@@ -700,6 +802,7 @@ bool SceneRay(PyMOLGlobals * G,
     }
   }
   timing = UtilGetSeconds(G) - timing;
+  I->RayCache.Timing.Total = timing;
   if(mode != 2) {               /* don't show timings for tests */
     accumTiming += timing;
 
@@ -708,6 +811,12 @@ bool SceneRay(PyMOLGlobals * G,
         PRINTFB(G, FB_Ray, FB_Details)
           " Ray: render time: %4.2f sec. = %3.1f frames/hour (%4.2f sec. accum.).\n",
           timing, 3600 / timing, accumTiming ENDFB(G);
+        if(I->RayCache.NReused) {
+          PRINTFB(G, FB_Ray, FB_Details)
+            " Ray: reused geometry in %d of %d frames (%.0f primitives).\n",
+            I->RayCache.NReused, I->RayCache.NFrame,
+            I->RayCache.NReusedPrimitive ENDFB(G);
+        }
       } else {
         PRINTFB(G, FB_Ray, FB_Details)
           " Ray: render aborted.\n" ENDFB(G);
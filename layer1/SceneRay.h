@@ -22,6 +22,7 @@ Z* -------------------------------------------------------------------
 #include"PyMOLObject.h"
 #include"Ortho.h"
 #include"View.h"
+#include"Ray.h"
 
 bool SceneRay(PyMOLGlobals * G,
               int ray_width, int ray_height, int mode,
@@ -31,5 +32,7 @@ bool SceneRay(PyMOLGlobals * G,
               int show_timing, int antialias);
 
 void SceneRenderRayVolume(PyMOLGlobals * G, CScene *I);
+void SceneRayInvalidateGeometry(PyMOLGlobals * G);
+const RayTiming *SceneRayGetTiming(PyMOLGlobals * G);
 
 #endif
@@ -27,6 +27,7 @@ Z* -------------------------------------------------------------------
 #include"Ortho.h"
 #include"Setting.h"
 #include"Scene.h"
+#include"SceneRay.h"
 #include"ButMode.h"
 #include"CGO.h"
 #include"Executive.h"
@@ -631,6 +632,8 @@ static bool is_session_blacklisted(int index) {
   switch (index) {
   case cSetting_antialias_shader:
   case cSetting_ati_bugs:
+  case cSetting_cache_dir:
+  case cSetting_cache_disk_max:
   case cSetting_cache_max:
   case cSetting_cgo_shader_ub_color:
   case cSetting_cgo_shader_ub_flags:
@@ -1883,6 +1886,8 @@ void SettingGenerateSideEffects(PyMOLGlobals * G, int index, const char *sele, i
   const char *inv_sele = (sele && sele[0]) ? sele : cKeywordAll;
   auto &rec = SettingInfo[index];
 
+  SceneRayInvalidateGeometry(G);
+
   if (rec.level == cSettingLevel_unused) {
     const char * name = rec.name;
 
@@ -2568,6 +2573,8 @@ void SettingGenerateSideEffects(PyMOLGlobals * G, int index, const char *sele, i
   case cSetting_surface_cavity_cutoff:   
   case cSetting_cavity_cull:
   case cSetting_surface_smooth_edges:
+  case cSetting_surface_method:
+  case cSetting_surface_edit_method:
     ExecutiveInvalidateRep(G, inv_sele, cRepSurface, cRepInvRep);
     SceneChanged(G);
     break;
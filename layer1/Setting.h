@@ -293,6 +293,11 @@ public:
   bool next() {
     return (++state < end);
   };
+
+  // true if more than one iteration is left
+  bool isMultistate() const {
+    return (end - state > 2);
+  }
 };
 
 /*
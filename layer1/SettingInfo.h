@@ -895,6 +895,17 @@ enum {
   REC_i( 785, cartoon_smooth_cylinder_cycles          , global    , 3 ),
   REC_i( 786, cartoon_smooth_cylinder_window          , global    , 2 ),
   REC_i( 787, isosurface_algorithm                    , global    , 0, 0, 2 ),
+  REC_b( 788, ray_bvh                                 , global    , false ), // BVH instead of voxel map for ray tracing
+  REC_i( 789, ray_packet_size                         , global    , -1, -1, 8 ), // rays per SIMD packet, -1: widest supported, 0/1: scalar
+  REC_b( 790, ray_instancing                          , global    , true ), // trace rigid copies of states (e.g. assemblies) as instances
+  REC_b( 791, ray_reuse_geometry                      , global    , true ), // keep ray tracer geometry if only the camera orientation changes
+  REC_b( 792, ray_antialias_adaptive                  , global    , false ), // antialias > 1: supersample edge pixels only (see ray_oversample_cutoff)
+  REC_i( 793, ray_progressive                         , global    , 0, 0, 64 ), // publish finished ray tracer tiles, N > 1: after a 1/N preview
+  REC_i( 794, movie_png_threads                       , global    , 0, 0, 64 ), // write movie frames on N background threads while rendering the next ones
+  REC_i( 795, surface_method                          , ostate    , 0, 0, 1 ), // 1: contour a distance field on a grid (fast, for very large systems)
+  REC_s( 796, cache_dir                               , global    , "" ), // also keep cached results (cache_mode) as files in this directory
+  REC_i( 797, cache_disk_max                          , global    , 1024, 0, 1048576 ), // size limit of cache_dir in MB, 0: unlimited
+  REC_i( 798, surface_edit_method                     , ostate    , 1, -1, 1 ), // surface_method while sculpting or dragging the object (1: incremental), -1: no change
 
 
 #ifdef SETTINGINFO_IMPLEMENTATION
@@ -20,6 +20,7 @@ Z* -------------------------------------------------------------------
 #include"os_std.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include"Base.h"
 #include"MemoryDebug.h"
@@ -1212,6 +1213,7 @@ void CoordSet::invalidateRep(cRep_t type, cRepInv_t level)
   if(level >= cRepInvCoord) {   /* if coordinates change, then this map becomes invalid */
     MapFree(Coord2Idx);
     Coord2Idx = nullptr;
+    CoordGeneration = CoordSetNextGeneration();
     ExecutiveInvalidateSelectionIndicatorsCGO(G);
     SceneInvalidatePicking(G);
     /* invalidate distances */
@@ -1231,46 +1233,71 @@ void CoordSet::invalidateRep(cRep_t type, cRepInv_t level)
 
 
 /*========================================================================*/
+const cRep_t CoordSet::RepBuildOrder[12] = {
+    cRepLine,
+    cRepCyl,
+    cRepDot,
+    cRepMesh,
+    cRepSphere,
+    cRepRibbon,
+    cRepCartoon,
+    cRepSurface,
+    cRepLabel,
+    cRepNonbonded,
+    cRepNonbondedSphere,
+    cRepEllipsoid,
+};
 
-#define RepUpdateMacro(rep, new_fn, state)                                     \
-  {                                                                            \
-    if (Active[rep] && !G->Interrupt) {                                        \
-      if (Rep[rep]) {                                                          \
-        assert(Rep[rep]->cs == this);                                          \
-        assert(Rep[rep]->getState() == state);                                 \
-        Rep[rep] = Rep[rep]->update();                                         \
-      } else {                                                                 \
-        Rep[rep] = new_fn(this, state);                                        \
-        if (Rep[rep]) {                                                        \
-          Rep[rep]->fNew = new_fn;                                             \
-          SceneInvalidatePicking(G);                                           \
-        } else {                                                               \
-          Active[rep] = false;                                                 \
-        }                                                                      \
-      }                                                                        \
-    }                                                                          \
-    OrthoBusyFast(G, rep, cRepCnt);                                            \
+/**
+ * Representation constructor for `rep`, or NULL if it's not built by
+ * CoordSet::update
+ */
+static ::Rep* (*CoordSetGetRepNew(cRep_t rep))(CoordSet*, int)
+{
+  switch (rep) {
+  case cRepLine: return RepWireBondNew;
+  case cRepCyl: return RepCylBondNew;
+  case cRepDot: return RepDotNew;
+  case cRepMesh: return RepMeshNew;
+  case cRepSphere: return RepSphereNew;
+  case cRepRibbon: return RepRibbonNew;
+  case cRepCartoon: return RepCartoonNew;
+  case cRepSurface: return RepSurfaceNew;
+  case cRepLabel: return RepLabelNew;
+  case cRepNonbonded: return RepNonbondedNew;
+  case cRepNonbondedSphere: return RepNonbondedSphereNew;
+  case cRepEllipsoid: return RepEllipsoidNew;
+  default: return nullptr;
   }
+}
 
-/*========================================================================*/
-void CoordSet::update(int state)
+bool CoordSet::updateRep(cRep_t rep, int state)
 {
-  assert(G == Obj->G);
+  auto new_fn = CoordSetGetRepNew(rep);
 
-  OrthoBusyFast(G, 0, cRepCnt);
-  RepUpdateMacro(cRepLine, RepWireBondNew, state);
-  RepUpdateMacro(cRepCyl, RepCylBondNew, state);
-  RepUpdateMacro(cRepDot, RepDotNew, state);
-  RepUpdateMacro(cRepMesh, RepMeshNew, state);
-  RepUpdateMacro(cRepSphere, RepSphereNew, state);
-  RepUpdateMacro(cRepRibbon, RepRibbonNew, state);
-  RepUpdateMacro(cRepCartoon, RepCartoonNew, state);
-  RepUpdateMacro(cRepSurface, RepSurfaceNew, state);
-  RepUpdateMacro(cRepLabel, RepLabelNew, state);
-  RepUpdateMacro(cRepNonbonded, RepNonbondedNew, state);
-  RepUpdateMacro(cRepNonbondedSphere, RepNonbondedSphereNew, state);
-  RepUpdateMacro(cRepEllipsoid, RepEllipsoidNew, state);
+  if (!new_fn || !Active[rep] || G->Interrupt)
+    return false;
+
+  if (Rep[rep]) {
+    assert(Rep[rep]->cs == this);
+    assert(Rep[rep]->getState() == state);
+    Rep[rep] = Rep[rep]->update();
+    return false;
+  }
+
+  Rep[rep] = new_fn(this, state);
+
+  if (!Rep[rep]) {
+    Active[rep] = false;
+    return false;
+  }
 
+  Rep[rep]->fNew = new_fn;
+  return true;
+}
+
+void CoordSet::updateFinish()
+{
   for (int a = 0; a < cRepCnt; ++a) {
     if (!Rep[a])
       Active[a] = false;
@@ -1287,16 +1314,50 @@ void CoordSet::update(int state)
   OrthoBusyFast(G, 1, 1);
 }
 
+/*========================================================================*/
+void CoordSet::update(int state)
+{
+  assert(G == Obj->G);
+
+  OrthoBusyFast(G, 0, cRepCnt);
+
+  for (auto rep : RepBuildOrder) {
+    if (updateRep(rep, state))
+      SceneInvalidatePicking(G);
+    OrthoBusyFast(G, rep, cRepCnt);
+  }
+
+  updateFinish();
+}
+
 
 /*========================================================================*/
-void CoordSetUpdateCoord2IdxMap(CoordSet * I, float cutoff)
+/**
+ * Unique value for CoordSet::CoordGeneration. Never repeats, so a cached
+ * result keyed on it can't be confused with another coordinate set.
+ */
+unsigned CoordSetNextGeneration()
+{
+  static std::atomic<unsigned> generation{0};
+  return ++generation;
+}
+
+/*========================================================================*/
+/**
+ * Makes sure that Coord2Idx is a map over the current coordinates with
+ * cells of at least `cutoff`. Small coordinate sets don't get a map.
+ * @return true if the map was (re)built
+ */
+bool CoordSetUpdateCoord2IdxMap(CoordSet * I, float cutoff)
 {
   if(cutoff < R_SMALL4)
     cutoff = R_SMALL4;
   if(I->NIndex > 10) {
     if(I->Coord2Idx) {
       if((I->Coord2IdxDiv < cutoff) ||
-         (((cutoff - I->Coord2IdxReq) / I->Coord2IdxReq) < -0.5F)) {
+         (((cutoff - I->Coord2IdxReq) / I->Coord2IdxReq) < -0.5F) ||
+         (I->Coord2IdxGeneration != I->CoordGeneration) ||
+         (I->Coord2Idx->NVert != I->NIndex)) {
         MapFree(I->Coord2Idx);
         I->Coord2Idx = NULL;
       }
@@ -1305,10 +1366,13 @@ void CoordSetUpdateCoord2IdxMap(CoordSet * I, float cutoff)
       I->Coord2IdxReq = cutoff;
       I->Coord2IdxDiv = cutoff * 1.25F;
       I->Coord2Idx = MapNew(I->G, I->Coord2IdxDiv, I->Coord, I->NIndex, NULL);
+      I->Coord2IdxGeneration = I->CoordGeneration;
       if(I->Coord2IdxDiv < I->Coord2Idx->Div)
         I->Coord2IdxDiv = I->Coord2Idx->Div;
+      return true;
     }
   }
+  return false;
 }
 
 /*========================================================================*/
@@ -1470,6 +1534,7 @@ void CoordSet::render(RenderInfo * info)
 /*========================================================================*/
 CoordSet::CoordSet(PyMOLGlobals* G)
     : CObjectState(G)
+    , CoordGeneration(CoordSetNextGeneration())
 {
 }
 
@@ -1494,6 +1559,7 @@ CoordSet::CoordSet(const CoordSet& cs)
   this->tmp_index = cs.tmp_index;
   this->Coord2IdxReq = cs.Coord2IdxReq;
   this->Coord2IdxDiv = cs.Coord2IdxDiv;
+  this->CoordGeneration = CoordSetNextGeneration();
   this->objMolOpInvalidated = cs.objMolOpInvalidated;
 
   // copy VLAs
@@ -48,6 +48,19 @@ struct CoordSet : CObjectState {
 
   // methods
   void update(int state);
+
+  /// Representations in the order update() builds them
+  static const cRep_t RepBuildOrder[12];
+
+  /// Build or update one representation, see update(). May run concurrently
+  /// for different representations of the same coordinate set.
+  /// @return true if a new representation was created, which requires
+  /// SceneInvalidatePicking()
+  bool updateRep(cRep_t rep, int state);
+
+  /// Last step of update(), after all updateRep() calls. Not thread safe.
+  void updateFinish();
+
   void render(RenderInfo * info);
   void enumIndices();
   int extendIndices(int nAtom);
@@ -137,6 +150,9 @@ struct CoordSet : CObjectState {
 
   MapType *Coord2Idx = nullptr;
   float Coord2IdxReq = 0, Coord2IdxDiv = 0;
+  unsigned Coord2IdxGeneration = 0; /* CoordGeneration which Coord2Idx was built from */
+
+  unsigned CoordGeneration = 0; /* unique, changes when coordinates change (cRepInvCoord) */
 
   /* temporary / optimization */
 
@@ -217,15 +233,12 @@ int CoordSetValidateRefPos(CoordSet * I);
 void CoordSetAdjustAtmIdx(CoordSet*, const int*);
 int CoordSetMerge(ObjectMolecule *OM, CoordSet * I, const CoordSet * cs);        /* must be non-overlapping */
 void CoordSetRecordTxfApplied(CoordSet * I, const float *TTT, int homogenous);
-void CoordSetUpdateCoord2IdxMap(CoordSet * I, float cutoff);
+bool CoordSetUpdateCoord2IdxMap(CoordSet * I, float cutoff);
+unsigned CoordSetNextGeneration();
 
 bool CoordSetFindOpenValenceVector(const CoordSet*, int atm, float* out,
     const float* seek = nullptr, int ignore_atm = -1);
 
-typedef struct _CCoordSetUpdateThreadInfo CCoordSetUpdateThreadInfo;
-
-void CoordSetUpdateThread(CCoordSetUpdateThreadInfo * T);
-
 void LabPosTypeCopy(const LabPosType * src, LabPosType * dst);
 void RefPosTypeCopy(const RefPosType * src, RefPosType * dst);
 
@@ -30,6 +30,7 @@ Z* -------------------------------------------------------------------
 #include"Ortho.h"
 #include"Util.h"
 #include"Matrix.h"
+#include"Ray.h"
 #include"Scene.h"
 #include"P.h"
 #include"PConv.h"
@@ -49,6 +50,8 @@ Z* -------------------------------------------------------------------
 #include "MolV3000.h"
 #include "HydrogenAdder.h"
 #include "Feedback.h"
+#include "TaskGraph.h"
+#include "GridSurface.h"
 
 #ifdef _WEBGL
 #endif
@@ -62,7 +65,9 @@ Z* -------------------------------------------------------------------
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <vector>
@@ -8689,6 +8694,9 @@ int ObjectMoleculeMerge(ObjectMolecule * I, pymol::vla<AtomInfoType>&& ai,
   const auto oldNAtom = I->NAtom;
   const auto oldNBond = I->NBond;
 
+  /* matched atoms take the identifiers of the loaded ones */
+  ++I->LexGeneration;
+
   /* first, sort the coodinate set */
 
   index = AtomInfoGetSortedIndex(G, I, ai, n_index, &outdex);
@@ -10364,6 +10372,21 @@ bool ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
       }
     }
 
+    /* interned identifiers may have changed, see SelectorGetLexPostings */
+    switch (op->code) {
+    case OMOP_LABL:
+      ++I->LexGeneration;
+      break;
+    case OMOP_ALTR:
+      if(!op->i2)
+        ++I->LexGeneration;
+      break;
+    case OMOP_AlterState:
+      if(!op->i3)
+        ++I->LexGeneration;
+      break;
+    }
+
     /* always run on exit... */
     switch (op->code) {
     case OMOP_LABL:
@@ -10481,54 +10504,12 @@ int ObjectMolecule::getNFrame() const
   return NCSet;
 }
 
-struct _CCoordSetUpdateThreadInfo {
-  CoordSet *cs;
-  int a;
-};
-
-void CoordSetUpdateThread(CCoordSetUpdateThreadInfo * T)
-{
-  if(T->cs) {
-    T->cs->update(T->a);
-  }
-}
-
-#ifndef _PYMOL_NOPY
-static void ObjMolCoordSetUpdateSpawn(PyMOLGlobals * G,
-                                      CCoordSetUpdateThreadInfo * Thread, int n_thread,
-                                      int n_total)
-{
-  if(n_total == 1) {
-    CoordSetUpdateThread(Thread);
-  } else if(n_total) {
-    int blocked;
-    PyObject *info_list;
-    int a, n = 0;
-    blocked = PAutoBlock(G);
-
-    PRINTFB(G, FB_Scene, FB_Blather)
-      " Scene: updating coordinate sets with %d threads...\n", n_thread ENDFB(G);
-    info_list = PyList_New(n_total);
-    for(a = 0; a < n_total; a++) {
-      PyList_SetItem(info_list, a, PyCapsule_New(Thread + a, nullptr, nullptr));
-      n++;
-    }
-    PXDecRef(PYOBJECT_CALLMETHOD
-             (G->P_inst->cmd, "_coordset_update_spawn", "Oi", info_list, n_thread));
-    Py_DECREF(info_list);
-    PAutoUnblock(G, blocked);
-  }
-}
-#endif
-
-
 /*========================================================================*/
-void ObjectMolecule::update()
+/**
+ * Refresh the representation cache and get the range of states to update
+ */
+static void ObjectMoleculeGetUpdateRange(ObjectMolecule * I, int *start, int *stop)
 {
-  auto I = this;
-  int a; /*, ok; */
-
-  OrthoBusyPrime(G);
   /* if the cached representation is invalid, reset state */
   if(!I->RepVisCacheValid) {
     /* note which representations are active */
@@ -10536,7 +10517,7 @@ void ObjectMolecule::update()
     if(I->NCSet > 1) {
       const AtomInfoType *ai = I->AtomInfo.data();
       I->RepVisCache = 0;
-      for(a = 0; a < I->NAtom; a++) {
+      for(int a = 0; a < I->NAtom; a++) {
         I->RepVisCache |= ai->visRep;
         ai++;
       }
@@ -10547,75 +10528,115 @@ void ObjectMolecule::update()
     }
     I->RepVisCacheValid = true;
   }
-  {
-    /* determine the start/stop states */
-    int start = 0;
-    int stop = I->NCSet;
-    /* set start and stop given an object */
-    ObjectAdjustStateRebuildRange(I, &start, &stop);
-    if((I->NCSet == 1)
-       && (SettingGet_b(G, I->Setting.get(), NULL, cSetting_static_singletons))) {
-      start = 0;
-      stop = 1;
+
+  /* determine the start/stop states */
+  *start = 0;
+  *stop = I->NCSet;
+  /* set start and stop given an object */
+  ObjectAdjustStateRebuildRange(I, start, stop);
+  if((I->NCSet == 1)
+     && (SettingGet_b(I->G, I->Setting.get(), NULL, cSetting_static_singletons))) {
+    *start = 0;
+    *stop = 1;
+  }
+  if(*stop > I->NCSet)
+    *stop = I->NCSet;
+}
+
+/*========================================================================*/
+/**
+ * Every (state, representation) build is a separate task, so a single
+ * large state builds on all threads. All builds depend on the neighbor
+ * array (needed by cartoons and ribbons), the per-state post-processing
+ * depends on all builds of that state and runs on the calling thread.
+ */
+void ObjectMolecule::addUpdateTasks(pymol::TaskGraph& graph)
+{
+  int start, stop;
+  ObjectMoleculeGetUpdateRange(this, &start, &stop);
+
+  auto neighbors = graph.add([this] { getNeighborArray(); });
+
+  for(int a = start; a < stop; a++) {
+    CoordSet* cs = CSet[a];
+    if(!cs)
+      continue;
+
+    // surface cache (cache_mode) calls into Python
+    bool surface_main_thread = SettingGet_i(G, cs->Setting.get(),
+        Setting.get(), cSetting_cache_mode) > 0;
+
+    auto new_rep = std::make_shared<std::atomic<bool>>(false);
+    std::vector<pymol::TaskGraph::TaskId> builds;
+
+    for(auto rep : CoordSet::RepBuildOrder) {
+      if(!cs->Active[rep])
+        continue;
+      builds.push_back(graph.add([cs, rep, a, new_rep] {
+        if(cs->updateRep(rep, a))
+          *new_rep = true;
+      }, {neighbors}, rep == cRepSurface && surface_main_thread));
     }
-    if(stop > I->NCSet)
-      stop = I->NCSet;
 
-    /* single and multithreaded coord set updates */
-    {
-#ifndef _PYMOL_NOPY
-      int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
-      int multithread = SettingGetGlobal_i(G, cSetting_async_builds);
+    graph.add([this, cs, a, new_rep] {
+      PRINTFB(G, FB_ObjectMolecule, FB_Blather)
+        " ObjectMolecule-DEBUG: updated representations for state %d of \"%s\".\n",
+        a + 1, Name ENDFB(G);
+      if(*new_rep)
+        SceneInvalidatePicking(G);
+      cs->updateFinish();
+    }, builds, true);
+  }
+}
 
-      if(multithread && (n_thread) && (stop - start) > 1) {
-        int cnt = 0;
+/*========================================================================*/
+void ObjectMolecule::update()
+{
+  auto I = this;
+  int a; /*, ok; */
 
-        /* must precalculate to avoid race-condition since this isn't
-           mutexed yet and neighbors are needed by cartoons */
-        this->getNeighborArray();
+  OrthoBusyPrime(G);
 
-        for(a = start; a < stop; a++)
-          if((a<I->NCSet) && I->CSet[a])
-            cnt++;
-        {
-          CCoordSetUpdateThreadInfo *thread_info = pymol::malloc<CCoordSetUpdateThreadInfo>(cnt);
-          if(thread_info) {
-            cnt = 0;
-            for(a = start; a < stop; a++) {
-              if((a<I->NCSet) && I->CSet[a]) {
-                thread_info[cnt].cs = I->CSet[a];
-                thread_info[cnt].a = a;
-                cnt++;
-              }
-            }
-            ObjMolCoordSetUpdateSpawn(G, thread_info, n_thread, cnt);
-            FreeP(thread_info);
-          }
+  int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
+  int multithread = SettingGetGlobal_i(G, cSetting_async_builds);
 
-        }
+  if(multithread && (n_thread > 1)) {
+    /* multithreaded coord set updates */
+    pymol::TaskGraph graph;
+    addUpdateTasks(graph);
+    graph.run(n_thread);
+  } else {
+    /* single thread */
+    int start, stop;
+    ObjectMoleculeGetUpdateRange(I, &start, &stop);
 
-      } else
-#endif
-      {                         /* single thread */
-        for(a = start; a < stop; a++) {
-          if((a<I->NCSet) && I->CSet[a] && (!G->Interrupt)) {
-	    /* status bar */
-            OrthoBusySlow(G, a, I->NCSet);
-            PRINTFB(G, FB_ObjectMolecule, FB_Blather)
-              " ObjectMolecule-DEBUG: updating representations for state %d of \"%s\".\n",
-              a + 1, I->Name ENDFB(G);
-            I->CSet[a]->update(a);
-          }
-        }
+    for(a = start; a < stop; a++) {
+      if((a<I->NCSet) && I->CSet[a] && (!G->Interrupt)) {
+        /* status bar */
+        OrthoBusySlow(G, a, I->NCSet);
+        PRINTFB(G, FB_ObjectMolecule, FB_Blather)
+          " ObjectMolecule-DEBUG: updating representations for state %d of \"%s\".\n",
+          a + 1, I->Name ENDFB(G);
+        I->CSet[a]->update(a);
       }
     }
-  } /* end block */
+  }
 
   PRINTFD(G, FB_ObjectMolecule)
     " ObjectMolecule: updates complete for object %s.\n", I->Name ENDFD;
 }
 
 /*========================================================================*/
+/*
+ * Unique value for ObjectMolecule::AtomGeneration. Never repeats, so a
+ * new object at the address of a deleted one can't be mistaken for it.
+ */
+static unsigned ObjectMoleculeNextAtomGeneration()
+{
+  static std::atomic<unsigned> generation{0};
+  return ++generation;
+}
+
 void ObjectMolecule::invalidate(cRep_t rep, cRepInv_t level, int state)
 {
   auto I = this;
@@ -10646,6 +10667,7 @@ void ObjectMolecule::invalidate(cRep_t rep, cRepInv_t level, int state)
       DeleteP(I->Sculpt);
     }
     if(level >= cRepInvAtoms) {
+      I->AtomGeneration = ObjectMoleculeNextAtomGeneration();
       SelectorUpdateObjectSele(I->G, I);
     }
   }
@@ -11001,6 +11023,102 @@ int ObjectMoleculeSetAtomVertex(ObjectMolecule * I, int state, int index, float
 }
 
 
+/*========================================================================*/
+/**
+ * Rigid body invariants of a coordinate set: radius of gyration and the
+ * distances of a few sentinel atoms from the centroid. Copies which differ
+ * in these can't be superposed, so they are rejected before fitting.
+ */
+struct RigidCopyKey {
+  static const int cNSentinel = 4;
+  float rg = 0.0F;
+  float dist[cNSentinel] = {};
+
+  explicit RigidCopyKey(const CoordSet * cs)
+  {
+    const int n = cs->NIndex;
+    if(!n)
+      return;
+
+    double sum[3] = {0.0, 0.0, 0.0};
+    for(int idx = 0; idx < n; idx++) {
+      const float *v = cs->coordPtr(idx);
+      sum[0] += v[0];
+      sum[1] += v[1];
+      sum[2] += v[2];
+    }
+    const float center[3] = {float(sum[0] / n), float(sum[1] / n),
+                             float(sum[2] / n)};
+
+    double sumsq = 0.0;
+    for(int idx = 0; idx < n; idx++) {
+      sumsq += diffsq3f(cs->coordPtr(idx), center);
+    }
+    rg = float(sqrt(sumsq / n));
+
+    for(int a = 0; a < cNSentinel; a++) {
+      dist[a] = diff3f(cs->coordPtr(a * (n - 1) / (cNSentinel - 1)), center);
+    }
+  }
+
+  /**
+   * @param tolerance per-atom tolerance of the fit
+   */
+  bool matches(const RigidCopyKey& other, float tolerance) const
+  {
+    /* a copy within `tolerance` per atom moves the centroid by at most
+       `tolerance`, so all invariants are within twice the tolerance */
+    const float limit = 2.0F * tolerance + R_SMALL4;
+    if(fabsf(rg - other.rg) > limit)
+      return false;
+    for(int a = 0; a < cNSentinel; a++) {
+      if(fabsf(dist[a] - other.dist[a]) > limit)
+        return false;
+    }
+    return true;
+  }
+};
+
+static const float cRigidCopyTolerance = 0.001F;
+
+/*========================================================================*/
+/**
+ * Get the rigid body transformation (row-major 4x4) which maps `proto` onto
+ * `cs`, if both have the same atoms and representations (e.g. the copies of
+ * a biological assembly, see ObjectMoleculeSetAssemblyCSets).
+ */
+static bool CoordSetGetRigidCopyMatrix(const CoordSet * proto,
+                                       const CoordSet * cs, float *matrix)
+{
+  const float tolerance = cRigidCopyTolerance;
+  float ttt[16], v[3];
+
+  if(!cs->NIndex || cs->IdxToAtm != proto->IdxToAtm)
+    return false;
+
+  /* state settings may change the geometry */
+  if(cs->Setting || proto->Setting || cs->has_any_atom_state_settings() ||
+     proto->has_any_atom_state_settings())
+    return false;
+
+  for(int a = 0; a < cRepCnt; a++) {
+    if(!cs->Active[a] != !proto->Active[a] || !cs->Rep[a] != !proto->Rep[a])
+      return false;
+  }
+
+  MatrixFitRMSTTTf(cs->G, cs->NIndex, cs->Coord.data(), proto->Coord.data(),
+                   NULL, ttt);
+
+  for(int idx = 0; idx < cs->NIndex; idx++) {
+    transformTTT44f3f(ttt, proto->coordPtr(idx), v);
+    if(diffsq3f(v, cs->coordPtr(idx)) > tolerance * tolerance)
+      return false;
+  }
+
+  convertTTTfR44f(ttt, matrix);
+  return true;
+}
+
 /*========================================================================*/
 void ObjectMolecule::render(RenderInfo * info)
 {
@@ -11016,9 +11134,57 @@ void ObjectMolecule::render(RenderInfo * info)
 
   ObjectPrepareContext(I, info);
 
-  for(StateIterator iter(G, I->Setting.get(), state, I->NCSet); iter.next();) {
+  StateIterator iter(G, I->Setting.get(), state, I->NCSet);
+
+  /* ray tracing multiple states: rigid copies of a state which has already
+     been rendered are traced as instances of it (see ray_instancing) */
+  struct RigidCopyProto {
+    const CoordSet *cs;
+    int id;
+    RigidCopyKey key;
+  };
+  std::vector<RigidCopyProto> protos;
+  bool instancing = info->ray && !use_matrices && iter.isMultistate();
+
+  /* bound the fitting work on trajectories which aren't rigid copies */
+  const int max_fits = 4;   // full superpositions per state
+  const int max_misses = 8; // consecutive states without a copy
+  int n_miss = 0;
+
+  while(iter.next()) {
     cs = I->CSet[iter.state];
     if(cs) {
+      if(instancing) {
+        float matrix[16];
+        bool done = false;
+        int n_fit = 0;
+        RigidCopyKey key(cs);
+        for(auto &proto : protos) {
+          if(proto.cs->NIndex != cs->NIndex ||
+             !proto.key.matches(key, cRigidCopyTolerance))
+            continue;
+          if(n_fit++ == max_fits)
+            break;
+          if(CoordSetGetRigidCopyMatrix(proto.cs, cs, matrix) &&
+             info->ray->instance(proto.id, matrix)) {
+            done = true;
+            break;
+          }
+        }
+        if(done) {
+          n_miss = 0;
+        } else {
+          int id = info->ray->instanceBegin();
+          cs->render(info);
+          if(id >= 0 && info->ray->instanceEnd())
+            protos.push_back({cs, id, key});
+          if(++n_miss == max_misses) {
+            /* most likely a trajectory, not an assembly */
+            instancing = false;
+          }
+        }
+        continue;
+      }
       if(use_matrices)
         pop_matrix = ObjectStatePushAndApplyMatrix(cs, info);
       cs->render(info);
@@ -11070,6 +11236,7 @@ ObjectMolecule::ObjectMolecule(PyMOLGlobals * G, int discreteFlag) : pymol::CObj
   auto I = this;
   int a;
   I->type = cObjectMolecule;
+  I->AtomGeneration = ObjectMoleculeNextAtomGeneration();
   I->CSet = pymol::vla<CoordSet*>(10); /* auto-zero */
   I->DiscreteFlag = discreteFlag;
   if(I->DiscreteFlag) {         /* discrete objects don't share atoms between states */
@@ -11085,6 +11252,7 @@ ObjectMolecule::ObjectMolecule(PyMOLGlobals * G, int discreteFlag) : pymol::CObj
     I->UndoState[a] = -1;
   }
   I->UndoIter = 0;
+  I->SurfaceGridCache = std::make_shared<pymol::GridSurfaceCache>();
 }
 
 
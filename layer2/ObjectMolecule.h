@@ -38,6 +38,12 @@ Z* -------------------------------------------------------------------
 #ifdef _WEBGL
 #endif
 
+namespace pymol
+{
+class GridSurfaceCache;
+class TaskGraph;
+}
+
 #define cKeywordAll "all"
 #define cKeywordNone "none"
 #define cKeywordSame "same"
@@ -75,6 +81,8 @@ struct ObjectMolecule : public pymol::CObject {
   /* proposed, for storing uniform trajectory data more efficiently:
      int *UniformAtmToIdx, *UniformIdxToAtm;  */
   int SeleBase = 0;                 /* for internal usage by  selector & only valid during selection process */
+  unsigned AtomGeneration = 0;      /* unique, changes when atoms are added, removed or reordered (cRepInvAtoms) */
+  unsigned LexGeneration = 0;       /* changes when interned atom identifiers (resn, chain, label, ...) are altered */
   pymol::copyable_ptr<CSymmetry> Symmetry;
 #if 1
   // legacy undo
@@ -103,6 +111,9 @@ public:
   // hetatm and ignore-flag by non-polymer classification
   bool need_hetatm_classification = false;
 
+  // surface patches of all states for surface_method 1, shared with copies
+  std::shared_ptr<pymol::GridSurfaceCache> SurfaceGridCache;
+
   // methods
   ObjectMolecule(PyMOLGlobals* G, int discreteFlag);
   ~ObjectMolecule();
@@ -114,6 +125,9 @@ public:
   CoordSet* getCoordSet(int state);
   const CoordSet* getCoordSet(int state) const;
 
+  /// Add the representation builds of update() to `graph`
+  void addUpdateTasks(pymol::TaskGraph& graph);
+
   // virtual methods
   void update() override;
   void render(RenderInfo* info) override;
@@ -41,6 +41,12 @@ Z* -------------------------------------------------------------------
 #include"ShaderMgr.h"
 #include"Rep.h"
 #include"CoordSet.h"
+#include"ThreadPool.h"
+#include"GridSurface.h"
+#include"Editor.h"
+
+#include <algorithm>
+#include <vector>
 
 #ifdef NT
 #undef NT
@@ -150,7 +156,7 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
                                  int surface_solvent, int cavity_cull,
                                  int all_visible_flag, float max_vdw,
                                  int cavity_mode, float cavity_radius, 
-                                 float cavity_cutoff);
+                                 float cavity_cutoff, int n_thread);
 
 static void SolventDotFree(SolventDot * I)
 {
@@ -162,6 +168,37 @@ static void SolventDotFree(SolventDot * I)
   DeleteP(I);
 }
 
+#define cSurfaceAtomChunkSize 256
+#define cSurfaceDotChunkSize 1024
+
+/**
+ * Threads for one surface calculation: max_threads, or the share of the
+ * task graph's workers if the surface is built in a task (several reps in
+ * parallel), which would otherwise multiply the thread count.
+ */
+static int SurfaceThreadCount(PyMOLGlobals * G)
+{
+  return pymol::ThreadPoolBudget(SettingGetGlobal_i(G, cSetting_max_threads));
+}
+
+/**
+ * Calls `func(worker, chunk, begin, end)` for chunks of [0, n) on up to
+ * `n_thread` threads. Callers keep per-chunk results and merge them in chunk
+ * order afterwards, so the surface doesn't depend on the number of threads.
+ * Only worker 0 may report progress.
+ */
+template <typename Func>
+static void SurfaceParallelFor(int n_thread, int n, int chunk_size, Func&& func)
+{
+  const int n_chunk = (n + chunk_size - 1) / chunk_size;
+  n_thread = std::max(1, std::min(n_thread, n_chunk));
+
+  pymol::ThreadPoolRunTasks(n_thread, n_chunk, [&](int worker, size_t c) {
+    const int begin = int(c) * chunk_size;
+    func(worker, c, begin, std::min(n, begin + chunk_size));
+  });
+}
+
 #ifndef PURE_OPENGL_ES_2
 static
 void immediate_draw_masked_vertices(
@@ -2898,6 +2935,10 @@ struct SurfaceJob {
   float cavityRadius{};
   float cavityCutoff{};
 
+  int surfaceMethod{};
+  std::shared_ptr<pymol::GridSurfaceCache> gridCache;
+  int nThread = 1; // see SurfaceThreadCount
+
   /* results */
   float* V{};
   float* VN{};
@@ -2970,7 +3011,7 @@ OV_INLINE SurfaceJobAtomInfo *SurfaceJobAtomInfoVLAFromPyTuple(PyObject * tuple)
 
 OV_INLINE PyObject *SurfaceJobInputAsTuple(PyMOLGlobals * G, SurfaceJob * I)
 {
-  PyObject *result = PyTuple_New(24);
+  PyObject *result = PyTuple_New(25);
   if(result) {
     PyTuple_SetItem(result, 0, PyString_FromString("SurfaceJob"));
     PyTuple_SetItem(result, 1, PyInt_FromLong(1));      /* version */
@@ -2997,6 +3038,7 @@ OV_INLINE PyObject *SurfaceJobInputAsTuple(PyMOLGlobals * G, SurfaceJob * I)
     PyTuple_SetItem(result, 21, PyInt_FromLong(I->cavityMode));
     PyTuple_SetItem(result, 22, PyFloat_FromDouble(I->cavityRadius));
     PyTuple_SetItem(result, 23, PyFloat_FromDouble(I->cavityCutoff));
+    PyTuple_SetItem(result, 24, PyInt_FromLong(I->surfaceMethod));
     
   }
   return result;
@@ -3320,27 +3362,30 @@ static int SurfaceJobAtomProximityCleanupPass(PyMOLGlobals * G, SurfaceJob * I,
   MapType *map =
     MapNewFlagged(G, I->maxVdw + probe_radius, I_coord, n_index, NULL,
 		  present_vla);
-  int a;
-  float *v;
   CHECKOK(ok, map);
   if (ok)
     ok &= MapSetupExpress(map);
-  v = I->V;
-  for(a = 0; ok && a < I->N; a++) {
-    int i = *(MapLocusEStart(map, v));
-    if(i && map->EList) {
-      int j = map->EList[i++];
-      while(j >= 0) {
-	SurfaceJobAtomInfo *atom_info = I_atom_info + j;
-	if((!present_vla) || present_vla[j]) {
-	  if(within3f(I_coord + 3 * j, v, atom_info->vdw + cutoff)) {
-	    dot_flag[a] = true;
-	  }
-	}
-	j = map->EList[i++];
+  if (ok) {
+    /* independent per dot */
+    SurfaceParallelFor(I->nThread, I->N, cSurfaceDotChunkSize,
+        [&](int worker, size_t c, int begin, int end) {
+      for(int a = begin; a < end && !G->Interrupt; a++) {
+        const float *v = I->V + 3 * a;
+        int i = *(MapLocusEStart(map, v));
+        if(i && map->EList) {
+          int j = map->EList[i++];
+          while(j >= 0) {
+            SurfaceJobAtomInfo *atom_info = I_atom_info + j;
+            if((!present_vla) || present_vla[j]) {
+              if(within3f(I_coord + 3 * j, v, atom_info->vdw + cutoff)) {
+                dot_flag[a] = true;
+              }
+            }
+            j = map->EList[i++];
+          }
+        }
       }
-    }
-    v += 3;
+    });
     ok &= !G->Interrupt;
   }
   MapFree(map);
@@ -3429,46 +3474,58 @@ static int SurfaceJobRefineAddNewVerticesCheckPoint(SurfaceJob * I, MapType *map
 static int SurfaceJobRefineAddNewVertices(PyMOLGlobals * G, SurfaceJob * I){
   int ok = true;
   float point_sep = I->pointSep;
-  int n_new = 0;
   float neighborhood = 2.6 * point_sep; /* these constants need more tuning... */
   float insert_cutoff = 1.1 * point_sep;
   float map_cutoff = neighborhood;
-  float *new_dot = VLAlloc(float, 1000);
-  float *v, *vn;
   if(map_cutoff < (2.9 * point_sep)) {  /* these constants need more tuning... */
     map_cutoff = 2.9 * point_sep;
   }
   {
     MapType *map = NULL;
-    int a;
     map = MapNew(G, map_cutoff, I->V, I->N, NULL);
     CHECKOK(ok, map);
     if (ok)
       ok &= MapSetupExpress(map);
-    v = I->V;
-    vn = I->VN;
-    for(a = 0; ok && a < I->N; a++) {
-      int i = *(MapLocusEStart(map, v));
-      if(i && map->EList) {
-	int j = map->EList[i++];
-	while(ok && j >= 0) {
-	  if(j > a) {
-	    SurfaceJobRefineAddNewVerticesCheckPoint(I, map, &n_new, &new_dot, j, v, vn, map_cutoff, neighborhood, insert_cutoff);
-	  }
-	  j = map->EList[i++];
-	  ok &= !G->Interrupt;
-	}
+    if (ok) {
+      /* new points per chunk of dots, appended in chunk order */
+      const int n_chunk = (I->N + cSurfaceDotChunkSize - 1) / cSurfaceDotChunkSize;
+      std::vector<float*> chunk_dot(n_chunk);
+      std::vector<int> chunk_n_new(n_chunk, 0), chunk_ok(n_chunk, true);
+
+      SurfaceParallelFor(I->nThread, I->N, cSurfaceDotChunkSize,
+          [&](int worker, size_t c, int begin, int end) {
+        float *new_dot = VLAlloc(float, 1000);
+        int ok = new_dot != NULL;
+        for(int a = begin; ok && a < end; a++) {
+          float *v = I->V + 3 * a;
+          float *vn = I->VN + 3 * a;
+          int i = *(MapLocusEStart(map, v));
+          if(i && map->EList) {
+            int j = map->EList[i++];
+            while(ok && j >= 0) {
+              if(j > a) {
+                ok = SurfaceJobRefineAddNewVerticesCheckPoint(I, map, &chunk_n_new[c], &new_dot, j, v, vn, map_cutoff, neighborhood, insert_cutoff);
+              }
+              j = map->EList[i++];
+              ok &= !G->Interrupt;
+            }
+          }
+          ok &= !G->Interrupt;
+        }
+        chunk_dot[c] = new_dot;
+        chunk_ok[c] = ok;
+      });
+
+      for(int c = 0; c < n_chunk; c++) {
+        ok &= chunk_ok[c];
+        if(ok && chunk_n_new[c]) {
+          ok = SurfaceJobRefineCopyNewPoints(I, chunk_dot[c], chunk_n_new[c]);
+        }
+        VLAFreeP(chunk_dot[c]);
       }
-      v += 3;
-      vn += 3;
-      ok &= !G->Interrupt;
     }
     MapFree(map);
   }
-  if(ok && n_new) {
-    ok = SurfaceJobRefineCopyNewPoints(I, new_dot, n_new);
-  }
-  VLAFreeP(new_dot);
   return ok;
 }
 
@@ -3566,6 +3623,77 @@ static void SurfaceJobSetProbeRadius(int surface_type, float point_sep,
   *probe_rad_less2 = (*probe_rad_less) * (*probe_rad_less);
 }
 
+/**
+ * surface_method 1: contour a distance field on a grid with spacing
+ * pointSep, instead of placing and triangulating dots
+ */
+static int SurfaceJobRunGrid(PyMOLGlobals * G, SurfaceJob * I)
+{
+  int ok = true;
+  int n_coord = VLAGetSize(I->coord) / 3;
+  std::vector<float> vdw(n_coord);
+  pymol::GridSurfaceParams params;
+  pymol::GridSurfaceMesh mesh;
+
+  for(int a = 0; a < n_coord; a++)
+    vdw[a] = I->atomInfo[a].vdw;
+
+  params.probe_radius = I->probeRadius;
+  params.spacing = I->pointSep;
+  params.solvent_accessible = I->surfaceSolvent;
+  if((I->cavityMode != 1) && (I->probeRadius > 0.75F) && (!I->surfaceSolvent))
+    params.cavity_cull = I->cavityCull;
+  params.n_thread = I->nThread;
+  params.interrupt = &G->Interrupt;
+  params.cache = I->gridCache.get();
+
+  OrthoBusyFast(G, 1, 5);
+  ok = pymol::GridSurfaceGenerate(I->coord, vdw.data(), I->presentVla,
+                                  n_coord, params, mesh);
+
+  if(ok) {
+    I->N = mesh.vertexCount();
+    I->V = VLAlloc(float, mesh.v.size() + 1);
+    CHECKOK(ok, I->V);
+    if(ok)
+      I->VN = VLAlloc(float, mesh.vn.size() + 1);
+    CHECKOK(ok, I->VN);
+    if(ok) {
+      std::copy(mesh.v.begin(), mesh.v.end(), I->V);
+      std::copy(mesh.vn.begin(), mesh.vn.end(), I->VN);
+    }
+  }
+
+  if(ok && I->surfaceType != 1) {       /* not a dot surface... */
+    I->NT = mesh.triangleCount();
+    I->T = VLAlloc(int, mesh.tri.size() + 1);
+    CHECKOK(ok, I->T);
+    if(ok)
+      I->S = VLAlloc(int, I->NT * 4 + 1);
+    CHECKOK(ok, I->S);
+    if(ok) {
+      /* one strip per triangle */
+      int *s = I->S;
+      std::copy(mesh.tri.begin(), mesh.tri.end(), I->T);
+      for(int a = 0; a < I->NT; a++) {
+        *(s++) = 1;
+        s = std::copy_n(I->T + a * 3, 3, s);
+      }
+      *s = 0;
+    }
+  }
+
+  PRINTFB(G, FB_RepSurface, FB_Blather)
+    " RepSurface: %i surface points, %i triangles (grid, %d of %d patches reused).\n",
+    I->N, I->NT, (int) mesh.n_brick_reused, (int) mesh.n_brick ENDFB(G);
+
+  OrthoBusyFast(G, 4, 5);
+
+  if(!ok)
+    SurfaceJobPurgeResult(G, I);
+  return ok;
+}
+
 static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
 {
   int ok = true;
@@ -3576,6 +3704,12 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
 
   SurfaceJobPurgeResult(G, I);
 
+  /* taken once, the share of a task may change while the surface is built */
+  I->nThread = SurfaceThreadCount(G);
+
+  if(I->surfaceMethod == 1)
+    return SurfaceJobRunGrid(G, I);
+
   {
     /* compute limiting storage requirements */
     int tmp = n_present;
@@ -3621,7 +3755,8 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
                             ssp, present_vla,
                             circumscribe, I->surfaceMode, I->surfaceSolvent,
                             I->cavityCull, I->allVisibleFlag, I->maxVdw,
-                            I->cavityMode, I->cavityRadius, I->cavityCutoff);
+                            I->cavityMode, I->cavityRadius, I->cavityCutoff,
+                            I->nThread);
     CHECKOK(ok, sol_dot);
     ok &= !G->Interrupt;
     if(ok) {
@@ -3664,7 +3799,6 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
 	    ok &= map->EList && solv_map->EList;
             if(sol_dot->nDot && ok) {
               Vector3f *dot = pymol::malloc<Vector3f>(sp->nDot);
-              float *v0, *n0;
 	      CHECKOK(ok, dot);
               if (ok){
                 int b;
@@ -3672,46 +3806,63 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
                   scale3f(sp->dot[b], probe_radius, dot[b]);
                 }
               }
-              v0 = sol_dot->dot;
-              n0 = sol_dot->dotNormal;
               if (ok) {
-                int a, b;
-                int sp_nDot = sp->nDot;
-                for(a = 0; ok && a < sol_dot->nDot; a++) {
-                  if(sol_dot->dotCode[a] || (surface_type < 6)) {     /* surface type 6 is completely scribed */
-                    OrthoBusyFast(G, a + sol_dot->nDot * 2, sol_dot->nDot * 5); /* 2/5 to 3/5 */
-                    for(b = 0; ok && b < sp_nDot; b++) {
-                      float *dot_b = dot[b];
-                      v[0] = v0[0] + dot_b[0];
-                      v[1] = v0[1] + dot_b[1];
-                      v[2] = v0[2] + dot_b[2];
-                      {
+                const int n_dot = sol_dot->nDot;
+                const int n_chunk = (n_dot + cSurfaceDotChunkSize - 1) / cSurfaceDotChunkSize;
+                std::vector<std::vector<float>> chunk_v(n_chunk), chunk_vn(n_chunk);
+                std::vector<int> chunk_ok(n_chunk, true);
+
+                SurfaceParallelFor(I->nThread, n_dot, cSurfaceDotChunkSize,
+                    [&](int worker, size_t c, int begin, int end) {
+                  auto& cv = chunk_v[c];
+                  auto& cvn = chunk_vn[c];
+                  int ok = true;
+                  for(int a = begin; ok && a < end; a++) {
+                    if(sol_dot->dotCode[a] || (surface_type < 6)) {     /* surface type 6 is completely scribed */
+                      const float *v0 = sol_dot->dot + 3 * a;
+                      if(!worker)
+                        OrthoBusyFast(G, a + n_dot * 2, n_dot * 5); /* 2/5 to 3/5 */
+                      for(int b = 0; ok && b < sp->nDot; b++) {
+                        float v[3];
                         int flag = true;
-			SurfaceJobCheckInteriorSolventSurface(solv_map, v, sol_dot, probe_rad_less, probe_rad_less2, a, &flag);
+                        add3f(v0, dot[b], v);
+                        SurfaceJobCheckInteriorSolventSurface(solv_map, v, sol_dot, probe_rad_less, probe_rad_less2, a, &flag);
                         /* at this point, we have points on the interior of the solvent surface,
                            so now we need to further trim that surface to cover atoms that are present */
                         if(flag) {
-			  SurfaceJobCheckPresentAndWithin(map, I, present_vla, v, probe_rad_more, &flag);
+                          SurfaceJobCheckPresentAndWithin(map, I, present_vla, v, probe_rad_more, &flag);
                           if(!flag) {   /* compute the normals */
-                            vn[0] = -sp->dot[b][0];
-                            vn[1] = -sp->dot[b][1];
-                            vn[2] = -sp->dot[b][2];
-                              I->N++;
-			    VLACheck(I->V, float, 3 * (I->N + 1));
-			    VLACheck(I->VN, float, 3 * (I->N + 1));
-			      CHECKOK(ok, I->V);
-			      CHECKOK(ok, I->VN);
-			    v = I->V + I->N * 3;
-			    vn = I->VN + I->N * 3;
+                            cv.insert(cv.end(), v, v + 3);
+                            cvn.push_back(-sp->dot[b][0]);
+                            cvn.push_back(-sp->dot[b][1]);
+                            cvn.push_back(-sp->dot[b][2]);
                           }
                         }
+                        ok &= !G->Interrupt;
                       }
-		      ok &= !G->Interrupt;
                     }
+                    ok &= !G->Interrupt;
                   }
-                  v0 += 3;
-                  n0 += 3;
-		  ok &= !G->Interrupt;
+                  chunk_ok[c] = ok;
+                });
+
+                /* append in chunk order */
+                size_t n_new = 0;
+                for(int c = 0; c < n_chunk; c++) {
+                  ok &= chunk_ok[c];
+                  n_new += chunk_v[c].size() / 3;
+                }
+                if(ok) {
+                  VLACheck(I->V, float, 3 * (I->N + n_new + 1));
+                  CHECKOK(ok, I->V);
+                  if(ok)
+                    VLACheck(I->VN, float, 3 * (I->N + n_new + 1));
+                  CHECKOK(ok, I->VN);
+                }
+                for(int c = 0; ok && c < n_chunk; c++) {
+                  std::copy(chunk_v[c].begin(), chunk_v[c].end(), I->V + 3 * I->N);
+                  std::copy(chunk_vn[c].begin(), chunk_vn[c].end(), I->VN + 3 * I->N);
+                  I->N += chunk_v[c].size() / 3;
                 }
               }
               FreeP(dot);
@@ -3798,7 +3949,7 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
         if((cutoff > probe_radius) && (!I->surfaceSolvent))
           cutoff = probe_radius;
         I->T = TrianglePointsToSurface(G, I->V, I->VN, I->N, cutoff, &I->NT, &I->S, NULL, 
-                                       I->cavityMode);
+                                       I->cavityMode, I->nThread);
 	CHECKOK(ok, I->T);
         PRINTFB(G, FB_RepSurface, FB_Blather)
           " RepSurface: %i triangles.\n", I->NT ENDFB(G);
@@ -3892,6 +4043,19 @@ static void RepSurfaceSetSettings(PyMOLGlobals * G, CoordSet * cs,
     *circumscribe = 0;
 }
 
+/**
+ * True while the coordinates of `obj` change interactively: it is being
+ * sculpted, or dragged (e.g. a torsion) in editing mode. Such surfaces use
+ * surface_edit_method.
+ */
+static bool RepSurfaceIsInteractive(PyMOLGlobals * G, ObjectMolecule * obj)
+{
+  if(obj->Sculpt &&
+     SettingGet_b(G, obj->Setting.get(), NULL, cSetting_sculpting))
+    return true;
+  return EditorDragObject(G) == obj;
+}
+
 static int RepSurfacePrepareSurfaceJob(PyMOLGlobals * G, SurfaceJob *surf_job,
     RepSurface *I, CoordSet *cs, ObjectMolecule *obj, SurfaceJobAtomInfo **atom_info,
     float *carve_vla, int n_present, int *present_vla, int optimize, int sphere_idx,
@@ -3963,6 +4127,17 @@ static int RepSurfacePrepareSurfaceJob(PyMOLGlobals * G, SurfaceJob *surf_job,
     surf_job->surfaceSolvent = SettingGet_b(G, cs->Setting.get(), obj->Setting.get(), cSetting_surface_solvent);
     surf_job->cavityCull = SettingGet_i(G, cs->Setting.get(),
 					obj->Setting.get(), cSetting_cavity_cull);
+    surf_job->surfaceMethod = SettingGet_i(G, cs->Setting.get(),
+					   obj->Setting.get(), cSetting_surface_method);
+    if(surf_job->surfaceMethod == 0 && RepSurfaceIsInteractive(G, obj)) {
+      /* the grid method only recomputes the patches around moved atoms */
+      int edit_method = SettingGet_i(G, cs->Setting.get(),
+                                     obj->Setting.get(), cSetting_surface_edit_method);
+      if(edit_method >= 0)
+        surf_job->surfaceMethod = edit_method;
+    }
+    if(surf_job->surfaceMethod == 1)
+      surf_job->gridCache = obj->SurfaceGridCache;
   }
   return ok;
 }
@@ -4550,6 +4725,66 @@ static int SolventDotGetDotsAroundVertexInSphere(PyMOLGlobals * G, SolventDot *I
   return ok;
 }
 
+/**
+ * SolventDotGetDotsAroundVertexInSphere for all present atoms which don't
+ * share their position with another atom. Atoms are processed in parallel
+ * chunks and the dots are appended in atom order, the result is the same as
+ * with a serial loop over all atoms.
+ */
+static int SolventDotGetDotsAroundAllVertices(PyMOLGlobals * G, SolventDot *I,
+    MapType *map, SurfaceJobAtomInfo * atom_info, float *coord, int n_coord,
+    int *present, SphereRec * sp, float radius, int *dotCnt, int stopDot,
+    float *dotPtr, float *dotNormal, int *nDot, bool progress, int n_thread)
+{
+  int ok = true;
+  const int n_chunk = (n_coord + cSurfaceAtomChunkSize - 1) / cSurfaceAtomChunkSize;
+  std::vector<std::vector<float>> chunk_dot(n_chunk), chunk_normal(n_chunk);
+  std::vector<int> chunk_ok(n_chunk, true);
+
+  SurfaceParallelFor(n_thread, n_coord, cSurfaceAtomChunkSize,
+      [&](int worker, size_t c, int begin, int end) {
+    auto& dot = chunk_dot[c];
+    auto& normal = chunk_normal[c];
+    int capacity = (end - begin) * sp->nDot;
+    int n_dot = 0, cnt = 0, ok = true;
+    dot.resize((capacity + 1) * 3);
+    if(dotNormal)
+      normal.resize(dot.size());
+    for(int a = begin; ok && a < end; a++) {
+      if(progress && !worker)
+        OrthoBusyFast(G, a, n_coord * 5);
+      if((!present) || (present[a])) {
+        int skip_flag = false;
+        ok = SolventDotFilterOutSameXYZ(G, map, atom_info, atom_info + a, coord, a, present, &skip_flag);
+        if(ok && !skip_flag) {
+          ok = SolventDotGetDotsAroundVertexInSphere(G, I, map, atom_info, atom_info + a, coord, a, present, sp, radius, &cnt, capacity, dot.data(), dotNormal ? normal.data() : NULL, &n_dot);
+        }
+      }
+    }
+    // release the worst case capacity, only the merge needs these
+    dot.resize(n_dot * 3);
+    dot.shrink_to_fit();
+    if(dotNormal) {
+      normal.resize(n_dot * 3);
+      normal.shrink_to_fit();
+    }
+    chunk_ok[c] = ok;
+  });
+
+  for(int c = 0; ok && c < n_chunk; c++) {
+    ok = chunk_ok[c];
+    int n_dot = std::min<int>(chunk_dot[c].size() / 3, stopDot - *dotCnt);
+    std::copy_n(chunk_dot[c].data(), n_dot * 3, dotPtr + (*nDot) * 3);
+    if(dotNormal)
+      std::copy_n(chunk_normal[c].data(), n_dot * 3, dotNormal + (*nDot) * 3);
+    *dotCnt += n_dot;
+    *nDot += n_dot;
+    std::vector<float>().swap(chunk_dot[c]);
+    std::vector<float>().swap(chunk_normal[c]);
+  }
+  return ok;
+}
+
 static int SolventDotCircumscribeAroundVertex(PyMOLGlobals * G, SolventDot *I,
     MapType *map, float *vdw, float dist, float *v0, float *v2, int circumscribe,
     SurfaceJobAtomInfo * atom_info, SurfaceJobAtomInfo *a_atom_info,
@@ -4743,7 +4978,7 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
                                  int surface_solvent, int cavity_cull,
                                  int all_visible_flag, float max_vdw,
                                  int cavity_mode, float cavity_radius, 
-                                 float cavity_cutoff)
+                                 float cavity_cutoff, int n_thread)
 {
   int ok = true;
   int stopDot;
@@ -4782,20 +5017,7 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
     if(map && ok) {
       ok &= MapSetupExpress(map);
       if (ok) {
-        int a;
-        int skip_flag;
-        SurfaceJobAtomInfo *a_atom_info = atom_info;
-        for(a = 0; ok && a < n_coord; a++) {
-          OrthoBusyFast(G, a, n_coord * 5);
-          if((!present) || (present[a])) {
-            skip_flag = false;
-	    ok = SolventDotFilterOutSameXYZ(G, map, atom_info, a_atom_info, coord, a, present, &skip_flag);
-            if(ok && !skip_flag) {
-	      ok = SolventDotGetDotsAroundVertexInSphere(G, I, map, atom_info, a_atom_info, coord, a, present, sp, probe_radius, &dotCnt, stopDot, I->dot, I->dotNormal, &I->nDot);
-            }
-          }
-          a_atom_info++;
-        }
+        ok = SolventDotGetDotsAroundAllVertices(G, I, map, atom_info, coord, n_coord, present, sp, probe_radius, &dotCnt, stopDot, I->dot, I->dotNormal, &I->nDot, true, n_thread);
       }
 
       /* for each pair of proximal atoms, circumscribe a circle for their intersection */
@@ -4873,19 +5095,7 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
       if(ok && map) {
         ok &= MapSetupExpress(map);
         if (ok) {
-          int a;
-          int skip_flag;
-          SurfaceJobAtomInfo *a_atom_info = atom_info;
-          for(a = 0; a < n_coord; a++) {
-            if((!present) || (present[a])) {
-              skip_flag = false;
-	      ok = SolventDotFilterOutSameXYZ(G, map, atom_info, a_atom_info, coord, a, present, &skip_flag);
-              if(ok && !skip_flag) {
-		ok = SolventDotGetDotsAroundVertexInSphere(G, I, map, atom_info, a_atom_info, coord, a, present, sp, cavity_radius, &dotCnt, stopDot, cavityDot, NULL, &nCavityDot);
-              }
-            }
-            a_atom_info++;
-          }
+          ok = SolventDotGetDotsAroundAllVertices(G, I, map, atom_info, coord, n_coord, present, sp, cavity_radius, &dotCnt, stopDot, cavityDot, NULL, &nCavityDot, false, n_thread);
         }
       }
       MapFree(map);
@@ -9986,6 +9986,32 @@ pymol::Result<int> ExecutiveSelect(PyMOLGlobals* G, const SelectArgs& sargs,
   return res.result();
 }
 
+/**
+ * cmd.select() for an expression from SelectorCompile (no merge or domain)
+ */
+pymol::Result<int> ExecutiveSelectCompiled(PyMOLGlobals* G, const char* name,
+    const SelectorCompiledPtr& compiled, int enable, int quiet, int state)
+{
+  if (ExecutiveFindObjectByName(G, name)) {
+    return pymol::make_error("name conflicts with an object");
+  }
+
+  auto res = SelectorCreateFromCompiled(G, name, compiled, state, quiet);
+
+  p_return_if_error(res);
+
+  if (enable == 1) {
+    ExecutiveSetObjVisib(G, name, 1, 0);
+  } else if (enable == 0) {
+    ExecutiveSetObjVisib(G, name, 0, 0);
+  }
+
+  SceneInvalidate(G);
+  SeqDirty(G);
+
+  return res.result();
+}
+
 /*========================================================================*/
 pymol::Result<int> ExecutiveSelectList(PyMOLGlobals* G, const char* sele_name,
     const char* oname, const int* list, size_t list_len, int state, int mode,
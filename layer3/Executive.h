@@ -290,6 +290,9 @@ pymol::Result<int> ExecutiveSelect(PyMOLGlobals* G, const SelectArgs& sargs,
     int enable, int quiet, int merge, int state,
     const char* domain);
 
+pymol::Result<int> ExecutiveSelectCompiled(PyMOLGlobals* G, const char* name,
+    const SelectorCompiledPtr& compiled, int enable, int quiet, int state);
+
 pymol::Result<int> ExecutiveSelectList(PyMOLGlobals* G, const char* sele_name,
     const char* oname, const int* list, size_t list_len, int state, int mode,
     int quiet);
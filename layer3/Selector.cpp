@@ -16,7 +16,10 @@ Z* -------------------------------------------------------------------
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <functional>
+#include <limits>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -32,6 +35,7 @@ Z* -------------------------------------------------------------------
 #include"Util.h"
 #include"PConv.h"
 #include"P.h"
+#include"PyMOL.h"
 #include"RingFinder.h"
 #include"AtomIterators.h"
 #include "Feedback.h"
@@ -56,6 +60,9 @@ Z* -------------------------------------------------------------------
 #include"Parse.h"
 
 #include"ListMacros.h"
+#include"Bitset.h"
+#include"RoaringBitmap.h"
+#include "ThreadPool.h"
 
 #ifdef _PYMOL_IP_PROPERTIES
 #endif
@@ -127,11 +134,32 @@ struct EvalElem {
   unsigned int code;
   std::string m_text;
   sele_array_t sele;
+  pymol::Bitset bits;           /* replaces `sele` while packed */
+  bool packed = false;
 
   // Helpers for refactoring `sele` type
   int* sele_data() { return sele.get(); }
-  void sele_free() { sele.reset(); }
-  void sele_calloc(size_t count) { sele_array_calloc(sele, count); }
+  void sele_free() { sele.reset(); bits = pymol::Bitset(); packed = false; }
+  void sele_calloc(size_t count) { sele_array_calloc(sele, count); packed = false; }
+
+  /// Replaces `sele` with bits, unless it has tags other than 0 and 1
+  void pack(size_t count)
+  {
+    packed = sele && bits.assignBool(sele.get(), count);
+    if (packed)
+      sele.reset();
+  }
+
+  /// Restores `sele` from the bits
+  void unpack()
+  {
+    if (packed) {
+      sele.reset(new int[bits.size()]);
+      bits.copyTo(sele.get());
+      bits = pymol::Bitset();
+      packed = false;
+    }
+  }
 
   // TODO replace with pymol::Error handling
   void sele_check_ok(int& ok) { CHECKOK(ok, sele_data()); }
@@ -139,8 +167,43 @@ struct EvalElem {
 
   /// read-only access to text
   const char* text() const { return m_text.c_str(); }
+
+  /// Copy of an operator or operand, without the list
+  EvalElem token() const
+  {
+    EvalElem copy;
+    copy.level = level;
+    copy.imp_op_level = imp_op_level;
+    copy.type = type;
+    copy.code = code;
+    copy.m_text = m_text;
+    return copy;
+  }
+};
+
+/**
+ * Selection expression after tokenizing and keyword lookup, i.e. the
+ * operator stack which SelectorEvaluate reduces to an atom list.
+ *
+ * Nothing in here depends on atoms or coordinates. The only session
+ * dependency is that partial keyword matches lose against selection
+ * names, so those outcomes are recorded and re-checked before reuse.
+ */
+struct SelectorCompiled {
+  std::string expr;
+  std::vector<std::string> word; /* tokens, for error messages */
+  std::vector<EvalElem> Stack;   /* 1..totDepth are used */
+  int totDepth = 0;
+  bool ignore_case = false;
+  std::vector<std::pair<std::string, bool>> name_checks;
 };
 
+/* compiled expressions kept per session */
+#define cSelectorCompiledCacheSize 256
+
+/* table atoms per task of parallel predicate evaluation */
+#define cSelectorChunkSize 32768
+
 typedef struct {
   int depth1;
   int depth2;
@@ -152,6 +215,8 @@ typedef struct {
 
 static pymol::Result<sele_array_t> SelectorSelect(
     PyMOLGlobals* G, const char* sele, int state, SelectorID_t domain, int quiet);
+static pymol::Result<sele_array_t> SelectorSelectCompiled(PyMOLGlobals* G,
+    SelectorCompiledPtr compiled, int state, SelectorID_t domain, int quiet);
 static std::vector<int> SelectorGetInterstateVLA(PyMOLGlobals* G, int sele1,
     int state1, int sele2, int state2, float cutoff);
 
@@ -161,8 +226,9 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state);
 static int SelectorLogic1(PyMOLGlobals * G, EvalElem * base, int state);
 static int SelectorLogic2(PyMOLGlobals * G, EvalElem * base);
 static int SelectorOperator22(PyMOLGlobals * G, EvalElem * base, int state);
+static pymol::Result<> SelectorCompileWords(PyMOLGlobals * G, SelectorCompiled& compiled);
 static pymol::Result<sele_array_t> SelectorEvaluate(
-    PyMOLGlobals* G, std::vector<std::string>& word, int state, int quiet);
+    PyMOLGlobals* G, const SelectorCompiled& compiled, int state, int quiet);
 static std::vector<std::string> SelectorParse(PyMOLGlobals * G, const char *s);
 static void SelectorPurgeMembers(PyMOLGlobals * G, SelectorID_t sele);
 static int SelectorEmbedSelection(PyMOLGlobals * G, const int *atom, pymol::zstring_view name,
@@ -194,23 +260,27 @@ bool SelectorAtomIterator::next() {
 }
 
 /**
- * Add atom `ai` to selection `sele`
+ * Add atom `ai` to selection `sele`. The atom gets its membership key
+ * (AtomInfoType::selEntry) when it's added to its first selection.
  */
 static void SelectorManagerInsertMember(
     CSelectorManager& self, AtomInfoType& ai, int sele, int tag = 1)
 {
-  int m;
-  if (self.FreeMember > 0) {
-    m = self.FreeMember;
-    self.FreeMember = self.Member[m].next;
-  } else {
-    m = self.Member.size();
-    self.Member.emplace_back();
+  if (!ai.selEntry) {
+    if (!self.FreeKeys.empty()) {
+      ai.selEntry = self.FreeKeys.back();
+      self.FreeKeys.pop_back();
+    } else {
+      ai.selEntry = self.NextKey++;
+    }
+  }
+  auto& members = self.Members[sele];
+  members.keys.add(ai.selEntry);
+  if (tag != 1) {
+    members.tags[ai.selEntry] = tag;
+  } else if (!members.tags.empty()) {
+    members.tags.erase(ai.selEntry);
   }
-  self.Member[m].selection = sele;
-  self.Member[m].tag = tag;
-  self.Member[m].next = ai.selEntry;
-  ai.selEntry = m;
 }
 
 /*========================================================================*/
@@ -1466,40 +1536,20 @@ static SelectorInfoIter_t SelectGetInfoIter(
  */
 void SelectorDefragment(PyMOLGlobals * G)
 {
-  CSelector* S = G->Selector;
-  auto I = S->mgr;
-  /* restore new member ordering so that CPU can continue to get good cache hit */
-
-  int n_free = 0;
-  auto m = I->FreeMember;
-  while(m) {
-    n_free++;
-    m = I->Member[m].next;
-  }
-  if(n_free) {
-    std::vector<int> list(n_free);
-    auto l = list.data();
-    auto m = I->FreeMember;
-    while(m) {
-      *(l++) = m;
-      m = I->Member[m].next;
-    }
-    std::sort(list.begin(), list.end());
-    auto NMember = int(I->Member.size()) - 1;
-    while(n_free > 5000) {      /* compact inactive members when possible */
-      if(list[n_free - 1] == NMember) {
-        NMember--;
-        n_free--;
-      } else
-        break;
-    }
-    for(int a = 0; a < (n_free - 1); a++) {
-      I->Member[list[a]].next = list[a + 1];
-    }
-    I->Member[list[n_free - 1]].next = 0;
-    I->FreeMember = list[0];
-    I->Member.resize(NMember + 1);
-  }
+  auto I = G->SelectorMgr;
+  /* hand out low keys first, so that the member bitmaps stay dense */
+  auto& free_keys = I->FreeKeys;
+  std::sort(free_keys.begin(), free_keys.end(), std::greater<>());
+
+  /* compact the key range when possible */
+  std::size_t n_top = 0;
+  while (n_top < free_keys.size() &&
+         free_keys[n_top] == I->NextKey - 1 - SelectorMemberOffset_t(n_top)) {
+    ++n_top;
+  }
+  free_keys.erase(free_keys.begin(), free_keys.begin() + n_top);
+  free_keys.shrink_to_fit();
+  I->NextKey -= SelectorMemberOffset_t(n_top);
 }
 
 typedef struct {
@@ -2980,20 +3030,48 @@ PyObject *SelectorAsPyList(PyMOLGlobals * G, SelectorID_t sele1)
     }
   }
   if(n_obj) {
+    int pse_export_version = SettingGetGlobal_f(G, cSetting_pse_export_version) * 1000;
+    bool dump_binary = SettingGetGlobal_b(G, cSetting_pse_binary_dump) &&
+      (!pse_export_version || pse_export_version >= 2600);
+
     result = PyList_New(n_obj);
     for(a = 0; a < n_obj; a++) {
-      obj_pyobj = PyList_New(3);
       n_idx = VLAGetSize(vla_list[a]);
-      idx_pyobj = PyList_New(n_idx);
-      tag_pyobj = PyList_New(n_idx);
-      for(b = 0; b < n_idx; b++) {
-        PyList_SetItem(idx_pyobj, b, PyInt_FromLong(vla_list[a][b].atom));
-        PyList_SetItem(tag_pyobj, b, PyInt_FromLong(vla_list[a][b].tag));
+      if(dump_binary) {
+        /* compressed atom indices, tags (in ascending atom order) only
+           for ordered selections */
+        std::sort(vla_list[a], vla_list[a] + n_idx,
+            [](const SelAtomTag& lhs, const SelAtomTag& rhs) {
+              return lhs.atom < rhs.atom;
+            });
+        pymol::RoaringBitmap atoms;
+        bool ordered = false;
+        for(b = 0; b < n_idx; b++) {
+          atoms.add(vla_list[a][b].atom);
+          ordered = ordered || vla_list[a][b].tag != 1;
+        }
+        auto blob = atoms.serialize();
+        idx_pyobj = PyBytes_FromStringAndSize(blob.data(), blob.size());
+        tag_pyobj = NULL;
+        if(ordered) {
+          tag_pyobj = PyList_New(n_idx);
+          for(b = 0; b < n_idx; b++)
+            PyList_SetItem(tag_pyobj, b, PyInt_FromLong(vla_list[a][b].tag));
+        }
+      } else {
+        idx_pyobj = PyList_New(n_idx);
+        tag_pyobj = PyList_New(n_idx);
+        for(b = 0; b < n_idx; b++) {
+          PyList_SetItem(idx_pyobj, b, PyInt_FromLong(vla_list[a][b].atom));
+          PyList_SetItem(tag_pyobj, b, PyInt_FromLong(vla_list[a][b].tag));
+        }
       }
       VLAFreeP(vla_list[a]);
+      obj_pyobj = PyList_New(tag_pyobj ? 3 : 2);
       PyList_SetItem(obj_pyobj, 0, PyString_FromString(obj_list[a]->Name));
       PyList_SetItem(obj_pyobj, 1, idx_pyobj);
-      PyList_SetItem(obj_pyobj, 2, tag_pyobj);
+      if(tag_pyobj)
+        PyList_SetItem(obj_pyobj, 2, tag_pyobj);
       PyList_SetItem(result, a, obj_pyobj);
     }
   } else {
@@ -3052,18 +3130,32 @@ int SelectorFromPyList(PyMOLGlobals * G, const char *name, PyObject * list)
           tag_list = PyList_GetItem(obj_list, 2);
         else
           tag_list = NULL;
-        if(ok)
-          ok = PyList_Check(idx_list);
-        if(ok)
-          n_idx = PyList_Size(idx_list);
-        for(b = 0; b < n_idx; b++) {
+
+        /* pse_binary_dump stores the atom indices as a compressed bitmap */
+        std::vector<std::uint32_t> idx_vec;
+        bool binary = ok && PyBytes_Check(idx_list);
+        if(binary) {
+          auto blob = PyBytes_AsSomeString(idx_list);
+          pymol::RoaringBitmap atoms;
+          ok = pymol::RoaringBitmap::deserialize(blob.data(), blob.length(), atoms);
+          idx_vec = atoms.toVector();
+          n_idx = idx_vec.size();
+        } else {
           if(ok)
+            ok = PyList_Check(idx_list);
+          if(ok)
+            n_idx = PyList_Size(idx_list);
+        }
+        for(b = 0; b < n_idx; b++) {
+          if(binary)
+            idx = idx_vec[b] < std::uint32_t(obj->NAtom) ? int(idx_vec[b]) : -1;
+          else if(ok)
             ok = PConvPyIntToInt(PyList_GetItem(idx_list, b), &idx);
           if(tag_list)
             PConvPyIntToInt(PyList_GetItem(tag_list, b), &tag);
           else
             tag = 1;
-          if(ok && (idx < obj->NAtom)) {
+          if(ok && (idx >= 0) && (idx < obj->NAtom)) {
             SelectorManagerInsertMember(*I, obj->AtomInfo[idx], sele, tag);
 
             /* take note of selections which are one atom/one object */
@@ -3711,11 +3803,11 @@ void SelectorLogSele(PyMOLGlobals * G, const char *name)
 int SelectorIsMember(PyMOLGlobals * G, SelectorMemberOffset_t s, SelectorID_t sele)
 {
   if(sele > 1) {
-    const MemberType *mem, *member = G->SelectorMgr->Member.data();
-    for (; s; s = mem->next) {
-      mem = member + s;
-      if (mem->selection == sele)
-        return mem->tag;
+    if(s) {
+      const auto& members = G->SelectorMgr->Members;
+      auto it = members.find(sele);
+      if (it != members.end())
+        return it->second.tag(s);
     }
   } else if(!sele)
     return true;                /* "all" is selection number 0, unordered */
@@ -3727,15 +3819,22 @@ int SelectorIsMember(PyMOLGlobals * G, SelectorMemberOffset_t s, SelectorID_t se
 bool SelectorMoveMember(PyMOLGlobals * G, SelectorMemberOffset_t s, SelectorID_t sele_old, SelectorID_t sele_new)
 {
   auto I = G->SelectorMgr;
-  int result = false;
-  while(s) {
-    if(I->Member[s].selection == sele_old) {
-      I->Member[s].selection = sele_new;
-      result = true;
-    }
-    s = I->Member[s].next;
-  }
-  return result;
+  if(!s)
+    return false;
+  auto it = I->Members.find(sele_old);
+  if (it == I->Members.end())
+    return false;
+  int tag = it->second.tag(s);
+  if(!tag)
+    return false;
+  it->second.keys.remove(s);
+  it->second.tags.erase(s);
+
+  auto& members = I->Members[sele_new];
+  members.keys.add(s);
+  if(tag != 1)
+    members.tags[s] = tag;
+  return true;
 }
 
 
@@ -4684,10 +4783,254 @@ float SelectorSumVDWOverlap(PyMOLGlobals * G, int sele1, int state1, int sele2,
  * @param cutoff Distance cutoff
  * @return List of selector table index pairs
  */
+/*========================================================================*/
+/**
+ * Neighbor search over the selector table atoms of one state.
+ *
+ * Queries go to each object's CoordSet::Coord2Idx map, which is kept
+ * between calls and only rebuilt when the coordinates change, instead of
+ * hashing the coordinates of all atoms again for every selection.
+ */
+class SelectorNeighborSearch
+{
+  struct Model {
+    CoordSet* cs;
+    int atm2table; // offset into m_atm2table
+  };
+
+  float m_cutoff;
+  std::vector<Model> m_models;
+  std::vector<int> m_atm2table; // table index, or -1 if not searched
+
+public:
+  /**
+   * @param state state of the searched coordinates (>= 0)
+   * @param cutoff search radius
+   * @param mask if not NULL, only search table atoms with a nonzero mask
+   */
+  SelectorNeighborSearch(
+      CSelector* I, int state, float cutoff, const int* mask = nullptr)
+      : m_cutoff(cutoff)
+  {
+    auto model2index = std::vector<int>(I->Obj.size(), -1);
+    int n_atm = 0;
+
+    for (size_t a = 0; a < I->Table.size(); ++a) {
+      int model = I->Table[a].model;
+      if ((mask && !mask[a]) || model2index[model] != -1)
+        continue;
+      auto obj = I->Obj[model];
+      auto cs = (state < obj->NCSet) ? obj->CSet[state] : nullptr;
+      if (!cs) {
+        model2index[model] = -2;
+        continue;
+      }
+      if (CoordSetUpdateCoord2IdxMap(cs, cutoff))
+        ++I->MapsBuilt;
+      model2index[model] = m_models.size();
+      m_models.push_back({cs, n_atm});
+      n_atm += obj->NAtom;
+    }
+
+    m_atm2table.resize(n_atm, -1);
+
+    for (size_t a = 0; a < I->Table.size(); ++a) {
+      int index = model2index[I->Table[a].model];
+      if (index >= 0 && !(mask && !mask[a])) {
+        m_atm2table[m_models[index].atm2table + I->Table[a].atom] = a;
+      }
+    }
+  }
+
+  bool empty() const { return m_models.empty(); }
+
+  /**
+   * Calls `fn(a, v1)` for all searched atoms `a` with coordinate `v1`
+   * within the cutoff of `v`
+   */
+  template <typename Fn> void forEach(const float* v, Fn&& fn) const
+  {
+    for (auto& model : m_models) {
+      auto cs = model.cs;
+      const int* atm2table = m_atm2table.data() + model.atm2table;
+
+      auto visit = [&](int idx) {
+        const float* v1 = cs->coordPtr(idx);
+        if (within3f(v1, v, m_cutoff)) {
+          int a = atm2table[cs->IdxToAtm[idx]];
+          if (a >= 0)
+            fn(a, v1);
+        }
+      };
+
+      if (auto map = cs->Coord2Idx) {
+        if (v[0] < map->Min[0] - m_cutoff || v[0] > map->Max[0] + m_cutoff ||
+            v[1] < map->Min[1] - m_cutoff || v[1] > map->Max[1] + m_cutoff ||
+            v[2] < map->Min[2] - m_cutoff || v[2] > map->Max[2] + m_cutoff)
+          continue;
+        int h, k, l;
+        MapLocus(map, v, &h, &k, &l);
+        for (int d = h - 1; d <= h + 1; ++d)
+          for (int e = k - 1; e <= k + 1; ++e)
+            for (int f = l - 1; f <= l + 1; ++f)
+              for (int j = *MapFirst(map, d, e, f); j >= 0; j = MapNext(map, j))
+                visit(j);
+      } else {
+        for (int idx = 0; idx < cs->NIndex; ++idx)
+          visit(idx);
+      }
+    }
+  }
+};
+
+/*========================================================================*/
+/**
+ * Number of threads for `n_chunk` chunks of table atoms (max_threads)
+ */
+static int SelectorThreadCount(PyMOLGlobals* G, size_t n_chunk)
+{
+  int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
+  return std::max(1, int(std::min<size_t>(n_thread, n_chunk)));
+}
+
+/**
+ * Sets `sele[a] = pred(a)` for all non-dummy table atoms.
+ *
+ * Tables larger than cSelectorChunkSize are split into chunks which run on
+ * up to max_threads threads. `make_pred()` is called once per chunk, so a
+ * predicate may keep private state like a SelectorLexMatcher memo.
+ *
+ * @return number of selected atoms
+ */
+template <typename MakePred>
+static int SelectorParallelSelect(
+    PyMOLGlobals* G, int* sele, MakePred&& make_pred)
+{
+  CSelector* I = G->Selector;
+  const size_t n = I->Table.size();
+  if (n <= cNDummyAtoms)
+    return 0;
+
+  size_t n_chunk =
+      (n - cNDummyAtoms + cSelectorChunkSize - 1) / cSelectorChunkSize;
+  int n_thread = SelectorThreadCount(G, n_chunk);
+  size_t chunk_size = cSelectorChunkSize;
+  if (n_thread < 2) {
+    n_chunk = 1;
+    chunk_size = n;
+  }
+
+  std::vector<int> counts(n_chunk);
+  auto run = [&](size_t chunk) {
+    size_t begin = cNDummyAtoms + chunk * chunk_size;
+    size_t end = std::min(n, begin + chunk_size);
+    auto pred = make_pred();
+    int c = 0;
+    for (size_t a = begin; a < end; ++a) {
+      if ((sele[a] = pred(a)))
+        ++c;
+    }
+    counts[chunk] = c;
+  };
+
+  if (n_thread < 2) {
+    run(0);
+  } else {
+    pymol::ThreadPoolRunTasks(
+        n_thread, n_chunk, [&](int, size_t chunk) { run(chunk); });
+  }
+
+  int c = 0;
+  for (int count : counts)
+    c += count;
+  return c;
+}
+
+/**
+ * Calls `fn(a, v, mark)` for all table atoms `a` with `src[a]` set and
+ * coordinates `v` in state `state`. `mark(j)` sets `dst[j] = value`.
+ *
+ * With more than one thread, every thread marks into a private array and
+ * the arrays are merged afterwards, so `fn` must not read `dst`.
+ */
+template <typename Fn>
+static void SelectorParallelMark(PyMOLGlobals* G, const int* src, int state,
+    int* dst, int value, Fn&& fn)
+{
+  CSelector* I = G->Selector;
+  const size_t n = I->Table.size();
+
+  auto visit = [&](size_t begin, size_t end, auto&& mark) {
+    for (size_t a = begin; a < end; ++a) {
+      if (!src[a])
+        continue;
+      auto obj = I->Obj[I->Table[a].model];
+      auto cs = (state < obj->NCSet) ? obj->CSet[state] : nullptr;
+      if (!cs)
+        continue;
+      int idx = cs->atmToIdx(I->Table[a].atom);
+      if (idx >= 0)
+        fn(a, cs->coordPtr(idx), mark);
+    }
+  };
+
+  const size_t n_chunk = (n + cSelectorChunkSize - 1) / cSelectorChunkSize;
+  int n_thread = SelectorThreadCount(G, n_chunk);
+  if (n_thread < 2) {
+    visit(0, n, [dst, value](int j) { dst[j] = value; });
+    return;
+  }
+
+  std::vector<std::vector<char>> marked(n_thread);
+  pymol::ThreadPoolRunTasks(n_thread, n_chunk, [&](int worker, size_t chunk) {
+    auto& flags = marked[worker];
+    if (flags.empty())
+      flags.resize(n);
+    char* flags_data = flags.data();
+    size_t begin = chunk * cSelectorChunkSize;
+    visit(begin, std::min(n, begin + cSelectorChunkSize),
+        [flags_data](int j) { flags_data[j] = 1; });
+  });
+
+  for (auto& flags : marked) {
+    for (size_t j = 0; j < flags.size(); ++j) {
+      if (flags[j])
+        dst[j] = value;
+    }
+  }
+}
+
+/*========================================================================*/
 std::vector<int> SelectorGetInterstateVLA(
     PyMOLGlobals* G, int sele1, int state1, int sele2, int state2, float cutoff)
 {                               /* Assumes valid tables */
-  const size_t table_size = G->Selector->Table.size();
+  CSelector *I = G->Selector;
+
+  if (state1 >= 0) {
+    // search the cached per-object maps
+    auto mask = std::vector<int>(I->Table.size());
+    for (size_t a = 0; a < I->Table.size(); ++a) {
+      auto obj = I->Obj[I->Table[a].model];
+      mask[a] = SelectorIsMember(
+          G, obj->AtomInfo[I->Table[a].atom].selEntry, sele1);
+    }
+
+    SelectorNeighborSearch neighbors(I, state1, cutoff, mask.data());
+    std::vector<int> out;
+
+    if (!neighbors.empty()) {
+      for (SeleCoordIterator iter(G, sele2, state2, false); iter.next();) {
+        neighbors.forEach(iter.getCoord(), [&](int a1, const float*) {
+          out.push_back(a1);
+          out.push_back(iter.a);
+        });
+      }
+    }
+
+    return out;
+  }
+
+  const size_t table_size = I->Table.size();
   auto coords_flat = std::vector<float>(3 * table_size);
   auto* coords = pymol::reshape<3>(coords_flat.data());
 
@@ -5623,6 +5966,7 @@ int SelectorAssignAtomTypes(PyMOLGlobals * G, int sele, int state, int quiet, in
 
     LexAssign(G, iter.getAtomInfo()->textType,
         getMOL2Type(obj, iter.getAtm()));
+    ++obj->LexGeneration;
   }
   return 1;
 #endif
@@ -5819,102 +6163,503 @@ pymol::Result<> SelectorLoadCoords(PyMOLGlobals * G, PyObject * coords, int sele
 }
 
 /*========================================================================*/
-pymol::Result<> SelectorUpdateCmd(PyMOLGlobals* G, //
-    SelectorID_t sele0,                            //
-    SelectorID_t sele1,                            //
-    int sta0, int sta1, int matchmaker, int quiet)
+/**
+ * (object, atom) pairs of a selection in selection order, for multi-state
+ * coordinate access where atoms may be missing in some states
+ */
+static std::vector<std::pair<ObjectMolecule*, int>> SelectorGetObjectAtoms(
+    PyMOLGlobals * G, int sele)
 {
-  CSelector *I = G->Selector;
-  int a, b;
-  int at0 = 0, at1;
-  int c0 = 0, c1 = 0;
-  int i0 = 0, i1;
-  ObjectMolecule *obj0 = NULL, *obj1;
-  CoordSet *cs0;
-  const CoordSet *cs1;
-  int matched_flag;
-  int b_start;
-  int ccc = 0;
+  std::vector<std::pair<ObjectMolecule*, int>> atoms;
+  SelectorUpdateTable(G, cSelectorUpdateTableAllStates, -1);
+  for(SeleAtomIterator iter(G, sele); iter.next();)
+    atoms.emplace_back(iter.obj, iter.getAtm());
+  return atoms;
+}
 
-  bool ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
-  bool ignore_case_chain = SettingGetGlobal_b(G, cSetting_ignore_case_chain);
+/*========================================================================*/
+/**
+ * Get selection coordinates of states [first, last] as a (states x atoms x 3)
+ * numpy array, with one allocation instead of one array per state. Atoms
+ * which have no coordinates in a state are NaN.
+ *
+ * @param first 0-based first state
+ * @param last 0-based last state, or -1 for the last state of the selection
+ */
+pymol::Result<PyObject*> SelectorGetCoordsStatesAsNumPy(
+    PyMOLGlobals * G, int sele, int first, int last)
+{
+#ifndef _PYMOL_NUMPY
+  return pymol::Error("No numpy support");
+#else
+  auto atoms = SelectorGetObjectAtoms(G, sele);
+  int n_state = SelectorCountStates(G, sele);
 
-  PRINTFD(G, FB_Selector)
-    " %s-Debug: entered sta0 %d sta1 %d", __func__, sta0, sta1 ENDFD;
+  if(last < 0)
+    last = n_state - 1;
 
-  // either both or none must be "all states"
-  if (sta0 != sta1) {
-    if (sta0 == cSelectorUpdateTableAllStates) {
-      sta0 = sta1;
-    } else if (sta1 == cSelectorUpdateTableAllStates) {
-      sta1 = sta0;
-    }
+  if(!n_state) {
+    // empty selection (or no coordinates): (0 x atoms x 3) array
+    first = 0;
+    last = -1;
+  } else if(first < 0 || last < first) {
+    return pymol::make_error("Invalid state range ", first + 1, "-", last + 1);
   }
 
-  if((sta0 < 0) || (sta1 < 0) || (sta0 != sta1)) {
-    SelectorUpdateTable(G, cSelectorUpdateTableAllStates, -1);
-  } else {
-    SelectorUpdateTable(G, sta0, -1);
+  import_array1(pymol::Error("numpy import failed"));
+
+  npy_intp dims[3] = {last - first + 1, npy_intp(atoms.size()), 3};
+  PyObject* result = PyArray_SimpleNew(3, dims, NPY_FLOAT32);
+  if(!result)
+    return pymol::Error("array allocation failed");
+
+  float* dataptr = (float*) PyArray_DATA((PyArrayObject *)result);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  double matrix[16];
+  double *matrix_ptr = NULL;
+
+  for(int state = first; state <= last; ++state) {
+    ObjectMolecule* obj = NULL;
+    CoordSet* cs = NULL;
+
+    for(auto& oa : atoms) {
+      if(obj != oa.first) {
+        obj = oa.first;
+        cs = obj->getCoordSet(state);
+        matrix_ptr = ObjectGetTotalMatrix(obj, state, false, matrix) ? matrix : NULL;
+      }
+
+      int idx = cs ? cs->atmToIdx(oa.second) : -1;
+
+      if(idx < 0) {
+        dataptr[0] = dataptr[1] = dataptr[2] = nan;
+      } else if(matrix_ptr) {
+        transform44d3f(matrix_ptr, cs->coordPtr(idx), dataptr);
+      } else {
+        copy3f(cs->coordPtr(idx), dataptr);
+      }
+
+      dataptr += 3;
+    }
   }
 
-  auto vla0 = pymol::vla_take_ownership(SelectorGetIndexVLA(G, sele0));
-  auto vla1 = pymol::vla_take_ownership(SelectorGetIndexVLA(G, sele1));
+  return result;
+#endif
+}
 
-  if (vla0 && vla1) {
-    c0 = VLAGetSize(vla0);
-    c1 = VLAGetSize(vla1);
+/*========================================================================*/
+/**
+ * Load coordinates from a (states x atoms x 3) array into states
+ * [first, first + states) of the given selection. Inverse of
+ * SelectorGetCoordsStatesAsNumPy, NaN coordinates and atoms without
+ * coordinates in a state are skipped. Representations are invalidated
+ * once per object, not once per state.
+ *
+ * @return Number of states loaded
+ */
+pymol::Result<int> SelectorLoadCoordsStates(
+    PyMOLGlobals * G, PyObject * coords, int sele, int first)
+{
+#ifndef _PYMOL_NUMPY
+  return pymol::Error("No numpy support");
+#else
+  auto atoms = SelectorGetObjectAtoms(G, sele);
+
+  if(first < 0)
+    return pymol::make_error("Invalid state ", first + 1);
+
+  import_array1(pymol::Error("numpy import failed"));
+
+  // no copy if already a C-contiguous float32 array
+  unique_PyObject_ptr array(PyArray_FROM_OTF(coords, NPY_FLOAT32,
+      NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST));
+  if(!array)
+    return pymol::Error("Expected a (states x atoms x 3) array");
+
+  auto arr = reinterpret_cast<PyArrayObject*>(array.get());
+  if(PyArray_NDIM(arr) != 3 ||
+      PyArray_DIM(arr, 1) != npy_intp(atoms.size()) ||
+      PyArray_DIM(arr, 2) != 3) {
+    return pymol::make_error("Array shape mismatch, expected (states x ",
+        atoms.size(), " x 3)");
   }
 
-  if (c0 < 1 || c1 < 1)
-    return pymol::make_error("No coordinates updated.");
-  else {
+  int n_state = PyArray_DIM(arr, 0);
+  if(first + n_state > SelectorCountStates(G, sele))
+    return pymol::Error("States out of range");
 
-    b = 0;
-    for(a = 0; a < c1; a++) {   /* iterate over source atoms */
-      /* NOTE, this algorithm is N^2 and slow in the worst case...
-         however the best case (N) is quite common, especially when merging 
-         files written out of PyMOL */
+  const float* dataptr = (const float*) PyArray_DATA(arr);
+  std::set<ObjectMolecule*> objects;
+  double matrix[16];
+  double *matrix_ptr = NULL;
+  float v_xyz[3];
 
-      i1 = vla1[a];
-      at1 = I->Table[i1].atom;
-      obj1 = I->Obj[I->Table[i1].model];
-      matched_flag = false;
+  for(int state = first; state < first + n_state; ++state) {
+    ObjectMolecule* obj = NULL;
+    CoordSet* cs = NULL;
 
-      switch (matchmaker) {
-      case 0:                 
-        /* simply assume that atoms are stored in PyMOL in the identical order, one for one */
-        if(b < c0) {
-          i0 = vla0[b];
-          at0 = I->Table[i0].atom;
-          obj0 = I->Obj[I->Table[i0].model];
-          b++;
-          matched_flag = true;
-        }
-        break;
-      case 1:                  
-        /* match each pair based on atom info */
-        b_start = b;
-        matched_flag = false;
-        while(1) {
-          i0 = vla0[b];
-          at0 = I->Table[i0].atom;
-          obj0 = I->Obj[I->Table[i0].model];
-          if(obj0 != obj1) {
-            if(AtomInfoMatch(G, obj1->AtomInfo + at1, obj0->AtomInfo + at0, ignore_case, ignore_case_chain)) {
-              matched_flag = true;
-              break;
-            }
-          } else if(at0 == at1) {
-            matched_flag = true;
-            break;
-          }
-          b++;
-          if(b >= c0)
-            b = 0;
-          if(b == b_start)
-            break;
+    for(auto& oa : atoms) {
+      if(obj != oa.first) {
+        obj = oa.first;
+        cs = obj->getCoordSet(state);
+        matrix_ptr = ObjectGetTotalMatrix(obj, state, false, matrix) ? matrix : NULL;
+        if(cs)
+          objects.insert(obj);
+      }
+
+      int idx = cs ? cs->atmToIdx(oa.second) : -1;
+
+      if(idx >= 0 && !std::isnan(dataptr[0])) {
+        if(matrix_ptr) {
+          inverse_transform44d3f(matrix_ptr, dataptr, v_xyz);
+          copy3f(v_xyz, cs->coordPtr(idx));
+        } else {
+          copy3f(dataptr, cs->coordPtr(idx));
         }
-        break;
+      }
+
+      dataptr += 3;
+    }
+  }
+
+  for(auto obj : objects)
+    obj->invalidate(cRepAll, cRepInvRep, -1);
+
+  return n_state;
+#endif
+}
+
+/*========================================================================*/
+/**
+ * Atom property (iterate/alter name) which is stored in AtomInfoType and
+ * can be accessed as a column, see SelectorGetAtomColumn
+ */
+static pymol::Result<const AtomPropertyInfo*> SelectorGetColumnInfo(
+    PyMOLGlobals * G, const char *name)
+{
+  const AtomPropertyInfo* ap = PyMOL_GetAtomPropertyInfo(G->PyMOL, name);
+  if(ap) {
+    switch (ap->Ptype) {
+    case cPType_float:
+    case cPType_int:
+    case cPType_uint32:
+    case cPType_schar:
+    case cPType_int_as_string:
+    case cPType_string:
+      return ap;
+    }
+  }
+  return pymol::make_error("Unsupported atom property: ", name);
+}
+
+#ifdef _PYMOL_NUMPY
+/**
+ * NumPy type number for a numeric column
+ */
+static int SelectorColumnTypeNum(const AtomPropertyInfo* ap)
+{
+  switch (ap->Ptype) {
+  case cPType_float:
+    return NPY_FLOAT32;
+  case cPType_int:
+    return NPY_INT32;
+  case cPType_uint32:
+    return NPY_UINT32;
+  case cPType_schar:
+    return NPY_INT8;
+  }
+  return NPY_OBJECT;
+}
+
+template <typename T>
+static T* SelectorColumnPtr(AtomInfoType* ai, const AtomPropertyInfo* ap)
+{
+  return reinterpret_cast<T*>(reinterpret_cast<char*>(ai) + ap->offset);
+}
+#endif
+
+/*========================================================================*/
+/**
+ * Get an atom property for all atoms in `sele` as a 1D NumPy array, in
+ * the same order as "iterate". Numeric properties give numeric arrays,
+ * string properties object arrays of str.
+ */
+pymol::Result<PyObject*> SelectorGetAtomColumn(
+    PyMOLGlobals * G, SelectorID_t sele, const char *name)
+{
+#ifndef _PYMOL_NUMPY
+  return pymol::Error("No numpy support");
+#else
+  auto ap = SelectorGetColumnInfo(G, name);
+  p_return_if_error(ap);
+
+  SelectorUpdateTable(G, cSelectorUpdateTableAllStates, -1);
+
+  npy_intp n_atom = 0;
+  for(SeleAtomIterator iter(G, sele); iter.next();)
+    n_atom++;
+
+  import_array1(pymol::Error("numpy import failed"));
+
+  int typenum = SelectorColumnTypeNum(ap.result());
+  PyObject* result = PyArray_ZEROS(1, &n_atom, typenum, 0);
+  if(!result)
+    return pymol::Error("array allocation failed");
+  auto arr = reinterpret_cast<PyArrayObject*>(result);
+  char* data = static_cast<char*>(PyArray_DATA(arr));
+  npy_intp i = 0;
+
+  if(typenum != NPY_OBJECT) {
+    int itemsize = PyArray_ITEMSIZE(arr);
+    for(SeleAtomIterator iter(G, sele); iter.next(); i++) {
+      memcpy(data + i * itemsize,
+          SelectorColumnPtr<char>(iter.getAtomInfo(), ap.result()), itemsize);
+    }
+    return result;
+  }
+
+  // one str object per distinct lexicon entry
+  std::unordered_map<lexidx_t, unique_PyObject_ptr> lexstr;
+
+  for(SeleAtomIterator iter(G, sele); iter.next(); i++) {
+    auto ai = iter.getAtomInfo();
+    PyObject* item;
+    if(ap.result()->Ptype == cPType_int_as_string) {
+      lexidx_t idx = *SelectorColumnPtr<lexidx_t>(ai, ap.result());
+      auto& cached = lexstr[idx];
+      if(!cached)
+        cached.reset(PyString_FromString(LexStr(G, idx)));
+      item = cached.get();
+      Py_INCREF(item);
+    } else {
+      auto str = SelectorColumnPtr<const char>(ai, ap.result());
+      item = PyString_FromStringAndSize(str, strnlen(str, ap.result()->maxlen + 1));
+    }
+    PyArray_SETITEM(arr, data + i * sizeof(PyObject*), item);
+    Py_DECREF(item);
+  }
+  return result;
+#endif
+}
+
+/*========================================================================*/
+/**
+ * Set an atom property for all atoms in `sele` from a sequence (ideally a
+ * NumPy array) with one value per atom, in the same order as
+ * SelectorGetAtomColumn. Representations are invalidated once per object.
+ *
+ * @return number of modified atoms
+ */
+pymol::Result<int> SelectorSetAtomColumn(
+    PyMOLGlobals * G, SelectorID_t sele, const char *name, PyObject * values)
+{
+#ifndef _PYMOL_NUMPY
+  return pymol::Error("No numpy support");
+#else
+  auto apres = SelectorGetColumnInfo(G, name);
+  p_return_if_error(apres);
+  auto ap = apres.result();
+
+  SelectorUpdateTable(G, cSelectorUpdateTableAllStates, -1);
+
+  npy_intp n_atom = 0;
+  for(SeleAtomIterator iter(G, sele); iter.next();)
+    n_atom++;
+
+  if(!PySequence_Check(values) || PySequence_Size(values) != n_atom) {
+    PyErr_Clear();
+    return pymol::make_error("Expected a sequence of ", n_atom, " values");
+  }
+
+  import_array1(pymol::Error("numpy import failed"));
+
+  int typenum = SelectorColumnTypeNum(ap);
+  unique_PyObject_ptr arrobj;
+  char* data = nullptr;
+  if(typenum != NPY_OBJECT) {
+    // converts lists and other dtypes as needed
+    arrobj.reset(PyArray_FROM_OTF(values, typenum, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST));
+    if(!arrobj) {
+      PyErr_Clear();
+      return pymol::make_error("Values for '", name, "' must be numeric");
+    }
+    data = static_cast<char*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(arrobj.get())));
+  }
+
+  ObjectMolecule* last_obj = nullptr;
+  std::vector<ObjectMolecule*> objs;
+  npy_intp i = 0;
+
+  for(SeleAtomIterator iter(G, sele); iter.next(); i++) {
+    auto ai = iter.getAtomInfo();
+
+    if(iter.obj != last_obj) {
+      last_obj = iter.obj;
+      if(std::find(objs.begin(), objs.end(), last_obj) == objs.end())
+        objs.push_back(last_obj);
+    }
+
+    switch (ap->Ptype) {
+    case cPType_float:
+      *SelectorColumnPtr<float>(ai, ap) = reinterpret_cast<float*>(data)[i];
+      break;
+    case cPType_int:
+      *SelectorColumnPtr<int>(ai, ap) = reinterpret_cast<int*>(data)[i];
+      break;
+    case cPType_uint32:
+      *SelectorColumnPtr<uint32_t>(ai, ap) = reinterpret_cast<uint32_t*>(data)[i];
+      break;
+    case cPType_schar:
+      *SelectorColumnPtr<signed char>(ai, ap) = reinterpret_cast<signed char*>(data)[i];
+      break;
+    default: {
+      auto item = unique_PyObject_ptr(PySequence_GetItem(values, i));
+      auto valobj = unique_PyObject_ptr(item ? PyObject_Str(item.get()) : nullptr);
+      if(!valobj) {
+        PyErr_Clear();
+        return pymol::make_error("Invalid value at index ", i);
+      }
+      const char* valstr = PyString_AS_STRING(valobj.get());
+      if(ap->Ptype == cPType_int_as_string) {
+        LexAssign(G, *SelectorColumnPtr<lexidx_t>(ai, ap), valstr);
+      } else {
+        auto dest = SelectorColumnPtr<char>(ai, ap);
+        strncpy(dest, valstr, ap->maxlen);
+        dest[ap->maxlen] = '\0';
+      }
+    }
+    }
+
+    /* same side effects as alter */
+    switch (ap->id) {
+    case ATOM_PROP_ELEM:
+      ai->protons = 0;
+      ai->vdw = 0;
+      AtomInfoAssignParameters(G, ai);
+      break;
+    case ATOM_PROP_RESV:
+      ai->inscode = '\0';
+      break;
+    case ATOM_PROP_SS:
+      ai->ssType[0] = toupper(ai->ssType[0]);
+      break;
+    case ATOM_PROP_FORMAL_CHARGE:
+      ai->chemFlag = false;
+      break;
+    }
+  }
+
+  cRepInv_t level = (ap->id == ATOM_PROP_COLOR) ? cRepInvColor : cRepInvRep;
+  for(auto obj : objs) {
+    if(ap->Ptype == cPType_int_as_string)
+      ++obj->LexGeneration;
+    obj->invalidate(cRepAll, level, -1);
+  }
+
+  if(ap->Ptype == cPType_int_as_string || ap->id == ATOM_PROP_RESV)
+    SeqChanged(G);
+
+  return int(n_atom);
+#endif
+}
+
+/*========================================================================*/
+pymol::Result<> SelectorUpdateCmd(PyMOLGlobals* G, //
+    SelectorID_t sele0,                            //
+    SelectorID_t sele1,                            //
+    int sta0, int sta1, int matchmaker, int quiet)
+{
+  CSelector *I = G->Selector;
+  int a, b;
+  int at0 = 0, at1;
+  int c0 = 0, c1 = 0;
+  int i0 = 0, i1;
+  ObjectMolecule *obj0 = NULL, *obj1;
+  CoordSet *cs0;
+  const CoordSet *cs1;
+  int matched_flag;
+  int b_start;
+  int ccc = 0;
+
+  bool ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
+  bool ignore_case_chain = SettingGetGlobal_b(G, cSetting_ignore_case_chain);
+
+  PRINTFD(G, FB_Selector)
+    " %s-Debug: entered sta0 %d sta1 %d", __func__, sta0, sta1 ENDFD;
+
+  // either both or none must be "all states"
+  if (sta0 != sta1) {
+    if (sta0 == cSelectorUpdateTableAllStates) {
+      sta0 = sta1;
+    } else if (sta1 == cSelectorUpdateTableAllStates) {
+      sta1 = sta0;
+    }
+  }
+
+  if((sta0 < 0) || (sta1 < 0) || (sta0 != sta1)) {
+    SelectorUpdateTable(G, cSelectorUpdateTableAllStates, -1);
+  } else {
+    SelectorUpdateTable(G, sta0, -1);
+  }
+
+  auto vla0 = pymol::vla_take_ownership(SelectorGetIndexVLA(G, sele0));
+  auto vla1 = pymol::vla_take_ownership(SelectorGetIndexVLA(G, sele1));
+
+  if (vla0 && vla1) {
+    c0 = VLAGetSize(vla0);
+    c1 = VLAGetSize(vla1);
+  }
+
+  if (c0 < 1 || c1 < 1)
+    return pymol::make_error("No coordinates updated.");
+  else {
+
+    b = 0;
+    for(a = 0; a < c1; a++) {   /* iterate over source atoms */
+      /* NOTE, this algorithm is N^2 and slow in the worst case...
+         however the best case (N) is quite common, especially when merging 
+         files written out of PyMOL */
+
+      i1 = vla1[a];
+      at1 = I->Table[i1].atom;
+      obj1 = I->Obj[I->Table[i1].model];
+      matched_flag = false;
+
+      switch (matchmaker) {
+      case 0:                 
+        /* simply assume that atoms are stored in PyMOL in the identical order, one for one */
+        if(b < c0) {
+          i0 = vla0[b];
+          at0 = I->Table[i0].atom;
+          obj0 = I->Obj[I->Table[i0].model];
+          b++;
+          matched_flag = true;
+        }
+        break;
+      case 1:                  
+        /* match each pair based on atom info */
+        b_start = b;
+        matched_flag = false;
+        while(1) {
+          i0 = vla0[b];
+          at0 = I->Table[i0].atom;
+          obj0 = I->Obj[I->Table[i0].model];
+          if(obj0 != obj1) {
+            if(AtomInfoMatch(G, obj1->AtomInfo + at1, obj0->AtomInfo + at0, ignore_case, ignore_case_chain)) {
+              matched_flag = true;
+              break;
+            }
+          } else if(at0 == at1) {
+            matched_flag = true;
+            break;
+          }
+          b++;
+          if(b >= c0)
+            b = 0;
+          if(b == b_start)
+            break;
+        }
+        break;
       case 2:                  /* match based on ID */
         {
           int target = obj1->AtomInfo[at1].id;
@@ -6338,38 +7083,13 @@ SelectorID_t SelectorIndexByName(PyMOLGlobals * G, const char *sname, int ignore
 static void SelectorPurgeMembers(PyMOLGlobals * G, SelectorID_t sele)
 {
   auto I = G->SelectorMgr;
-  void *iterator = NULL;
-  ObjectMolecule *obj = NULL;
-  short changed = 0;
+  auto it = I->Members.find(sele);
+  if (it == I->Members.end())
+    return;
 
-  if(!I->Member.empty()) {
+  bool changed = !it->second.keys.empty();
+  I->Members.erase(it);
 
-    while(ExecutiveIterateObjectMolecule(G, &obj, &iterator)) {
-      if(obj->type == cObjectMolecule) {
-        AtomInfoType *ai = obj->AtomInfo.data();
-        int a, n_atom = obj->NAtom;
-        for(a = 0; a < n_atom; a++) {
-          int s = (ai++)->selEntry;
-          int l = -1;
-          while(s) {
-            auto& i_member_s = I->Member[s];
-            int nxt = i_member_s.next;
-            if(i_member_s.selection == sele) {
-              if(l > 0)
-                I->Member[l].next = i_member_s.next;
-              else
-                ai[-1].selEntry = i_member_s.next;
-	      changed = 1;
-              i_member_s.next = I->FreeMember;
-              I->FreeMember = s;
-            }
-            l = s;
-            s = nxt;
-          }
-        }
-      }
-    }
-  }
   if (changed){
     // not sure if this is needed since its in SelectorClean()
     ExecutiveInvalidateSelectionIndicatorsCGO(G);
@@ -6383,24 +7103,43 @@ int SelectorPurgeObjectMembers(PyMOLGlobals * G, ObjectMolecule * obj)
   bool changed = false;
 
   auto I = G->SelectorMgr;
-  if(!I->Member.empty()) {
-    for(int a = 0; a < obj->NAtom; a++) {
-      auto s = obj->AtomInfo[a].selEntry;
-      while(s) {
-        auto nxt = I->Member[s].next;
-        I->Member[s].next = I->FreeMember;
-        I->FreeMember = s;
-        s = nxt;
+  pymol::RoaringBitmap keys;
+  for(int a = 0; a < obj->NAtom; a++) {
+    auto& s = obj->AtomInfo[a].selEntry;
+    if(s) {
+      keys.add(s);
+      s = 0;
+    }
+  }
+
+  if(!keys.empty()) {
+    for (auto it = I->Members.begin(); it != I->Members.end();) {
+      auto& members = it->second;
+      members.keys.andNot(keys);
+      if (members.keys.empty()) {
+        it = I->Members.erase(it);
+        continue;
+      }
+      for (auto t = members.tags.begin(); t != members.tags.end();) {
+        t = keys.contains(t->first) ? members.tags.erase(t) : std::next(t);
       }
-      obj->AtomInfo[a].selEntry = 0;
-      changed = true;
+      ++it;
     }
+    keys.forEach([I](std::uint32_t key) { I->FreeKeys.push_back(key); });
+    changed = true;
   }
   if (changed){
     // not sure if this is needed since its in SelectorClean()
     ExecutiveInvalidateSelectionIndicatorsCGO(G);
   }
 
+  I->LexPostings.erase(obj);
+
+  // the table outlives selections, don't leave a dangling object in it
+  if (G->Selector && pymol::ranges::contains(G->Selector->Obj, obj)) {
+    SelectorClean(G);
+  }
+
   return 1;
 }
 
@@ -6695,7 +7434,7 @@ static int SelectorEmbedSelection(PyMOLGlobals * G, const int *atom, pymol::zstr
         }
       }
 
-      /* store this is the Selectors->Member table, so make sure there's room */
+      /* store this in the selection manager's member bitmaps */
       c++;
       /* at runtime, selections can now have transient ordering --
          but these are not yet persistent through session saves & restores */
@@ -6775,7 +7514,8 @@ _SelectorCreate(PyMOLGlobals * G, pymol::zstring_view sname, const char *sele,
                            ObjectMolecule ** obj, int quiet, Multipick * mp,
                            CSeqRow * rowVLA, int nRow, int **obj_idx, int *n_idx,
                            int n_obj, const std::unordered_map<int, int>* id2tag, int executive_manage,
-                           int state, SelectorID_t domain)
+                           int state, SelectorID_t domain,
+                           const SelectorCompiledPtr* compiled = nullptr)
 {
   sele_array_t atom{};
   std::string name;
@@ -6805,6 +7545,10 @@ _SelectorCreate(PyMOLGlobals * G, pymol::zstring_view sname, const char *sele,
       auto res = SelectorSelect(G, sele, state, domain, quiet);
       p_return_if_error(res);
       atom = std::move(res.result());
+    } else if(compiled) {
+      auto res = SelectorSelectCompiled(G, *compiled, state, domain, quiet);
+      p_return_if_error(res);
+      atom = std::move(res.result());
     } else if(id2tag) {
       atom = SelectorSelectFromTagDict(G, *id2tag);
     } else if(obj && obj[0]) {  /* optimized full-object selection */
@@ -6826,7 +7570,6 @@ _SelectorCreate(PyMOLGlobals * G, pymol::zstring_view sname, const char *sele,
   }
 
   c = SelectorEmbedSelection(G, atom.get(), sname, embed_obj, false, executive_manage);
-  SelectorClean(G);
   /* ignore reporting on quiet */
   if(!quiet) {
     /* ignore reporting on internal/private names */
@@ -6880,6 +7623,13 @@ SelectorCreateResult_t SelectorCreate(PyMOLGlobals * G, const char *sname, const
                          -1, -1);
 }
 
+SelectorCreateResult_t SelectorCreateFromCompiled(PyMOLGlobals * G, const char *sname,
+    const SelectorCompiledPtr& compiled, int state, int quiet)
+{
+  return _SelectorCreate(G, sname, NULL, NULL, quiet, NULL, NULL, 0, NULL, 0, 0, NULL, -1,
+                         state, -1, &compiled);
+}
+
 SelectorCreateResult_t SelectorCreateWithStateDomain(PyMOLGlobals * G, const char *sname, const char *sele,
                                   ObjectMolecule * obj, int quiet, Multipick * mp,
                                   int state, const char *domain)
@@ -6920,6 +7670,46 @@ static void SelectorClean(PyMOLGlobals* G)
   auto I = G->Selector;
   I->Table.clear();
   I->Obj.clear();
+  I->TableKey.clear();
+}
+
+/**
+ * Resolves the state of `obj` for a table update with `req_state`
+ */
+static int SelectorTableState(PyMOLGlobals* G, ObjectMolecule* obj, int req_state)
+{
+  if(req_state >= 0)
+    return req_state;
+  switch (req_state) {
+  case cSelectorUpdateTableCurrentState:
+    return SettingGetGlobal_i(G, cSetting_state) - 1;
+  case cSelectorUpdateTableEffectiveStates:
+    return obj->getCurrentState();
+  default:                     /* all states, or unknown input -- fail safe */
+    return -1;
+  }
+}
+
+/**
+ * Summary of everything the selector table depends on (without a domain):
+ * the objects in order, their atom generation and the coordinate sets of
+ * the requested states. Equal keys mean that the table is still valid.
+ */
+static std::vector<std::size_t> SelectorTableKey(PyMOLGlobals* G, int req_state)
+{
+  std::vector<std::size_t> key{(std::size_t) req_state};
+  ObjectMolecule* obj = nullptr;
+  void* iterator = nullptr;
+  while(ExecutiveIterateObjectMolecule(G, &obj, &iterator)) {
+    int state = SelectorTableState(G, obj, req_state);
+    const CoordSet* cs =
+        (state >= 0 && state < obj->NCSet) ? obj->CSet[state] : nullptr;
+    key.insert(key.end(), {(std::size_t) obj, obj->AtomGeneration,
+                              (std::size_t) obj->NAtom, (std::size_t) obj->NCSet,
+                              (std::size_t) state, (std::size_t) cs,
+                              (std::size_t) (cs ? cs->NIndex : 0)});
+  }
+  return key;
 }
 
 /*========================================================================*/
@@ -7062,6 +7852,15 @@ int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, Selec
   if(!I->Center)
     I->Center.reset(ObjectMoleculeDummyNew(G, cObjectMoleculeDummyCenter));
 
+  /* the table of the global selector is kept until an object changes;
+     others can't be reused since they share ObjectMolecule::SeleBase */
+  std::vector<std::size_t> key;
+  if(I == G->Selector && domain < 0) {
+    key = SelectorTableKey(G, req_state);
+    if(!I->Table.empty() && key == I->TableKey)
+      return (true);
+  }
+
   SelectorClean(G);
   I->NCSet = 0;
 
@@ -7119,21 +7918,7 @@ int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, Selec
   while(ExecutiveIterateObjectMolecule(G, &obj, &iterator)) {
     int skip_flag = false;
     if(req_state < 0) {
-      switch (req_state) {
-      case cSelectorUpdateTableAllStates:
-        state = -1;             /* all states */
-        /* proceed... */
-        break;
-      case cSelectorUpdateTableCurrentState:
-        state = SettingGetGlobal_i(G, cSetting_state) - 1;
-        break;
-      case cSelectorUpdateTableEffectiveStates:
-        state = obj->getCurrentState();
-        break;
-      default:                 /* unknown input -- fail safe (all states) */
-        state = -1;
-        break;
-      }
+      state = SelectorTableState(G, obj, req_state);
     } else {
       if(state >= obj->NCSet)
         skip_flag = true;
@@ -7227,23 +8012,129 @@ int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, Selec
   }
   I->Obj.resize(modelCnt);
   I->Table.resize(c);
+  I->TableKey = std::move(key);
   /* printf("selector update table state=%d, natom=%d\n",req_state,c); */
   return (true);
 }
 
 
 /*========================================================================*/
-static pymol::Result<sele_array_t> SelectorSelect(
-    PyMOLGlobals* G, const char* sele, int state, SelectorID_t domain, int quiet)
+/**
+ * False if `compiled` was built with a different ignore_case setting, or
+ * if a word which it took as a keyword now names a selection (or vice versa)
+ */
+static bool SelectorCompiledIsCurrent(PyMOLGlobals * G, const SelectorCompiled& compiled)
+{
+  if(compiled.ignore_case != SettingGetGlobal_b(G, cSetting_ignore_case))
+    return false;
+  for(auto& check : compiled.name_checks) {
+    if((SelectorIndexByName(G, check.first.c_str()) >= 0) != check.second)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Tokenizes a selection expression and resolves its keywords. Repeated
+ * calls with the same text return the cached result.
+ *
+ * The result can be held and evaluated any number of times, for any state,
+ * with SelectorCreateFromCompiled or SelectorCountCompiled.
+ */
+pymol::Result<SelectorCompiledPtr> SelectorCompile(PyMOLGlobals * G, const char *sele)
+{
+  auto I = G->SelectorMgr;
+  auto it = I->Compiled.find(sele);
+  if(it != I->Compiled.end() && SelectorCompiledIsCurrent(G, *it->second))
+    return SelectorCompiledPtr(it->second);
+
+  auto compiled = std::make_shared<SelectorCompiled>();
+  compiled->expr = sele;
+  compiled->ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
+  compiled->word = SelectorParse(G, sele);
+  if(!compiled->word.empty()) {
+    p_return_if_error(SelectorCompileWords(G, *compiled));
+  }
+
+  if(I->Compiled.size() >= cSelectorCompiledCacheSize)
+    I->Compiled.clear();
+  I->Compiled[sele] = compiled;
+  return SelectorCompiledPtr(std::move(compiled));
+}
+
+/*========================================================================*/
+static pymol::Result<sele_array_t> SelectorSelectCompiled(PyMOLGlobals* G,
+    SelectorCompiledPtr compiled, int state, SelectorID_t domain, int quiet)
 {
+  if(!SelectorCompiledIsCurrent(G, *compiled)) {
+    auto res = SelectorCompile(G, compiled->expr.c_str());
+    p_return_if_error(res);
+    compiled = res.result();
+  }
   SelectorUpdateTable(G, state, domain);
-  auto parsed = SelectorParse(G, sele);
-  if (!parsed.empty()) {
-    return SelectorEvaluate(G, parsed, state, quiet);
+  if (!compiled->word.empty()) {
+    return SelectorEvaluate(G, *compiled, state, quiet);
   }
   return {};
 }
 
+/*========================================================================*/
+static pymol::Result<sele_array_t> SelectorSelect(
+    PyMOLGlobals* G, const char* sele, int state, SelectorID_t domain, int quiet)
+{
+  auto compiled = SelectorCompile(G, sele);
+  p_return_if_error(compiled);
+  return SelectorSelectCompiled(G, compiled.result(), state, domain, quiet);
+}
+
+/*========================================================================*/
+/**
+ * Number of atoms in `compiled` for the given state
+ */
+pymol::Result<int> SelectorCountCompiled(PyMOLGlobals * G,
+    const SelectorCompiledPtr& compiled, int state)
+{
+  auto res = SelectorSelectCompiled(G, compiled, state, cSelectionInvalid, true);
+  p_return_if_error(res);
+  auto atom = res.result().get();
+  if(!atom)
+    return 0;
+  return int(std::count_if(atom, atom + G->Selector->Table.size(),
+      [](int tag) { return tag != 0; }));
+}
+
+/*========================================================================*/
+/**
+ * Evaluates `sele` and reports time and atom counts for every operator
+ * application, in evaluation order. The first record is the parsing (or
+ * cache lookup) of the expression, the second the table update.
+ */
+pymol::Result<std::vector<SelectorProfileRec>> SelectorExplain(
+    PyMOLGlobals * G, const char *sele, int state)
+{
+  CSelector *I = G->Selector;
+  std::vector<SelectorProfileRec> profile(2);
+
+  profile[0].op = "(parse)";
+  double start = UtilGetSeconds(G);
+  auto compiled = SelectorCompile(G, sele);
+  p_return_if_error(compiled);
+  profile[0].seconds = UtilGetSeconds(G) - start;
+
+  profile[1].op = "(table)";
+  start = UtilGetSeconds(G);
+  SelectorUpdateTable(G, state, cSelectionInvalid);
+  profile[1].seconds = UtilGetSeconds(G) - start;
+  profile[1].atoms_out = std::max(0, int(I->Table.size()) - cNDummyAtoms);
+
+  I->Profile = &profile;
+  auto res = SelectorSelectCompiled(G, compiled.result(), state, cSelectionInvalid, true);
+  I->Profile = nullptr;
+  p_return_if_error(res);
+
+  return profile;
+}
+
 
 /*========================================================================*/
 static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
@@ -7253,11 +8144,9 @@ static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
   int c = 0;
   float dist;
   int nbond;
-  float *v2;
-  CoordSet *cs;
   int ok = true;
   int nCSet;
-  int n1, at, idx;
+  int at;
   ObjectMolecule *obj;
 
   if(state < 0) {
@@ -7280,64 +8169,30 @@ static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
     if(!sscanf(base[2].text(), "%f", &dist))
       ok = ErrMessage(G, "Selector", "Invalid distance.");
     if(ok) {
+      // Potential atoms to be selected (exclude dummies)
+      auto Flag1 = std::vector<int>(I->Table.size(), 1);
+      std::fill_n(Flag1.begin(), cNDummyAtoms, 0);
+
       for(d = 0; d < I->NCSet; d++) {
         if((state < 0) || (d == state)) {
-          n1 = 0;
-
-          const size_t table_size = I->Table.size();
-          auto coords_flat = std::vector<float>(table_size * 3);
-          auto* coords = pymol::reshape<3>(coords_flat.data());
-          auto Flag1 = std::vector<MapFlag_t>(table_size, 0);
-
-          // Potential atoms to be selected (exclude dummies)
-          for (a = cNDummyAtoms; a < I->Table.size(); a++) {
-            at = I->Table[a].atom;
-            obj = I->Obj[I->Table[a].model];
-            if(d < obj->NCSet)
-              cs = obj->CSet[d];
-            else
-              cs = NULL;
-            if(cs) {
-              if (CoordSetGetAtomVertex(cs, at, coords[a])) {
-                Flag1[a] = true;
-                n1++;
-              }
-            }
-          }
-          if(n1) {
-            std::unique_ptr<MapType> map(MapNewFlagged(G, -dist,
-                pymol::flatten(coords), table_size, nullptr, Flag1.data()));
-	    CHECKOK(ok, map);
+          SelectorNeighborSearch neighbors(I, d, dist, Flag1.data());
+          if(!neighbors.empty()) {
             if(ok) {
               nCSet = SelectorGetArrayNCSet(G, base[1].sele, false);
               for(e = 0; ok && e < nCSet; e++) {
                 if((state < 0) || (e == state)) {
                   // Input selection (include dummies)
-                  for(a = 0; ok && a < I->Table.size(); a++) {
-                    if(base[1].sele[a]) {
-                      at = I->Table[a].atom;
-                      obj = I->Obj[I->Table[a].model];
-                      if(e < obj->NCSet)
-                        cs = obj->CSet[e];
-                      else
-                        cs = NULL;
-                      if(cs) {
-                        idx = cs->atmToIdx(at);
-                        if(idx >= 0) {
-                          v2 = cs->coordPtr(idx);
-                          for (const auto j : MapEIter(*map, v2, false)) {
-                            if (!base[0].sele[j] &&
-                                (!base[1].sele[j] ||
-                                    base[1].code == SELE_EXP_)) {
-                              /*exclude current selection */
-                              if (within3f(coords[j], v2, dist))
-                                base[0].sele[j] = true;
-                            }
+                  SelectorParallelMark(G, base[1].sele_data(), e,
+                      base[0].sele_data(), true,
+                      [&](int, const float* v2, auto&& mark) {
+                        neighbors.forEach(v2, [&](int j, const float*) {
+                          if (!base[1].sele[j] ||
+                              base[1].code == SELE_EXP_) {
+                            /*exclude current selection */
+                            mark(j);
                           }
-                        }
-                      }
-                    }
-                  }
+                        });
+                      });
                 }
               }
             }
@@ -7381,67 +8236,27 @@ static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
         at = I->Table[a].atom;
         I->Table[a].f1 = obj->AtomInfo[at].vdw;
         base[0].sele[a] = true; /* start selected, subtract off */
-        c = I->Table.size();
       }
       for(d = 0; d < I->NCSet; d++) {
         if((state < 0) || (d == state)) {
-          n1 = 0;
-
-          auto Flag1 = std::vector<MapFlag_t>(I->Table.size(), 0);
-          auto Vertex = std::vector<float>(I->Table.size() * 3, 0.0f);
-
-          for(a = 0; a < I->Table.size(); a++) {
-            obj = I->Obj[I->Table[a].model];
-            at = I->Table[a].atom;
-            if(d < obj->NCSet)
-              cs = obj->CSet[d];
-            else
-              cs = NULL;
-            if(cs) {
-              if(CoordSetGetAtomVertex(cs, at, Vertex.data() + 3 * a)) {
-                Flag1[a] = true;
-                n1++;
-              }
-            }
-          }
-          if(n1) {
-            std::unique_ptr<MapType> map(MapNewFlagged(G, -(dist + 2 * MAX_VDW),
-                Vertex.data(), I->Table.size(), nullptr, Flag1.data()));
-	    CHECKOK(ok, map);
+          SelectorNeighborSearch neighbors(I, d, dist + 2 * MAX_VDW);
+          if(!neighbors.empty()) {
             if(ok) {
 
               nCSet = SelectorGetArrayNCSet(G, base[1].sele, false);
               for(e = 0; ok && e < nCSet; e++) {
                 if((state < 0) || (e == state)) {
-                  for(a = 0; ok && a < I->Table.size(); a++) {
-                    if(base[1].sele[a]) {
-                      at = I->Table[a].atom;
-                      obj = I->Obj[I->Table[a].model];
-                      if(e < obj->NCSet)
-                        cs = obj->CSet[e];
-                      else
-                        cs = NULL;
-                      if(cs) {
-                        idx = cs->atmToIdx(at);
-
-                        if(idx >= 0) {
-                          v2 = cs->coordPtr(idx);
-                          for (const auto j : MapEIter(*map, v2, false)) {
-                              if((base[0].sele[j]) && (!base[1].sele[j])) {     /*exclude current selection */
-                                if(within3f(Vertex.data() + 3 * j, v2, dist +       /* eliminate atoms w/o gap */
-                                            I->Table[a].f1 + I->Table[j].f1)) {
-                                  base[0].sele[j] = false;
-                                  c--;
-                                }
-                              } else if(base[1].sele[j]) {
-                                base[0].sele[j] = false;
-                                c--;
-                              }
+                  SelectorParallelMark(G, base[1].sele_data(), e,
+                      base[0].sele_data(), false,
+                      [&](int a, const float* v2, auto&& mark) {
+                        neighbors.forEach(v2, [&](int j, const float* v1) {
+                          if(base[1].sele[j] ||         /*exclude current selection */
+                             within3f(v1, v2, dist +    /* eliminate atoms w/o gap */
+                                      I->Table[a].f1 + I->Table[j].f1)) {
+                            mark(j);
                           }
-                        }
-                      }
-                    }
-                  }
+                        });
+                      });
                 }
               }
             }
@@ -7685,6 +8500,121 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
 }
 
 
+/*========================================================================*/
+/**
+ * CWordMatcher for interned (lexicon) strings, which runs the matcher only
+ * once per distinct string. Identifiers like resn, name or chain take few
+ * distinct values, so the per-atom cost becomes a table lookup.
+ */
+class SelectorLexMatcher
+{
+  PyMOLGlobals* m_G;
+  CWordMatcher* m_matcher;
+  std::vector<signed char> m_hit; // by lexidx_t, -1 = not matched yet
+
+public:
+  SelectorLexMatcher(PyMOLGlobals* G, CWordMatcher* matcher)
+      : m_G(G), m_matcher(matcher) {}
+
+  /// Use a new matcher, e.g. after the options changed
+  void reset(CWordMatcher* matcher)
+  {
+    m_matcher = matcher;
+    m_hit.clear();
+  }
+
+  bool operator()(lexidx_t idx)
+  {
+    if (idx < 0)
+      return WordMatcherMatchAlpha(m_matcher, LexStr(m_G, idx));
+    if (size_t(idx) >= m_hit.size())
+      m_hit.resize(idx + 1, -1);
+    auto& hit = m_hit[idx];
+    if (hit < 0)
+      hit = WordMatcherMatchAlpha(m_matcher, LexStr(m_G, idx)) ? 1 : 0;
+    return hit;
+  }
+};
+
+/*========================================================================*/
+/**
+ * Atoms of `obj` by value of the lexidx_t field at `offset` in AtomInfoType.
+ * Kept until the object's atoms or identifiers change, so repeated
+ * selections like "resn POPC" or "chain A+B" only visit matching atoms.
+ */
+static const SelectorLexPostings& SelectorGetLexPostings(
+    PyMOLGlobals* G, const ObjectMolecule* obj, int offset)
+{
+  auto& list = G->SelectorMgr->LexPostings[obj];
+  auto it = std::find_if(list.begin(), list.end(),
+      [offset](const SelectorLexPostings& p) { return p.offset == offset; });
+  if (it == list.end()) {
+    list.emplace_back();
+    it = std::prev(list.end());
+    it->offset = offset;
+  }
+
+  auto& postings = *it;
+  if (postings.atomGeneration != obj->AtomGeneration ||
+      postings.lexGeneration != obj->LexGeneration ||
+      postings.nAtom != obj->NAtom) {
+    postings.atomGeneration = obj->AtomGeneration;
+    postings.lexGeneration = obj->LexGeneration;
+    postings.nAtom = obj->NAtom;
+    postings.atoms.clear();
+    for (int atm = 0; atm < obj->NAtom; ++atm) {
+      auto ai = reinterpret_cast<const char*>(obj->AtomInfo + atm);
+      postings.atoms[*reinterpret_cast<const lexidx_t*>(ai + offset)]
+          .push_back(atm);
+    }
+  }
+  return postings;
+}
+
+/**
+ * Sets `sele[a]` for all non-dummy table atoms whose lexidx_t field at
+ * `offset` in AtomInfoType matches `matcher`. Objects which are completely
+ * in the table use their posting lists, others are scanned.
+ *
+ * @return number of selected atoms
+ */
+static int SelectorSelectLex(
+    PyMOLGlobals* G, int* sele, int offset, CWordMatcher* matcher)
+{
+  CSelector* I = G->Selector;
+  const int n = I->Table.size();
+  SelectorLexMatcher lex_matcher(G, matcher);
+  int c = 0;
+
+  for (int a = cNDummyAtoms; a < n;) {
+    const int model = I->Table[a].model;
+    const ObjectMolecule* obj = I->Obj[model];
+
+    /* table atoms are in ascending order, at most NAtom per object */
+    const int end = a + obj->NAtom;
+    if (I->Table[a].atom == 0 && end <= n &&
+        I->Table[end - 1].model == model) {
+      std::fill(sele + a, sele + end, 0);
+      for (const auto& item : SelectorGetLexPostings(G, obj, offset).atoms) {
+        if (lex_matcher(item.first)) {
+          for (int atm : item.second)
+            sele[a + atm] = true;
+          c += item.second.size();
+        }
+      }
+      a = end;
+      continue;
+    }
+
+    for (; a < n && I->Table[a].model == model; ++a) {
+      auto ai = reinterpret_cast<const char*>(obj->AtomInfo + I->Table[a].atom);
+      if ((sele[a] = lex_matcher(*reinterpret_cast<const lexidx_t*>(ai + offset))))
+        ++c;
+    }
+  }
+  return c;
+}
+
 /*========================================================================*/
 static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 {
@@ -7842,6 +8772,7 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
       WordMatchOptionsConfigAlphaList(&options, atom_name_wildcard[0], ignore_case);
 
       matcher = WordMatcherNew(G, base[1].text(), &options, false);
+      SelectorLexMatcher lex_matcher(G, matcher);
 
       base_0_sele_a = &base[0].sele[cNDummyAtoms];
       last_obj = NULL;
@@ -7866,18 +8797,17 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
             matcher = WordMatcherNew(G, base[1].text(), &options, false);
             if(!matcher)
               WordPrimeCommaMatch(G, &base[1].m_text[0] /* replace '+' with ',' */);
+            lex_matcher.reset(matcher);
           }
           last_obj = obj;
         }
 
-        const char * name = LexStr(G, obj->AtomInfo[table_a.atom].name);
+        auto name = obj->AtomInfo[table_a.atom].name;
         if(matcher)
-          hit_flag =
-            WordMatcherMatchAlpha(matcher,
-                                  name);
+          hit_flag = lex_matcher(name);
         else
           hit_flag = (WordMatchCommaExact(G, base[1].text(),
-                                          name,
+                                          LexStr(G, name),
                                           ignore_case) < 0);
 
         if((*base_0_sele_a = hit_flag))
@@ -7894,22 +8824,11 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text(), &options, true))) {
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-#ifndef NO_MMLIBS
-#endif
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          auto& table_a = I->Table[a];
-          auto ai = I->Obj[table_a.model]->AtomInfo + table_a.atom;
 #ifndef NO_MMLIBS
 #endif
-          if((*base_0_sele_a = WordMatcherMatchAlpha(matcher, LexStr(G, ai->textType))))
-	    c++;
-          base_0_sele_a++;
-        }
+        c = SelectorSelectLex(G, base[0].sele_data(),
+            offsetof(AtomInfoType, textType), matcher);
         WordMatcherFree(matcher);
       }
     }
@@ -7920,19 +8839,14 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text(), &options, true))) {
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          auto& table_a = I->Table[a];
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,
-                                    I->Obj[table_a.model]->AtomInfo[table_a.atom].elem)))
-            c++;
-          base_0_sele_a++;
-        }
+        c = SelectorParallelSelect(G, base[0].sele_data(), [&]() {
+          return [&](size_t a) {
+            auto& table_a = I->Table[a];
+            return WordMatcherMatchAlpha(matcher,
+                I->Obj[table_a.model]->AtomInfo[table_a.atom].elem);
+          };
+        });
         WordMatcherFree(matcher);
       }
     }
@@ -8018,8 +8932,6 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case_chain);
 
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       int offset = 0;
       switch (base->code) {
         case SELE_CHNs:
@@ -8039,18 +8951,7 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
       }
 
       if((matcher = WordMatcherNew(G, base[1].text(), &options, true))) {
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          auto& table_a = I->Table[a];
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher, LexStr(G,
-                  *reinterpret_cast<decltype(AtomInfoType::chain)*>
-                  (((char*)(I->Obj[table_a.model]->AtomInfo + table_a.atom)) + offset)
-                  ))))
-            c++;
-          base_0_sele_a++;
-        }
+        c = SelectorSelectLex(G, base[0].sele_data(), offset, matcher);
         WordMatcherFree(matcher);
       }
     }
@@ -8163,24 +9064,26 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
   case SELE_RSIs:
     {
       CWordMatchOptions options;
-      AtomInfoType *ai;
 
       WordMatchOptionsConfigMixed(&options, wildcard[0], ignore_case);
 
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text(), &options, true))) {
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          auto& table_a = I->Table[a];
-          ai = I->Obj[table_a.model]->AtomInfo + table_a.atom;
-          char resi[8];
-          AtomResiFromResv(resi, sizeof(resi), ai);
-          if((*base_0_sele_a = WordMatcherMatchMixed(matcher, resi, ai->resv)))
-            c++;
-          base_0_sele_a++;
-        }
+        c = SelectorParallelSelect(G, base[0].sele_data(), [&]() {
+          /* atoms of a residue are adjacent, only match when resi changes */
+          return [&, last_resv = 0, last_inscode = char(0),
+                     last_hit = -1](size_t a) mutable {
+            auto& table_a = I->Table[a];
+            auto ai = I->Obj[table_a.model]->AtomInfo + table_a.atom;
+            if(last_hit < 0 || ai->resv != last_resv || ai->inscode != last_inscode) {
+              char resi[8];
+              AtomResiFromResv(resi, sizeof(resi), ai);
+              last_hit = WordMatcherMatchMixed(matcher, resi, ai->resv) ? 1 : 0;
+              last_resv = ai->resv;
+              last_inscode = ai->inscode;
+            }
+            return last_hit;
+          };
+        });
         WordMatcherFree(matcher);
       }
     }
@@ -8191,19 +9094,9 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text(), &options, true))) {
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          auto& table_a = I->Table[a];
-          auto& resn = I->Obj[table_a.model]->AtomInfo[table_a.atom].resn;
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher, LexStr(G, resn))))
-            c++;
-          base_0_sele_a++;
-        }
+        c = SelectorSelectLex(G, base[0].sele_data(),
+            offsetof(AtomInfoType, resn), matcher);
         WordMatcherFree(matcher);
       }
     }
@@ -8240,16 +9133,14 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
           }
           if (WordMatcherMatchAlpha(matcher, rec.name.c_str())) {
             if (!enabled_only || activeselename == rec.name) {
+              auto members = IM->Members.find(rec.ID);
+              if (members == IM->Members.end())
+                continue;
               for(a = cNDummyAtoms; a < I_NAtom; a++) {
                 s = I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom].selEntry;
-                while(s) {
-                  if (I->mgr->Member[s].selection == rec.ID) {
-                    if(!base[0].sele[a]) {
-                      base[0].sele[a] = I->mgr->Member[s].tag;
-                      c++;
-                    }
-                  }
-                  s = IM->Member[s].next;
+                if(s && !base[0].sele[a]) {
+                  if((base[0].sele[a] = members->second.tag(s)))
+                    c++;
                 }
               }
             }
@@ -8284,16 +9175,14 @@ static pymol::Result<> SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int qu
                  WordMatchExact(G, activeselename, word, ignore_case)) {
         auto it = SelectGetInfoIter(G, word, 1, ignore_case);
         if (it != IM->Info.end()) {
+          auto members = IM->Members.find(it->ID);
           for(a = cNDummyAtoms; a < I_NAtom; a++) {
             base[0].sele[a] = false;
+            if (members == IM->Members.end())
+              continue;
             s = I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom].selEntry;
-            while(s) {
-              if (IM->Member[s].selection == it->ID) {
-                base[0].sele[a] = IM->Member[s].tag;
-                c++;
-              }
-              s = IM->Member[s].next;
-            }
+            if(s && (base[0].sele[a] = members->second.tag(s)))
+              c++;
           }
         } else {
           int group_list_id;
@@ -8436,7 +9325,6 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
   int exact;
   int ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
 
-  AtomInfoType *at1;
   CSelector *I = G->Selector;
   base->type = STYP_LIST;
   base->sele_calloc(I->Table.size());
@@ -8515,155 +9403,38 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
         break;
       }
       if(ok) {
-        switch (oper) {
-        case SCMP_GTHN:
-          switch (base->code) {
-          case SELE_BVLx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->b > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_QVLx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->q > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_PCHx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->partialCharge > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_FCHx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->formalCharge > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          }
-          break;
-        case SCMP_LTHN:
-          switch (base->code) {
-          case SELE_BVLx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->b < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_QVLx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->q < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_PCHx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->partialCharge < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_FCHx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->formalCharge < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          }
-          break;
-        case SCMP_EQAL:
-          switch (base->code) {
-          case SELE_BVLx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->b - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_QVLx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->q - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_PCHx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->partialCharge - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
-            break;
-          case SELE_FCHx:
-            for(a = cNDummyAtoms; a < I->Table.size(); a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->formalCharge - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
+        auto compare = [oper, comp1](float value) {
+          switch (oper) {
+          case SCMP_GTHN:
+            return value > comp1;
+          case SCMP_LTHN:
+            return value < comp1;
+          case SCMP_EQAL:
+            return fabs(value - comp1) < R_SMALL4;
+          }
+          return false;
+        };
+        auto code = base->code;
+        c = SelectorParallelSelect(G, base[0].sele_data(), [&]() {
+          return [&](size_t a) {
+            auto& table_a = I->Table[a];
+            auto& ai = I->Obj[table_a.model]->AtomInfo[table_a.atom];
+            switch (code) {
+            case SELE_BVLx:
+              return compare(ai.b);
+            case SELE_QVLx:
+              return compare(ai.q);
+            case SELE_PCHx:
+              return compare(ai.partialCharge);
+            case SELE_FCHx:
+              return compare(ai.formalCharge);
             }
-            break;
-          }
-          break;
-        }
-        break;
+            return false;
+          };
+        });
       }
     }
+    break;
   }
 
   PRINTFD(G, FB_Selector)
@@ -9367,19 +10138,60 @@ static int SelectorLogic2(PyMOLGlobals * G, EvalElem * base)
 }
 
 
+/*========================================================================*/
+/**
+ * SelectorLogic1 for packed lists. Tags are 0 or 1 in that case, so the
+ * result only depends on the bits.
+ * @return false if the operator or the operand needs the int arrays
+ */
+static bool SelectorLogic1Bits(EvalElem * base)
+{
+  if(base[0].code != SELE_NOT1 || !base[1].packed)
+    return false;
+  base[0].sele.reset();
+  base[0].bits = std::move(base[1].bits);
+  base[0].bits.flip();
+  base[0].packed = true;
+  base[0].type = STYP_LIST;
+  base[1].sele_free();
+  return true;
+}
+
+/**
+ * SelectorLogic2 for packed lists, see SelectorLogic1Bits
+ */
+static bool SelectorLogic2Bits(EvalElem * base)
+{
+  if(!base[0].packed || !base[2].packed)
+    return false;
+  switch (base[1].code) {
+  case SELE_OR_2:
+  case SELE_IOR2:
+    base[0].bits |= base[2].bits;
+    break;
+  case SELE_AND2:
+    base[0].bits &= base[2].bits;
+    break;
+  case SELE_ANT2:
+    base[0].bits.andNot(base[2].bits);
+    break;
+  default:
+    return false;
+  }
+  base[2].sele_free();
+  return true;
+}
+
 /*========================================================================*/
 int SelectorOperator22(PyMOLGlobals * G, EvalElem * base, int state)
 {
   int c = 0;
   int a, d, e;
   CSelector *I = G->Selector;
-  ObjectMolecule *obj;
 
   float dist;
-  CoordSet *cs;
   int ok = true;
   int nCSet;
-  int n1, at, idx;
   int code = base[1].code;
 
   if(state < 0) {
@@ -9402,8 +10214,6 @@ int SelectorOperator22(PyMOLGlobals * G, EvalElem * base, int state)
         dist = 0.0;
 
       const size_t table_size = I->Table.size();
-      auto coords_flat = std::vector<float>(table_size * 3);
-      auto* coords = pymol::reshape<3>(coords_flat.data());
 
       /* copy starting mask */
       const auto Flag2 = std::move(base[0].sele);
@@ -9411,53 +10221,21 @@ int SelectorOperator22(PyMOLGlobals * G, EvalElem * base, int state)
 
       for(d = 0; d < I->NCSet; d++) {
         if((state < 0) || (d == state)) {
-          n1 = 0;
-          auto Flag1 = std::vector<MapFlag_t>(table_size);
-          for(a = 0; a < table_size; a++) {
-            at = I->Table[a].atom;
-            obj = I->Obj[I->Table[a].model];
-            if(d < obj->NCSet)
-              cs = obj->CSet[d];
-            else
-              cs = NULL;
-            if(cs) {
-              if(CoordSetGetAtomVertex(cs, at, coords[a])) {
-                Flag1[a] = true;
-                n1++;
-              }
-            }
-          }
-          if(n1) {
-            std::unique_ptr<MapType> map(MapNewFlagged(G, -dist,
-                pymol::flatten(coords), table_size, nullptr, Flag1.data()));
-	    CHECKOK(ok, map);
+          SelectorNeighborSearch neighbors(I, d, dist, Flag2.get());
+          if(!neighbors.empty()) {
             if(ok) {
               nCSet = SelectorGetArrayNCSet(G, base[4].sele, false);
               for(e = 0; ok && e < nCSet; e++) {
                 if((state < 0) || (e == state)) {
-                  for(a = 0; a < I->Table.size(); a++) {
-                    if(base[4].sele[a]) {
-                      at = I->Table[a].atom;
-                      obj = I->Obj[I->Table[a].model];
-                      if(e < obj->NCSet)
-                        cs = obj->CSet[e];
-                      else
-                        cs = NULL;
-                      if(cs) {
-                        idx = cs->atmToIdx(at);
-                        if(idx >= 0) {
-                          const float* v2 = cs->coordPtr(idx);
-                          for (const auto j : MapEIter(*map, v2, false)) {
-                            if (!base[0].sele[j] && Flag2[j] &&
-                                within3f(coords[j], v2, dist) &&
-                                (code != SELE_NTO_ || !base[4].sele[j])) {
-                              base[0].sele[j] = true;
-                            }
+                  SelectorParallelMark(G, base[4].sele_data(), e,
+                      base[0].sele_data(), true,
+                      [&](int, const float* v2, auto&& mark) {
+                        neighbors.forEach(v2, [&](int j, const float*) {
+                          if (code != SELE_NTO_ || !base[4].sele[j]) {
+                            mark(j);
                           }
-                        }
-                      }
-                    }
-                  }
+                        });
+                      });
                 }
               }
             }
@@ -9598,25 +10376,26 @@ static std::string indicate_last_token(
   }
 
 /*========================================================================*/
-pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
-    std::vector<std::string>& word,
-    int state, int quiet)
+/**
+ * Builds the operator stack for the tokens in `compiled.word`
+ */
+pymol::Result<> SelectorCompileWords(PyMOLGlobals * G, SelectorCompiled& compiled)
 {
+  auto& word = compiled.word;
   int level = 0, imp_op_level = 0;
   int depth = 0;
   int a, b, c = 0;
   int ok = true;
   unsigned int code = 0;
   int valueFlag = 0;            /* are we expecting? */
-  int opFlag, maxLevel;
-  int totDepth = 0;
   int exact = 0;
 
-  int ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
+  int ignore_case = compiled.ignore_case;
   /* CFGs can efficiently be parsed by stacks; use a clean stack w/space
    * for 10 (was: 100) elements */
   EvalElem *e;
-  auto Stack = std::vector<EvalElem>(10);
+  auto& Stack = compiled.Stack;
+  Stack.resize(10);
 
   /* converts all keywords into code, adds them into a operation list */
   while(ok && c < word.size()) {
@@ -9682,9 +10461,12 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
         }
         PRINTFD(G, FB_Selector)
           " Selector: code %x\n", code ENDFD;
-        if((code > 0) && (!exact))
-          if(SelectorIndexByName(G, word[c].c_str()) >= 0)
+        if((code > 0) && (!exact)) {
+          bool is_name = SelectorIndexByName(G, word[c].c_str()) >= 0;
+          compiled.name_checks.emplace_back(word[c], is_name);
+          if(is_name)
             code = 0;           /* favor selections over partial keyword matches */
+        }
         if(code) {
           /* this is a known operation */
           STACK_PUSH_OPERATION(code);
@@ -9807,8 +10589,109 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
   if(level > 0){
     return_error_with_tokens("Malformed selection.");
   }
+  if (!ok) {
+    return pymol::Error(indicate_last_token(word, c));
+  }
+  compiled.totDepth = depth;
+  return {};
+}
+
+/*========================================================================*/
+/**
+ * Number of selected (non-dummy) atoms in a list operand
+ */
+static int SelectorEvalElemCount(const EvalElem& elem, size_t n_atom)
+{
+  int c = 0;
+  if(elem.packed) {
+    c = elem.bits.count();
+    for(size_t a = 0; a < cNDummyAtoms && a < n_atom; a++)
+      c -= elem.bits.test(a);
+  } else if(elem.sele) {
+    for(size_t a = cNDummyAtoms; a < n_atom; a++)
+      if(elem.sele[a])
+        c++;
+  }
+  return c;
+}
+
+/**
+ * Times one evaluation step while a selection is being profiled
+ * (CSelector::Profile is set), does nothing otherwise.
+ */
+class SelectorProfileScope
+{
+  CSelector* m_I;
+  SelectorProfileRec m_rec;
+  double m_start = 0.0;
+  int m_maps_built = 0;
+
+public:
+  /**
+   * @param op operator, followed by `n_arg` value operands
+   * @param inputs list operands
+   */
+  SelectorProfileScope(CSelector* I, const EvalElem* op, int n_arg,
+      std::initializer_list<const EvalElem*> inputs = {})
+      : m_I(I->Profile ? I : nullptr)
+  {
+    if(!m_I)
+      return;
+    for(auto kw = Keyword; kw->word[0]; kw++) {
+      if(unsigned(kw->value) == op->code) {
+        m_rec.op = kw->word;
+        break;
+      }
+    }
+    for(int a = 1; a <= n_arg; a++) {
+      if(!m_rec.op.empty())
+        m_rec.op += ' ';
+      m_rec.op += op[a].m_text;
+    }
+    for(auto input : inputs)
+      m_rec.atoms_in += SelectorEvalElemCount(*input, I->Table.size());
+    m_maps_built = I->MapsBuilt;
+    m_start = UtilGetSeconds(I->G);
+  }
+
+  /// Records the step, with `result` as its output list
+  void done(const EvalElem& result)
+  {
+    if(!m_I)
+      return;
+    m_rec.seconds = UtilGetSeconds(m_I->G) - m_start;
+    m_rec.maps_built = m_I->MapsBuilt - m_maps_built;
+    m_rec.atoms_out = SelectorEvalElemCount(result, m_I->Table.size());
+    m_I->Profile->push_back(std::move(m_rec));
+    m_I = nullptr;
+  }
+};
+
+/*========================================================================*/
+/**
+ * Reduces the operator stack of a compiled expression to an atom list
+ * @pre Selector table is up-to-date
+ */
+pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
+    const SelectorCompiled& compiled, int state, int quiet)
+{
+  const auto& word = compiled.word;
+  int level;
+  int depth = 0;
+  int a, c = word.size();
+  int ok = true;
+  int opFlag, maxLevel;
+  int totDepth = compiled.totDepth;
+
+  auto Stack = std::vector<EvalElem>(compiled.Stack.size());
+  for(a = 1; a <= totDepth; a++) {
+    Stack[a] = compiled.Stack[a].token();
+  }
+
+  /* lists without ordering tags are kept as bits between operations */
+  auto pack = [G](EvalElem& elem) { elem.pack(G->Selector->Table.size()); };
+
   if(ok) {                      /* this is the main operation loop */
-    totDepth = depth;
     opFlag = true;
     maxLevel = -1;
     for(a = 1; a <= totDepth; a++) {
@@ -9837,7 +10720,10 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
             if(depth > 0)
               if((!opFlag) && (Stack[depth].type == STYP_SEL0)) {
                 opFlag = true;
+                SelectorProfileScope profile(G->Selector, &Stack[depth], 0);
                 ok = SelectorSelect0(G, &Stack[depth]);
+                pack(Stack[depth]);
+                profile.done(Stack[depth]);
               }
           if(ok)
             if(depth > 1)
@@ -9846,8 +10732,11 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                    && (Stack[depth].type == STYP_VALU)) {
                   /* 1 argument selection operator */
                   opFlag = true;
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 1], 1);
                   return_on_error_with_tokens(
                       SelectorSelect1(G, &Stack[depth - 1], quiet));
+                  pack(Stack[depth - 1]);
+                  profile.done(Stack[depth - 1]);
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 1] = std::move(Stack[a]);
                   totDepth--;
@@ -9855,7 +10744,14 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                           && (Stack[depth].type == STYP_LIST)) {
                   /* 1 argument logical operator */
                   opFlag = true;
-                  ok = SelectorLogic1(G, &Stack[depth - 1], state);
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 1], 0,
+                      {&Stack[depth]});
+                  if(!SelectorLogic1Bits(&Stack[depth - 1])) {
+                    Stack[depth].unpack();
+                    ok = SelectorLogic1(G, &Stack[depth - 1], state);
+                    pack(Stack[depth - 1]);
+                  }
+                  profile.done(Stack[depth - 1]);
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 1] = std::move(Stack[a]);
                   totDepth--;
@@ -9888,7 +10784,15 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                    && (Stack[depth].type == STYP_LIST)
                    && (Stack[depth - 2].type == STYP_LIST)) {
                   /* 2 argument logical operator */
-                  ok = SelectorLogic2(G, &Stack[depth - 2]);
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 1], 0,
+                      {&Stack[depth - 2], &Stack[depth]});
+                  if(!SelectorLogic2Bits(&Stack[depth - 2])) {
+                    Stack[depth - 2].unpack();
+                    Stack[depth].unpack();
+                    ok = SelectorLogic2(G, &Stack[depth - 2]);
+                    pack(Stack[depth - 2]);
+                  }
+                  profile.done(Stack[depth - 2]);
                   opFlag = true;
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 2] = std::move(Stack[a]);
@@ -9897,7 +10801,12 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                           && (Stack[depth].type == STYP_PVAL)
                           && (Stack[depth - 2].type == STYP_LIST)) {
                   /* 2 argument logical operator */
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 1], 1,
+                      {&Stack[depth - 2]});
+                  Stack[depth - 2].unpack();
                   ok = SelectorModulate1(G, &Stack[depth - 2], state);
+                  pack(Stack[depth - 2]);
+                  profile.done(Stack[depth - 2]);
                   opFlag = true;
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 2] = std::move(Stack[a]);
@@ -9913,7 +10822,10 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                    && (Stack[depth - 1].type == STYP_VALU)
                    && (Stack[depth].type == STYP_VALU)) {
                   /* 2 argument value operator */
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 2], 2);
                   ok = SelectorSelect2(G, &Stack[depth - 2], state);
+                  pack(Stack[depth - 2]);
+                  profile.done(Stack[depth - 2]);
                   opFlag = true;
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 2] = std::move(Stack[a]);
@@ -9931,8 +10843,11 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                    && (Stack[depth - 1].type == STYP_VALU)
                    && (Stack[depth - 2].type == STYP_VALU)) {
                   /* 2 argument logical operator */
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 3], 3);
                   p_return_if_error(
                       SelectorSelect3(G, &Stack[depth - 3], state));
+                  pack(Stack[depth - 3]);
+                  profile.done(Stack[depth - 3]);
                   opFlag = true;
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 3] = std::move(Stack[a]);
@@ -9952,7 +10867,13 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
                    && (Stack[depth].type == STYP_LIST)
                    && (Stack[depth - 4].type == STYP_LIST)) {
 
+                  SelectorProfileScope profile(G->Selector, &Stack[depth - 3], 2,
+                      {&Stack[depth - 4], &Stack[depth]});
+                  Stack[depth - 4].unpack();
+                  Stack[depth].unpack();
                   ok = SelectorOperator22(G, &Stack[depth - 4], state);
+                  pack(Stack[depth - 4]);
+                  profile.done(Stack[depth - 4]);
                   opFlag = true;
                   for(a = depth + 1; a <= totDepth; a++)
                     Stack[a - 4] = std::move(Stack[a]);
@@ -9989,6 +10910,7 @@ pymol::Result<sele_array_t> SelectorEvaluate(PyMOLGlobals* G,
     return pymol::Error("Invalid selection.");
   }
 
+  Stack[totDepth].unpack();
   return std::move(Stack[totDepth].sele); /* return the selection list */
 }
 
@@ -10097,16 +11019,19 @@ void SelectorMemoryDump(PyMOLGlobals * G)
   auto I = G->SelectorMgr;
   printf(" SelectorMemory: NSelection %d\n", I->NSelection);
   printf(" SelectorMemory: NActive %zu\n", I->Info.size());
-  printf(" SelectorMemory: NMember %d\n", int(I->Member.size()) - 1);
+  std::size_t n_member = 0, n_bytes = 0;
+  for (const auto& item : I->Members) {
+    n_member += item.second.keys.cardinality();
+    n_bytes += item.second.keys.memoryUsage();
+  }
+  printf(" SelectorMemory: NMember %zu (%zu bytes)\n", n_member, n_bytes);
+  printf(" SelectorMemory: NKey %d\n", I->NextKey - 1);
 }
 
 CSelectorManager::CSelectorManager()
 {
   auto I = this;
 
-  // indices are >0 by convention
-  Member.resize(1);
-
   /* create placeholder "all" selection, which is selection 0
      and "none" selection, which is selection 1 */
   I->Info.emplace_back(I->NSelection++, cKeywordAll);
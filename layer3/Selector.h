@@ -17,7 +17,10 @@ Z* -------------------------------------------------------------------
 #ifndef _H_Selector
 #define _H_Selector
 
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include"os_python.h"
 
@@ -40,6 +43,28 @@ int SelectorInitImpl(PyMOLGlobals * G, CSelector **I, short init2);
 /// return type of all SelectorCreate related functions
 typedef pymol::Result<int> SelectorCreateResult_t;
 
+/// Parsed selection expression with resolved keywords, see SelectorCompile
+struct SelectorCompiled;
+typedef std::shared_ptr<const SelectorCompiled> SelectorCompiledPtr;
+
+pymol::Result<SelectorCompiledPtr> SelectorCompile(PyMOLGlobals * G, const char *sele);
+SelectorCreateResult_t SelectorCreateFromCompiled(PyMOLGlobals * G, const char *sname,
+    const SelectorCompiledPtr& compiled, int state, int quiet);
+pymol::Result<int> SelectorCountCompiled(PyMOLGlobals * G,
+    const SelectorCompiledPtr& compiled, int state);
+
+/// One evaluation step of a profiled selection, see SelectorExplain
+struct SelectorProfileRec {
+  std::string op;               // keyword and arguments
+  double seconds = 0.0;
+  int atoms_in = 0;             // selected atoms in the list operands
+  int atoms_out = 0;
+  int maps_built = 0;           // spatial maps built or rebuilt
+};
+
+pymol::Result<std::vector<SelectorProfileRec>> SelectorExplain(
+    PyMOLGlobals * G, const char *sele, int state);
+
 SelectorCreateResult_t SelectorCreate(PyMOLGlobals * G, const char *name, const char *sele, ObjectMolecule * obj,
                    int quiet, Multipick * mp);
 SelectorCreateResult_t SelectorCreateWithStateDomain(PyMOLGlobals * G, const char *name, const char *sele,
@@ -84,6 +109,14 @@ pymol::Result<int> SelectorGetTmpResult(PyMOLGlobals * G, const char *input, cha
 
 pymol::Result<> SelectorLoadCoords(PyMOLGlobals * G, PyObject * coords, int sele, int state);
 PyObject *SelectorGetCoordsAsNumPy(PyMOLGlobals * G, int sele, int state);
+pymol::Result<PyObject*> SelectorGetCoordsStatesAsNumPy(
+    PyMOLGlobals * G, int sele, int first, int last);
+pymol::Result<int> SelectorLoadCoordsStates(
+    PyMOLGlobals * G, PyObject * coords, int sele, int first);
+pymol::Result<PyObject*> SelectorGetAtomColumn(
+    PyMOLGlobals * G, SelectorID_t sele, const char *name);
+pymol::Result<int> SelectorSetAtomColumn(
+    PyMOLGlobals * G, SelectorID_t sele, const char *name, PyObject * values);
 float SelectorSumVDWOverlap(PyMOLGlobals * G, int sele1, int state1,
                             int sele2, int state2, float adjust);
 int SelectorVdwFit(PyMOLGlobals * G, int sele1, int state1, int sele2, int state2,
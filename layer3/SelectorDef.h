@@ -10,6 +10,8 @@
 #include "pymol/memory.h"
 
 #include "AtomIterators.h"
+#include "RoaringBitmap.h"
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -44,19 +46,50 @@ struct SelectionInfoRec {
 };
 
 
-struct MemberType {
-  SelectorID_t selection;
-  int tag;                      /* must not be zero since it is also used as a boolean test for membership */
-  SelectorMemberOffset_t next;
+/**
+ * Atoms of a named selection, by membership key (AtomInfoType::selEntry).
+ * Only ordered selections store tags, all other members have tag 1.
+ */
+struct SelectionMembers {
+  pymol::RoaringBitmap keys;
+  std::unordered_map<SelectorMemberOffset_t, int> tags; // tag != 1 only
+
+  int tag(SelectorMemberOffset_t key) const
+  {
+    if (!keys.contains(key))
+      return 0;
+    if (tags.empty())
+      return 1;
+    auto it = tags.find(key);
+    return it == tags.end() ? 1 : it->second;
+  }
 };
 
+/**
+ * Atoms of an object by value of one interned identifier field (e.g. all
+ * atoms with resn POPC), see SelectorGetLexPostings
+ */
+struct SelectorLexPostings {
+  int offset = -1;             // lexidx_t field in AtomInfoType
+  unsigned atomGeneration = 0; // ObjectMolecule::AtomGeneration
+  unsigned lexGeneration = 0;  // ObjectMolecule::LexGeneration
+  int nAtom = 0;
+  std::unordered_map<lexidx_t, std::vector<int>> atoms;
+};
+
+struct SelectorCompiled;
+struct SelectorProfileRec;
+
 struct CSelectorManager
 {
-  std::vector<MemberType> Member;
-  SelectorMemberOffset_t FreeMember = 0;
+  std::unordered_map<SelectorID_t, SelectionMembers> Members; // by selection ID
+  std::vector<SelectorMemberOffset_t> FreeKeys; // keys of deleted atoms
+  SelectorMemberOffset_t NextKey = 1; // 0 means "no key yet"
   std::vector<SelectionInfoRec> Info;
   SelectorID_t NSelection = 0;
   std::unordered_map<std::string, int> Key;
+  std::unordered_map<std::string, std::shared_ptr<SelectorCompiled>> Compiled; // by expression, see SelectorCompile
+  std::unordered_map<const ObjectMolecule*, std::vector<SelectorLexPostings>> LexPostings; // by object
   CSelectorManager();
 };
 
@@ -69,6 +102,9 @@ struct CSelector {
   pymol::cache_ptr<ObjectMolecule> Center;
   int NCSet = 0; // Seems to hold the largest NCSet in Obj
   bool SeleBaseOffsetsValid = false;
+  std::vector<std::size_t> TableKey; // what Table was built from, see SelectorUpdateTableImpl
+  std::vector<SelectorProfileRec>* Profile = nullptr; // see SelectorExplain
+  int MapsBuilt = 0; // spatial maps built by SelectorNeighborSearch
   CSelector(PyMOLGlobals* G, CSelectorManager* mgr);
   CSelector(const CSelector&) = default;
   CSelector& operator=(const CSelector&) = default;
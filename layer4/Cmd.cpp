@@ -445,91 +445,6 @@ static PyObject *CmdFixChemistry(PyObject * self, PyObject * args)
   return APIResult(G, result);
 }
 
-static PyObject *CmdRayAntiThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  PyObject *py_thread_info;
-  API_SETUP_ARGS(G, self, args, "OO", &self, &py_thread_info);
-
-  auto thread_info = reinterpret_cast<CRayAntiThreadInfo*>(
-      PyCapsule_GetPointer(py_thread_info, nullptr));
-  API_ASSERT(thread_info);
-
-  PUnblock(G);
-  RayAntiThread(thread_info);
-  PBlock(G);
-
-  return APISuccess();
-}
-
-static PyObject *CmdRayHashThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  PyObject *py_thread_info;
-  API_SETUP_ARGS(G, self, args, "OO", &self, &py_thread_info);
-
-  auto thread_info = reinterpret_cast<CRayHashThreadInfo*>(
-      PyCapsule_GetPointer(py_thread_info, nullptr));
-  API_ASSERT(thread_info);
-
-  PUnblock(G);
-  RayHashThread(thread_info);
-  PBlock(G);
-
-  return APISuccess();
-}
-
-static PyObject *CmdRayTraceThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  PyObject *py_thread_info;
-  API_SETUP_ARGS(G, self, args, "OO", &self, &py_thread_info);
-
-  auto thread_info = reinterpret_cast<CRayThreadInfo*>(
-      PyCapsule_GetPointer(py_thread_info, nullptr));
-  API_ASSERT(thread_info);
-
-  PUnblock(G);
-  RayTraceThread(thread_info);
-  PBlock(G);
-
-  return APISuccess();
-}
-
-static PyObject *CmdCoordSetUpdateThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  PyObject *py_thread_info;
-  API_SETUP_ARGS(G, self, args, "OO", &self, &py_thread_info);
-
-  auto thread_info = reinterpret_cast<CCoordSetUpdateThreadInfo*>(
-      PyCapsule_GetPointer(py_thread_info, nullptr));
-  API_ASSERT(thread_info);
-
-  PUnblock(G);
-  CoordSetUpdateThread(thread_info);
-  PBlock(G);
-
-  return APISuccess();
-}
-
-static PyObject *CmdObjectUpdateThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  PyObject *py_thread_info;
-  API_SETUP_ARGS(G, self, args, "OO", &self, &py_thread_info);
-
-  auto thread_info = reinterpret_cast<CObjectUpdateThreadInfo*>(
-      PyCapsule_GetPointer(py_thread_info, nullptr));
-  API_ASSERT(thread_info);
-
-  PUnblock(G);
-  SceneObjectUpdateThread(thread_info);
-  PBlock(G);
-
-  return APISuccess();
-}
-
 static PyObject *CmdGetMovieLocked(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -2031,6 +1946,53 @@ static PyObject *CmdGetCoordsAsNumPy(PyObject * self, PyObject * args)
   return (APIAutoNone(result));
 }
 
+static PyObject *CmdGetCoordsStatesAsNumPy(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *str1;
+  int first = 0, last = -1;
+  API_SETUP_ARGS(G, self, args, "Os|ii", &self, &str1, &first, &last);
+  APIEnterBlocked(G);
+  auto res = [&]() -> pymol::Result<PyObject*> {
+    auto tmpsele1 = SelectorTmp::make(G, str1);
+    p_return_if_error(tmpsele1);
+    return SelectorGetCoordsStatesAsNumPy(G, tmpsele1->getIndex(), first, last);
+  }();
+  APIExitBlocked(G);
+  return APIResult(G, res);
+}
+
+static PyObject *CmdGetAtomColumn(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *str1, *name;
+  API_SETUP_ARGS(G, self, args, "Oss", &self, &str1, &name);
+  APIEnterBlocked(G);
+  auto res = [&]() -> pymol::Result<PyObject*> {
+    auto tmpsele1 = SelectorTmp::make(G, str1);
+    p_return_if_error(tmpsele1);
+    return SelectorGetAtomColumn(G, tmpsele1->getIndex(), name);
+  }();
+  APIExitBlocked(G);
+  return APIResult(G, res);
+}
+
+static PyObject *CmdSetAtomColumn(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *str1, *name;
+  PyObject *values;
+  API_SETUP_ARGS(G, self, args, "OssO", &self, &str1, &name, &values);
+  API_ASSERT(APIEnterBlockedNotModal(G));
+  auto res = [&]() -> pymol::Result<int> {
+    auto tmpsele1 = SelectorTmp::make(G, str1);
+    p_return_if_error(tmpsele1);
+    return SelectorSetAtomColumn(G, tmpsele1->getIndex(), name, values);
+  }();
+  APIExitBlocked(G);
+  return APIResult(G, res);
+}
+
 static PyObject *CmdGetCoordSetAsNumPy(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -2105,6 +2067,19 @@ static PyObject *CmdGetView(PyObject * self, PyObject * args)
   }
 }
 
+static PyObject *CmdGetRayTiming(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  API_SETUP_ARGS(G, self, args, "O", &self);
+  APIEnter(G);
+  RayTiming t = *SceneRayGetTiming(G);
+  APIExit(G);
+  return Py_BuildValue("{s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:i,s:i}",
+      "geometry", t.Geometry, "expand", t.Expand, "map", t.Map,
+      "trace", t.Trace, "edge", t.Edge, "antialias", t.Antialias,
+      "total", t.Total, "primitives", t.NPrimitive, "threads", t.NThread);
+}
+
 static PyObject *CmdGetViewPort(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -5380,6 +5355,74 @@ static PyObject *CmdSelect(PyObject * self, PyObject * args)
   return APIResult(G, res);
 }
 
+static void SelectorCompiledCapsuleDestructor(PyObject* capsule)
+{
+  delete static_cast<SelectorCompiledPtr*>(
+      PyCapsule_GetPointer(capsule, "SelectorCompiled"));
+}
+
+static PyObject *CmdCompileSelection(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *sele;
+  API_SETUP_ARGS(G, self, args, "Os", &self, &sele);
+  API_ASSERT(APIEnterNotModal(G));
+  auto res = SelectorCompile(G, sele);
+  APIExit(G);
+  if (!res)
+    return APIFailure(G, res.error());
+  return PyCapsule_New(new SelectorCompiledPtr(res.result()),
+      "SelectorCompiled", SelectorCompiledCapsuleDestructor);
+}
+
+/**
+ * Evaluates a compiled selection. Creates a named selection, or just
+ * counts the atoms if the name is empty.
+ */
+static PyObject *CmdSelectCompiled(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  PyObject *capsule;
+  char *sname;
+  int state, quiet, enable;
+  API_SETUP_ARGS(G, self, args, "OOsiii", &self, &capsule, &sname, &state,
+      &quiet, &enable);
+  auto compiled = static_cast<SelectorCompiledPtr*>(
+      PyCapsule_GetPointer(capsule, "SelectorCompiled"));
+  API_ASSERT(compiled);
+  API_ASSERT(APIEnterNotModal(G));
+  auto res = sname[0]
+                 ? ExecutiveSelectCompiled(G, sname, *compiled, enable, quiet, state)
+                 : SelectorCountCompiled(G, *compiled, state);
+  APIExit(G);
+  return APIResult(G, res);
+}
+
+/**
+ * Profiles a selection, returns one (op, seconds, atoms_in, atoms_out,
+ * maps_built) tuple per evaluation step
+ */
+static PyObject *CmdExplainSelection(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *sele;
+  int state;
+  API_SETUP_ARGS(G, self, args, "Osi", &self, &sele, &state);
+  API_ASSERT(APIEnterNotModal(G));
+  auto res = SelectorExplain(G, sele, state);
+  APIExit(G);
+  if (!res)
+    return APIFailure(G, res.error());
+  PyObject* result = PyList_New(res.result().size());
+  for (size_t i = 0; i < res.result().size(); ++i) {
+    auto& rec = res.result()[i];
+    PyList_SetItem(result, i,
+        Py_BuildValue("(sdiii)", rec.op.c_str(), rec.seconds, rec.atoms_in,
+            rec.atoms_out, rec.maps_built));
+  }
+  return result;
+}
+
 static PyObject *CmdFinishObject(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -5497,6 +5540,28 @@ static PyObject *CmdLoadCoords(PyObject * self, PyObject * args)
   return APIResult(G, result);
 }
 
+static PyObject *CmdLoadCoordsStates(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *str1;
+  int first = 0;
+  PyObject *coords = NULL;
+  API_SETUP_ARGS(G, self, args, "OsO|i", &self, &str1, &coords, &first);
+  API_ASSERT(APIEnterBlockedNotModal(G));
+  auto res = [&]() -> pymol::Result<int> {
+    auto tmpsele1 = SelectorTmp::make(G, str1);
+    p_return_if_error(tmpsele1);
+    return SelectorLoadCoordsStates(G, coords, tmpsele1->getIndex(), first);
+  }();
+  APIExitBlocked(G);
+
+  if (!res && PyErr_Occurred()) {
+    return nullptr;
+  }
+
+  return APIResult(G, res);
+}
+
 static PyObject *CmdLoadCoordSet(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -6287,7 +6352,7 @@ static PyMethodDef Cmd_methods[] = {
   {"color", CmdColor, METH_VARARGS},
   {"colordef", CmdColorDef, METH_VARARGS},
   {"combine_object_ttt", CmdCombineObjectTTT, METH_VARARGS},
-  {"coordset_update_thread", CmdCoordSetUpdateThread, METH_VARARGS},
+  {"compile_selection", CmdCompileSelection, METH_VARARGS},
   {"copy", CmdCopy, METH_VARARGS},
   {"create", CmdCreate, METH_VARARGS},
   {"count_states", CmdCountStates, METH_VARARGS},
@@ -6308,6 +6373,7 @@ static PyMethodDef Cmd_methods[] = {
   {"drag", CmdDrag, METH_VARARGS},
   {"dump", CmdDump, METH_VARARGS},
   {"edit", CmdEdit, METH_VARARGS},
+  {"explain_selection", CmdExplainSelection, METH_VARARGS},
   {"torsion", CmdTorsion, METH_VARARGS},
   {"feedback", CmdFeedback, METH_VARARGS},
   {"find_pairs", CmdFindPairs, METH_VARARGS},
@@ -6334,7 +6400,9 @@ static PyMethodDef Cmd_methods[] = {
   {"get_collada", CmdGetCOLLADA, METH_VARARGS},
   {"get_color", CmdGetColor, METH_VARARGS},
   {"get_colorection", CmdGetColorection, METH_VARARGS},
+  {"get_atom_column", CmdGetAtomColumn, METH_VARARGS},
   {"get_coords", CmdGetCoordsAsNumPy, METH_VARARGS},
+  {"get_coords_states", CmdGetCoordsStatesAsNumPy, METH_VARARGS},
   {"get_coordset", CmdGetCoordSetAsNumPy, METH_VARARGS},
   {"get_distance", CmdGetDistance, METH_VARARGS},
   {"get_dihe", CmdGetDihe, METH_VARARGS},
@@ -6383,6 +6451,7 @@ static PyMethodDef Cmd_methods[] = {
   {"get_unused_name", CmdGetUnusedName, METH_VARARGS},
   {"get_version", CmdGetVersion, METH_VARARGS},
   {"get_view", CmdGetView, METH_VARARGS},
+  {"get_ray_timing", CmdGetRayTiming, METH_VARARGS},
   {"get_viewport", CmdGetViewPort, METH_VARARGS},
   {"get_vis", CmdGetVis, METH_VARARGS},
   {"get_capabilities", CmdGetCapabilities, METH_NOARGS, "Get a set of compiled-in capabilities"},
@@ -6413,6 +6482,7 @@ static PyMethodDef Cmd_methods[] = {
   {"load", CmdLoad, METH_VARARGS},
   {"load_color_table", CmdLoadColorTable, METH_VARARGS},
   {"load_coords", CmdLoadCoords, METH_VARARGS},
+  {"load_coords_states", CmdLoadCoordsStates, METH_VARARGS},
   {"load_coordset", CmdLoadCoordSet, METH_VARARGS},
   {"load_png", CmdLoadPNG, METH_VARARGS},
   {"load_object", CmdLoadObject, METH_VARARGS},
@@ -6438,7 +6508,6 @@ static PyMethodDef Cmd_methods[] = {
   {"mpng_", CmdMPNG, METH_VARARGS},
   {"mmatrix", CmdMMatrix, METH_VARARGS},
   {"mview", CmdMView, METH_VARARGS},
-  {"object_update_thread", CmdObjectUpdateThread, METH_VARARGS},
   {"origin", CmdOrigin, METH_VARARGS},
   {"orient", CmdOrient, METH_VARARGS},
   {"onoff", CmdOnOff, METH_VARARGS},
@@ -6457,9 +6526,6 @@ static PyMethodDef Cmd_methods[] = {
   {"pbc_unwrap", CmdPBCUnwrap, METH_VARARGS},
   {"pbc_wrap", CmdPBCWrap, METH_VARARGS},
   {"quit", CmdQuit, METH_VARARGS},
-  {"ray_trace_thread", CmdRayTraceThread, METH_VARARGS},
-  {"ray_hash_thread", CmdRayHashThread, METH_VARARGS},
-  {"ray_anti_thread", CmdRayAntiThread, METH_VARARGS},
   {"ramp_new", CmdRampNew, METH_VARARGS},
   {"ready", CmdReady, METH_VARARGS},
   {"rebuild", CmdRebuild, METH_VARARGS},
@@ -6482,8 +6548,10 @@ static PyMethodDef Cmd_methods[] = {
   {"rock", CmdRock, METH_VARARGS},
   {"runpymol", CmdRunPyMOL, METH_VARARGS},
   {"select", CmdSelect, METH_VARARGS},
+  {"select_compiled", CmdSelectCompiled, METH_VARARGS},
   {"select_list", CmdSelectList, METH_VARARGS},
   {"set", CmdSet, METH_VARARGS},
+  {"set_atom_column", CmdSetAtomColumn, METH_VARARGS},
   {"set_bond", CmdSetBond, METH_VARARGS},
   {"get_bond", CmdGetBond, METH_VARARGS},
   {"scene", CmdScene, METH_VARARGS},
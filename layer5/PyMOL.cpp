@@ -42,6 +42,7 @@
 #include "Sphere.h"
 #include "Setting.h"
 #include "Ray.h"
+#include "RayProgress.h"
 #include "Util.h"
 #include "Movie.h"
 #include "P.h"
@@ -1906,6 +1907,7 @@ void PyMOL_Start(CPyMOL * I)
   TextInit(G);
   CharacterInit(G);
   PlugIOManagerInit(G);
+  RayProgressInit(G);
   SphereInit(G);
   // OpenVRInit() called in ExecutiveStereo
   OrthoInit(G, G->Option->show_splash);
@@ -2001,6 +2003,7 @@ void PyMOL_Stop(CPyMOL * I)
   TextureFree(G);
   SphereFree(G);
   PlugIOManagerFree(G);
+  RayProgressFree(G);
   PFree(G);
   CGORendererFree(G);
   ColorFree(G);
@@ -2838,6 +2841,49 @@ void PyMOL_SetInterrupt(CPyMOL * I, int value)
   }
 }
 
+void PyMOL_SetRayTileFn(CPyMOL * I, PyMOLRayTileFn * fn, void *data)
+{                               /* lock intentionally omitted */
+  if(I->G->RayProgress)
+    I->G->RayProgress->setCallback(fn, data);
+}
+
+PyMOLreturn_int_array PyMOL_GetRayTiles(CPyMOL * I, int reset)
+{                               /* lock intentionally omitted */
+  PyMOLreturn_int_array result = { PyMOLstatus_FAILURE, 0, NULL };
+  if(I->G->RayProgress) {
+    auto tiles = I->G->RayProgress->getTiles(reset);
+    result.array = VLAlloc(int, tiles.size());
+    if(result.array) {
+      std::copy(tiles.begin(), tiles.end(), result.array);
+      result.size = tiles.size();
+      result.status = PyMOLstatus_SUCCESS;
+    }
+  }
+  return result;
+}
+
+PyMOLreturn_int_array PyMOL_GetRayImageSize(CPyMOL * I)
+{                               /* lock intentionally omitted */
+  PyMOLreturn_int_array result = { PyMOLstatus_FAILURE, 2, NULL };
+  if(I->G->RayProgress) {
+    result.array = VLAlloc(int, 2);
+    if(result.array) {
+      result.array[0] = I->G->RayProgress->getWidth();
+      result.array[1] = I->G->RayProgress->getHeight();
+      result.status = PyMOLstatus_SUCCESS;
+    }
+  }
+  return result;
+}
+
+int PyMOL_GetRayTileData(CPyMOL * I, int x, int y, int width, int height,
+                         int row_bytes, void *buffer)
+{                               /* lock intentionally omitted */
+  int ok = I->G->RayProgress &&
+    I->G->RayProgress->copy(x, y, width, height, row_bytes, buffer);
+  return get_status_ok(ok);
+}
+
 void PyMOL_Drag(CPyMOL * I, int x, int y, int modifiers)
 {
   PYMOL_API_LOCK OrthoDrag(I->G, x, y, modifiers);
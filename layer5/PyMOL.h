@@ -324,6 +324,22 @@ int PyMOL_GetProgressChanged(CPyMOL * I, int reset);
 int PyMOL_GetInterrupt(CPyMOL * I, int reset);
 void PyMOL_SetInterrupt(CPyMOL * I, int value);
 
+/* progressive ray tracing (ray_progressive): partial images while the ray
+   tracer is still working. Tiles are given as x, y, width, height, pass
+   (0: preview, 1: trace, 2: edge oversampling, 3: final image) in pixels
+   of the ray traced image, with y = 0 at the bottom row. Pixels are RGBA
+   and are not gamma corrected until the final image. The callback is
+   called from the tracer threads; all of these may be called while the
+   ray tracer holds the API lock. */
+
+typedef void PyMOLRayTileFn(void *data, int x, int y, int width, int height, int pass);
+
+void PyMOL_SetRayTileFn(CPyMOL * I, PyMOLRayTileFn * fn, void *data);
+PyMOLreturn_int_array PyMOL_GetRayTiles(CPyMOL * I, int reset);
+PyMOLreturn_int_array PyMOL_GetRayImageSize(CPyMOL * I);
+int PyMOL_GetRayTileData(CPyMOL * I, int x, int y, int width, int height,
+                         int row_bytes, void *buffer);
+
 
 /* modal updates -- PyMOL is busy with some complex task, but we have
    to return control to the host in order to get a valid draw callback */
@@ -0,0 +1,144 @@
+#include "Test.h"
+
+#include <set>
+
+#include "BVH.h"
+
+// unit boxes centered at (2 * i, 0, 0)
+static std::vector<float> row_of_boxes(int n)
+{
+  std::vector<float> bounds;
+  for (int i = 0; i < n; ++i) {
+    float x = 2.0F * i;
+    bounds.insert(bounds.end(), {x - 0.5F, -0.5F, -0.5F, x + 0.5F, 0.5F, 0.5F});
+  }
+  return bounds;
+}
+
+TEST_CASE("BVH leaves list every element once", "[BVH]")
+{
+  const int n = 100;
+  auto bounds = row_of_boxes(n);
+  std::vector<int> ids(n);
+  for (int i = 0; i < n; ++i)
+    ids[i] = 1000 + i;
+
+  BVHType bvh;
+  REQUIRE(bvh.build(n, bounds.data(), ids.data(), 4));
+  REQUIRE(bvh.EList[0] == -1);
+
+  std::multiset<int> seen;
+  for (auto& node : bvh.Nodes) {
+    if (!node.Count)
+      continue;
+    REQUIRE(node.First > 0);
+    REQUIRE(node.Count <= 4);
+    for (int k = 0; k < node.Count; ++k)
+      seen.insert(bvh.EList[node.First + k]);
+    REQUIRE(bvh.EList[node.First + node.Count] == -1);
+  }
+  REQUIRE(seen.size() == n);
+  REQUIRE(std::set<int>(seen.begin(), seen.end()).size() == n);
+}
+
+TEST_CASE("BVHWalker visits leaves front to back", "[BVH]")
+{
+  const int n = 50;
+  auto bounds = row_of_boxes(n);
+
+  BVHType bvh;
+  bvh.build(n, bounds.data(), nullptr, 1);
+
+  // ray along -x from beyond the last box
+  const float org[3] = {2.0F * n, 0.0F, 0.0F};
+  const float dir[3] = {-1.0F, 0.0F, 0.0F};
+
+  BVHStats stats;
+  BVHWalker walker;
+  walker.init(&bvh, org, dir, 0.0F, &stats);
+
+  int last = n, count = 0, h;
+  while ((h = walker.next(1e6F))) {
+    int i = bvh.EList[h];
+    REQUIRE(i < last);
+    last = i;
+    ++count;
+  }
+  REQUIRE(count == n);
+  REQUIRE(stats.NLeaf == n);
+  REQUIRE(stats.NNode >= stats.NLeaf);
+}
+
+TEST_CASE("BVHWalker culls by distance and misses", "[BVH]")
+{
+  auto bounds = row_of_boxes(10);
+
+  BVHType bvh;
+  bvh.build(10, bounds.data(), nullptr, 1);
+
+  BVHWalker walker;
+  const float dir[3] = {0.0F, 0.0F, -1.0F};
+
+  // axis-parallel ray through box 3 only
+  const float org[3] = {6.0F, 0.0F, 10.0F};
+  walker.init(&bvh, org, dir, 0.0F);
+  int h = walker.next(1e6F);
+  REQUIRE(h);
+  REQUIRE(bvh.EList[h] == 3);
+  REQUIRE(!walker.next(1e6F));
+
+  // same ray, but the box starts beyond the limit
+  walker.init(&bvh, org, dir, 0.0F);
+  REQUIRE(!walker.next(5.0F));
+
+  // ray between two boxes
+  const float gap[3] = {5.0F, 0.0F, 10.0F};
+  walker.init(&bvh, gap, dir, 0.0F);
+  REQUIRE(!walker.next(1e6F));
+}
+
+TEST_CASE("BVH refit follows moved elements", "[BVH]")
+{
+  const int n = 20;
+  auto bounds = row_of_boxes(n);
+
+  BVHType bvh;
+  bvh.build(n, bounds.data(), nullptr, 2);
+  size_t n_nodes = bvh.Nodes.size();
+
+  // same boxes along y instead of x
+  std::vector<float> moved(bounds.size());
+  for (int i = 0; i < n; ++i) {
+    const float *b = bounds.data() + 6 * i;
+    float *m = moved.data() + 6 * i;
+    m[0] = b[1]; m[1] = b[0]; m[2] = b[2];
+    m[3] = b[4]; m[4] = b[3]; m[5] = b[5];
+  }
+
+  bvh.refit([&](int i, float *lo, float *hi) {
+    std::copy(moved.data() + 6 * i, moved.data() + 6 * i + 3, lo);
+    std::copy(moved.data() + 6 * i + 3, moved.data() + 6 * i + 6, hi);
+    return i != 0; // element 0 is empty now
+  });
+  REQUIRE(bvh.Nodes.size() == n_nodes);
+  REQUIRE(bvh.Nodes[0].Min[1] == Approx(1.5F));
+  REQUIRE(bvh.Nodes[0].Max[1] == Approx(2.0F * (n - 1) + 0.5F));
+
+  // ray along -z through box 3 at its new place
+  const float org[3] = {0.0F, 6.0F, 10.0F};
+  const float dir[3] = {0.0F, 0.0F, -1.0F};
+  BVHWalker walker;
+  walker.init(&bvh, org, dir, 0.0F);
+  std::set<int> seen;
+  int h;
+  while ((h = walker.next(1e6F))) {
+    for (const int *ip = bvh.EList.data() + h; *ip >= 0; ++ip)
+      seen.insert(*ip);
+  }
+  REQUIRE(seen.count(3));
+
+  // nothing left where element 0 was
+  const float old_org[3] = {0.0F, 0.0F, 10.0F};
+  walker.init(&bvh, old_org, dir, 0.0F);
+  REQUIRE(!walker.next(1e6F));
+}
@@ -0,0 +1,59 @@
+#include "Test.h"
+
+#include "Bitset.h"
+
+TEST_CASE("Bitset packs boolean arrays", "[Bitset]")
+{
+  std::vector<int> values(130, 0);
+  values[0] = values[64] = values[129] = 1;
+
+  pymol::Bitset bits;
+  REQUIRE(bits.assignBool(values.data(), values.size()));
+  REQUIRE(bits.size() == 130);
+  REQUIRE(bits.count() == 3);
+  REQUIRE(bits.test(64));
+  REQUIRE(!bits.test(63));
+
+  std::vector<int> out(values.size(), 5);
+  bits.copyTo(out.data());
+  REQUIRE(out == values);
+
+  // ordering tags can't be packed
+  values[3] = 2;
+  REQUIRE(!bits.assignBool(values.data(), values.size()));
+  REQUIRE(bits.empty());
+}
+
+TEST_CASE("Bitset logical operators", "[Bitset]")
+{
+  const std::size_t n = 70;
+  pymol::Bitset a(n), b(n);
+  a.set(1);
+  a.set(2);
+  a.set(69);
+  b.set(2);
+  b.set(3);
+
+  auto c = a;
+  c |= b;
+  REQUIRE(c.count() == 4);
+
+  c = a;
+  c &= b;
+  REQUIRE(c.count() == 1);
+  REQUIRE(c.test(2));
+
+  c = a;
+  c.andNot(b);
+  REQUIRE(c.count() == 2);
+  REQUIRE(!c.test(2));
+
+  // bits past size() stay clear
+  c.flip();
+  REQUIRE(c.count() == n - 2);
+  c.flip();
+  REQUIRE(c.count() == 2);
+
+  REQUIRE(c == c);
+  REQUIRE(!(c == a));
+}
@@ -0,0 +1,173 @@
+#include "Test.h"
+
+#include <map>
+#include <utility>
+
+#include "GridSurface.h"
+
+static float distance3(const float* a, const float* b)
+{
+  float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/**
+ * Every edge is shared by exactly two triangles, with opposite directions
+ */
+static bool isClosedManifold(const pymol::GridSurfaceMesh& mesh)
+{
+  std::map<std::pair<int, int>, int> edges;
+  for (size_t t = 0; t < mesh.tri.size(); t += 3) {
+    for (int e = 0; e < 3; ++e) {
+      int a = mesh.tri[t + e], b = mesh.tri[t + (e + 1) % 3];
+      if (++edges[{a, b}] != 1)
+        return false;
+    }
+  }
+  for (auto& edge : edges) {
+    if (!edges.count({edge.first.second, edge.first.first}))
+      return false;
+  }
+  return true;
+}
+
+TEST_CASE("GridSurface single atom", "[GridSurface]")
+{
+  const float coord[3] = {1.F, 2.F, 3.F};
+  const float vdw[1] = {1.5F};
+
+  pymol::GridSurfaceParams params;
+  params.spacing = 0.1F; // several bricks
+  params.n_thread = 2;
+
+  pymol::GridSurfaceMesh mesh;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, nullptr, 1, params, mesh));
+  REQUIRE(mesh.triangleCount() > 100);
+  REQUIRE(mesh.vn.size() == mesh.v.size());
+  REQUIRE(isClosedManifold(mesh));
+
+  for (size_t i = 0; i < mesh.vertexCount(); ++i) {
+    const float* v = &mesh.v[i * 3];
+    const float* vn = &mesh.vn[i * 3];
+    REQUIRE(std::abs(distance3(v, coord) - 1.5F) < params.spacing);
+    float radial = 0.F;
+    for (int d = 0; d < 3; ++d)
+      radial += vn[d] * (v[d] - coord[d]) / 1.5F;
+    REQUIRE(radial > 0.9F);
+  }
+
+  // solvent accessible
+  params.solvent_accessible = true;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, nullptr, 1, params, mesh));
+  REQUIRE(isClosedManifold(mesh));
+  for (size_t i = 0; i < mesh.vertexCount(); ++i) {
+    REQUIRE(std::abs(distance3(&mesh.v[i * 3], coord) - 2.9F) < 0.01F);
+  }
+
+  // no present atoms
+  const int present[1] = {0};
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, present, 1, params, mesh));
+  REQUIRE(mesh.triangleCount() == 0);
+}
+
+TEST_CASE("GridSurface atom pair", "[GridSurface]")
+{
+  const float coord[9] = {0.F, 0.F, 0.F, 3.F, 0.F, 0.F, 20.F, 0.F, 0.F};
+  const float vdw[3] = {1.6F, 1.6F, 1.6F};
+  const int present[3] = {1, 1, 0};
+
+  pymol::GridSurfaceParams params;
+  params.spacing = 0.2F;
+
+  pymol::GridSurfaceMesh serial;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, present, 3, params, serial));
+  REQUIRE(isClosedManifold(serial));
+
+  float min_x = 1e9F, max_x = -1e9F;
+  for (size_t i = 0; i < serial.vertexCount(); ++i) {
+    const float* v = &serial.v[i * 3];
+    // on or outside of the vdw spheres
+    float d = std::min(distance3(v, coord), distance3(v, coord + 3));
+    REQUIRE(d > 1.6F - params.spacing);
+    min_x = std::min(min_x, v[0]);
+    max_x = std::max(max_x, v[0]);
+  }
+  REQUIRE(min_x == Approx(-1.6F).margin(params.spacing));
+  REQUIRE(max_x == Approx(4.6F).margin(params.spacing));
+
+  // the probe doesn't fit between the atoms, the reentrant surface bridges
+  // the gap at x = 1.5 well outside of the vdw spheres (radius 0.67)
+  float min_r_mid = 1e9F;
+  for (size_t i = 0; i < serial.vertexCount(); ++i) {
+    const float* v = &serial.v[i * 3];
+    if (std::abs(v[0] - 1.5F) < 0.1F)
+      min_r_mid = std::min(min_r_mid, std::sqrt(v[1] * v[1] + v[2] * v[2]));
+  }
+  REQUIRE(min_r_mid > 1.0F);
+
+  // same result with threads
+  params.n_thread = 4;
+  pymol::GridSurfaceMesh threaded;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, present, 3, params, threaded));
+  REQUIRE(threaded.v == serial.v);
+  REQUIRE(threaded.vn == serial.vn);
+  REQUIRE(threaded.tri == serial.tri);
+}
+
+TEST_CASE("GridSurface interrupt", "[GridSurface]")
+{
+  const float coord[3] = {0.F, 0.F, 0.F};
+  const float vdw[1] = {1.5F};
+  const int interrupt = 1;
+
+  pymol::GridSurfaceParams params;
+  params.interrupt = &interrupt;
+
+  pymol::GridSurfaceMesh mesh;
+  REQUIRE(!pymol::GridSurfaceGenerate(coord, vdw, nullptr, 1, params, mesh));
+}
+
+TEST_CASE("GridSurface cache", "[GridSurface]")
+{
+  // two atoms far apart, in different bricks
+  float coord[6] = {0.F, 0.F, 0.F, 60.F, 0.F, 0.F};
+  const float vdw[2] = {1.6F, 1.6F};
+
+  pymol::GridSurfaceCache cache;
+  pymol::GridSurfaceParams params;
+  params.spacing = 0.25F;
+  params.cache = &cache;
+
+  pymol::GridSurfaceMesh first;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, nullptr, 2, params, first));
+  REQUIRE(first.n_brick > 1);
+  REQUIRE(first.n_brick_reused == 0);
+  REQUIRE(cache.size() == first.n_brick);
+
+  // nothing changed
+  pymol::GridSurfaceMesh second;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, nullptr, 2, params, second));
+  REQUIRE(second.n_brick_reused == second.n_brick);
+  REQUIRE(second.v == first.v);
+  REQUIRE(second.vn == first.vn);
+  REQUIRE(second.tri == first.tri);
+
+  // move one atom, only its bricks get recomputed
+  coord[3] += 0.3F;
+  pymol::GridSurfaceMesh moved;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, nullptr, 2, params, moved));
+  REQUIRE(moved.n_brick_reused > 0);
+  REQUIRE(moved.n_brick_reused < moved.n_brick);
+
+  params.cache = nullptr;
+  pymol::GridSurfaceMesh uncached;
+  REQUIRE(pymol::GridSurfaceGenerate(coord, vdw, nullptr, 2, params, uncached));
+  REQUIRE(uncached.n_brick_reused == 0);
+  REQUIRE(moved.v == uncached.v);
+  REQUIRE(moved.vn == uncached.vn);
+  REQUIRE(moved.tri == uncached.tri);
+  REQUIRE(isClosedManifold(moved));
+
+  cache.clear();
+  REQUIRE(cache.size() == 0);
+}
@@ -0,0 +1,42 @@
+#include "Test.h"
+
+#include <cstdio>
+
+#include "MovieEncoder.h"
+#include "MyPNG.h"
+
+TEST_CASE("MovieEncoder writes every frame", "[MovieEncoder]")
+{
+  const int n_frame = 8;
+  std::vector<std::string> fnames;
+  {
+    CMovieEncoder encoder(2, 3);
+    for (int i = 0; i < n_frame; ++i) {
+      fnames.push_back(pymol::string_format("_movie_encoder_%04d.ppm", i));
+      auto image = std::make_shared<pymol::Image>(4, 3);
+      std::fill(image->pixels(), image->pixels() + 12, 0xFF000000u | i);
+      encoder.push({fnames.back(), image, 72.0F, cMyPNG_FormatPPM, 1.0F, 1.0F});
+    }
+    encoder.finish();
+    REQUIRE(encoder.takeFailures().empty());
+  }
+  for (auto& fname : fnames) {
+    FILE* fp = fopen(fname.c_str(), "rb");
+    REQUIRE(fp);
+    fclose(fp);
+    remove(fname.c_str());
+  }
+}
+
+TEST_CASE("MovieEncoder reports failed writes", "[MovieEncoder]")
+{
+  CMovieEncoder encoder(1, 1);
+  auto image = std::make_shared<pymol::Image>(2, 2);
+  encoder.push({"_no_such_dir/frame.png", image, 72.0F, cMyPNG_FormatPNG,
+      1.0F, 1.0F});
+  encoder.finish();
+  auto failures = encoder.takeFailures();
+  REQUIRE(failures.size() == 1);
+  REQUIRE(failures[0] == "_no_such_dir/frame.png");
+  REQUIRE(encoder.takeFailures().empty());
+}
@@ -0,0 +1,63 @@
+#include "Test.h"
+
+#include "Ray.h"
+#include "Vector.h"
+
+TEST_CASE("CRay instances need a recorded prototype", "[Ray]")
+{
+  CRay ray{};
+  float matrix[16];
+  identity44f(matrix);
+
+  // disabled unless the scene enables it for the built-in renderer
+  REQUIRE(ray.instanceBegin() == -1);
+
+  ray.Instances.Enabled = true;
+  int proto = ray.instanceBegin();
+  REQUIRE(proto == 0);
+
+  // can't nest or instantiate an open prototype
+  REQUIRE(ray.instanceBegin() == -1);
+  REQUIRE(!ray.instance(proto, matrix));
+
+  REQUIRE(ray.instanceEnd());
+  REQUIRE(!ray.instanceEnd());
+  REQUIRE(ray.instance(proto, matrix));
+  REQUIRE(!ray.instance(proto + 1, matrix));
+  REQUIRE(ray.Instances.Inst.size() == 1);
+
+  ray.Instances.clear();
+  REQUIRE(ray.Instances.empty());
+  REQUIRE(ray.Instances.Proto.empty());
+}
+
+TEST_CASE("CRay instances are rigid body copies", "[Ray]")
+{
+  CRay ray{};
+  ray.Instances.Enabled = true;
+  int proto = ray.instanceBegin();
+  REQUIRE(ray.instanceEnd());
+
+  // rotation about z and a translation
+  float matrix[16];
+  identity44f(matrix);
+  matrix[0] = matrix[5] = 0.0F;
+  matrix[1] = -1.0F;
+  matrix[4] = 1.0F;
+  matrix[3] = 10.0F;
+  REQUIRE(ray.instance(proto, matrix));
+  REQUIRE(ray.Instances.Inst.back().Matrix[3] == 10.0F);
+
+  // scaling
+  float scaled[16];
+  copy44f(matrix, scaled);
+  scaled[10] = 2.0F;
+  REQUIRE(!ray.instance(proto, scaled));
+
+  // projection
+  copy44f(matrix, scaled);
+  scaled[14] = 1.0F;
+  REQUIRE(!ray.instance(proto, scaled));
+
+  REQUIRE(ray.Instances.Inst.size() == 1);
+}
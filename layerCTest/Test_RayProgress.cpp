@@ -0,0 +1,60 @@
+#include "Test.h"
+
+#include "RayProgress.h"
+
+TEST_CASE("RayProgress folds oversampled tiles", "[RayProgress]")
+{
+  const int mag = 2, w = 3, h = 2;
+  const int bw = (w + 2) * mag, bh = (h + 2) * mag;
+
+  // every byte of a buffer pixel is its output column
+  std::vector<unsigned int> buffer(bw * bh);
+  for (int y = 0; y < bh; ++y)
+    for (int x = 0; x < bw; ++x)
+      buffer[y * bw + x] = 0x01010101u * (unsigned) (x / mag - 1);
+
+  CRayProgress progress;
+  progress.begin(w, h);
+  progress.publishTile(buffer.data(), bw, mag, 0, bw, 0, bh, cRayProgressTrace);
+
+  auto tiles = progress.getTiles(true);
+  REQUIRE(tiles == std::vector<int>({0, 0, w, h, cRayProgressTrace}));
+  REQUIRE(progress.getTiles(false).empty());
+
+  std::vector<unsigned int> out(w * h);
+  REQUIRE(progress.copy(0, 0, w, h, w * 4, out.data()));
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      REQUIRE(out[y * w + x] == 0x01010101u * x);
+
+  REQUIRE(!progress.copy(1, 0, w, h, w * 4, out.data()));
+}
+
+TEST_CASE("RayProgress reports tiles to the callback", "[RayProgress]")
+{
+  std::vector<int> seen;
+  CRayProgress progress;
+  progress.setCallback(
+      [](void* data, int x, int y, int width, int height, int pass) {
+        static_cast<std::vector<int>*>(data)->insert(
+            static_cast<std::vector<int>*>(data)->end(),
+            {x, y, width, height, pass});
+      },
+      &seen);
+
+  std::vector<unsigned int> preview(2 * 2, 7);
+  progress.begin(8, 6);
+  progress.publishPreview(preview.data(), 2, 2);
+
+  std::vector<unsigned int> buffer(8 * 6, 9);
+  progress.publishTile(buffer.data(), 8, 1, 4, 8, 2, 6, cRayProgressTrace);
+
+  REQUIRE(seen == std::vector<int>({0, 0, 8, 6, cRayProgressPreview, //
+                                    4, 2, 4, 4, cRayProgressTrace}));
+  REQUIRE(seen == progress.getTiles(false));
+
+  unsigned int corner[2];
+  REQUIRE(progress.copy(3, 2, 2, 1, 8, corner));
+  REQUIRE(corner[0] == 7);
+  REQUIRE(corner[1] == 9);
+}
@@ -0,0 +1,92 @@
+#include "Test.h"
+
+#include "RoaringBitmap.h"
+
+TEST_CASE("RoaringBitmap membership", "[RoaringBitmap]")
+{
+  pymol::RoaringBitmap bits;
+  REQUIRE(bits.empty());
+
+  bits.add(5);
+  bits.add(70000);
+  bits.add(5);
+  REQUIRE(bits.cardinality() == 2);
+  REQUIRE(bits.contains(5));
+  REQUIRE(bits.contains(70000));
+  REQUIRE(!bits.contains(6));
+  REQUIRE(!bits.contains(5 + 65536));
+
+  REQUIRE(bits.remove(5));
+  REQUIRE(!bits.remove(5));
+  REQUIRE(bits.toVector() == std::vector<std::uint32_t>{70000});
+}
+
+TEST_CASE("RoaringBitmap dense containers", "[RoaringBitmap]")
+{
+  pymol::RoaringBitmap bits;
+  for (std::uint32_t i = 0; i < 10000; ++i)
+    bits.add(i * 2);
+  REQUIRE(bits.cardinality() == 10000);
+  REQUIRE(bits.contains(19998));
+  REQUIRE(!bits.contains(19999));
+
+  // converts back to an array container
+  for (std::uint32_t i = 0; i < 9000; ++i)
+    REQUIRE(bits.remove(i * 2));
+  REQUIRE(bits.cardinality() == 1000);
+  REQUIRE(bits.toVector().front() == 18000);
+
+  // much smaller than one int per value
+  pymol::RoaringBitmap all;
+  for (std::uint32_t i = 0; i < 1000000; ++i)
+    all.add(i);
+  REQUIRE(all.memoryUsage() < 200000);
+}
+
+TEST_CASE("RoaringBitmap set algebra", "[RoaringBitmap]")
+{
+  pymol::RoaringBitmap a, b;
+  for (std::uint32_t i = 0; i < 6000; ++i)
+    a.add(i);
+  a.add(200000);
+  for (std::uint32_t i = 5000; i < 7000; ++i)
+    b.add(i);
+  b.add(300000);
+
+  auto c = a;
+  c |= b;
+  REQUIRE(c.cardinality() == 7002);
+
+  c = a;
+  c &= b;
+  REQUIRE(c.cardinality() == 1000);
+  REQUIRE(c.contains(5000));
+  REQUIRE(!c.contains(200000));
+
+  c = a;
+  c.andNot(b);
+  REQUIRE(c.cardinality() == 5001);
+  REQUIRE(c.contains(4999));
+  REQUIRE(!c.contains(5000));
+
+  c.andNot(a);
+  REQUIRE(c.empty());
+  REQUIRE(c == pymol::RoaringBitmap());
+}
+
+TEST_CASE("RoaringBitmap serialization", "[RoaringBitmap]")
+{
+  pymol::RoaringBitmap bits, copy;
+  for (std::uint32_t i = 0; i < 5000; ++i)
+    bits.add(i * 3);
+  bits.add(1u << 31);
+
+  auto data = bits.serialize();
+  REQUIRE(pymol::RoaringBitmap::deserialize(data.data(), data.size(), copy));
+  REQUIRE(copy == bits);
+
+  // truncated
+  REQUIRE(!pymol::RoaringBitmap::deserialize(
+      data.data(), data.size() - 1, copy));
+  REQUIRE(copy.empty());
+}
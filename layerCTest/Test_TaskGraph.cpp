@@ -0,0 +1,114 @@
+#include "Test.h"
+
+#include <atomic>
+#include <thread>
+
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+
+TEST_CASE("TaskGraph respects dependencies", "[TaskGraph]")
+{
+  const int n_state = 20, n_rep = 8;
+  std::atomic<int> prep_done{0};
+  std::vector<std::atomic<int>> built(n_state);
+  std::atomic<int> errors{0};
+
+  pymol::TaskGraph graph;
+  auto prep = graph.add([&] { prep_done = 1; });
+
+  for (int s = 0; s < n_state; ++s) {
+    std::vector<pymol::TaskGraph::TaskId> builds;
+    for (int r = 0; r < n_rep; ++r) {
+      builds.push_back(graph.add([&, s] {
+        if (!prep_done)
+          ++errors;
+        ++built[s];
+      }, {prep}));
+    }
+    graph.add([&, s] {
+      if (built[s] != n_rep)
+        ++errors;
+      built[s] = -1;
+    }, builds);
+  }
+
+  REQUIRE(graph.size() == 1 + n_state * (n_rep + 1));
+  graph.run(4);
+  REQUIRE(graph.empty());
+  REQUIRE(errors == 0);
+  for (auto& b : built)
+    REQUIRE(b == -1);
+}
+
+TEST_CASE("TaskGraph main thread tasks", "[TaskGraph]")
+{
+  const auto caller = std::this_thread::get_id();
+  std::atomic<int> n_main{0}, n_wrong{0}, n_other{0}, n_pool_worker{0};
+
+  pymol::TaskGraph graph;
+  for (int i = 0; i < 50; ++i) {
+    auto id = graph.add([&] {
+      ++n_other;
+      if (pymol::ThreadPoolIsWorker())
+        ++n_pool_worker;
+    });
+    graph.add([&] {
+      ++n_main;
+      if (std::this_thread::get_id() != caller || pymol::ThreadPoolIsWorker())
+        ++n_wrong;
+    }, {id}, true);
+  }
+
+  graph.run(3);
+  REQUIRE(n_main == 50);
+  REQUIRE(n_other == 50);
+  REQUIRE(n_wrong == 0);
+  REQUIRE(!pymol::ThreadPoolIsWorker());
+}
+
+TEST_CASE("TaskGraph single worker and empty graph", "[TaskGraph]")
+{
+  pymol::TaskGraph graph;
+  graph.run(4);
+
+  std::vector<int> order;
+  auto a = graph.add([&] { order.push_back(1); });
+  auto b = graph.add([&] { order.push_back(2); }, {a}, true);
+  graph.add([&] { order.push_back(3); }, {a, b});
+  graph.run(1);
+  REQUIRE(order == std::vector<int>({1, 2, 3}));
+}
+
+TEST_CASE("TaskGraph thread budget", "[TaskGraph]")
+{
+  REQUIRE(pymol::ThreadPoolBudget(8) == 8);
+  REQUIRE(pymol::ThreadPoolBudget(0) == 1);
+
+  pymol::ThreadBudget budget(8);
+  budget.setScheduled(3);
+  REQUIRE(budget.share() == 2);
+  budget.setScheduled(16);
+  REQUIRE(budget.share() == 1);
+
+  // a chain of tasks: each one runs alone and gets all threads
+  pymol::TaskGraph graph;
+  std::vector<int> shares;
+  auto a = graph.add([&] { shares.push_back(pymol::ThreadPoolBudget(64)); });
+  auto b = graph.add([&] { shares.push_back(pymol::ThreadPoolBudget(64)); }, {a});
+  graph.add([&] { shares.push_back(pymol::ThreadPoolBudget(2)); }, {b});
+  graph.run(4);
+  REQUIRE(shares == std::vector<int>({4, 4, 2}));
+
+  // independent tasks share the threads
+  std::atomic<int> n_over{0};
+  for (int i = 0; i < 8; ++i) {
+    graph.add([&] {
+      if (pymol::ThreadPoolBudget(64) > 4)
+        ++n_over;
+    });
+  }
+  graph.run(4);
+  REQUIRE(n_over == 0);
+
+  REQUIRE(pymol::ThreadPoolBudget(8) == 8);
+}
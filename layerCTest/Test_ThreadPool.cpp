@@ -0,0 +1,64 @@
+#include "Test.h"
+
+#include <atomic>
+
+#include "ThreadPool.h"
+
+TEST_CASE("WorkStealingQueue pops every task exactly once", "[ThreadPool]")
+{
+  pymol::WorkStealingQueue queue(10, 3);
+  REQUIRE(queue.size() == 10);
+  std::vector<int> seen(10, 0);
+  std::size_t task;
+  // a single worker drains its own run and then steals all others
+  while (queue.pop(1, task)) {
+    REQUIRE(task < 10);
+    ++seen[task];
+  }
+  REQUIRE(queue.done() == 10);
+  REQUIRE(std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }));
+  REQUIRE(!queue.pop(0, task));
+}
+
+TEST_CASE("WorkStealingQueue with more workers than tasks", "[ThreadPool]")
+{
+  pymol::WorkStealingQueue queue(2, 8);
+  std::size_t task;
+  REQUIRE(queue.pop(5, task));
+  REQUIRE(queue.pop(5, task));
+  REQUIRE(!queue.pop(5, task));
+}
+
+TEST_CASE("ThreadPoolRunTasks", "[ThreadPool]")
+{
+  const std::size_t n_task = 1000;
+  std::vector<std::atomic<int>> seen(n_task);
+  std::atomic<int> max_worker{0};
+  pymol::ThreadPoolRunTasks(4, n_task, [&](int worker, std::size_t task) {
+    ++seen[task];
+    int prev = max_worker;
+    while (worker > prev && !max_worker.compare_exchange_weak(prev, worker)) {
+    }
+  });
+  for (auto& n : seen) {
+    REQUIRE(n == 1);
+  }
+  REQUIRE(max_worker < 4);
+}
+
+TEST_CASE("ThreadPoolRun nested", "[ThreadPool]")
+{
+  // every inner call runs all of its workers, even if the pool is busy
+  std::atomic<int> n_inner{0};
+  std::atomic<int> n_main_thread{0};
+  for (int repeat = 0; repeat < 10; ++repeat) {
+    pymol::ThreadPoolRun(4, [&](int outer) {
+      if (outer == 0 && !pymol::ThreadPoolIsWorker())
+        ++n_main_thread;
+      pymol::ThreadPoolRun(4, [&](int) { ++n_inner; });
+    });
+  }
+  REQUIRE(n_inner == 10 * 4 * 4);
+  REQUIRE(n_main_thread == 10);
+  REQUIRE(!pymol::ThreadPoolIsWorker());
+}
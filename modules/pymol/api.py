@@ -10,6 +10,7 @@ from .importing import \
       load_callback,      \
       load_cgo,           \
       load_coords,        \
+      load_coords_states, \
       load_coordset,      \
       load_embedded,      \
       load_map,           \
@@ -114,7 +115,9 @@ from .querying import \
       get_object_state,   \
       get_color_tuple,    \
       get_atom_coords,    \
+      get_atom_column,    \
       get_coords,         \
+      get_coords_states,  \
       get_coordset,       \
       get_dihedral,       \
       get_distance,       \
@@ -137,6 +140,7 @@ from .querying import \
       get_position,       \
       get_povray,         \
       get_raw_alignment,  \
+      get_ray_timing,     \
       get_renderer,       \
       get_selection_state,\
       get_symmetry,       \
@@ -155,7 +159,9 @@ from .querying import \
 
 #--------------------------------------------------------------------
 from .selecting import \
+      compile_selection,  \
       deselect,           \
+      explain,            \
       indicate,           \
       select,             \
       select_list,        \
@@ -185,6 +191,7 @@ from .editing import \
       alter,              \
       alter_list,         \
       alter_state,        \
+      set_atom_column,    \
       alphatoall,         \
       attach,             \
       bond,               \
@@ -158,8 +158,6 @@ if True:
         from . import internal
 
         _alt = internal._alt
-        _coordset_update_spawn = internal._coordset_update_spawn
-        _coordset_update_thread = internal._coordset_update_thread
         _copy_image = internal._copy_image
         _call_in_gui_thread = lambda func: func()
         _call_with_opengl_context = _call_in_gui_thread
@@ -174,12 +172,7 @@ if True:
         _interpret_color = internal._interpret_color
         _invalidate_color_sc = internal._invalidate_color_sc
         _mpng = internal._mpng
-        _object_update_spawn = internal._object_update_spawn
-        _object_update_thread = internal._object_update_thread
         _quit = internal._quit
-        _ray_anti_spawn = internal._ray_anti_spawn
-        _ray_hash_spawn = internal._ray_hash_spawn
-        _ray_spawn = internal._ray_spawn
         _refresh = internal._refresh
         _special = internal._special
         _validate_color_sc = internal._validate_color_sc
@@ -188,6 +181,7 @@ if True:
         _cache_clear = internal._cache_clear
         _cache_purge = internal._cache_purge
         _cache_mark = internal._cache_mark
+        _cache_status = internal._cache_status
         _sdof = internal._sdof
 
         #######################################################################
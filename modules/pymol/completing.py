@@ -128,6 +128,7 @@ def get_auto_arg_list(self_cmd=cmd):
         'group'          : [ self_cmd.group_sc               , 'group object'    , ', ' ],
         'help'           : [ self_cmd.help_sc                , 'selection'       , ''   ],
         'help_setting'   : [ self_cmd.setting.setting_sc     , 'setting'         , ''   ],
+        'explain'        : aa_sel_e,
         'h_add'          : aa_sel_e,
         'hide'           : aa_rem_c,
         'isolevel'       : [ self_cmd.contour_sc             , 'contour'         , ', ' ],
@@ -1472,6 +1472,40 @@ SEE ALSO
             return _cmd.alter(_self._COb, selection, expression, False,
                               int(quiet), dict(space))
 
+    def set_atom_column(name, values, selection='all', quiet=1, *, _self=cmd):
+        '''
+DESCRIPTION
+
+    API only. Assign one atom property of all selected atoms from a
+    sequence or numpy array, in selection order. Equivalent to "alter"
+    with one value per atom, without evaluating a Python expression for
+    each atom.
+
+ARGUMENTS
+
+    name = str: property name, as in "alter" (e.g. b, q, elem, resv,
+    formal_charge, color, flags, chain)
+
+    values = sequence: one value per selected atom
+
+    selection = str: atom selection {default: all}
+
+EXAMPLE
+
+    b = cmd.get_atom_column("b", "polymer")
+    cmd.set_atom_column("b", b * 2.0, "polymer")
+
+SEE ALSO
+
+    get_atom_column, alter, load_coords
+        '''
+        selection = selector.process(selection)
+        with _self.lockcm:
+            r = _cmd.set_atom_column(_self._COb, selection, str(name), values)
+        if not int(quiet):
+            print(" set_atom_column: modified %d atoms." % r)
+        return r
+
     def alter_list(object, expr_list, quiet=1, space=None, _self=cmd):
         '''
 DESCRIPTION
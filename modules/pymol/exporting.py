@@ -40,6 +40,7 @@ if True:
         'read_only'   : 2,
         'clear'       : 3,
         'optimize'    : 4,
+        'status'      : 5,
     }
 
     cache_action_sc = Shortcut(cache_action_dict.keys())
@@ -57,7 +58,7 @@ USAGE
 
 ARGUMENTS
 
-    action = string: enable, disable, read_only, clear, or optimize
+    action = string: enable, disable, read_only, clear, optimize, or status
 
     scenes = string: a space-separated list of scene names (default: '')
 
@@ -68,12 +69,22 @@ EXAMPLES
     cache enable
     cache optimize
     cache optimize, F1 F2 F5
+    set cache_dir, ~/.pymol/cache
+    cache status
 
 NOTES
 
     "cache optimize" will iterate through the list of scenes provided
     (or all defined scenes), compute any missing surfaces, and store
     them in the cache for later reuse.
+
+    With "cache_dir" set, cached results are also stored as files in that
+    directory (at most "cache_disk_max" MB, least recently used files are
+    removed first), so they survive restarts and are shared between
+    sessions. "cache clear" empties that directory as well.
+
+    "cache status" prints (and returns) hit and miss counters and the
+    memory and disk usage.
     
 PYMOL API
 
@@ -90,7 +101,7 @@ PYMOL API
         elif action == 2:  # read_only
             _self.set('cache_mode', 1, quiet=quiet)
         elif action == 3: # clear
-            _self._cache_clear()
+            _self._cache_clear(_self=_self, disk_dir=_self.get('cache_dir'))
         elif action == 4: # optimize
             _self._cache_mark()
             cur_scene = _self.get('scene_current_name')
@@ -130,6 +141,17 @@ PYMOL API
             _self.set('cache_max',cache_max) # restore previous limits
             if not quiet:
                 print(" cache: optimization complete (~%0.1f MB)."%(usage*4/1000000.0))
+        elif action == 5: # status
+            stats = _self._cache_status(_self=_self)
+            if not quiet:
+                print(" cache: %d memory hits, %d disk hits, %d misses." % (
+                    stats['hits'], stats['disk_hits'], stats['misses']))
+                print(" cache: %d entries (~%0.1f MB) in memory, "
+                      "%d files (%0.1f MB) on disk." % (stats['entries'],
+                          stats['memory'] * 4 / 1000000.0,
+                          stats['disk_entries'],
+                          stats['disk_bytes'] / 1000000.0))
+            return stats
         else:
             raise ValueError('action')
 
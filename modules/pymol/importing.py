@@ -1439,6 +1439,32 @@ ARGUMENTS
             r = _cmd.load_coords(_self._COb, selection, coords, int(state)-1)
         return r
 
+    def load_coords_states(coords, selection, first=1, quiet=1, *, _self=cmd):
+        '''
+DESCRIPTION
+
+    API only. Load selection coordinates of multiple states from a
+    (states x atoms x 3) array, e.g. as returned by get_coords_states.
+    Representations are invalidated once, not once per state. NaN
+    coordinates are skipped.
+
+ARGUMENTS
+
+    coords = array: (states x atoms x 3) float array
+
+    selection = str: atom selection
+
+    first = int: object state of coords[0] {default: 1}
+
+SEE ALSO
+
+    cmd.get_coords_states, cmd.load_coords
+        '''
+        with _self.lockcm:
+            r = _cmd.load_coords_states(_self._COb, selection, coords,
+                                        int(first)-1)
+        return r
+
     def load_idx(filename, object, state=0, quiet=1, zoom=-1, *, _self=cmd):
         '''
 DESCRIPTION
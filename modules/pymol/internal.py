@@ -2,7 +2,6 @@ import os
 import sys
 cmd = sys.modules["pymol.cmd"]
 from pymol import _cmd
-import threading
 import traceback
 
 import _thread as thread
@@ -10,6 +9,9 @@ import urllib.request as urllib2
 
 import re
 import time
+import hashlib
+import marshal
+import zlib
 import pymol
 
 import chempy.io
@@ -19,6 +21,9 @@ from .cmd import DEFAULT_ERROR, DEFAULT_SUCCESS, loadable, _load2str, Shortcut,
 
 # cache management:
 
+_CACHE_DISK_VERSION = 1
+_CACHE_DISK_SUFFIX = '.pymolcache'
+
 def _cache_validate(_self=cmd):
     r = DEFAULT_SUCCESS
     with _self.lock_api_data:
@@ -27,15 +32,173 @@ def _cache_validate(_self=cmd):
             _pymol._cache = []
         if not hasattr(_pymol,"_cache_memory"):
             _pymol._cache_memory = 0
+        if not hasattr(_pymol,"_cache_stats"):
+            _pymol._cache_stats = dict.fromkeys(('hits', 'disk_hits',
+                'misses', 'disk_writes', 'disk_evictions'), 0)
+        if not hasattr(_pymol,"_cache_disk_usage"):
+            _pymol._cache_disk_usage = {} # bytes by directory
+
+def _cache_count(key, _self=cmd):
+    _cache_validate(_self)
+    with _self.lock_api_data:
+        _self._pymol._cache_stats[key] += 1
 
-def _cache_clear(_self=cmd):
+def _cache_clear(_self=cmd, disk_dir=''):
     r = DEFAULT_SUCCESS
+    _cache_validate(_self)
     with _self.lock_api_data:
         _pymol = _self._pymol
         _pymol._cache = []
         _pymol._cache_memory = 0
+        _pymol._cache_disk_usage = {}
+    if disk_dir:
+        for path in _cache_disk_files(disk_dir):
+            try:
+                os.remove(path)
+            except OSError:
+                pass
     return r
 
+def _cache_disk_path(disk_dir, inp):
+    '''
+    File name for the result of `inp`, a hash of its content (marshal is
+    exact for floats and stable for a given Python version).
+    '''
+    key = hashlib.sha1(marshal.dumps(inp, 4)).hexdigest()
+    return os.path.join(os.path.expanduser(disk_dir), key + _CACHE_DISK_SUFFIX)
+
+def _cache_disk_files(disk_dir):
+    disk_dir = os.path.expanduser(disk_dir)
+    try:
+        names = os.listdir(disk_dir)
+    except OSError:
+        return []
+    return [os.path.join(disk_dir, name) for name in names
+            if name.endswith(_CACHE_DISK_SUFFIX)]
+
+def _cache_disk_get(disk_dir, inp):
+    '''
+    Look up the result of `inp` in `disk_dir`, or return None. Unreadable
+    files are removed.
+    '''
+    path = _cache_disk_path(disk_dir, inp)
+    try:
+        with open(path, 'rb') as handle:
+            raw = handle.read()
+    except OSError:
+        return None
+    try:
+        version, stored_inp, output = marshal.loads(zlib.decompress(raw))
+    except Exception:
+        version = None
+    if version != _CACHE_DISK_VERSION:
+        # truncated, corrupt or stale format
+        try:
+            os.remove(path)
+        except OSError:
+            pass
+        return None
+    # guard against hash collisions
+    if stored_inp != inp:
+        return None
+    try:
+        os.utime(path) # least recently used eviction goes by mtime
+    except OSError:
+        pass
+    return output
+
+def _cache_disk_prune(disk_dir, max_size, keep, _self=cmd):
+    '''
+    Remove the least recently used files until `disk_dir` holds at most
+    `max_size` bytes, except `keep`.
+    @return remaining size in bytes
+    '''
+    files = []
+    for name in _cache_disk_files(disk_dir):
+        try:
+            st = os.stat(name)
+        except OSError:
+            continue
+        files.append((st.st_mtime, st.st_size, name))
+    files.sort()
+    total = sum(f[1] for f in files)
+    for mtime, size, name in files:
+        if total <= max_size:
+            break
+        if name == keep:
+            continue
+        try:
+            os.remove(name)
+        except OSError:
+            continue
+        total -= size
+        _cache_count('disk_evictions', _self)
+    return total
+
+def _cache_disk_set(disk_dir, disk_max, inp, output, _self=cmd):
+    '''
+    Store the result of `inp` in `disk_dir`. If that takes the directory
+    above `disk_max` MB (0: unlimited), remove the least recently used files
+    until it is at 3/4 of the limit, so full directories are not scanned on
+    every write.
+    '''
+    path = _cache_disk_path(disk_dir, inp)
+    tmp_path = '%s.%d.%d.tmp' % (path, os.getpid(), thread.get_ident())
+    try:
+        old_size = os.path.getsize(path)
+    except OSError:
+        old_size = 0
+    try:
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        data = zlib.compress(marshal.dumps((_CACHE_DISK_VERSION, inp, output), 4))
+        with open(tmp_path, 'wb') as handle:
+            handle.write(data)
+        os.replace(tmp_path, path) # atomic, safe with concurrent sessions
+    except (OSError, ValueError):
+        traceback.print_exc()
+        try:
+            os.remove(tmp_path)
+        except OSError:
+            pass
+        return
+    _cache_count('disk_writes', _self)
+
+    # running total, the directory is only listed once per session and
+    # when pruning (other sessions may write to it in the meantime)
+    key = os.path.expanduser(disk_dir)
+    with _self.lock_api_data:
+        usage = _self._pymol._cache_disk_usage
+        if key in usage:
+            usage[key] += len(data) - old_size
+        else:
+            usage[key] = sum(os.path.getsize(f)
+                             for f in _cache_disk_files(disk_dir)
+                             if os.path.exists(f))
+        total = usage[key]
+
+    max_size = disk_max * 1024 * 1024
+    if max_size > 0 and total > max_size:
+        total = _cache_disk_prune(disk_dir, max_size * 3 // 4, path, _self)
+        with _self.lock_api_data:
+            _self._pymol._cache_disk_usage[key] = total
+
+def _cache_status(_self=cmd):
+    '''
+    Counters and sizes of the result cache, as a dictionary
+    '''
+    _cache_validate(_self)
+    with _self.lock_api_data:
+        _pymol = _self._pymol
+        stats = dict(_pymol._cache_stats)
+        stats['entries'] = len(_pymol._cache)
+        stats['memory'] = _pymol._cache_memory
+    disk_dir = _self.get('cache_dir')
+    files = _cache_disk_files(disk_dir) if disk_dir else []
+    stats['disk_entries'] = len(files)
+    stats['disk_bytes'] = sum(os.path.getsize(f) for f in files
+                              if os.path.exists(f))
+    return stats
+
 def _cache_mark(_self=cmd):
     r = DEFAULT_SUCCESS
     with _self.lock_api_data:
@@ -76,8 +239,9 @@ def _cache_purge(max_size, _self=cmd):
         result = _pymol._cache_memory
     return result
 
-def _cache_get(target, hash_size = None, _self=cmd):
+def _cache_get(target, hash_size = None, _self=cmd, disk_dir='', max_size=0):
     result = None
+    _cache_validate(_self)
     with _self.lock_api_data:
         try:
             if hash_size is None:
@@ -95,9 +259,22 @@ def _cache_get(target, hash_size = None, _self=cmd):
                         break
         except:
             traceback.print_exc()
+    if result is not None:
+        _cache_count('hits', _self)
+    elif disk_dir:
+        result = _cache_disk_get(disk_dir, target[2])
+        if result is not None:
+            _cache_count('disk_hits', _self)
+            # keep it in memory for the next lookup (see PCacheSet for size)
+            target[0] += len(result) + sum(len(x) for x in result
+                                           if isinstance(x, tuple))
+            target[3] = result
+            _cache_set(target, max_size, _self)
+    if result is None:
+        _cache_count('misses', _self)
     return result
 
-def _cache_set(new_entry, max_size, _self=cmd):
+def _cache_set(new_entry, max_size, _self=cmd, disk_dir='', disk_max=0):
     r = DEFAULT_SUCCESS
     with _self.lock_api_data:
         _pymol = _self._pymol
@@ -124,113 +301,10 @@ def _cache_set(new_entry, max_size, _self=cmd):
                         _cache_purge(max_size, _self)
         except:
             traceback.print_exc()
+    if disk_dir:
+        _cache_disk_set(disk_dir, disk_max, new_entry[2], new_entry[3], _self)
     return r
 
-# ray tracing threads
-
-def _ray_anti_spawn(thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    # internal routine to support multithreaded raytracing
-    thread_list = []
-    for a in thread_info[1:]:
-        t = threading.Thread(target=_cmd.ray_anti_thread,
-                                    args=(_self._COb,a))
-        t.setDaemon(1)
-        thread_list.append(t)
-    for t in thread_list:
-        t.start()
-    _cmd.ray_anti_thread(_self._COb,thread_info[0])
-    for t in thread_list:
-        t.join()
-
-def _ray_hash_spawn(thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    # internal routine to support multithreaded raytracing
-    thread_list = []
-    for a in thread_info[1:]:
-        if a is not None:
-            t = threading.Thread(target=_cmd.ray_hash_thread,
-                                 args=(_self._COb,a))
-            t.setDaemon(1)
-            thread_list.append(t)
-    for t in thread_list:
-        t.start()
-    if thread_info[0] is not None:
-        _cmd.ray_hash_thread(_self._COb,thread_info[0])
-    for t in thread_list:
-        t.join()
-
-def _ray_spawn(thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    # internal routine to support multithreaded raytracing
-    thread_list = []
-    for a in thread_info[1:]:
-        t = threading.Thread(target=_cmd.ray_trace_thread,
-                                    args=(_self._COb,a))
-        t.setDaemon(1)
-        thread_list.append(t)
-    for t in thread_list:
-        t.start()
-    _cmd.ray_trace_thread(_self._COb,thread_info[0])
-    for t in thread_list:
-        t.join()
-
-def _coordset_update_thread(list_lock,thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    while 1:
-        list_lock.acquire()
-        if not len(thread_info):
-            list_lock.release()
-            break
-        else:
-            info = thread_info.pop(0)
-            list_lock.release()
-        _cmd.coordset_update_thread(_self._COb,info)
-
-def _coordset_update_spawn(thread_info,n_thread,_self=cmd):
-    # WARNING: internal routine, subject to change
-    if len(thread_info):
-        list_lock = threading.Lock() # mutex for list
-        thread_list = []
-        for a in range(1,n_thread):
-            t = threading.Thread(target=_coordset_update_thread,
-                                        args=(list_lock,thread_info))
-            t.setDaemon(1)
-            thread_list.append(t)
-        for t in thread_list:
-            t.start()
-        _coordset_update_thread(list_lock,thread_info)
-        for t in thread_list:
-            t.join()
-
-def _object_update_thread(list_lock,thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    while 1:
-        list_lock.acquire()
-        if not len(thread_info):
-            list_lock.release()
-            break
-        else:
-            info = thread_info.pop(0)
-            list_lock.release()
-        _cmd.object_update_thread(_self._COb,info)
-
-def _object_update_spawn(thread_info,n_thread,_self=cmd):
-    # WARNING: internal routine, subject to change
-    if len(thread_info):
-        list_lock = threading.Lock() # mutex for list
-        thread_list = []
-        for a in range(1,n_thread):
-            t = threading.Thread(target=_object_update_thread,
-                                        args=(list_lock,thread_info))
-            t.setDaemon(1)
-            thread_list.append(t)
-        for t in thread_list:
-            t.start()
-        _object_update_thread(list_lock,thread_info)
-        for t in thread_list:
-            t.join()
-
 # status reporting
 
 # do command (while API already locked)
@@ -473,6 +473,8 @@ if True:
                             options.deferred.append("_do__ cmd.get_wizard().ray_trace1()")
                         if a[2:]=='2':
                             options.deferred.append("_do__ cmd.get_wizard().ray_trace2()")
+                        if a[2:]=='3':
+                            options.deferred.append("_do__ cmd.get_wizard().ray_phases()")
 
                     if "p" in a:
                         options.read_stdin = 1
@@ -870,6 +870,38 @@ DESCRIPTION
 
         return r
 
+    def get_ray_timing(quiet=1, *, _self=cmd):
+        '''
+DESCRIPTION
+
+    "get_ray_timing" returns the wall clock seconds spent in each phase
+    of the last ray traced image (built-in renderer only), as a dictionary.
+
+USAGE
+
+    get_ray_timing
+
+NOTES
+
+    geometry: reps -> primitives, expand: primitive expansion and
+    transformation, map: voxel maps or BVHs, trace: primary and shadow
+    rays, edge: edge oversampling, antialias: folding of the oversampled
+    image, total: everything including the above.
+
+SEE ALSO
+
+    ray
+        '''
+        with _self.lockcm:
+            r = _cmd.get_ray_timing(_self._COb)
+
+        if not int(quiet):
+            for key in ('geometry', 'expand', 'map', 'trace', 'edge',
+                        'antialias', 'total'):
+                print(" Ray: %-10s %8.3f sec." % (key, r[key]))
+
+        return r
+
     def get_phipsi(selection="(name CA)", state=CURRENT_STATE, *, _self=cmd):
         # preprocess selections
         selection = selector.process(selection)
@@ -911,6 +943,58 @@ ARGUMENTS
             r = _cmd.get_coords(_self._COb, selection, int(state) - 1)
             return r
 
+    def get_coords_states(selection='all', first=1, last=0, *, _self=cmd):
+        '''
+DESCRIPTION
+
+    API only. Get selection coordinates of a range of states as one
+    (states x atoms x 3) numpy array. Atoms without coordinates in a
+    state are NaN.
+
+ARGUMENTS
+
+    selection = str: atom selection {default: all}
+
+    first = int: first state {default: 1}
+
+    last = int: last state, or 0 for the last state {default: 0}
+
+SEE ALSO
+
+    get_coords, load_coords_states
+        '''
+        selection = selector.process(selection)
+        with _self.lockcm:
+            return _cmd.get_coords_states(_self._COb, selection,
+                                          int(first) - 1, int(last) - 1)
+
+    def get_atom_column(name, selection='all', *, _self=cmd):
+        '''
+DESCRIPTION
+
+    API only. Get one atom property of all selected atoms as a numpy
+    array, in selection order. Much faster than collecting the values
+    with "iterate".
+
+ARGUMENTS
+
+    name = str: property name, as in "iterate" (e.g. b, q, elem, resv,
+    formal_charge, color, flags, chain)
+
+    selection = str: atom selection {default: all}
+
+EXAMPLE
+
+    b = cmd.get_atom_column("b", "polymer")
+
+SEE ALSO
+
+    set_atom_column, iterate, get_coords
+        '''
+        selection = selector.process(selection)
+        with _self.lockcm:
+            return _cmd.get_atom_column(_self._COb, selection, str(name))
+
     def get_coordset(name, state=1, copy=1, quiet=1, *, _self=cmd):
         '''
 DESCRIPTION
@@ -172,6 +172,109 @@ ARGUMENTS
             return _cmd.select_list(_self._COb, name, object, id_list,
                                     int(state) - 1, int(mode), int(quiet))
 
+    class CompiledSelection(object):
+        '''
+        Selection expression which is parsed once and can be evaluated
+        repeatedly, e.g. for every state of a trajectory. See
+        compile_selection.
+        '''
+
+        def __init__(self, expression, handle, _self):
+            self.expression = expression
+            self._handle = handle
+            self._self = _self
+
+        def select(self, name, state=0, enable=-1, quiet=1):
+            '''
+            Create (or replace) the named selection. Returns the number of
+            selected atoms.
+            '''
+            with self._self.lockcm:
+                return _cmd.select_compiled(self._self._COb, self._handle,
+                        str(name), int(state) - 1, int(quiet), int(enable))
+
+        def count(self, state=0):
+            '''
+            Number of atoms matching the expression in the given state.
+            '''
+            with self._self.lockcm:
+                return _cmd.select_compiled(self._self._COb, self._handle,
+                        "", int(state) - 1, 1, -1)
+
+        def __repr__(self):
+            return 'CompiledSelection(%r)' % (self.expression,)
+
+    def compile_selection(selection, _self=cmd):
+        '''
+DESCRIPTION
+
+    API only. Parse a selection-expression once, for repeated evaluation.
+
+    Parsed expressions are also cached by their text, so calling this
+    again with the same expression is cheap. Changes to named selections
+    which the expression depends on are picked up automatically.
+
+EXAMPLE
+
+    sele = cmd.compile_selection("polymer and name CA within 5 of organic")
+    for state in range(1, cmd.count_states() + 1):
+        print(sele.count(state))
+    sele.select("site", state=1)
+
+SEE ALSO
+
+    select
+        '''
+        selection = str(selector.process(selection))
+        with _self.lockcm:
+            handle = _cmd.compile_selection(_self._COb, selection)
+        return CompiledSelection(selection, handle, _self)
+
+    def explain(selection, state=0, quiet=0, _self=cmd):
+        '''
+DESCRIPTION
+
+    "explain" evaluates a selection-expression and reports the time spent
+    in each step, together with the number of atoms going into and coming
+    out of it and the number of spatial maps which had to be built.
+
+    The first two steps are the parsing of the expression and the update
+    of the atom table.
+
+USAGE
+
+    explain selection [, state ]
+
+EXAMPLE
+
+    explain polymer and name CA within 5 of organic
+
+PYMOL API
+
+    cmd.explain(string selection, int state=0, int quiet=0)
+
+    Returns a list of dictionaries with the keys "op", "seconds",
+    "atoms_in", "atoms_out" and "maps_built".
+
+SEE ALSO
+
+    select, count_atoms
+        '''
+        selection = str(selector.process(selection))
+        with _self.lockcm:
+            r = _cmd.explain_selection(_self._COb, selection, int(state) - 1)
+        keys = ('op', 'seconds', 'atoms_in', 'atoms_out', 'maps_built')
+        r = [dict(zip(keys, rec)) for rec in r]
+        if not int(quiet):
+            print(' %10s %9s %9s %4s  %s' % ('ms', 'atoms in', 'out', 'maps', 'step'))
+            for rec in r:
+                print(' %10.3f %9d %9d %4d  %s' % (rec['seconds'] * 1e3,
+                    rec['atoms_in'], rec['atoms_out'], rec['maps_built'],
+                    rec['op']))
+            print(' explain: %.3f ms total' % (
+                sum(rec['seconds'] for rec in r) * 1e3))
+        return r
+
     def indicate(selection="(all)",_self=cmd):
         '''
 DESCRIPTION
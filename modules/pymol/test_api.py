@@ -0,0 +1,244 @@
+'''
+Tests for the NumPy and selection APIs, on a private PyMOL instance.
+
+    python -m unittest pymol.test_api
+'''
+
+import unittest
+
+import numpy
+import pymol
+import pymol2
+
+
+class PyMOLTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls._pymol = pymol2.PyMOL()
+        cls._pymol.start()
+        cls.cmd = cls._pymol.cmd
+
+    @classmethod
+    def tearDownClass(cls):
+        cls._pymol.stop()
+
+    def setUp(self):
+        self.cmd.reinitialize()
+        self.cmd.feedback('disable', 'all', 'everything')
+
+
+class TestCoordsStates(PyMOLTestCase):
+
+    def setUp(self):
+        super().setUp()
+        self.cmd.fragment('ala', 'm1')
+        for state in (2, 3):
+            self.cmd.create('m1', 'm1', 1, state)
+        self.n_atom = self.cmd.count_atoms('m1')
+
+    def test_get_matches_get_coords(self):
+        coords = self.cmd.get_coords_states('m1')
+        self.assertEqual(coords.shape, (3, self.n_atom, 3))
+        self.assertEqual(coords.dtype, numpy.float32)
+        for state in (1, 2, 3):
+            numpy.testing.assert_allclose(coords[state - 1],
+                                          self.cmd.get_coords('m1', state))
+
+    def test_round_trip(self):
+        coords = self.cmd.get_coords_states('m1')
+        shift = numpy.arange(1, 4, dtype=numpy.float32).reshape(3, 1, 1)
+        self.assertEqual(self.cmd.load_coords_states(coords + shift, 'm1'), 3)
+        numpy.testing.assert_allclose(self.cmd.get_coords_states('m1'),
+                                      coords + shift, atol=1e-5)
+
+    def test_round_trip_range(self):
+        coords = self.cmd.get_coords_states('m1', 2, 3)
+        self.assertEqual(coords.shape, (2, self.n_atom, 3))
+        self.cmd.load_coords_states(coords + 5.0, 'm1', first=2)
+        numpy.testing.assert_allclose(self.cmd.get_coords_states('m1', 2, 3),
+                                      coords + 5.0, atol=1e-5)
+        # state 1 is untouched
+        numpy.testing.assert_allclose(self.cmd.get_coords_states('m1', 1, 1),
+                                      coords[:1], atol=1e-5)
+
+    def test_nan_is_skipped(self):
+        coords = self.cmd.get_coords_states('m1')
+        update = coords + 1.0
+        update[1, 0] = numpy.nan
+        self.cmd.load_coords_states(update, 'm1')
+        result = self.cmd.get_coords_states('m1')
+        numpy.testing.assert_allclose(result[1, 0], coords[1, 0])
+        numpy.testing.assert_allclose(result[1, 1:], update[1, 1:], atol=1e-5)
+
+    def test_missing_atoms_are_nan(self):
+        self.cmd.fragment('gly', 'm2')
+        coords = self.cmd.get_coords_states('m1 or m2')
+        n2 = self.cmd.count_atoms('m2')
+        self.assertEqual(coords.shape, (3, self.n_atom + n2, 3))
+        self.assertFalse(numpy.isnan(coords[0]).any())
+        self.assertTrue(numpy.isnan(coords[1:, self.n_atom:]).all())
+
+    def test_empty_selection(self):
+        coords = self.cmd.get_coords_states('none')
+        self.assertEqual(coords.shape, (0, 0, 3))
+
+    def test_shape_mismatch(self):
+        coords = self.cmd.get_coords_states('m1')
+        with self.assertRaises(pymol.CmdException):
+            self.cmd.load_coords_states(coords[:, 1:], 'm1')
+        with self.assertRaises(pymol.CmdException):
+            self.cmd.load_coords_states(coords, 'm1', first=2)
+
+
+class TestAtomColumn(PyMOLTestCase):
+
+    def setUp(self):
+        super().setUp()
+        self.cmd.fragment('ala', 'm1')
+        self.cmd.fragment('gly', 'm2')
+        self.n_atom = self.cmd.count_atoms()
+
+    def iterate(self, name, selection='all'):
+        values = []
+        self.cmd.iterate(selection, 'values.append(%s)' % name,
+                         space={'values': values})
+        return values
+
+    def check_round_trip(self, name, dtype, values):
+        column = self.cmd.get_atom_column(name)
+        self.assertEqual(column.dtype, dtype)
+        self.assertEqual(list(column), self.iterate(name))
+
+        self.assertEqual(self.cmd.set_atom_column(name, values), self.n_atom)
+        column = self.cmd.get_atom_column(name)
+        self.assertEqual(list(column), list(values))
+        self.assertEqual(list(column), self.iterate(name))
+
+    def test_float(self):
+        values = numpy.linspace(0.0, 99.0, self.n_atom, dtype=numpy.float32)
+        self.check_round_trip('b', numpy.float32, values)
+        self.check_round_trip('q', numpy.float32, values / 100.0)
+
+    def test_int(self):
+        values = numpy.arange(10, 10 + self.n_atom, dtype=numpy.int32)
+        self.check_round_trip('resv', numpy.int32, values)
+        self.check_round_trip('ID', numpy.int32, values * 2)
+
+    def test_uint32(self):
+        values = numpy.arange(self.n_atom, dtype=numpy.uint32) << 24
+        self.check_round_trip('flags', numpy.uint32, values)
+
+    def test_schar(self):
+        values = (numpy.arange(self.n_atom) % 3 - 1).astype(numpy.int8)
+        self.check_round_trip('formal_charge', numpy.int8, values)
+
+    def test_int_as_string(self):
+        values = ['A' if i % 2 else 'B' for i in range(self.n_atom)]
+        self.check_round_trip('chain', object, values)
+        self.check_round_trip('resn', object, ['LIG'] * self.n_atom)
+        self.assertEqual(self.cmd.count_atoms('chain A'), self.n_atom // 2)
+        self.assertEqual(self.cmd.count_atoms('resn LIG'), self.n_atom)
+
+    def test_string(self):
+        values = ['N'] * self.n_atom
+        self.check_round_trip('elem', object, values)
+        self.check_round_trip('alt', object, ['B'] * self.n_atom)
+
+    def test_selection_order(self):
+        column = self.cmd.get_atom_column('name', 'm2')
+        self.assertEqual(list(column), self.iterate('name', 'm2'))
+        self.cmd.alter('m1', 'b = 3.0')
+        self.cmd.set_atom_column('b', [7.0] * len(column), 'm2')
+        self.assertEqual(set(self.iterate('b', 'm1')), {3.0})
+        self.assertEqual(set(self.iterate('b', 'm2')), {7.0})
+
+    def test_errors(self):
+        with self.assertRaises(pymol.CmdException):
+            self.cmd.get_atom_column('no_such_property')
+        with self.assertRaises(pymol.CmdException):
+            self.cmd.set_atom_column('b', [1.0, 2.0])
+
+
+class TestCompileSelection(PyMOLTestCase):
+
+    def setUp(self):
+        super().setUp()
+        self.cmd.fragment('ala', 'm1')
+        self.cmd.fragment('gly', 'm2')
+        self.cmd.create('m1', 'm1', 1, 2)
+        self.cmd.translate([50.0, 0.0, 0.0], 'm1', state=2, camera=0)
+
+    def test_count_matches_select(self):
+        for expression in ('name CA', 'm1 and elem C', 'not hydro',
+                           'm2 within 3 of m1', 'byres name CB'):
+            sele = self.cmd.compile_selection(expression)
+            for state in (0, 1, 2):
+                self.assertEqual(
+                    sele.count(state),
+                    self.cmd.count_atoms(expression, state=state),
+                    (expression, state))
+
+    def test_select(self):
+        sele = self.cmd.compile_selection('name CA')
+        self.assertEqual(sele.select('ca'), 2)
+        self.assertIn('ca', self.cmd.get_names('selections'))
+        self.assertEqual(self.cmd.count_atoms('ca'), 2)
+
+    def test_state_dependent(self):
+        sele = self.cmd.compile_selection('m1 within 3 of m2')
+        self.assertGreater(sele.count(1), 0)
+        self.assertEqual(sele.count(2), 0)
+
+    def test_named_selection_changes(self):
+        self.cmd.select('site', 'm1')
+        sele = self.cmd.compile_selection('site and name CA')
+        self.assertEqual(sele.count(), 1)
+        self.cmd.select('site', 'm1 or m2')
+        self.assertEqual(sele.count(), 2)
+        self.cmd.delete('site')
+        with self.assertRaises(pymol.CmdException):
+            sele.count()
+
+    def test_invalid(self):
+        with self.assertRaises(pymol.CmdException):
+            self.cmd.compile_selection('name CA and (')
+
+
+class TestExplain(PyMOLTestCase):
+
+    def setUp(self):
+        super().setUp()
+        self.cmd.fab('ACDEF', 'pep')
+
+    def maps_built(self, expression):
+        return sum(rec['maps_built']
+                   for rec in self.cmd.explain(expression, quiet=1))
+
+    def test_records(self):
+        r = self.cmd.explain('name CA and resi 2-4', quiet=1)
+        for rec in r:
+            self.assertEqual(set(rec), {'op', 'seconds', 'atoms_in',
+                                        'atoms_out', 'maps_built'})
+            self.assertGreaterEqual(rec['seconds'], 0.0)
+        self.assertEqual([rec['op'] for rec in r[:2]], ['(parse)', '(table)'])
+        self.assertEqual(r[1]['atoms_out'], self.cmd.count_atoms())
+        self.assertGreater(len(r), 2)
+        self.assertEqual(r[-1]['atoms_out'],
+                         self.cmd.count_atoms('name CA and resi 2-4'))
+
+    def test_maps_built(self):
+        expression = 'pep within 4 of (resi 3 and name CA)'
+        # moved coordinates need a new map, which is reused afterwards
+        self.cmd.translate([1.0, 0.0, 0.0], 'pep', camera=0)
+        self.assertGreater(self.maps_built(expression), 0)
+        self.assertEqual(self.maps_built(expression), 0)
+        self.assertEqual(self.maps_built('name CA'), 0)
+
+    def test_invalid(self):
+        with self.assertRaises(pymol.CmdException):
+            self.cmd.explain('name CA and (', quiet=1)
+
+
+if __name__ == '__main__':
+    unittest.main()
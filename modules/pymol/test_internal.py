@@ -0,0 +1,91 @@
+'''
+Tests for the result cache (cache_mode) with the disk tier (cache_dir), see
+_cache_get and _cache_set. They run on a stand-in for cmd, so they don't
+depend on the session's cache.
+
+    python -m unittest pymol.test_internal
+'''
+
+import os
+import tempfile
+import threading
+import types
+import unittest
+
+from pymol import cmd
+from pymol import internal
+
+
+def make_self():
+    return types.SimpleNamespace(lock_api_data=threading.RLock(),
+                                 _pymol=types.SimpleNamespace())
+
+
+def make_entry(inp, output=None):
+    # same layout as CacheCreateEntry in P.cpp
+    return [len(inp), tuple(hash(x) & 0x7FFFFFFF for x in inp), inp,
+            output, 0, 0.0]
+
+
+class TestCacheDisk(unittest.TestCase):
+
+    inp = ('SurfaceJob', 1, (0.5, 1.5, 2.5))
+    out = (1, (0.1, 0.2, 0.3), (0, 0, 1))
+
+    def setUp(self):
+        self._tmpdir = tempfile.TemporaryDirectory()
+        self.disk_dir = self._tmpdir.name
+        self._self = make_self()
+
+    def tearDown(self):
+        self._tmpdir.cleanup()
+
+    def get(self, inp, max_size=0):
+        return internal._cache_get(make_entry(inp), None, self._self,
+                                   self.disk_dir, max_size)
+
+    def set(self, inp, out, disk_max=1):
+        internal._cache_set(make_entry(inp, out), 0, self._self,
+                            self.disk_dir, disk_max)
+
+    def test_disk_hit_is_promoted(self):
+        self.assertIsNone(self.get(self.inp))
+        self.set(self.inp, self.out)
+
+        # empty memory (e.g. new session): read from disk, then from memory
+        internal._cache_clear(self._self)
+        self.assertEqual(self.get(self.inp, 1 << 20), self.out)
+        self.assertEqual(self.get(self.inp, 1 << 20), self.out)
+
+        stats = self._self._pymol._cache_stats
+        self.assertEqual(stats['misses'], 1)
+        self.assertEqual(stats['disk_hits'], 1)
+        self.assertEqual(stats['hits'], 1)
+        self.assertEqual(stats['disk_writes'], 1)
+
+    def test_corrupt_file_is_dropped(self):
+        self.set(self.inp, self.out)
+        path = internal._cache_disk_path(self.disk_dir, self.inp)
+        with open(path, 'wb') as handle:
+            handle.write(b'\x78')
+
+        internal._cache_clear(self._self)
+        self.assertIsNone(self.get(self.inp))
+        self.assertFalse(os.path.exists(path))
+        self.assertEqual(self._self._pymol._cache_stats['misses'], 1)
+
+    def test_lru_eviction(self):
+        # 1 MB limit, the most recent file is kept
+        for i in range(8):
+            self.set(('big', i), (os.urandom(300000),))
+
+        files = internal._cache_disk_files(self.disk_dir)
+        self.assertLessEqual(sum(os.path.getsize(f) for f in files),
+                             1024 * 1024)
+        self.assertGreater(self._self._pymol._cache_stats['disk_evictions'], 0)
+        self.assertTrue(os.path.exists(
+            internal._cache_disk_path(self.disk_dir, ('big', 7))))
+
+
+if __name__ == '__main__':
+    unittest.main()
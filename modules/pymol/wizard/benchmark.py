@@ -1,9 +1,12 @@
 import threading
 from pymol.wizard import Wizard
 from pymol import cmd
+from pymol import util
 import pymol
 import types
 import time
+import json
+import multiprocessing
 
 
 class Benchmark(Wizard):
@@ -333,6 +336,82 @@ class Benchmark(Wizard):
             self.report('RAY_V2_PX%d_TH%02d_HSH%03d'%(width*height,
                                                                       max_threads,hash_max),60*cnt/elapsed)
 
+    # Reproducible ray tracing scenes for the phase benchmark: fixed data,
+    # fixed view and representations, no geometry reuse between frames.
+
+    def ray_scene_small(self):
+        self.cmd.load("$PYMOL_DATA/demo/pept.pdb")
+        self.cmd.hide()
+        self.cmd.show("sticks")
+        self.cmd.show("spheres")
+        self.cmd.set("sphere_scale",0.25)
+
+    def ray_scene_protein(self):
+        self.cmd.load("$PYMOL_DATA/demo/1tii.pdb")
+        self.cmd.hide()
+        self.cmd.show("cartoon")
+        self.cmd.show("surface","chain D")
+        self.cmd.spectrum("count",selection="name ca")
+
+    def ray_scene_assembly(self):
+        self.cmd.load("$PYMOL_DATA/demo/1tii.pdb")
+        self.cmd.symexp("sym","1tii","1tii",5.0)
+        self.cmd.hide()
+        self.cmd.show("spheres")
+        util.cbc(_self=self.cmd)
+
+    def ray_phases(self,filename='',repeat=1,sizes=((640,480),(1600,1200)),
+                   shadows=(0,1),antialias=(0,2),threads=None):
+        '''Ray traces the scenes above under every combination of the
+        given conditions and reports the time of each phase of the ray
+        tracer (see cmd.get_ray_timing) as JSON, to stdout or "filename".
+        Of "repeat" runs, the fastest one is reported.'''
+        if threads is None:
+            threads = sorted(set([1,multiprocessing.cpu_count()]))
+        results = []
+        for scene in ('small','protein','assembly'):
+            self.configure()
+            getattr(self,'ray_scene_'+scene)()
+            self.cmd.orient()
+            self.cmd.turn('x',25)
+            self.cmd.turn('y',25)
+            self.cmd.set('ray_reuse_geometry',0)
+            for (width,height) in sizes:
+                for shadow in shadows:
+                    for aa in antialias:
+                        for n_thread in threads:
+                            self.cmd.set('ray_shadows',shadow)
+                            self.cmd.set('antialias',aa)
+                            self.cmd.set('max_threads',n_thread)
+                            best = None
+                            for i in range(int(repeat)):
+                                self.cmd.ray(width,height,quiet=1)
+                                timing = self.cmd.get_ray_timing()
+                                if best is None or timing['total']<best['total']:
+                                    best = timing
+                            results.append({
+                                'scene' : scene,
+                                'width' : width,
+                                'height' : height,
+                                'shadows' : shadow,
+                                'antialias' : aa,
+                                'threads' : n_thread,
+                                'timing' : best,
+                                })
+                            self.report('RAY_PHASES_%s_PX%d_SH%d_AA%d_TH%02d'%(
+                                scene.upper(),width*height,shadow,aa,n_thread),
+                                best['total'])
+        output = json.dumps({
+            'version' : self.cmd.get_version()[0],
+            'results' : results,
+            },indent=1)
+        if filename:
+            with open(filename,'w') as handle:
+                handle.write(output)
+        else:
+            print(output)
+        return results
+
     def get_prompt(self):
         self.prompt = self.message
         return self.prompt
@@ -364,5 +443,6 @@ class Benchmark(Wizard):
             [ 2, 'Surface Calculation', 'cmd.get_wizard().delay_launch("surface_calculation")'],
             [ 2, 'Mesh Calculation', 'cmd.get_wizard().delay_launch("mesh_calculation")'],
             [ 2, 'Ray Tracing', 'cmd.get_wizard().delay_launch("ray_trace0")'],
+            [ 2, 'Ray Tracing Phases', 'cmd.get_wizard().delay_launch("ray_phases")'],
             [ 2, 'End Demonstration', 'cmd.set_wizard()' ]
             ]